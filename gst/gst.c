@@ -643,6 +643,8 @@ init_post (GOptionContext * context, GOptionGroup * group, gpointer data,
   g_type_class_ref (gst_tag_flag_get_type ());
   g_type_class_ref (gst_tag_scope_get_type ());
   g_type_class_ref (gst_task_pool_get_type ());
+  g_type_class_ref (gst_task_pool_priority_get_type ());
+  g_type_class_ref (gst_task_scheduling_get_type ());
   g_type_class_ref (gst_task_state_get_type ());
   g_type_class_ref (gst_toc_entry_type_get_type ());
   g_type_class_ref (gst_type_find_probability_get_type ());
@@ -1027,6 +1029,8 @@ gst_deinit (void)
   g_type_class_unref (g_type_class_peek (gst_tag_merge_mode_get_type ()));
   g_type_class_unref (g_type_class_peek (gst_tag_flag_get_type ()));
   g_type_class_unref (g_type_class_peek (gst_tag_scope_get_type ()));
+  g_type_class_unref (g_type_class_peek (gst_task_pool_priority_get_type ()));
+  g_type_class_unref (g_type_class_peek (gst_task_scheduling_get_type ()));
   g_type_class_unref (g_type_class_peek (gst_task_state_get_type ()));
   g_type_class_unref (g_type_class_peek (gst_toc_entry_type_get_type ()));
   g_type_class_unref (g_type_class_peek (gst_toc_scope_get_type ()));
@@ -119,12 +119,24 @@ G_GNUC_INTERNAL  void  _priv_gst_value_initialize (void);
 G_GNUC_INTERNAL  void  _priv_gst_debug_init (void);
 G_GNUC_INTERNAL  void  _priv_gst_context_initialize (void);
 
+/* Private meta functions, APIs registered with gst_meta_api_type_register()
+ * get one of the GST_META_API_SLOTS direct lookup slots on a buffer until
+ * they run out */
+#define GST_META_API_SLOTS 8
+
+G_GNUC_INTERNAL
+gint      _priv_gst_meta_api_get_slot (GType api);
+
 /* Private registry functions */
 G_GNUC_INTERNAL
 gboolean _priv_gst_registry_remove_cache_plugins (GstRegistry *registry);
 
 G_GNUC_INTERNAL  void _priv_gst_registry_cleanup (void);
 
+/* Private task pool functions, parses a CPU list like "0-3,8" */
+G_GNUC_INTERNAL
+GArray * _priv_gst_parse_cpu_list (const gchar *str);
+
 gboolean _gst_plugin_loader_client_run (void);
 
 /* Used in GstBin for manual state handling */
@@ -141,11 +153,47 @@ gboolean  priv_gst_structure_append_to_gstring (const GstStructure * structure,
 G_GNUC_INTERNAL
 void priv_gst_caps_features_append_to_gstring (const GstCapsFeatures * features, GString *s);
 
+/* canonical shared feature sets, used in gstcaps.c and gstelementfactory.c */
+G_GNUC_INTERNAL
+GstCapsFeatures * priv_gst_caps_features_intern (GstCapsFeatures * features);
+G_GNUC_INTERNAL
+GstCapsFeatures * priv_gst_caps_features_share (const GstCapsFeatures * features);
+G_GNUC_INTERNAL
+gboolean priv_gst_caps_features_is_interned (const GstCapsFeatures * features);
+
 G_GNUC_INTERNAL
 gboolean priv_gst_structure_parse_name (gchar * str, gchar **start, gchar ** end, gchar ** next);
 G_GNUC_INTERNAL
 gboolean priv_gst_structure_parse_fields (gchar *str, gchar ** end, GstStructure *structure);
 
+/* the parsers work in place on a copy of the string, which is made in a
+ * buffer on the stack when it fits. This only saves the copy of the input,
+ * the parsed values and the structures still allocate as before, there is
+ * no single-pass parser that writes straight into the structures */
+#define PRIV_GST_PARSE_BUFFER_SIZE 2048
+
+G_GNUC_INTERNAL
+gchar * priv_gst_parse_buffer_init (gchar buf[PRIV_GST_PARSE_BUFFER_SIZE], const gchar * string);
+
+/* binary serialization of structures, used by the binary caps format */
+G_GNUC_INTERNAL
+void priv_gst_structure_write_binary (const GstStructure * structure,
+                                      const GstCapsFeatures * features,
+                                      GByteArray * data);
+G_GNUC_INTERNAL
+GstStructure * priv_gst_structure_read_binary (const guint8 ** data, const guint8 * end,
+                                               GstCapsFeatures ** features);
+
+/* binary caps of the static pad templates from the registry */
+G_GNUC_INTERNAL
+void priv_gst_static_caps_set_binary (GstStaticCaps * static_caps, const guint8 * data, gsize size);
+G_GNUC_INTERNAL
+const guint8 * priv_gst_static_caps_get_binary (GstStaticCaps * static_caps, gsize * size);
+
+/* used to recycle the structures of events and queries */
+G_GNUC_INTERNAL
+gboolean priv_gst_structure_reset (GstStructure * structure, GQuark name, guint max_fields);
+
 /* registry cache backends */
 G_GNUC_INTERNAL
 gboolean		priv_gst_registry_binary_read_cache	(GstRegistry * registry, const char *location);
@@ -383,6 +431,8 @@ struct _GstElementFactory {
 
   GList *               interfaces;             /* interface type names this element implements */
 
+  GArray *              template_index;         /* media types of the pad templates, made when first filtered */
+
   /*< private >*/
   gpointer _gst_reserved[GST_PADDING];
 };
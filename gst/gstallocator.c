@@ -45,6 +45,24 @@
 
 #include "gst_private.h"
 #include "gstmemory.h"
+#include "gstmagazine.h"
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#define USE_MMAP_ALLOCATOR 1
+#endif
 
 GST_DEBUG_CATEGORY_STATIC (gst_allocator_debug);
 #define GST_CAT_DEFAULT gst_allocator_debug
@@ -72,6 +90,16 @@ gsize gst_memory_alignment = 0;
 /* the default allocator */
 static GstAllocator *_default_allocator;
 
+/* caches for small sysmem blocks, the first one is for memory without data */
+#define SYSMEM_CACHE_MAX 4096
+static gsize sysmem_cache_sizes[] = { 0, 256, 512, 1024, 2048, SYSMEM_CACHE_MAX };
+static const gchar *sysmem_cache_names[] = { "GstMemorySystem",
+  "GstMemorySystem-256", "GstMemorySystem-512", "GstMemorySystem-1024",
+  "GstMemorySystem-2048", "GstMemorySystem-4096"
+};
+
+static GstMagazineCache *sysmem_caches[G_N_ELEMENTS (sysmem_cache_sizes)];
+
 static GstAllocator *_sysmem_allocator;
 
 /* registered allocators */
@@ -337,6 +365,54 @@ gst_allocator_free (GstAllocator * allocator, GstMemory * memory)
     aclass->free (allocator, memory);
 }
 
+/**
+ * gst_allocator_set_cache_limits:
+ * @magazine_size: the number of blocks a thread caches per magazine, 0
+ *     disables the caches
+ * @depot_size: the number of full magazines each cache keeps for
+ *     redistribution between threads
+ *
+ * Configure the per-thread caches used for #GstBuffer structures, small
+ * memory blocks of the default system memory allocator and the recycled
+ * events and queries of frequently used types. Each thread caches
+ * at most 2 * @magazine_size blocks of each size, the shared depot of each
+ * size at most @depot_size * @magazine_size blocks. Blocks above these limits
+ * are released to the system.
+ *
+ * The caches are disabled when running in valgrind or when G_SLICE is set to
+ * always-malloc.
+ *
+ * Since: 1.2
+ */
+void
+gst_allocator_set_cache_limits (guint magazine_size, guint depot_size)
+{
+  _priv_gst_magazine_set_limits (magazine_size, depot_size);
+}
+
+/**
+ * gst_allocator_get_cache_stats:
+ *
+ * Get the statistics of the per-thread caches configured with
+ * gst_allocator_set_cache_limits(). The returned structure contains the
+ * configuration and a #GstStructure for each cache with the number of "hits",
+ * "misses", depot "exchanges" and "trimmed" blocks. The hits of a thread are
+ * only added when it exchanges a magazine with the depot.
+ *
+ * The caches of recycled events and queries are named after their type, like
+ * "GstEvent-qos" and "GstQuery-position".
+ *
+ * Returns: (transfer full): a #GstStructure with the statistics, free with
+ *     gst_structure_free() after usage.
+ *
+ * Since: 1.2
+ */
+GstStructure *
+gst_allocator_get_cache_stats (void)
+{
+  return _priv_gst_magazine_get_stats ();
+}
+
 /* default memory implementation */
 typedef struct
 {
@@ -359,6 +435,48 @@ typedef struct
   GstAllocatorClass parent_class;
 } GstAllocatorSysmemClass;
 
+/* get the cache for blocks of at least *slice_size bytes and update
+ * *slice_size to the size of the cached blocks. Returns NULL when the blocks
+ * are too big to be cached. */
+static inline GstMagazineCache *
+_sysmem_find_cache (gsize * slice_size)
+{
+  guint i;
+
+  if (*slice_size > SYSMEM_CACHE_MAX)
+    return NULL;
+
+  for (i = 0; i < G_N_ELEMENTS (sysmem_cache_sizes); i++) {
+    if (*slice_size <= sysmem_cache_sizes[i]) {
+      *slice_size = sysmem_cache_sizes[i];
+      return sysmem_caches[i];
+    }
+  }
+  return NULL;
+}
+
+static inline gpointer
+_sysmem_slice_alloc (gsize * slice_size)
+{
+  GstMagazineCache *cache;
+
+  if ((cache = _sysmem_find_cache (slice_size)))
+    return _priv_gst_magazine_cache_alloc (cache);
+
+  return g_slice_alloc (*slice_size);
+}
+
+static inline void
+_sysmem_slice_free (gsize slice_size, gpointer mem)
+{
+  GstMagazineCache *cache;
+
+  if ((cache = _sysmem_find_cache (&slice_size)))
+    _priv_gst_magazine_cache_free (cache, mem);
+  else
+    g_slice_free1 (slice_size, mem);
+}
+
 GType gst_allocator_sysmem_get_type (void);
 G_DEFINE_TYPE (GstAllocatorSysmem, gst_allocator_sysmem, GST_TYPE_ALLOCATOR);
 
@@ -389,7 +507,7 @@ _sysmem_new (GstMemoryFlags flags,
 
   slice_size = sizeof (GstMemorySystem);
 
-  mem = g_slice_alloc (slice_size);
+  mem = _sysmem_slice_alloc (&slice_size);
   _sysmem_init (mem, flags, parent, slice_size,
       data, maxsize, align, offset, size, user_data, notify);
 
@@ -409,10 +527,11 @@ _sysmem_new_block (GstMemoryFlags flags,
   align |= gst_memory_alignment;
   /* allocate more to compensate for alignment */
   maxsize += align;
-  /* alloc header and data in one block */
+  /* alloc header and data in one block, small blocks come from the per-thread
+   * caches and can be a little bigger */
   slice_size = sizeof (GstMemorySystem) + maxsize;
 
-  mem = g_slice_alloc (slice_size);
+  mem = _sysmem_slice_alloc (&slice_size);
   if (mem == NULL)
     return NULL;
 
@@ -534,7 +653,7 @@ default_free (GstAllocator * allocator, GstMemory * mem)
   memset (mem, 0xff, sizeof (GstMemorySystem));
 #endif
 
-  g_slice_free1 (slice_size, mem);
+  _sysmem_slice_free (slice_size, mem);
 }
 
 static void
@@ -573,9 +692,535 @@ gst_allocator_sysmem_init (GstAllocatorSysmem * allocator)
   alloc->mem_is_span = (GstMemoryIsSpanFunction) _sysmem_is_span;
 }
 
+#ifdef USE_MMAP_ALLOCATOR
+/* memory backed by anonymous mmap regions */
+typedef struct
+{
+  GstMemory mem;
+
+  /* the mapped region, only set on the parent */
+  gpointer area;
+  gsize area_size;
+  guint8 *data;
+} GstMemoryMmap;
+
+typedef struct
+{
+  GstAllocator parent;
+
+  gboolean prefault;
+} GstAllocatorMmap;
+
+typedef struct
+{
+  GstAllocatorClass parent_class;
+} GstAllocatorMmapClass;
+
+/* regions of at least this size are placed in huge pages */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+static gsize page_size;
+
+GType gst_allocator_mmap_get_type (void);
+G_DEFINE_TYPE (GstAllocatorMmap, gst_allocator_mmap, GST_TYPE_ALLOCATOR);
+
+static GstAllocator *_mmap_allocator;
+static GstAllocator *_mmap_prefault_allocator;
+
+/* data of empty regions, they are not mapped */
+static guint8 _mmap_empty_data[1];
+
+static gpointer
+_mmap_area_alloc (gsize * area_size, gboolean prefault)
+{
+  gpointer area;
+  gint flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  gsize size;
+
+#ifdef MAP_POPULATE
+  if (prefault)
+    flags |= MAP_POPULATE;
+#endif
+
+#ifdef MAP_HUGETLB
+  /* try the reserved huge pages first, there are usually none configured
+   * so fall back to normal pages when this fails */
+  if (*area_size >= HUGE_PAGE_SIZE) {
+    size = (*area_size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    area = mmap (NULL, size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB,
+        -1, 0);
+    if (area != MAP_FAILED) {
+      GST_CAT_LOG (GST_CAT_MEMORY, "mapped %" G_GSIZE_FORMAT
+          " bytes in huge pages", size);
+      *area_size = size;
+      return area;
+    }
+  }
+#endif
+
+  size = (*area_size + page_size - 1) & ~(page_size - 1);
+  area = mmap (NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (area == MAP_FAILED) {
+    GST_CAT_WARNING (GST_CAT_MEMORY, "failed to map %" G_GSIZE_FORMAT
+        " bytes: %s", size, g_strerror (errno));
+    return NULL;
+  }
+
+#ifdef MADV_HUGEPAGE
+  /* let the kernel use transparent huge pages when it can */
+  if (size >= HUGE_PAGE_SIZE)
+    madvise (area, size, MADV_HUGEPAGE);
+#endif
+
+#ifndef MAP_POPULATE
+  if (prefault) {
+    gsize i;
+
+    for (i = 0; i < size; i += page_size)
+      ((volatile guint8 *) area)[i] = 0;
+  }
+#endif
+
+  *area_size = size;
+
+  return area;
+}
+
+static inline void
+_mmap_init (GstMemoryMmap * mem, GstAllocator * allocator,
+    GstMemoryFlags flags, GstMemory * parent, gpointer area, gsize area_size,
+    guint8 * data, gsize maxsize, gsize align, gsize offset, gsize size)
+{
+  gst_memory_init (GST_MEMORY_CAST (mem),
+      flags, allocator, parent, maxsize, align, offset, size);
+
+  mem->area = area;
+  mem->area_size = area_size;
+  mem->data = data;
+}
+
+static GstMemoryMmap *
+_mmap_new_block (GstAllocator * allocator, GstMemoryFlags flags,
+    gsize maxsize, gsize align, gsize offset, gsize size)
+{
+  GstMemoryMmap *mem;
+  gpointer area;
+  gsize area_size, aoffset;
+  guint8 *data;
+
+  align |= gst_memory_alignment;
+
+  /* mmap() fails for 0 bytes, give empty memory that is not mapped */
+  if (G_UNLIKELY (maxsize == 0)) {
+    mem = g_slice_new (GstMemoryMmap);
+    _mmap_init (mem, allocator, flags, NULL, NULL, 0, _mmap_empty_data, 0,
+        align, 0, 0);
+    return mem;
+  }
+
+  /* regions are page aligned, only bigger alignments need extra space */
+  area_size = maxsize;
+  if (align >= page_size)
+    area_size += align;
+
+  area = _mmap_area_alloc (&area_size,
+      ((GstAllocatorMmap *) allocator)->prefault);
+  if (area == NULL)
+    return NULL;
+
+  data = area;
+  if ((aoffset = ((guintptr) data & align)))
+    data += (align + 1) - aoffset;
+
+  /* use all of the region, anonymous mappings are zero filled so the prefix
+   * and padding don't need to be cleared */
+  maxsize = area_size - (data - (guint8 *) area);
+
+  mem = g_slice_new (GstMemoryMmap);
+  _mmap_init (mem, allocator, flags, NULL, area, area_size, data, maxsize,
+      align, offset, size);
+
+  return mem;
+}
+
+static gpointer
+_mmap_map (GstMemoryMmap * mem, gsize maxsize, GstMapFlags flags)
+{
+  return mem->data;
+}
+
+static gboolean
+_mmap_unmap (GstMemoryMmap * mem)
+{
+  return TRUE;
+}
+
+static GstMemoryMmap *
+_mmap_copy (GstMemoryMmap * mem, gssize offset, gsize size)
+{
+  GstMemoryMmap *copy;
+
+  if (size == -1)
+    size = mem->mem.size > offset ? mem->mem.size - offset : 0;
+
+  copy = _mmap_new_block (mem->mem.allocator, 0, mem->mem.maxsize,
+      mem->mem.align, mem->mem.offset + offset, size);
+  if (copy == NULL)
+    return NULL;
+
+  GST_CAT_DEBUG (GST_CAT_PERFORMANCE,
+      "memcpy %" G_GSIZE_FORMAT " memory %p -> %p", mem->mem.maxsize, mem,
+      copy);
+  memcpy (copy->data, mem->data, mem->mem.maxsize);
+
+  return copy;
+}
+
+static GstMemoryMmap *
+_mmap_share (GstMemoryMmap * mem, gssize offset, gsize size)
+{
+  GstMemoryMmap *sub;
+  GstMemory *parent;
+
+  if ((parent = mem->mem.parent) == NULL)
+    parent = (GstMemory *) mem;
+
+  if (size == -1)
+    size = mem->mem.size - offset;
+
+  sub = g_slice_new (GstMemoryMmap);
+  _mmap_init (sub, mem->mem.allocator, GST_MINI_OBJECT_FLAGS (parent) |
+      GST_MINI_OBJECT_FLAG_LOCK_READONLY, parent, NULL, 0, mem->data,
+      mem->mem.maxsize, mem->mem.align, mem->mem.offset + offset, size);
+
+  return sub;
+}
+
+static gboolean
+_mmap_is_span (GstMemoryMmap * mem1, GstMemoryMmap * mem2, gsize * offset)
+{
+  if (offset) {
+    GstMemoryMmap *parent;
+
+    parent = (GstMemoryMmap *) mem1->mem.parent;
+
+    *offset = mem1->mem.offset - parent->mem.offset;
+  }
+
+  return mem1->data + mem1->mem.offset + mem1->mem.size ==
+      mem2->data + mem2->mem.offset;
+}
+
+static GstMemory *
+mmap_alloc (GstAllocator * allocator, gsize size, GstAllocationParams * params)
+{
+  gsize maxsize = size + params->prefix + params->padding;
+
+  return (GstMemory *) _mmap_new_block (allocator, params->flags,
+      maxsize, params->align, params->prefix, size);
+}
+
+static void
+mmap_free (GstAllocator * allocator, GstMemory * mem)
+{
+  GstMemoryMmap *mmem = (GstMemoryMmap *) mem;
+
+  if (mmem->area)
+    munmap (mmem->area, mmem->area_size);
+
+  g_slice_free (GstMemoryMmap, mmem);
+}
+
+static void
+gst_allocator_mmap_class_init (GstAllocatorMmapClass * klass)
+{
+  GstAllocatorClass *allocator_class = (GstAllocatorClass *) klass;
+
+  allocator_class->alloc = mmap_alloc;
+  allocator_class->free = mmap_free;
+}
+
+static void
+gst_allocator_mmap_init (GstAllocatorMmap * allocator)
+{
+  GstAllocator *alloc = GST_ALLOCATOR_CAST (allocator);
+
+  GST_CAT_DEBUG (GST_CAT_MEMORY, "init allocator %p", allocator);
+
+  alloc->mem_type = GST_ALLOCATOR_MMAP;
+  alloc->mem_map = (GstMemoryMapFunction) _mmap_map;
+  alloc->mem_unmap = (GstMemoryUnmapFunction) _mmap_unmap;
+  alloc->mem_copy = (GstMemoryCopyFunction) _mmap_copy;
+  alloc->mem_share = (GstMemoryShareFunction) _mmap_share;
+  alloc->mem_is_span = (GstMemoryIsSpanFunction) _mmap_is_span;
+}
+
+/* memory in a memfd, or an unlinked temporary file when memfd is not
+ * available, that can be passed to other processes */
+typedef struct
+{
+  GstMemory mem;
+
+  /* the fd and the mapping, owned by the parent */
+  gint fd;
+  gpointer area;
+  gsize area_size;
+  guint8 *data;
+} GstMemoryFd;
+
+typedef struct
+{
+  GstAllocator parent;
+} GstAllocatorMemfd;
+
+typedef struct
+{
+  GstAllocatorClass parent_class;
+} GstAllocatorMemfdClass;
+
+GType gst_allocator_memfd_get_type (void);
+G_DEFINE_TYPE (GstAllocatorMemfd, gst_allocator_memfd, GST_TYPE_ALLOCATOR);
+
+static GstAllocator *_memfd_allocator;
+
+static gint
+_memfd_create (void)
+{
+  gchar *name;
+  gint fd;
+
+#if defined(__linux__) && defined(SYS_memfd_create)
+  fd = syscall (SYS_memfd_create, "gst-memfd", MFD_CLOEXEC);
+  if (fd >= 0)
+    return fd;
+#endif
+
+  fd = g_file_open_tmp ("gst-memfd-XXXXXX", &name, NULL);
+  if (fd >= 0) {
+    unlink (name);
+    g_free (name);
+    /* don't leak the memory into child processes */
+    fcntl (fd, F_SETFD, FD_CLOEXEC);
+  }
+  return fd;
+}
+
+static inline void
+_fdmem_init (GstMemoryFd * mem, GstAllocator * allocator,
+    GstMemoryFlags flags, GstMemory * parent, gint fd, gpointer area,
+    gsize area_size, gsize maxsize, gsize align, gsize offset, gsize size)
+{
+  gst_memory_init (GST_MEMORY_CAST (mem),
+      flags, allocator, parent, maxsize, align, offset, size);
+
+  mem->fd = fd;
+  mem->area = area;
+  mem->area_size = area_size;
+  /* the data always starts at the start of the fd */
+  mem->data = area;
+}
+
+/* map the first maxsize bytes of fd, takes ownership of fd */
+static GstMemoryFd *
+_fdmem_new (GstAllocator * allocator, GstMemoryFlags flags, gint fd,
+    gsize maxsize, gsize align, gsize offset, gsize size)
+{
+  GstMemoryFd *mem;
+  gpointer area;
+  gsize area_size;
+  gint prot;
+
+  /* readonly memory is usually shared with another process, make sure we
+   * can't write to it */
+  if (flags & GST_MEMORY_FLAG_READONLY)
+    prot = PROT_READ;
+  else
+    prot = PROT_READ | PROT_WRITE;
+
+  /* mmap fails for 0 bytes, empty memory gets a page that is never read */
+  area_size = (MAX (maxsize, 1) + page_size - 1) & ~(page_size - 1);
+  area = mmap (NULL, area_size, prot, MAP_SHARED, fd, 0);
+  if (area == MAP_FAILED)
+    goto map_failed;
+
+  mem = g_slice_new (GstMemoryFd);
+  _fdmem_init (mem, allocator, flags, NULL, fd, area, area_size, maxsize,
+      align, offset, size);
+
+  return mem;
+
+map_failed:
+  {
+    GST_CAT_WARNING (GST_CAT_MEMORY, "failed to map fd %d: %s", fd,
+        g_strerror (errno));
+    close (fd);
+    return NULL;
+  }
+}
+
+static GstMemoryFd *
+_fdmem_new_block (GstAllocator * allocator, GstMemoryFlags flags,
+    gsize maxsize, gsize align, gsize offset, gsize size)
+{
+  gint fd;
+
+  /* the mapping is page aligned, bigger alignments are not possible because
+   * the data has to start at the start of the fd */
+  align |= gst_memory_alignment;
+  if (align >= page_size) {
+    GST_CAT_WARNING (GST_CAT_MEMORY, "alignment %" G_GSIZE_FORMAT
+        " is bigger than the page size", align);
+    return NULL;
+  }
+
+  if ((fd = _memfd_create ()) < 0)
+    goto create_failed;
+
+  /* the new file is filled with 0 */
+  if (ftruncate (fd, maxsize) < 0)
+    goto truncate_failed;
+
+  return _fdmem_new (allocator, flags, fd, maxsize, align, offset, size);
+
+  /* ERRORS */
+create_failed:
+  {
+    GST_CAT_WARNING (GST_CAT_MEMORY, "failed to create memfd: %s",
+        g_strerror (errno));
+    return NULL;
+  }
+truncate_failed:
+  {
+    GST_CAT_WARNING (GST_CAT_MEMORY, "failed to resize memfd to %"
+        G_GSIZE_FORMAT ": %s", maxsize, g_strerror (errno));
+    close (fd);
+    return NULL;
+  }
+}
+
+static gpointer
+_fdmem_map (GstMemoryFd * mem, gsize maxsize, GstMapFlags flags)
+{
+  return mem->data;
+}
+
+static gboolean
+_fdmem_unmap (GstMemoryFd * mem)
+{
+  return TRUE;
+}
+
+static GstMemoryFd *
+_fdmem_copy (GstMemoryFd * mem, gssize offset, gsize size)
+{
+  GstMemoryFd *copy;
+
+  if (size == -1)
+    size = mem->mem.size > offset ? mem->mem.size - offset : 0;
+
+  copy = _fdmem_new_block (_memfd_allocator, 0, mem->mem.maxsize,
+      mem->mem.align, mem->mem.offset + offset, size);
+  if (copy == NULL)
+    return NULL;
+
+  GST_CAT_DEBUG (GST_CAT_PERFORMANCE,
+      "memcpy %" G_GSIZE_FORMAT " memory %p -> %p", mem->mem.maxsize, mem,
+      copy);
+  memcpy (copy->data, mem->data, mem->mem.maxsize);
+
+  return copy;
+}
+
+static GstMemoryFd *
+_fdmem_share (GstMemoryFd * mem, gssize offset, gsize size)
+{
+  GstMemoryFd *sub;
+  GstMemory *parent;
+
+  if ((parent = mem->mem.parent) == NULL)
+    parent = (GstMemory *) mem;
+
+  if (size == -1)
+    size = mem->mem.size - offset;
+
+  /* the sub memory uses the fd and mapping of the parent */
+  sub = g_slice_new (GstMemoryFd);
+  _fdmem_init (sub, mem->mem.allocator, GST_MINI_OBJECT_FLAGS (parent) |
+      GST_MINI_OBJECT_FLAG_LOCK_READONLY, parent, mem->fd, NULL, 0,
+      mem->mem.maxsize, mem->mem.align, mem->mem.offset + offset, size);
+  sub->data = mem->data;
+
+  return sub;
+}
+
+static gboolean
+_fdmem_is_span (GstMemoryFd * mem1, GstMemoryFd * mem2, gsize * offset)
+{
+  if (offset) {
+    GstMemoryFd *parent;
+
+    parent = (GstMemoryFd *) mem1->mem.parent;
+
+    *offset = mem1->mem.offset - parent->mem.offset;
+  }
+
+  return mem1->data + mem1->mem.offset + mem1->mem.size ==
+      mem2->data + mem2->mem.offset;
+}
+
+static GstMemory *
+memfd_alloc (GstAllocator * allocator, gsize size,
+    GstAllocationParams * params)
+{
+  gsize maxsize = size + params->prefix + params->padding;
+
+  return (GstMemory *) _fdmem_new_block (allocator, params->flags,
+      maxsize, params->align, params->prefix, size);
+}
+
+static void
+memfd_free (GstAllocator * allocator, GstMemory * mem)
+{
+  GstMemoryFd *fmem = (GstMemoryFd *) mem;
+
+  if (fmem->area) {
+    munmap (fmem->area, fmem->area_size);
+    close (fmem->fd);
+  }
+
+  g_slice_free (GstMemoryFd, fmem);
+}
+
+static void
+gst_allocator_memfd_class_init (GstAllocatorMemfdClass * klass)
+{
+  GstAllocatorClass *allocator_class = (GstAllocatorClass *) klass;
+
+  allocator_class->alloc = memfd_alloc;
+  allocator_class->free = memfd_free;
+}
+
+static void
+gst_allocator_memfd_init (GstAllocatorMemfd * allocator)
+{
+  GstAllocator *alloc = GST_ALLOCATOR_CAST (allocator);
+
+  GST_CAT_DEBUG (GST_CAT_MEMORY, "init allocator %p", allocator);
+
+  alloc->mem_type = GST_ALLOCATOR_MEMFD;
+  alloc->mem_map = (GstMemoryMapFunction) _fdmem_map;
+  alloc->mem_unmap = (GstMemoryUnmapFunction) _fdmem_unmap;
+  alloc->mem_copy = (GstMemoryCopyFunction) _fdmem_copy;
+  alloc->mem_share = (GstMemoryShareFunction) _fdmem_share;
+  alloc->mem_is_span = (GstMemoryIsSpanFunction) _fdmem_is_span;
+}
+#endif /* USE_MMAP_ALLOCATOR */
+
 void
 _priv_gst_memory_initialize (void)
 {
+  guint i;
+
   g_rw_lock_init (&lock);
   allocators = g_hash_table_new (g_str_hash, g_str_equal);
 
@@ -588,12 +1233,38 @@ _priv_gst_memory_initialize (void)
   GST_CAT_DEBUG (GST_CAT_MEMORY, "memory alignment: %" G_GSIZE_FORMAT,
       gst_memory_alignment);
 
+  sysmem_cache_sizes[0] = sizeof (GstMemorySystem);
+  for (i = 0; i < G_N_ELEMENTS (sysmem_cache_sizes); i++)
+    sysmem_caches[i] = _priv_gst_magazine_cache_new (sysmem_cache_names[i],
+        sysmem_cache_sizes[i]);
+
   _sysmem_allocator = g_object_new (gst_allocator_sysmem_get_type (), NULL);
 
   gst_allocator_register (GST_ALLOCATOR_SYSMEM,
       gst_object_ref (_sysmem_allocator));
 
   _default_allocator = gst_object_ref (_sysmem_allocator);
+
+#ifdef USE_MMAP_ALLOCATOR
+#ifdef HAVE_GETPAGESIZE
+  page_size = getpagesize ();
+#else
+  page_size = sysconf (_SC_PAGESIZE);
+#endif
+
+  _mmap_allocator = g_object_new (gst_allocator_mmap_get_type (), NULL);
+  gst_allocator_register (GST_ALLOCATOR_MMAP, gst_object_ref (_mmap_allocator));
+
+  _mmap_prefault_allocator =
+      g_object_new (gst_allocator_mmap_get_type (), NULL);
+  ((GstAllocatorMmap *) _mmap_prefault_allocator)->prefault = TRUE;
+  gst_allocator_register (GST_ALLOCATOR_MMAP_PREFAULT,
+      gst_object_ref (_mmap_prefault_allocator));
+
+  _memfd_allocator = g_object_new (gst_allocator_memfd_get_type (), NULL);
+  gst_allocator_register (GST_ALLOCATOR_MEMFD,
+      gst_object_ref (_memfd_allocator));
+#endif
 }
 
 /**
@@ -630,3 +1301,74 @@ gst_memory_new_wrapped (GstMemoryFlags flags, gpointer data,
 
   return (GstMemory *) mem;
 }
+
+/**
+ * gst_memory_new_fd:
+ * @flags: #GstMemoryFlags
+ * @fd: a file descriptor
+ * @maxsize: the number of bytes of @fd to use
+ * @offset: offset of the valid data in @fd
+ * @size: size of valid data
+ *
+ * Make a new memory that maps the first @maxsize bytes of @fd, usually a fd
+ * that was received from another process after gst_memory_get_fd(). The
+ * memory takes ownership of @fd and closes it when it is freed.
+ *
+ * The memory is shared with all other users of @fd, writes of other processes
+ * are visible in the memory.
+ *
+ * Returns: (transfer full): a new #GstMemory or %NULL when @fd could not be
+ *     mapped or when the platform doesn't support this.
+ *
+ * Since: 1.2
+ */
+GstMemory *
+gst_memory_new_fd (GstMemoryFlags flags, gint fd, gsize maxsize,
+    gsize offset, gsize size)
+{
+  g_return_val_if_fail (fd >= 0, NULL);
+  g_return_val_if_fail (offset + size <= maxsize, NULL);
+
+#ifdef USE_MMAP_ALLOCATOR
+  return (GstMemory *) _fdmem_new (_memfd_allocator, flags, fd, maxsize,
+      0, offset, size);
+#else
+  return NULL;
+#endif
+}
+
+/**
+ * gst_memory_get_fd:
+ * @mem: a #GstMemory
+ * @offset: (out) (allow-none): the offset of the data of @mem in the fd
+ *
+ * Get the file descriptor that backs @mem. Only memory from the
+ * #GST_ALLOCATOR_MEMFD allocator, the memory from gst_memory_new_fd() and the
+ * memory shared from those has a file descriptor.
+ *
+ * The fd remains owned by @mem and is only valid as long as @mem is alive,
+ * it can be passed to other processes, which can use gst_memory_new_fd() to
+ * access the memory without copies.
+ *
+ * Returns: the file descriptor of @mem or -1 when @mem has none.
+ *
+ * Since: 1.2
+ */
+gint
+gst_memory_get_fd (GstMemory * mem, gsize * offset)
+{
+  g_return_val_if_fail (mem != NULL, -1);
+
+#ifdef USE_MMAP_ALLOCATOR
+  if (mem->allocator == NULL
+      || G_OBJECT_TYPE (mem->allocator) != gst_allocator_memfd_get_type ())
+    return -1;
+
+  if (offset)
+    *offset = mem->offset;
+
+  return ((GstMemoryFd *) mem)->fd;
+#else
+  return -1;
+#endif
+}
@@ -24,6 +24,7 @@
 #define __GST_ALLOCATOR_H__
 
 #include <gst/gstmemory.h>
+#include <gst/gststructure.h>
 
 G_BEGIN_DECLS
 
@@ -58,6 +59,39 @@ GST_EXPORT gsize gst_memory_alignment;
  */
 #define GST_ALLOCATOR_SYSMEM   "SystemMemory"
 
+/**
+ * GST_ALLOCATOR_MMAP:
+ *
+ * The allocator name for the allocator that places each memory in its own
+ * anonymous mmap region. Big regions use huge pages when the system has them
+ * available. The allocator is not available on platforms without mmap().
+ *
+ * Since: 1.2
+ */
+#define GST_ALLOCATOR_MMAP          "MmapMemory"
+
+/**
+ * GST_ALLOCATOR_MMAP_PREFAULT:
+ *
+ * The allocator name for a #GST_ALLOCATOR_MMAP allocator that faults in all
+ * pages of the region when the memory is allocated, so that the first writes
+ * to the memory don't take page faults.
+ *
+ * Since: 1.2
+ */
+#define GST_ALLOCATOR_MMAP_PREFAULT "MmapMemoryPrefault"
+
+/**
+ * GST_ALLOCATOR_MEMFD:
+ *
+ * The allocator name for the allocator of memory that is backed by a file
+ * descriptor, see gst_memory_get_fd(). The allocator is not available on
+ * platforms without mmap().
+ *
+ * Since: 1.2
+ */
+#define GST_ALLOCATOR_MEMFD         "MemfdMemory"
+
 /**
  * GstAllocationParams:
  * @flags: flags to control allocation
@@ -150,10 +184,19 @@ GstMemory *    gst_allocator_alloc           (GstAllocator * allocator, gsize si
                                               GstAllocationParams *params);
 void           gst_allocator_free            (GstAllocator * allocator, GstMemory *memory);
 
+/* per-thread block caches */
+void           gst_allocator_set_cache_limits (guint magazine_size, guint depot_size);
+GstStructure * gst_allocator_get_cache_stats  (void);
+
 GstMemory *    gst_memory_new_wrapped  (GstMemoryFlags flags, gpointer data, gsize maxsize,
                                         gsize offset, gsize size, gpointer user_data,
                                         GDestroyNotify notify);
 
+/* fd backed memory */
+GstMemory *    gst_memory_new_fd       (GstMemoryFlags flags, gint fd, gsize maxsize,
+                                        gsize offset, gsize size);
+gint           gst_memory_get_fd       (GstMemory *mem, gsize *offset);
+
 G_END_DECLS
 
 #endif /* __GST_ALLOCATOR_H__ */
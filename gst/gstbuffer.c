@@ -124,9 +124,13 @@
 #include "gstinfo.h"
 #include "gstutils.h"
 #include "gstversion.h"
+#include "gstmagazine.h"
 
 GType _gst_buffer_type = 0;
 
+/* per-thread cache for GstBufferImpl structures */
+static GstMagazineCache *_gst_buffer_cache = NULL;
+
 typedef struct _GstMetaItem GstMetaItem;
 
 struct _GstMetaItem
@@ -135,15 +139,23 @@ struct _GstMetaItem
   GstMeta meta;
 };
 #define ITEM_SIZE(info) ((info)->size + sizeof (GstMetaItem))
+#define ITEM_ALIGN(size) (((size) + G_MEM_ALIGN - 1) & ~(G_MEM_ALIGN - 1))
 
 #define GST_BUFFER_MEM_MAX         16
+#define GST_BUFFER_META_ARENA_SIZE 256
 
 #define GST_BUFFER_SLICE_SIZE(b)   (((GstBufferImpl *)(b))->slice_size)
 #define GST_BUFFER_MEM_LEN(b)      (((GstBufferImpl *)(b))->len)
+#define GST_BUFFER_MEM_SIZE(b)     (((GstBufferImpl *)(b))->mem_size)
 #define GST_BUFFER_MEM_ARRAY(b)    (((GstBufferImpl *)(b))->mem)
+#define GST_BUFFER_MEM_INLINE(b)   (((GstBufferImpl *)(b))->mem_inline)
 #define GST_BUFFER_MEM_PTR(b,i)    (((GstBufferImpl *)(b))->mem[i])
 #define GST_BUFFER_BUFMEM(b)       (((GstBufferImpl *)(b))->bufmem)
 #define GST_BUFFER_META(b)         (((GstBufferImpl *)(b))->item)
+#define GST_BUFFER_META_SLOT_MASK(b) (((GstBufferImpl *)(b))->slot_mask)
+#define GST_BUFFER_META_SLOT(b,i)  (((GstBufferImpl *)(b))->slot[i])
+#define GST_BUFFER_META_ARENA(b)   (((GstBufferImpl *)(b))->arena.data)
+#define GST_BUFFER_META_ARENA_USED(b) (((GstBufferImpl *)(b))->arena_used)
 
 typedef struct
 {
@@ -151,18 +163,115 @@ typedef struct
 
   gsize slice_size;
 
-  /* the memory blocks */
+  /* the memory blocks, mem points to mem_inline until more than
+   * GST_BUFFER_MEM_MAX blocks are added, then to an allocated array of
+   * mem_size entries */
   guint len;
-  GstMemory *mem[GST_BUFFER_MEM_MAX];
+  guint mem_size;
+  GstMemory **mem;
+  GstMemory *mem_inline[GST_BUFFER_MEM_MAX];
 
   /* memory of the buffer when allocated from 1 chunk */
   GstMemory *bufmem;
 
-  /* FIXME, make metadata allocation more efficient by using part of the
-   * GstBufferImpl */
+  /* the list of metadata, most recently added first */
   GstMetaItem *item;
+
+  /* when bit i of slot_mask is set, slot[i] is the first metadata in the
+   * list for the API with lookup slot i */
+  guint slot_mask;
+  GstMeta *slot[GST_META_API_SLOTS];
+
+  /* metadata items are allocated from the arena until it is full. Space is
+   * given back when the last item of the arena is removed or when the list of
+   * metadata becomes empty */
+  guint arena_used;
+  union
+  {
+    guint8 data[GST_BUFFER_META_ARENA_SIZE];
+    gdouble align_d;
+    gint64 align_i;
+    gpointer align_p;
+  } arena;
 } GstBufferImpl;
 
+static inline GstMetaItem *
+_meta_item_alloc (GstBuffer * buffer, gsize size)
+{
+  guint used = GST_BUFFER_META_ARENA_USED (buffer);
+  gsize asize = ITEM_ALIGN (size);
+
+  if (G_LIKELY (asize <= GST_BUFFER_META_ARENA_SIZE - used)) {
+    GST_BUFFER_META_ARENA_USED (buffer) = used + asize;
+    return (GstMetaItem *) (GST_BUFFER_META_ARENA (buffer) + used);
+  }
+  return g_slice_alloc (size);
+}
+
+static inline gboolean
+_meta_item_in_arena (GstBuffer * buffer, GstMetaItem * item)
+{
+  guint8 *arena = GST_BUFFER_META_ARENA (buffer);
+
+  return (guint8 *) item >= arena &&
+      (guint8 *) item < arena + GST_BUFFER_META_ARENA_SIZE;
+}
+
+static inline void
+_meta_item_free (GstBuffer * buffer, GstMetaItem * item, gsize size)
+{
+  if (_meta_item_in_arena (buffer, item)) {
+    guint8 *arena = GST_BUFFER_META_ARENA (buffer);
+    guint used = GST_BUFFER_META_ARENA_USED (buffer);
+
+    if ((guint8 *) item + ITEM_ALIGN (size) == arena + used)
+      GST_BUFFER_META_ARENA_USED (buffer) = used - ITEM_ALIGN (size);
+  } else {
+    g_slice_free1 (size, item);
+  }
+}
+
+/* unlink @walk from the list of metadata of @buffer, @prev is the item before
+ * @walk or NULL when @walk is the first item. */
+static void
+_meta_item_remove (GstBuffer * buffer, GstMetaItem * walk, GstMetaItem * prev)
+{
+  GstMeta *meta = &walk->meta;
+  const GstMetaInfo *info = meta->info;
+  gint slot;
+
+  /* remove from list */
+  if (prev == NULL)
+    GST_BUFFER_META (buffer) = walk->next;
+  else
+    prev->next = walk->next;
+
+  /* move the lookup slot to the next metadata of the same API, there can only
+   * be metadata of the API after @walk in the list */
+  slot = _priv_gst_meta_api_get_slot (info->api);
+  if (slot >= 0 && GST_BUFFER_META_SLOT (buffer, slot) == meta) {
+    GstMetaItem *next;
+
+    for (next = walk->next; next; next = next->next)
+      if (next->meta.info->api == info->api)
+        break;
+
+    if (next)
+      GST_BUFFER_META_SLOT (buffer, slot) = &next->meta;
+    else
+      GST_BUFFER_META_SLOT_MASK (buffer) &= ~(1u << slot);
+  }
+
+  /* call free_func if any */
+  if (info->free_func)
+    info->free_func (meta, buffer);
+
+  /* and free the item */
+  _meta_item_free (buffer, walk, ITEM_SIZE (info));
+
+  if (GST_BUFFER_META (buffer) == NULL)
+    GST_BUFFER_META_ARENA_USED (buffer) = 0;
+}
 
 static gboolean
 _is_span (GstMemory ** mem, gsize len, gsize * poffset, GstMemory ** parent)
@@ -288,6 +397,27 @@ _replace_memory (GstBuffer * buffer, guint len, guint idx, guint length,
   GST_BUFFER_MEM_LEN (buffer) = len - length;
 }
 
+/* make room for more memory blocks than fit in the inline array. The
+ * pointers are moved to an allocated array, no memory is merged or copied. */
+static void
+_memory_array_grow (GstBuffer * buffer)
+{
+  guint size = GST_BUFFER_MEM_SIZE (buffer) * 2;
+
+  GST_CAT_DEBUG (GST_CAT_PERFORMANCE, "memory array overflow in buffer %p, "
+      "grow to %u", buffer, size);
+
+  if (GST_BUFFER_MEM_ARRAY (buffer) == GST_BUFFER_MEM_INLINE (buffer)) {
+    GST_BUFFER_MEM_ARRAY (buffer) = g_new (GstMemory *, size);
+    memcpy (GST_BUFFER_MEM_ARRAY (buffer), GST_BUFFER_MEM_INLINE (buffer),
+        GST_BUFFER_MEM_LEN (buffer) * sizeof (gpointer));
+  } else {
+    GST_BUFFER_MEM_ARRAY (buffer) =
+        g_renew (GstMemory *, GST_BUFFER_MEM_ARRAY (buffer), size);
+  }
+  GST_BUFFER_MEM_SIZE (buffer) = size;
+}
+
 static inline void
 _memory_add (GstBuffer * buffer, gint idx, GstMemory * mem, gboolean lock)
 {
@@ -296,23 +426,14 @@ _memory_add (GstBuffer * buffer, gint idx, GstMemory * mem, gboolean lock)
   GST_CAT_LOG (GST_CAT_BUFFER, "buffer %p, idx %d, mem %p, lock %d", buffer,
       idx, mem, lock);
 
-  if (G_UNLIKELY (len >= GST_BUFFER_MEM_MAX)) {
-    /* too many buffer, span them. */
-    /* FIXME, there is room for improvement here: We could only try to merge
-     * 2 buffers to make some room. If we can't efficiently merge 2 buffers we
-     * could try to only merge the two smallest buffers to avoid memcpy, etc. */
-    GST_CAT_DEBUG (GST_CAT_PERFORMANCE, "memory array overflow in buffer %p",
-        buffer);
-    _replace_memory (buffer, len, 0, len, _get_merged_memory (buffer, 0, len));
-    /* we now have 1 single spanned buffer */
-    len = 1;
-  }
+  if (G_UNLIKELY (len >= GST_BUFFER_MEM_SIZE (buffer)))
+    _memory_array_grow (buffer);
 
   if (idx == -1)
     idx = len;
 
   for (i = len; i > idx; i--) {
-    /* move buffers to insert, FIXME, we need to insert first and then merge */
+    /* move buffers to insert */
     GST_BUFFER_MEM_PTR (buffer, i) = GST_BUFFER_MEM_PTR (buffer, i - 1);
   }
   /* and insert the new buffer */
@@ -328,18 +449,23 @@ void
 _priv_gst_buffer_initialize (void)
 {
   _gst_buffer_type = gst_buffer_get_type ();
+
+  _gst_buffer_cache = _priv_gst_magazine_cache_new ("GstBuffer",
+      sizeof (GstBufferImpl));
 }
 
 /**
  * gst_buffer_get_max_memory:
  *
- * Get the maximum amount of memory blocks that a buffer can hold. This is a
- * compile time constant that can be queried with the function.
+ * Get the amount of memory blocks that a buffer can hold without allocating
+ * extra storage. This is a compile time constant that can be queried with the
+ * function.
  *
- * When more memory blocks are added, existing memory blocks will be merged
- * together to make room for the new block.
+ * When more memory blocks are added, the buffer stores them in an allocated
+ * array. The memory blocks are not merged until a mapping of more than one
+ * memory block is requested.
  *
- * Returns: the maximum amount of memory blocks that a buffer can hold.
+ * Returns: the amount of memory blocks that a buffer can hold inline.
  *
  * Since: 1.2.0
  */
@@ -485,20 +611,19 @@ gst_buffer_copy_into (GstBuffer * dest, GstBuffer * src,
   }
 
   if (flags & GST_BUFFER_COPY_META) {
+    GstMetaTransformCopy copy_data;
+
+    copy_data.region = region;
+    copy_data.offset = offset;
+    copy_data.size = size;
+
     for (walk = GST_BUFFER_META (src); walk; walk = walk->next) {
       GstMeta *meta = &walk->meta;
       const GstMetaInfo *info = meta->info;
 
-      if (info->transform_func) {
-        GstMetaTransformCopy copy_data;
-
-        copy_data.region = region;
-        copy_data.offset = offset;
-        copy_data.size = size;
-
+      if (info->transform_func)
         info->transform_func (dest, meta, src,
             _gst_meta_transform_copy, &copy_data);
-      }
     }
   }
 
@@ -563,8 +688,9 @@ _gst_buffer_free (GstBuffer * buffer)
       info->free_func (meta, buffer);
 
     next = walk->next;
-    /* and free the slice */
-    g_slice_free1 (ITEM_SIZE (info), walk);
+    /* and free the slice, items in the arena go with the buffer */
+    if (!_meta_item_in_arena (buffer, walk))
+      g_slice_free1 (ITEM_SIZE (info), walk);
   }
 
   /* get the size, when unreffing the memory, we could also unref the buffer
@@ -577,13 +703,18 @@ _gst_buffer_free (GstBuffer * buffer)
     gst_memory_unlock (GST_BUFFER_MEM_PTR (buffer, i), GST_LOCK_FLAG_EXCLUSIVE);
     gst_memory_unref (GST_BUFFER_MEM_PTR (buffer, i));
   }
+  if (GST_BUFFER_MEM_ARRAY (buffer) != GST_BUFFER_MEM_INLINE (buffer))
+    g_free (GST_BUFFER_MEM_ARRAY (buffer));
 
   /* we set msize to 0 when the buffer is part of the memory block */
   if (msize) {
 #ifdef USE_POISONING
     memset (buffer, 0xff, msize);
 #endif
-    g_slice_free1 (msize, buffer);
+    if (G_LIKELY (msize == sizeof (GstBufferImpl) && _gst_buffer_cache))
+      _priv_gst_magazine_cache_free (_gst_buffer_cache, buffer);
+    else
+      g_slice_free1 (msize, buffer);
   } else {
     gst_memory_unref (GST_BUFFER_BUFMEM (buffer));
   }
@@ -607,7 +738,11 @@ gst_buffer_init (GstBufferImpl * buffer, gsize size)
   GST_BUFFER_OFFSET_END (buffer) = GST_BUFFER_OFFSET_NONE;
 
   GST_BUFFER_MEM_LEN (buffer) = 0;
+  GST_BUFFER_MEM_SIZE (buffer) = GST_BUFFER_MEM_MAX;
+  GST_BUFFER_MEM_ARRAY (buffer) = GST_BUFFER_MEM_INLINE (buffer);
   GST_BUFFER_META (buffer) = NULL;
+  GST_BUFFER_META_SLOT_MASK (buffer) = 0;
+  GST_BUFFER_META_ARENA_USED (buffer) = 0;
 }
 
 /**
@@ -624,7 +759,10 @@ gst_buffer_new (void)
 {
   GstBufferImpl *newbuf;
 
-  newbuf = g_slice_new (GstBufferImpl);
+  if (G_LIKELY (_gst_buffer_cache))
+    newbuf = _priv_gst_magazine_cache_alloc (_gst_buffer_cache);
+  else
+    newbuf = g_slice_new (GstBufferImpl);
   GST_CAT_LOG (GST_CAT_BUFFER, "new %p", newbuf);
 
   gst_buffer_init (newbuf, sizeof (GstBufferImpl));
@@ -795,8 +933,9 @@ gst_buffer_new_wrapped (gpointer data, gsize size)
  * gst_buffer_n_memory:
  * @buffer: a #GstBuffer.
  *
- * Get the amount of memory blocks that this buffer has. This amount is never
- * larger than what gst_buffer_get_max_memory() returns.
+ * Get the amount of memory blocks that this buffer has. This amount can be
+ * larger than what gst_buffer_get_max_memory() returns, the memory blocks
+ * after that are stored in an allocated array.
  *
  * Returns: (transfer full): the amount of memory block in this buffer.
  */
@@ -851,9 +990,9 @@ gst_buffer_append_memory (GstBuffer * buffer, GstMemory * mem)
  * Insert the memory block @mem to @buffer at @idx. This function takes ownership
  * of @mem and thus doesn't increase its refcount.
  *
- * Only gst_buffer_get_max_memory() can be added to a buffer. If more memory is
- * added, existing memory blocks will automatically be merged to make room for
- * the new memory.
+ * A buffer can hold gst_buffer_get_max_memory() memory blocks without extra
+ * allocations. If more memory is added, the existing memory blocks are kept
+ * as they are and more storage is allocated for the new memory.
  */
 void
 gst_buffer_insert_memory (GstBuffer * buffer, gint idx, GstMemory * mem)
@@ -1874,10 +2013,19 @@ gst_buffer_get_meta (GstBuffer * buffer, GType api)
 {
   GstMetaItem *item;
   GstMeta *result = NULL;
+  gint slot;
 
   g_return_val_if_fail (buffer != NULL, NULL);
   g_return_val_if_fail (api != 0, NULL);
 
+  /* APIs with a lookup slot don't need to walk the list */
+  slot = _priv_gst_meta_api_get_slot (api);
+  if (G_LIKELY (slot >= 0)) {
+    if (GST_BUFFER_META_SLOT_MASK (buffer) & (1u << slot))
+      result = GST_BUFFER_META_SLOT (buffer, slot);
+    return result;
+  }
+
   /* find GstMeta of the requested API */
   for (item = GST_BUFFER_META (buffer); item; item = item->next) {
     GstMeta *meta = &item->meta;
@@ -1906,14 +2054,15 @@ gst_buffer_add_meta (GstBuffer * buffer, const GstMetaInfo * info,
   GstMetaItem *item;
   GstMeta *result = NULL;
   gsize size;
+  gint slot;
 
   g_return_val_if_fail (buffer != NULL, NULL);
   g_return_val_if_fail (info != NULL, NULL);
   g_return_val_if_fail (gst_buffer_is_writable (buffer), NULL);
 
-  /* create a new slice */
+  /* create a new item */
   size = ITEM_SIZE (info);
-  item = g_slice_alloc (size);
+  item = _meta_item_alloc (buffer, size);
   result = &item->meta;
   result->info = info;
   result->flags = GST_META_FLAG_NONE;
@@ -1931,11 +2080,18 @@ gst_buffer_add_meta (GstBuffer * buffer, const GstMetaInfo * info,
   item->next = GST_BUFFER_META (buffer);
   GST_BUFFER_META (buffer) = item;
 
+  /* the new item is the first of its API in the list */
+  slot = _priv_gst_meta_api_get_slot (info->api);
+  if (slot >= 0) {
+    GST_BUFFER_META_SLOT (buffer, slot) = result;
+    GST_BUFFER_META_SLOT_MASK (buffer) |= 1u << slot;
+  }
+
   return result;
 
 init_failed:
   {
-    g_slice_free1 (size, item);
+    _meta_item_free (buffer, item, size);
     return NULL;
   }
 }
@@ -1962,23 +2118,10 @@ gst_buffer_remove_meta (GstBuffer * buffer, GstMeta * meta)
       FALSE);
 
   /* find the metadata and delete */
-  prev = GST_BUFFER_META (buffer);
-  for (walk = prev; walk; walk = walk->next) {
-    GstMeta *m = &walk->meta;
-    if (m == meta) {
-      const GstMetaInfo *info = meta->info;
-
-      /* remove from list */
-      if (GST_BUFFER_META (buffer) == walk)
-        GST_BUFFER_META (buffer) = walk->next;
-      else
-        prev->next = walk->next;
-      /* call free_func if any */
-      if (info->free_func)
-        info->free_func (m, buffer);
-
-      /* and free the slice */
-      g_slice_free1 (ITEM_SIZE (info), walk);
+  prev = NULL;
+  for (walk = GST_BUFFER_META (buffer); walk; walk = walk->next) {
+    if (&walk->meta == meta) {
+      _meta_item_remove (buffer, walk, prev);
       break;
     }
     prev = walk;
@@ -2046,8 +2189,8 @@ gst_buffer_foreach_meta (GstBuffer * buffer, GstBufferForeachMetaFunc func,
   g_return_val_if_fail (func != NULL, FALSE);
 
   /* find the metadata and delete */
-  prev = GST_BUFFER_META (buffer);
-  for (walk = prev; walk; walk = next) {
+  prev = NULL;
+  for (walk = GST_BUFFER_META (buffer); walk; walk = next) {
     GstMeta *m, *new;
 
     m = new = &walk->meta;
@@ -2056,27 +2199,16 @@ gst_buffer_foreach_meta (GstBuffer * buffer, GstBufferForeachMetaFunc func,
     res = func (buffer, &new, user_data);
 
     if (new == NULL) {
-      const GstMetaInfo *info = m->info;
-
       GST_CAT_DEBUG (GST_CAT_BUFFER, "remove metadata %p (%s)", m,
-          g_type_name (info->type));
+          g_type_name (m->info->type));
 
       g_return_val_if_fail (gst_buffer_is_writable (buffer), FALSE);
       g_return_val_if_fail (!GST_META_FLAG_IS_SET (m, GST_META_FLAG_LOCKED),
           FALSE);
 
-      /* remove from list */
-      if (GST_BUFFER_META (buffer) == walk)
-        GST_BUFFER_META (buffer) = next;
-      else
-        prev->next = next;
-
-      /* call free_func if any */
-      if (info->free_func)
-        info->free_func (m, buffer);
-
-      /* and free the slice */
-      g_slice_free1 (ITEM_SIZE (info), walk);
+      _meta_item_remove (buffer, walk, prev);
+    } else {
+      prev = walk;
     }
     if (!res)
       break;
@@ -75,7 +75,6 @@
 #include <sys/types.h>
 
 #include "gstatomicqueue.h"
-#include "gstpoll.h"
 #include "gstinfo.h"
 #include "gstquark.h"
 #include "gstvalue.h"
@@ -91,10 +90,32 @@ GST_DEBUG_CATEGORY_STATIC (gst_buffer_pool_debug);
 #define GST_BUFFER_POOL_LOCK(pool)   (g_rec_mutex_lock(&pool->priv->rec_lock))
 #define GST_BUFFER_POOL_UNLOCK(pool) (g_rec_mutex_unlock(&pool->priv->rec_lock))
 
+/* the number of per-thread cache slots with the THREAD_CACHE option. Each
+ * thread gets its own slot number the first time it uses a pool, only when
+ * there are more threads than slots they share one */
+#define CACHE_SLOTS 16
+
+static GPrivate cache_slot_private;
+static gint cache_slot_next;
+
+/* one buffer per slot, padded so that threads don't share cache lines */
+typedef struct
+{
+  GstBuffer *buffer;
+  gpointer padding[64 / sizeof (gpointer) - 1];
+} CacheSlot;
+
 struct _GstBufferPoolPrivate
 {
   GstAtomicQueue *queue;
-  GstPoll *poll;
+
+  /* waiting for released buffers */
+  GMutex wait_lock;
+  GCond wait_cond;
+  gint waiters;
+
+  /* per-thread cache, NULL when disabled */
+  CacheSlot *slots;
 
   GRecMutex rec_lock;
 
@@ -111,6 +132,20 @@ struct _GstBufferPoolPrivate
   guint cur_buffers;
   GstAllocator *allocator;
   GstAllocationParams params;
+
+  /* trimming of idle buffers, 0 idle_timeout disables */
+  GstClockTime idle_timeout;
+  GMutex trim_lock;
+  GstClockTime trim_time;
+  gint min_queued;
+
+  /* stats */
+  gint peak_buffers;
+  gint hits;
+  gint misses;
+  gint waits;
+  gint trimmed;
+  GstClockTime wait_time;
 };
 
 enum
@@ -165,8 +200,10 @@ gst_buffer_pool_init (GstBufferPool * pool)
   priv = pool->priv = GST_BUFFER_POOL_GET_PRIVATE (pool);
 
   g_rec_mutex_init (&priv->rec_lock);
+  g_mutex_init (&priv->wait_lock);
+  g_cond_init (&priv->wait_cond);
+  g_mutex_init (&priv->trim_lock);
 
-  priv->poll = gst_poll_new_timer ();
   priv->queue = gst_atomic_queue_new (10);
   pool->flushing = 1;
   priv->active = FALSE;
@@ -178,7 +215,6 @@ gst_buffer_pool_init (GstBufferPool * pool)
   gst_allocation_params_init (&priv->params);
   gst_buffer_pool_config_set_allocator (priv->config, priv->allocator,
       &priv->params);
-  gst_poll_write_control (priv->poll);
 
   GST_DEBUG_OBJECT (pool, "created");
 }
@@ -196,9 +232,12 @@ gst_buffer_pool_finalize (GObject * object)
 
   gst_buffer_pool_set_active (pool, FALSE);
   gst_atomic_queue_unref (priv->queue);
-  gst_poll_free (priv->poll);
+  g_free (priv->slots);
   gst_structure_free (priv->config);
   g_rec_mutex_clear (&priv->rec_lock);
+  g_mutex_clear (&priv->wait_lock);
+  g_cond_clear (&priv->wait_cond);
+  g_mutex_clear (&priv->trim_lock);
   if (priv->allocator)
     gst_object_unref (priv->allocator);
 
@@ -273,6 +312,17 @@ do_alloc_buffer (GstBufferPool * pool, GstBuffer ** buffer,
   if (G_UNLIKELY (result != GST_FLOW_OK))
     goto alloc_failed;
 
+  /* keep track of the peak number of buffers */
+  cur_buffers++;
+  while (cur_buffers > g_atomic_int_get (&priv->peak_buffers)) {
+    gint peak = g_atomic_int_get (&priv->peak_buffers);
+
+    if (cur_buffers <= peak
+        || g_atomic_int_compare_and_exchange (&priv->peak_buffers, peak,
+            cur_buffers))
+      break;
+  }
+
   gst_buffer_foreach_meta (*buffer, mark_meta_pooled, pool);
 
   GST_LOG_OBJECT (pool, "allocated buffer %d/%d, %p", cur_buffers,
@@ -363,6 +413,62 @@ default_free_buffer (GstBufferPool * pool, GstBuffer * buffer)
   gst_buffer_unref (buffer);
 }
 
+/* the slot of the current thread in every pool */
+static inline guint
+cache_slot_index (void)
+{
+  guint index;
+
+  index = GPOINTER_TO_UINT (g_private_get (&cache_slot_private));
+  if (G_UNLIKELY (index == 0)) {
+    /* 0 is the unset value, store the slot number + 1 */
+    index = (g_atomic_int_add (&cache_slot_next, 1) % CACHE_SLOTS) + 1;
+    g_private_set (&cache_slot_private, GUINT_TO_POINTER (index));
+  }
+  return index - 1;
+}
+
+/* take the buffer from a cache slot */
+static inline GstBuffer *
+cache_slot_take (CacheSlot * slot)
+{
+  GstBuffer *buffer;
+
+  do {
+    buffer = g_atomic_pointer_get (&slot->buffer);
+  } while (buffer
+      && !g_atomic_pointer_compare_and_exchange (&slot->buffer, buffer, NULL));
+
+  return buffer;
+}
+
+/* take a buffer from any of the cache slots */
+static GstBuffer *
+cache_steal (GstBufferPoolPrivate * priv)
+{
+  GstBuffer *buffer = NULL;
+  guint i;
+
+  if (priv->slots) {
+    for (i = 0; i < CACHE_SLOTS && buffer == NULL; i++)
+      buffer = cache_slot_take (&priv->slots[i]);
+  }
+  return buffer;
+}
+
+/* wake up threads that wait for a released buffer */
+static inline void
+wake_waiters (GstBufferPoolPrivate * priv)
+{
+  /* the push of the buffer or flushing flag is ordered before this read by the
+   * atomic operation, the waiters increment before checking the queue */
+  if (g_atomic_int_get (&priv->waiters) > 0) {
+    g_mutex_lock (&priv->wait_lock);
+    g_cond_broadcast (&priv->wait_cond);
+    g_mutex_unlock (&priv->wait_lock);
+  }
+}
+
 /* must be called with the lock */
 static gboolean
 default_stop (GstBufferPool * pool)
@@ -374,9 +480,9 @@ default_stop (GstBufferPool * pool)
   pclass = GST_BUFFER_POOL_GET_CLASS (pool);
 
   /* clear the pool */
-  while ((buffer = gst_atomic_queue_pop (priv->queue))) {
+  while ((buffer = gst_atomic_queue_pop (priv->queue))
+      || (buffer = cache_steal (priv))) {
     GST_LOG_OBJECT (pool, "freeing %p", buffer);
-    gst_poll_read_control (priv->poll);
 
     if (G_LIKELY (pclass->free_buffer))
       pclass->free_buffer (pool, buffer);
@@ -450,15 +556,19 @@ gst_buffer_pool_set_active (GstBufferPool * pool, gboolean active)
     if (!do_start (pool))
       goto start_failed;
 
+    /* start a new trim period with all queued buffers idle */
+    priv->trim_time = gst_util_get_timestamp () + priv->idle_timeout;
+    g_atomic_int_set (&priv->min_queued,
+        gst_atomic_queue_length (priv->queue));
+
     /* unset the flushing state now */
-    gst_poll_read_control (priv->poll);
     g_atomic_int_set (&pool->flushing, 0);
   } else {
     gint outstanding;
 
     /* set to flushing first */
     g_atomic_int_set (&pool->flushing, 1);
-    gst_poll_write_control (priv->poll);
+    wake_waiters (priv);
 
     /* when all buffers are in the pool, free them. Else they will be
      * freed when they are released */
@@ -529,6 +639,7 @@ default_set_config (GstBufferPool * pool, GstStructure * config)
   guint size, min_buffers, max_buffers;
   GstAllocator *allocator;
   GstAllocationParams params;
+  GstClockTime idle_timeout;
 
   /* parse the config and keep around */
   if (!gst_buffer_pool_config_get_params (config, &caps, &size, &min_buffers,
@@ -538,12 +649,25 @@ default_set_config (GstBufferPool * pool, GstStructure * config)
   if (!gst_buffer_pool_config_get_allocator (config, &allocator, &params))
     goto wrong_config;
 
+  if (!gst_buffer_pool_config_get_idle_timeout (config, &idle_timeout))
+    idle_timeout = 0;
+
   GST_DEBUG_OBJECT (pool, "config %" GST_PTR_FORMAT, config);
 
   priv->size = size;
   priv->min_buffers = min_buffers;
   priv->max_buffers = max_buffers;
   priv->cur_buffers = 0;
+  priv->idle_timeout = idle_timeout;
+
+  if (gst_buffer_pool_config_has_option (config,
+          GST_BUFFER_POOL_OPTION_THREAD_CACHE)) {
+    if (priv->slots == NULL)
+      priv->slots = g_new0 (CacheSlot, CACHE_SLOTS);
+  } else {
+    g_free (priv->slots);
+    priv->slots = NULL;
+  }
 
   if (priv->allocator)
     gst_object_unref (priv->allocator);
@@ -970,49 +1094,286 @@ gst_buffer_pool_config_get_allocator (GstStructure * config,
   return TRUE;
 }
 
+/**
+ * gst_buffer_pool_config_set_idle_timeout:
+ * @config: a #GstBufferPool configuration
+ * @timeout: the idle time after which buffers are freed or 0 to disable
+ *
+ * Make the pool elastic. Buffers that were not used for @timeout are freed
+ * until the pool is back at the min_buffers that were configured with
+ * gst_buffer_pool_config_set_params(). Without an idle timeout, all allocated
+ * buffers stay in the pool until it is stopped.
+ *
+ * The default implementation of acquire_buffer and release_buffer checks for
+ * idle buffers, a pool that is not used is not trimmed.
+ *
+ * Since: 1.2
+ */
+void
+gst_buffer_pool_config_set_idle_timeout (GstStructure * config,
+    GstClockTime timeout)
+{
+  g_return_if_fail (config != NULL);
+  g_return_if_fail (GST_CLOCK_TIME_IS_VALID (timeout));
+
+  gst_structure_id_set (config,
+      GST_QUARK (IDLE_TIMEOUT), G_TYPE_UINT64, timeout, NULL);
+}
+
+/**
+ * gst_buffer_pool_config_get_idle_timeout:
+ * @config: (transfer none): a #GstBufferPool configuration
+ * @timeout: (out): the idle timeout
+ *
+ * Get the idle timeout from @config, see
+ * gst_buffer_pool_config_set_idle_timeout().
+ *
+ * Returns: %TRUE when @config has an idle timeout.
+ *
+ * Since: 1.2
+ */
+gboolean
+gst_buffer_pool_config_get_idle_timeout (GstStructure * config,
+    GstClockTime * timeout)
+{
+  g_return_val_if_fail (config != NULL, FALSE);
+  g_return_val_if_fail (timeout != NULL, FALSE);
+
+  return gst_structure_id_get (config,
+      GST_QUARK (IDLE_TIMEOUT), G_TYPE_UINT64, timeout, NULL);
+}
+
+/**
+ * gst_buffer_pool_get_stats:
+ * @pool: a #GstBufferPool
+ *
+ * Get the usage statistics of @pool. The structure contains the number of
+ * "allocated" and "outstanding" buffers, the "peak" number of allocated
+ * buffers, the number of acquires that reused a buffer ("hits") or had to
+ * allocate one ("misses"), the number of acquires that had to wait
+ * ("waits") with the total "wait-time" and the number of "trimmed" buffers.
+ *
+ * The counters are only maintained by the default acquire_buffer and
+ * release_buffer implementations.
+ *
+ * Returns: (transfer full): a new #GstStructure, free with
+ *     gst_structure_free() after usage.
+ *
+ * Since: 1.2
+ */
+GstStructure *
+gst_buffer_pool_get_stats (GstBufferPool * pool)
+{
+  GstBufferPoolPrivate *priv;
+  GstClockTime wait_time;
+
+  g_return_val_if_fail (GST_IS_BUFFER_POOL (pool), NULL);
+
+  priv = pool->priv;
+
+  g_mutex_lock (&priv->wait_lock);
+  wait_time = priv->wait_time;
+  g_mutex_unlock (&priv->wait_lock);
+
+  return gst_structure_new ("GstBufferPoolStats",
+      "allocated", G_TYPE_UINT, (guint) g_atomic_int_get (&priv->cur_buffers),
+      "outstanding", G_TYPE_UINT,
+      (guint) g_atomic_int_get (&priv->outstanding),
+      "peak", G_TYPE_UINT, (guint) g_atomic_int_get (&priv->peak_buffers),
+      "hits", G_TYPE_UINT, (guint) g_atomic_int_get (&priv->hits),
+      "misses", G_TYPE_UINT, (guint) g_atomic_int_get (&priv->misses),
+      "waits", G_TYPE_UINT, (guint) g_atomic_int_get (&priv->waits),
+      "wait-time", G_TYPE_UINT64, wait_time,
+      "trimmed", G_TYPE_UINT, (guint) g_atomic_int_get (&priv->trimmed),
+      NULL);
+}
+
+/* free the buffers that stayed in the queue during the last idle period,
+ * called from acquire and release, the pool can't stop concurrently because
+ * there is an outstanding buffer */
+static void
+trim_idle_buffers (GstBufferPool * pool)
+{
+  GstBufferPoolPrivate *priv = pool->priv;
+  GstBufferPoolClass *pclass;
+  GstClockTime now;
+  gint idle, trimmed = 0;
+
+  now = gst_util_get_timestamp ();
+  if (G_LIKELY (now < priv->trim_time))
+    return;
+
+  if (!g_mutex_trylock (&priv->trim_lock))
+    return;
+
+  if (now < priv->trim_time || GST_BUFFER_POOL_IS_FLUSHING (pool))
+    goto done;
+
+  pclass = GST_BUFFER_POOL_GET_CLASS (pool);
+
+  /* the oldest buffers are at the head of the queue */
+  idle = g_atomic_int_get (&priv->min_queued);
+  while (idle > 0
+      && (guint) g_atomic_int_get (&priv->cur_buffers) > priv->min_buffers) {
+    GstBuffer *buffer;
+
+    if (!(buffer = gst_atomic_queue_pop (priv->queue)))
+      break;
+
+    GST_LOG_OBJECT (pool, "trimming idle buffer %p", buffer);
+    if (G_LIKELY (pclass->free_buffer))
+      pclass->free_buffer (pool, buffer);
+    g_atomic_int_add (&priv->cur_buffers, -1);
+    g_atomic_int_inc (&priv->trimmed);
+    trimmed++;
+    idle--;
+  }
+
+  g_atomic_int_set (&priv->min_queued, gst_atomic_queue_length (priv->queue));
+  priv->trim_time = now + priv->idle_timeout;
+
+  /* waiters can allocate again now that there is room below max_buffers */
+  if (trimmed > 0) {
+    g_mutex_lock (&priv->wait_lock);
+    g_cond_broadcast (&priv->wait_cond);
+    g_mutex_unlock (&priv->wait_lock);
+  }
+
+done:
+  g_mutex_unlock (&priv->trim_lock);
+}
+
+/* track the lowest number of queued buffers in this idle period */
+static inline void
+update_min_queued (GstBufferPoolPrivate * priv)
+{
+  gint queued = gst_atomic_queue_length (priv->queue);
+
+  if (queued < g_atomic_int_get (&priv->min_queued))
+    g_atomic_int_set (&priv->min_queued, queued);
+}
+
+/* wait until a buffer is released, one can be allocated again or the pool is
+ * flushing */
 static GstFlowReturn
-default_acquire_buffer (GstBufferPool * pool, GstBuffer ** buffer,
-    GstBufferPoolAcquireParams * params)
+wait_buffer (GstBufferPool * pool, GstBuffer ** buffer)
 {
-  GstFlowReturn result;
   GstBufferPoolPrivate *priv = pool->priv;
+  GstFlowReturn result = GST_FLOW_OK;
+  GstClockTime start;
+  gboolean try_alloc = TRUE, allocated = FALSE;
 
-  while (TRUE) {
-    if (G_UNLIKELY (GST_BUFFER_POOL_IS_FLUSHING (pool)))
-      goto flushing;
+  start = gst_util_get_timestamp ();
+  g_atomic_int_inc (&priv->waits);
 
-    /* try to get a buffer from the queue */
-    *buffer = gst_atomic_queue_pop (priv->queue);
-    if (G_LIKELY (*buffer)) {
-      gst_poll_read_control (priv->poll);
-      result = GST_FLOW_OK;
-      GST_LOG_OBJECT (pool, "acquired buffer %p", *buffer);
+  g_mutex_lock (&priv->wait_lock);
+  g_atomic_int_inc (&priv->waiters);
+  while (TRUE) {
+    if (G_UNLIKELY (GST_BUFFER_POOL_IS_FLUSHING (pool))) {
+      result = GST_FLOW_FLUSHING;
       break;
     }
-
-    /* no buffer, try to allocate some more */
-    GST_LOG_OBJECT (pool, "no buffer, trying to allocate");
-    result = do_alloc_buffer (pool, buffer, NULL);
-    if (G_LIKELY (result == GST_FLOW_OK))
-      /* we have a buffer, return it */
+    /* releasers check the waiters after adding the buffer, so it is either
+     * seen here or they will signal us */
+    if ((*buffer = gst_atomic_queue_pop (priv->queue)))
       break;
-
-    if (G_UNLIKELY (result != GST_FLOW_EOS))
-      /* something went wrong, return error */
+    if ((*buffer = cache_steal (priv)))
       break;
 
-    /* check if we need to wait */
-    if (params && (params->flags & GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT)) {
-      GST_LOG_OBJECT (pool, "no more buffers");
-      break;
+    /* buffers that were freed, for example by trimming, make room for new
+     * ones. Allocate without the lock, check the queue again afterwards
+     * because a release while we were allocating did not wake us up */
+    if (try_alloc) {
+      g_mutex_unlock (&priv->wait_lock);
+      result = do_alloc_buffer (pool, buffer, NULL);
+      g_mutex_lock (&priv->wait_lock);
+
+      if (result != GST_FLOW_EOS) {
+        /* we have a buffer or something went wrong */
+        allocated = (result == GST_FLOW_OK);
+        break;
+      }
+      result = GST_FLOW_OK;
+      try_alloc = FALSE;
+      continue;
     }
 
-    /* now wait */
     GST_LOG_OBJECT (pool, "waiting for free buffers");
-    gst_poll_wait (priv->poll, GST_CLOCK_TIME_NONE);
+    g_cond_wait (&priv->wait_cond, &priv->wait_lock);
+    try_alloc = TRUE;
   }
+  g_atomic_int_add (&priv->waiters, -1);
+  priv->wait_time += gst_util_get_timestamp () - start;
+  g_mutex_unlock (&priv->wait_lock);
+
+  if (allocated)
+    g_atomic_int_inc (&priv->misses);
+  else if (result == GST_FLOW_OK)
+    g_atomic_int_inc (&priv->hits);
 
   return result;
+}
+
+static GstFlowReturn
+default_acquire_buffer (GstBufferPool * pool, GstBuffer ** buffer,
+    GstBufferPoolAcquireParams * params)
+{
+  GstFlowReturn result;
+  GstBufferPoolPrivate *priv = pool->priv;
+
+  if (G_UNLIKELY (GST_BUFFER_POOL_IS_FLUSHING (pool)))
+    goto flushing;
+
+  /* try the buffer that this thread released last */
+  if (priv->slots) {
+    *buffer = cache_slot_take (&priv->slots[cache_slot_index ()]);
+    if (*buffer) {
+      GST_LOG_OBJECT (pool, "acquired cached buffer %p", *buffer);
+      g_atomic_int_inc (&priv->hits);
+      return GST_FLOW_OK;
+    }
+  }
+
+  /* try to get a buffer from the queue */
+  *buffer = gst_atomic_queue_pop (priv->queue);
+  if (G_LIKELY (*buffer)) {
+    GST_LOG_OBJECT (pool, "acquired buffer %p", *buffer);
+    g_atomic_int_inc (&priv->hits);
+    if (priv->idle_timeout) {
+      update_min_queued (priv);
+      trim_idle_buffers (pool);
+    }
+    return GST_FLOW_OK;
+  }
+  if (priv->idle_timeout)
+    g_atomic_int_set (&priv->min_queued, 0);
+
+  /* the cache of the other threads might still have buffers */
+  if ((*buffer = cache_steal (priv))) {
+    GST_LOG_OBJECT (pool, "acquired cached buffer %p of another thread",
+        *buffer);
+    g_atomic_int_inc (&priv->hits);
+    return GST_FLOW_OK;
+  }
+
+  /* no buffer, try to allocate some more */
+  GST_LOG_OBJECT (pool, "no buffer, trying to allocate");
+  result = do_alloc_buffer (pool, buffer, NULL);
+  if (G_LIKELY (result != GST_FLOW_EOS)) {
+    /* we have a buffer or something went wrong */
+    if (result == GST_FLOW_OK)
+      g_atomic_int_inc (&priv->misses);
+    return result;
+  }
+
+  /* check if we need to wait */
+  if (params && (params->flags & GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT)) {
+    GST_LOG_OBJECT (pool, "no more buffers");
+    return result;
+  }
+
+  /* now wait */
+  return wait_buffer (pool, buffer);
 
   /* ERRORS */
 flushing:
@@ -1114,10 +1475,30 @@ gst_buffer_pool_acquire_buffer (GstBufferPool * pool, GstBuffer ** buffer,
 static void
 default_release_buffer (GstBufferPool * pool, GstBuffer * buffer)
 {
-  /* keep it around in our queue */
+  GstBufferPoolPrivate *priv = pool->priv;
+
   GST_LOG_OBJECT (pool, "released buffer %p", buffer);
-  gst_atomic_queue_push (pool->priv->queue, buffer);
-  gst_poll_write_control (pool->priv->poll);
+
+  /* keep it in the cache of this thread when nobody is waiting for it */
+  if (priv->slots && g_atomic_int_get (&priv->waiters) == 0) {
+    CacheSlot *slot = &priv->slots[cache_slot_index ()];
+
+    if (g_atomic_pointer_compare_and_exchange (&slot->buffer, NULL, buffer)) {
+      /* a thread might have started waiting before the buffer was in the
+       * slot, move it to the queue where it will be found */
+      if (G_LIKELY (g_atomic_int_get (&priv->waiters) == 0))
+        return;
+      if ((buffer = cache_slot_take (slot)) == NULL)
+        return;
+    }
+  }
+
+  /* keep it around in our queue */
+  gst_atomic_queue_push (priv->queue, buffer);
+  wake_waiters (priv);
+
+  if (priv->idle_timeout)
+    trim_idle_buffers (pool);
 }
 
 /**
@@ -96,6 +96,20 @@ struct _GstBufferPoolAcquireParams {
  */
 #define GST_BUFFER_POOL_IS_FLUSHING(pool)  (g_atomic_int_get (&pool->flushing))
 
+/**
+ * GST_BUFFER_POOL_OPTION_THREAD_CACHE:
+ *
+ * An option that can be activated on the bufferpool config with
+ * gst_buffer_pool_config_add_option(). The default implementation of
+ * acquire_buffer and release_buffer will then keep released buffers in
+ * per-thread cache slots without contention, which is faster when the thread
+ * that releases a buffer acquires the next one. Buffers in the slots of other
+ * threads are used before new buffers are allocated.
+ *
+ * Since: 1.2
+ */
+#define GST_BUFFER_POOL_OPTION_THREAD_CACHE "GstBufferPoolOptionThreadCache"
+
 /**
  * GstBufferPool:
  * @object: the parent structure
@@ -182,6 +196,8 @@ GstStructure *   gst_buffer_pool_get_config      (GstBufferPool *pool);
 const gchar **   gst_buffer_pool_get_options     (GstBufferPool *pool);
 gboolean         gst_buffer_pool_has_option      (GstBufferPool *pool, const gchar *option);
 
+GstStructure *   gst_buffer_pool_get_stats       (GstBufferPool *pool);
+
 /* helpers for configuring the config structure */
 void             gst_buffer_pool_config_set_params    (GstStructure *config, GstCaps *caps,
                                                        guint size, guint min_buffers, guint max_buffers);
@@ -191,6 +207,8 @@ void             gst_buffer_pool_config_set_allocator (GstStructure *config, Gst
                                                        const GstAllocationParams *params);
 gboolean         gst_buffer_pool_config_get_allocator (GstStructure *config, GstAllocator **allocator,
                                                        GstAllocationParams *params);
+void             gst_buffer_pool_config_set_idle_timeout (GstStructure *config, GstClockTime timeout);
+gboolean         gst_buffer_pool_config_get_idle_timeout (GstStructure *config, GstClockTime *timeout);
 
 /* options */
 guint            gst_buffer_pool_config_n_options   (GstStructure *config);
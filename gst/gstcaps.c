@@ -82,10 +82,17 @@ typedef struct _GstCapsImpl
   GstCaps caps;
 
   GArray *array;
+
+  /* unique id of interned caps, 0 when not interned */
+  guint64 intern_id;
+  guint intern_hash;
 } GstCapsImpl;
 
 #define GST_CAPS_ARRAY(c) (((GstCapsImpl *)(c))->array)
 
+#define CAPS_INTERN_ID(c) (((GstCapsImpl *)(c))->intern_id)
+#define CAPS_IS_INTERNED(c) (CAPS_INTERN_ID (c) != 0)
+
 #define GST_CAPS_LEN(c)   (GST_CAPS_ARRAY(c)->len)
 
 #define IS_WRITABLE(caps) \
@@ -102,7 +109,17 @@ typedef struct _GstCapsImpl
 #define CAPS_IS_EMPTY_SIMPLE(caps)					\
   ((GST_CAPS_ARRAY (caps) == NULL) || (GST_CAPS_LEN (caps) == 0))
 
-#define gst_caps_features_copy_conditional(f) ((f && (gst_caps_features_is_any (f) || !gst_caps_features_is_equal (f, GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY))) ? gst_caps_features_copy (f) : NULL)
+#define gst_caps_features_copy_conditional(f) ((f && (gst_caps_features_is_any (f) || !gst_caps_features_is_equal (f, GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY))) ? priv_gst_caps_features_share (f) : NULL)
+
+/* interned features are shared between caps and are never freed */
+#define gst_caps_features_free_conditional(f) G_STMT_START { \
+    if (!priv_gst_caps_features_is_interned (f))             \
+      gst_caps_features_free (f);                             \
+  } G_STMT_END
+
+/* equal feature sets are usually the same interned instance */
+#define gst_caps_features_is_equal_fast(f1, f2) \
+    ((f1) == (f2) || gst_caps_features_is_equal (f1, f2))
 
 /* quick way to get a caps structure at an index without doing a type or array
  * length check */
@@ -121,6 +138,36 @@ typedef struct _GstCapsImpl
 /* lock to protect multiple invocations of static caps to caps conversion */
 G_LOCK_DEFINE_STATIC (static_caps_lock);
 
+/* the table of interned caps holds a ref on each of them so that they are
+ * never writable. Caps that are only kept alive by the table are released
+ * when the table has doubled in size since the last sweep. The memo caches
+ * subset and intersect results of pairs of interned caps, keyed on their
+ * unique ids so that released caps never match. */
+#define INTERN_MIN_SWEEP        256
+#define MEMO_SIZE               512
+
+typedef enum
+{
+  MEMO_SUBSET,
+  MEMO_INTERSECT_ZIG_ZAG,
+  MEMO_INTERSECT_FIRST
+} MemoOp;
+
+typedef struct
+{
+  guint64 id1;
+  guint64 id2;
+  MemoOp op;
+  gboolean subset;
+  GstCaps *result;
+} MemoEntry;
+
+G_LOCK_DEFINE_STATIC (intern_lock);
+static GHashTable *intern_table = NULL;
+static guint intern_sweep_at = INTERN_MIN_SWEEP;
+static guint64 intern_next_id = 1;
+static MemoEntry memo[MEMO_SIZE];
+
 static void gst_caps_transform_to_string (const GValue * src_value,
     GValue * dest_value);
 static gboolean gst_caps_from_string_inplace (GstCaps * caps,
@@ -191,7 +238,7 @@ _gst_caps_free (GstCaps * caps)
     features = gst_caps_get_features_unchecked (caps, i);
     if (features) {
       gst_caps_features_set_parent_refcount (features, NULL);
-      gst_caps_features_free (features);
+      gst_caps_features_free_conditional (features);
     }
   }
   g_array_free (GST_CAPS_ARRAY (caps), TRUE);
@@ -202,6 +249,178 @@ _gst_caps_free (GstCaps * caps)
   g_slice_free1 (sizeof (GstCapsImpl), caps);
 }
 
+/* interning */
+static gboolean
+intern_hash_field (GQuark field_id, const GValue * value, gpointer user_data)
+{
+  guint *hash = user_data;
+  guint h;
+
+  h = field_id * 31 + (guint) G_VALUE_TYPE (value);
+  switch (G_VALUE_TYPE (value)) {
+    case G_TYPE_INT:
+      h = h * 31 + (guint) g_value_get_int (value);
+      break;
+    case G_TYPE_UINT:
+      h = h * 31 + g_value_get_uint (value);
+      break;
+    case G_TYPE_BOOLEAN:
+      h = h * 31 + (g_value_get_boolean (value) ? 1 : 0);
+      break;
+    case G_TYPE_STRING:
+      if (g_value_get_string (value))
+        h = h * 31 + g_str_hash (g_value_get_string (value));
+      break;
+    default:
+      /* other values only contribute their type */
+      break;
+  }
+  /* the field order does not matter for equality, so combine the fields with
+   * an order independent operation */
+  h ^= h >> 16;
+  h *= 0x45d9f3b;
+  *hash += h ^ (h >> 16);
+
+  return TRUE;
+}
+
+/* the hash of the name and features of a structure, the hashes of the
+ * fields are added to it */
+static guint
+intern_hash_structure_name (const GstStructure * s, const GstCapsFeatures * f)
+{
+  guint j, n, h;
+
+  if (!f)
+    f = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
+
+  h = gst_structure_get_name_id (s);
+  if (gst_caps_features_is_any (f))
+    h = ~h;
+  n = gst_caps_features_get_size (f);
+  for (j = 0; j < n; j++)
+    h += gst_caps_features_get_nth_id (f, j) * 0x9e3779b1;
+
+  return h;
+}
+
+/* equal caps, as in gst_caps_is_strictly_equal(), have the same hash */
+static guint
+intern_hash_caps (const GstCaps * caps)
+{
+  GstStructure *s;
+  guint i, len, hash, h;
+
+  hash = CAPS_IS_ANY (caps) ? 1 : 0;
+  len = GST_CAPS_LEN (caps);
+  for (i = 0; i < len; i++) {
+    s = gst_caps_get_structure_unchecked (caps, i);
+
+    h = intern_hash_structure_name (s, gst_caps_get_features_unchecked (caps,
+            i));
+    gst_structure_foreach (s, intern_hash_field, &h);
+
+    hash = hash * 31 + h;
+  }
+  return hash;
+}
+
+static guint
+intern_table_hash (gconstpointer key)
+{
+  return ((const GstCapsImpl *) key)->intern_hash;
+}
+
+static gboolean
+intern_table_equal (gconstpointer a, gconstpointer b)
+{
+  const GstCaps *caps1 = a, *caps2 = b;
+
+  return CAPS_IS_ANY (caps1) == CAPS_IS_ANY (caps2) &&
+      gst_caps_is_strictly_equal (caps1, caps2);
+}
+
+/* called with the intern lock, release the caps that are only referenced by
+ * the table. Nobody else can get a ref to them without taking the lock. */
+static void
+intern_table_sweep (void)
+{
+  GHashTableIter iter;
+  gpointer key;
+
+  g_hash_table_iter_init (&iter, intern_table);
+  while (g_hash_table_iter_next (&iter, &key, NULL)) {
+    GstCaps *caps = key;
+
+    if (GST_CAPS_REFCOUNT_VALUE (caps) == 1) {
+      g_hash_table_iter_remove (&iter);
+      gst_caps_unref (caps);
+    }
+  }
+  intern_sweep_at =
+      MAX (INTERN_MIN_SWEEP, 2 * g_hash_table_size (intern_table));
+
+  GST_CAT_DEBUG (GST_CAT_CAPS, "%u interned caps after sweep",
+      g_hash_table_size (intern_table));
+}
+
+static inline MemoEntry *
+memo_entry (const GstCaps * caps1, const GstCaps * caps2, MemoOp op)
+{
+  guint64 h;
+
+  h = (CAPS_INTERN_ID (caps1) * 0x9e3779b97f4a7c15ULL) ^
+      (CAPS_INTERN_ID (caps2) * 31 + op);
+
+  return &memo[(h ^ (h >> 32)) % MEMO_SIZE];
+}
+
+/* look up the result of @op on two interned caps, @result gets a new ref */
+static gboolean
+memo_lookup (const GstCaps * caps1, const GstCaps * caps2, MemoOp op,
+    gboolean * subset, GstCaps ** result)
+{
+  MemoEntry *entry;
+  gboolean found;
+
+  G_LOCK (intern_lock);
+  entry = memo_entry (caps1, caps2, op);
+  found = entry->id1 == CAPS_INTERN_ID (caps1) &&
+      entry->id2 == CAPS_INTERN_ID (caps2) && entry->op == op;
+  if (found) {
+    if (subset)
+      *subset = entry->subset;
+    if (result)
+      *result = gst_caps_ref (entry->result);
+  }
+  G_UNLOCK (intern_lock);
+
+  return found;
+}
+
+/* store the result of @op on two interned caps, @result must be interned */
+static void
+memo_store (const GstCaps * caps1, const GstCaps * caps2, MemoOp op,
+    gboolean subset, GstCaps * result)
+{
+  MemoEntry *entry;
+  GstCaps *old;
+
+  G_LOCK (intern_lock);
+  entry = memo_entry (caps1, caps2, op);
+  old = entry->result;
+  entry->id1 = CAPS_INTERN_ID (caps1);
+  entry->id2 = CAPS_INTERN_ID (caps2);
+  entry->op = op;
+  entry->subset = subset;
+  entry->result = result ? gst_caps_ref (result) : NULL;
+  G_UNLOCK (intern_lock);
+
+  /* interned, so there is always another ref in the table */
+  if (old)
+    gst_caps_unref (old);
+}
+
 static void
 gst_caps_init (GstCaps * caps)
 {
@@ -209,6 +428,9 @@ gst_caps_init (GstCaps * caps)
       (GstMiniObjectCopyFunction) _gst_caps_copy, NULL,
       (GstMiniObjectFreeFunction) _gst_caps_free);
 
+  CAPS_INTERN_ID (caps) = 0;
+  ((GstCapsImpl *) caps)->intern_hash = 0;
+
   /* the 32 has been determined by logging caps sizes in _gst_caps_free
    * but g_ptr_array uses 16 anyway if it expands once, so this does not help
    * in practice
@@ -372,11 +594,58 @@ gst_caps_new_full_valist (GstStructure * structure, va_list var_args)
 
 G_DEFINE_POINTER_TYPE (GstStaticCaps, gst_static_caps);
 
+/* static caps from the registry can have the binary representation of the
+ * caps, which is converted faster than the string */
+#define STATIC_CAPS_BINARY(sc)          ((sc)->_gst_reserved[0])
+#define STATIC_CAPS_BINARY_SIZE(sc)     GPOINTER_TO_SIZE ((sc)->_gst_reserved[1])
+
+/*
+ * priv_gst_static_caps_set_binary:
+ * @static_caps: a #GstStaticCaps
+ * @data: (transfer none): data from gst_caps_to_binary()
+ * @size: the size of @data
+ *
+ * Use @data instead of the string of @static_caps to make the caps. @data is
+ * not copied, it must stay valid as long as @static_caps is used.
+ */
+void
+priv_gst_static_caps_set_binary (GstStaticCaps * static_caps,
+    const guint8 * data, gsize size)
+{
+  G_LOCK (static_caps_lock);
+  static_caps->_gst_reserved[0] = (gpointer) data;
+  static_caps->_gst_reserved[1] = GSIZE_TO_POINTER (size);
+  G_UNLOCK (static_caps_lock);
+}
+
+/*
+ * priv_gst_static_caps_get_binary:
+ * @static_caps: a #GstStaticCaps
+ * @size: (out): the size of the data
+ *
+ * Returns: (transfer none): the binary caps set with
+ *     priv_gst_static_caps_set_binary() or %NULL.
+ */
+const guint8 *
+priv_gst_static_caps_get_binary (GstStaticCaps * static_caps, gsize * size)
+{
+  const guint8 *data;
+
+  G_LOCK (static_caps_lock);
+  data = STATIC_CAPS_BINARY (static_caps);
+  *size = STATIC_CAPS_BINARY_SIZE (static_caps);
+  G_UNLOCK (static_caps_lock);
+
+  return data;
+}
+
 /**
  * gst_static_caps_get:
  * @static_caps: the #GstStaticCaps to convert
  *
- * Converts a #GstStaticCaps to a #GstCaps.
+ * Converts a #GstStaticCaps to a #GstCaps. The caps are interned, see
+ * gst_caps_intern(), so static caps with the same contents share one
+ * instance.
  *
  * Returns: (transfer full): a pointer to the #GstCaps. Unref after usage.
  *     Since the core holds an additional ref to the returned caps,
@@ -402,6 +671,18 @@ gst_static_caps_get (GstStaticCaps * static_caps)
 
     string = static_caps->string;
 
+    if (STATIC_CAPS_BINARY (static_caps)) {
+      *caps = gst_caps_from_binary (STATIC_CAPS_BINARY (static_caps),
+          STATIC_CAPS_BINARY_SIZE (static_caps));
+      if (G_LIKELY (*caps != NULL)) {
+        GST_CAT_TRACE (GST_CAT_CAPS, "created %p from binary caps",
+            static_caps);
+        goto done;
+      }
+      GST_CAT_WARNING (GST_CAT_CAPS, "invalid binary caps for %p",
+          static_caps);
+    }
+
     if (G_UNLIKELY (string == NULL))
       goto no_string;
 
@@ -414,6 +695,9 @@ gst_static_caps_get (GstStaticCaps * static_caps)
     GST_CAT_TRACE (GST_CAT_CAPS, "created %p from string %s", static_caps,
         string);
   done:
+    /* many elements have the same template caps, share them */
+    if (G_LIKELY (*caps != NULL))
+      *caps = gst_caps_intern (*caps);
     G_UNLOCK (static_caps_lock);
   }
   /* ref the caps, makes it not writable */
@@ -442,6 +726,8 @@ gst_static_caps_cleanup (GstStaticCaps * static_caps)
 {
   G_LOCK (static_caps_lock);
   gst_caps_replace (&static_caps->caps, NULL);
+  static_caps->_gst_reserved[0] = NULL;
+  static_caps->_gst_reserved[1] = NULL;
   G_UNLOCK (static_caps_lock);
 }
 
@@ -478,7 +764,7 @@ gst_caps_remove_and_get_structure (GstCaps * caps, guint idx)
   gst_caps_remove_and_get_structure_and_features (caps, idx, &s, &f);
 
   if (f)
-    gst_caps_features_free (f);
+    gst_caps_features_free_conditional (f);
 
   return s;
 }
@@ -751,7 +1037,7 @@ gst_caps_merge_structure_full (GstCaps * caps, GstStructure * structure,
      */
     if (((!gst_caps_features_is_any (features_tmp)
                 || gst_caps_features_is_any (features1))
-            && gst_caps_features_is_equal (features_tmp, features1))
+            && gst_caps_features_is_equal_fast (features_tmp, features1))
         && gst_structure_is_subset (structure, structure1)) {
       unique = FALSE;
       break;
@@ -763,7 +1049,7 @@ gst_caps_merge_structure_full (GstCaps * caps, GstStructure * structure,
   } else {
     gst_structure_free (structure);
     if (features)
-      gst_caps_features_free (features);
+      gst_caps_features_free_conditional (features);
   }
   return caps;
 }
@@ -850,8 +1136,17 @@ gst_caps_get_features (const GstCaps * caps, guint index)
   g_return_val_if_fail (index < GST_CAPS_LEN (caps), NULL);
 
   features = gst_caps_get_features_unchecked (caps, index);
-  if (!features)
+  if (!features) {
     features = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
+  } else if (priv_gst_caps_features_is_interned (features)
+      && IS_WRITABLE (caps)) {
+    /* the caller may modify the features of writable caps, give this
+     * structure its own copy of the shared instance */
+    features = gst_caps_features_copy (features);
+    gst_caps_features_set_parent_refcount (features,
+        &GST_CAPS_REFCOUNT (caps));
+    gst_caps_get_features_unchecked (caps, index) = features;
+  }
 
   return features;
 }
@@ -883,7 +1178,7 @@ gst_caps_set_features (GstCaps * caps, guint index, GstCapsFeatures * features)
     gst_caps_features_set_parent_refcount (features, &GST_CAPS_REFCOUNT (caps));
 
   if (old)
-    gst_caps_features_free (old);
+    gst_caps_features_free_conditional (old);
 }
 
 /**
@@ -1097,7 +1392,8 @@ gst_caps_is_fixed (const GstCaps * caps)
   if (GST_CAPS_LEN (caps) != 1)
     return FALSE;
 
-  features = gst_caps_get_features (caps, 0);
+  /* don't unshare the features of writable caps, they are only read */
+  features = gst_caps_get_features_unchecked (caps, 0);
   if (features && gst_caps_features_is_any (features))
     return FALSE;
 
@@ -1135,7 +1431,7 @@ gst_caps_is_equal_fixed (const GstCaps * caps1, const GstCaps * caps2)
     features2 = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
 
   return gst_structure_is_equal (struct1, struct2) &&
-      gst_caps_features_is_equal (features1, features2);
+      gst_caps_features_is_equal_fast (features1, features2);
 }
 
 /**
@@ -1172,7 +1468,7 @@ gst_caps_is_subset (const GstCaps * subset, const GstCaps * superset)
 {
   GstStructure *s1, *s2;
   GstCapsFeatures *f1, *f2;
-  gboolean ret = TRUE;
+  gboolean ret = TRUE, memoize = FALSE;
   gint i, j;
 
   g_return_val_if_fail (subset != NULL, FALSE);
@@ -1183,6 +1479,14 @@ gst_caps_is_subset (const GstCaps * subset, const GstCaps * superset)
   if (CAPS_IS_ANY (subset) || CAPS_IS_EMPTY (superset))
     return FALSE;
 
+  if (CAPS_IS_INTERNED (subset) && CAPS_IS_INTERNED (superset)) {
+    if (subset == superset)
+      return TRUE;
+    if (memo_lookup (subset, superset, MEMO_SUBSET, &ret, NULL))
+      return ret;
+    memoize = TRUE;
+  }
+
   for (i = GST_CAPS_LEN (subset) - 1; i >= 0; i--) {
     for (j = GST_CAPS_LEN (superset) - 1; j >= 0; j--) {
       s1 = gst_caps_get_structure_unchecked (subset, i);
@@ -1194,7 +1498,7 @@ gst_caps_is_subset (const GstCaps * subset, const GstCaps * superset)
       if (!f2)
         f2 = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
       if ((!gst_caps_features_is_any (f1) || gst_caps_features_is_any (f2)) &&
-          gst_caps_features_is_equal (f1, f2)
+          gst_caps_features_is_equal_fast (f1, f2)
           && gst_structure_is_subset (s1, s2)) {
         /* If we found a superset, continue with the next
          * subset structure */
@@ -1209,6 +1513,9 @@ gst_caps_is_subset (const GstCaps * subset, const GstCaps * superset)
     }
   }
 
+  if (memoize)
+    memo_store (subset, superset, MEMO_SUBSET, ret, NULL);
+
   return ret;
 }
 
@@ -1286,7 +1593,7 @@ gst_caps_is_subset_structure_full (const GstCaps * caps,
     if (!f)
       f = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
     if ((!gst_caps_features_is_any (features) || gst_caps_features_is_any (f))
-        && gst_caps_features_is_equal (features, f)
+        && gst_caps_features_is_equal_fast (features, f)
         && gst_structure_is_subset (structure, s)) {
       /* If we found a superset return TRUE */
       return TRUE;
@@ -1314,8 +1621,12 @@ gst_caps_is_equal (const GstCaps * caps1, const GstCaps * caps2)
   if (G_UNLIKELY (caps1 == caps2))
     return TRUE;
 
-  if (G_UNLIKELY (gst_caps_is_fixed (caps1) && gst_caps_is_fixed (caps2)))
+  if (G_UNLIKELY (gst_caps_is_fixed (caps1) && gst_caps_is_fixed (caps2))) {
+    /* there is only one interned instance of any fixed caps */
+    if (CAPS_IS_INTERNED (caps1) && CAPS_IS_INTERNED (caps2))
+      return FALSE;
     return gst_caps_is_equal_fixed (caps1, caps2);
+  }
 
   return gst_caps_is_subset (caps1, caps2) && gst_caps_is_subset (caps2, caps1);
 }
@@ -1342,6 +1653,10 @@ gst_caps_is_strictly_equal (const GstCaps * caps1, const GstCaps * caps2)
   if (G_UNLIKELY (caps1 == caps2))
     return TRUE;
 
+  /* strictly equal caps are interned to the same instance */
+  if (CAPS_IS_INTERNED (caps1) && CAPS_IS_INTERNED (caps2))
+    return FALSE;
+
   if (GST_CAPS_LEN (caps1) != GST_CAPS_LEN (caps2))
     return FALSE;
 
@@ -1356,7 +1671,7 @@ gst_caps_is_strictly_equal (const GstCaps * caps1, const GstCaps * caps2)
       f2 = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
 
     if (gst_caps_features_is_any (f1) != gst_caps_features_is_any (f2) ||
-        !gst_caps_features_is_equal (f1, f2) ||
+        !gst_caps_features_is_equal_fast (f1, f2) ||
         !gst_structure_is_equal (s1, s2))
       return FALSE;
   }
@@ -1364,8 +1679,201 @@ gst_caps_is_strictly_equal (const GstCaps * caps1, const GstCaps * caps2)
   return TRUE;
 }
 
+/**
+ * gst_caps_intern:
+ * @caps: (transfer full): a #GstCaps
+ *
+ * Gets the shared instance of caps that are strictly equal to @caps, see
+ * gst_caps_is_strictly_equal(). The first caps that are interned become the
+ * shared instance. Interned caps are never writable, use
+ * gst_caps_make_writable() to get a copy that can be modified.
+ *
+ * Strictly equal interned caps are the same pointer, which makes the
+ * comparisons between interned caps cheap. The results of
+ * gst_caps_is_subset() and gst_caps_intersect() on two interned caps are
+ * cached, the intersection of interned caps is interned as well.
+ *
+ * Returns: (transfer full): the interned caps
+ *
+ * Since: 1.2
+ */
+GstCaps *
+gst_caps_intern (GstCaps * caps)
+{
+  GstCaps *interned;
+  guint hash;
+
+  g_return_val_if_fail (GST_IS_CAPS (caps), NULL);
+
+  if (CAPS_IS_INTERNED (caps))
+    return caps;
+
+  hash = intern_hash_caps (caps);
+
+  G_LOCK (intern_lock);
+  if (G_UNLIKELY (intern_table == NULL))
+    intern_table = g_hash_table_new (intern_table_hash, intern_table_equal);
+
+  ((GstCapsImpl *) caps)->intern_hash = hash;
+  interned = g_hash_table_lookup (intern_table, caps);
+  if (interned) {
+    gst_caps_ref (interned);
+    G_UNLOCK (intern_lock);
+
+    gst_caps_unref (caps);
+    return interned;
+  }
+
+  if (g_hash_table_size (intern_table) >= intern_sweep_at)
+    intern_table_sweep ();
+
+  CAPS_INTERN_ID (caps) = intern_next_id++;
+  g_hash_table_insert (intern_table, gst_caps_ref (caps), NULL);
+  G_UNLOCK (intern_lock);
+
+  GST_CAT_TRACE (GST_CAT_CAPS, "interned caps %p", caps);
+
+  return caps;
+}
+
 /* intersect operation */
 
+/* caps with at least this many structure pairs are intersected with the help
+ * of an index of the structures of the second caps sorted by name */
+#define NAME_INDEX_MIN_PAIRS 256
+
+typedef struct
+{
+  GQuark name;
+  guint index;
+} CapsNameIndex;
+
+typedef struct
+{
+  guint j;
+  guint k;
+} CapsPair;
+
+/* cheap check that rules out most structure pairs that can't intersect,
+ * structures with different names or features */
+static inline gboolean
+gst_caps_structures_compatible (const GstStructure * struct1,
+    GstCapsFeatures * features1, const GstStructure * struct2,
+    GstCapsFeatures * features2)
+{
+  if (struct1->name != struct2->name)
+    return FALSE;
+  if (features1 == features2)
+    return TRUE;
+
+  if (!features1)
+    features1 = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
+  if (!features2)
+    features2 = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
+
+  return gst_caps_features_is_equal_fast (features1, features2);
+}
+
+static gint
+name_index_compare (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  const CapsNameIndex *n1 = a, *n2 = b;
+
+  if (n1->name != n2->name)
+    return n1->name < n2->name ? -1 : 1;
+  /* keep the caps order within a name */
+  return n1->index < n2->index ? -1 : (n1->index > n2->index ? 1 : 0);
+}
+
+/* make an index of the structures of @caps sorted by name */
+static CapsNameIndex *
+gst_caps_name_index_new (const GstCaps * caps)
+{
+  CapsNameIndex *index;
+  guint i, len;
+
+  len = GST_CAPS_LEN (caps);
+  index = g_new (CapsNameIndex, len);
+  for (i = 0; i < len; i++) {
+    index[i].name = gst_caps_get_structure_unchecked (caps, i)->name;
+    index[i].index = i;
+  }
+  g_qsort_with_data (index, len, sizeof (CapsNameIndex), name_index_compare,
+      NULL);
+
+  return index;
+}
+
+/* find the first entry of @index for @name, @n is set to the number of
+ * structures with @name */
+static guint
+gst_caps_name_index_find (const CapsNameIndex * index, guint len, GQuark name,
+    guint * n)
+{
+  guint lo = 0, hi = len, end;
+
+  while (lo < hi) {
+    guint mid = (lo + hi) / 2;
+
+    if (index[mid].name < name)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  for (end = lo; end < len && index[end].name == name; end++);
+  *n = end - lo;
+
+  return lo;
+}
+
+/* order of the zig-zag iteration, see gst_caps_intersect_zig_zag() */
+static gint
+zig_zag_compare (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  const CapsPair *p1 = a, *p2 = b;
+  guint d1 = p1->j + p1->k, d2 = p2->j + p2->k;
+
+  if (d1 != d2)
+    return d1 < d2 ? -1 : 1;
+  return p1->j > p2->j ? -1 : (p1->j < p2->j ? 1 : 0);
+}
+
+/* intersect structure @j of @caps1 with structure @k of @caps2 and merge the
+ * result into @dest */
+static GstCaps *
+gst_caps_intersect_pair (GstCaps * dest, GstCaps * caps1, guint j,
+    GstCaps * caps2, guint k)
+{
+  GstStructure *struct1, *struct2, *istruct;
+  GstCapsFeatures *features1, *features2;
+
+  struct1 = gst_caps_get_structure_unchecked (caps1, j);
+  features1 = gst_caps_get_features_unchecked (caps1, j);
+  struct2 = gst_caps_get_structure_unchecked (caps2, k);
+  features2 = gst_caps_get_features_unchecked (caps2, k);
+
+  if (!gst_caps_structures_compatible (struct1, features1, struct2, features2))
+    return dest;
+
+  if (!features1)
+    features1 = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
+  if (!features2)
+    features2 = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
+
+  istruct = gst_structure_intersect (struct1, struct2);
+  if (istruct) {
+    if (gst_caps_features_is_any (features1))
+      dest =
+          gst_caps_merge_structure_full (dest, istruct,
+          gst_caps_features_copy_conditional (features2));
+    else
+      dest =
+          gst_caps_merge_structure_full (dest, istruct,
+          gst_caps_features_copy_conditional (features1));
+  }
+  return dest;
+}
+
 /**
  * gst_caps_can_intersect:
  * @caps1: a #GstCaps to intersect
@@ -1401,6 +1909,33 @@ gst_caps_can_intersect (const GstCaps * caps1, const GstCaps * caps2)
   if (G_UNLIKELY (CAPS_IS_ANY (caps1) || CAPS_IS_ANY (caps2)))
     return TRUE;
 
+  len1 = GST_CAPS_LEN (caps1);
+  len2 = GST_CAPS_LEN (caps2);
+
+  /* for large caps only try the structures with the same name, the order
+   * does not matter here */
+  if ((guint64) len1 * len2 >= NAME_INDEX_MIN_PAIRS) {
+    CapsNameIndex *index;
+    gboolean ret = FALSE;
+    guint start, n;
+
+    index = gst_caps_name_index_new (caps2);
+    for (j = 0; j < len1 && !ret; j++) {
+      struct1 = gst_caps_get_structure_unchecked (caps1, j);
+      features1 = gst_caps_get_features_unchecked (caps1, j);
+      start = gst_caps_name_index_find (index, len2, struct1->name, &n);
+      for (k = start; k < start + n && !ret; k++) {
+        struct2 = gst_caps_get_structure_unchecked (caps2, index[k].index);
+        features2 = gst_caps_get_features_unchecked (caps2, index[k].index);
+        ret = gst_caps_structures_compatible (struct1, features1, struct2,
+            features2) && gst_structure_can_intersect (struct1, struct2);
+      }
+    }
+    g_free (index);
+
+    return ret;
+  }
+
   /* run zigzag on top line then right line, this preserves the caps order
    * much better than a simple loop.
    *
@@ -1418,8 +1953,6 @@ gst_caps_can_intersect (const GstCaps * caps1, const GstCaps * caps2)
    * structures. The result is that the intersections are ordered based on the
    * sum of the indexes in the list.
    */
-  len1 = GST_CAPS_LEN (caps1);
-  len2 = GST_CAPS_LEN (caps2);
   for (i = 0; i < len1 + len2 - 1; i++) {
     /* superset index goes from 0 to sgst_caps_structure_intersectuperset->structs->len-1 */
     j = MIN (i, len1 - 1);
@@ -1431,14 +1964,10 @@ gst_caps_can_intersect (const GstCaps * caps1, const GstCaps * caps2)
     while (k < len2) {
       struct1 = gst_caps_get_structure_unchecked (caps1, j);
       features1 = gst_caps_get_features_unchecked (caps1, j);
-      if (!features1)
-        features1 = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
       struct2 = gst_caps_get_structure_unchecked (caps2, k);
       features2 = gst_caps_get_features_unchecked (caps2, k);
-      if (!features2)
-        features2 = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
-      if (gst_caps_features_is_equal (features1, features2) &&
-          gst_structure_can_intersect (struct1, struct2)) {
+      if (gst_caps_structures_compatible (struct1, features1, struct2,
+              features2) && gst_structure_can_intersect (struct1, struct2)) {
         return TRUE;
       }
       /* move down left */
@@ -1452,17 +1981,65 @@ gst_caps_can_intersect (const GstCaps * caps1, const GstCaps * caps2)
   return FALSE;
 }
 
+/* zig-zag intersection of large caps, only the pairs of structures with the
+ * same name are intersected, in the zig-zag order. Returns %NULL when most
+ * pairs have the same name and the plain iteration is faster. */
+static GstCaps *
+gst_caps_intersect_zig_zag_indexed (GstCaps * caps1, GstCaps * caps2)
+{
+  CapsNameIndex *index;
+  CapsPair *pairs;
+  guint j, k, len1, len2, start, n, n_pairs;
+  guint64 max_pairs;
+  GstCaps *dest;
+
+  len1 = GST_CAPS_LEN (caps1);
+  len2 = GST_CAPS_LEN (caps2);
+  max_pairs = (guint64) len1 * len2 / 2;
+
+  index = gst_caps_name_index_new (caps2);
+
+  n_pairs = 0;
+  for (j = 0; j < len1; j++) {
+    gst_caps_name_index_find (index, len2,
+        gst_caps_get_structure_unchecked (caps1, j)->name, &n);
+    n_pairs += n;
+    if (n_pairs > max_pairs) {
+      g_free (index);
+      return NULL;
+    }
+  }
+
+  pairs = g_new (CapsPair, MAX (n_pairs, 1));
+  n_pairs = 0;
+  for (j = 0; j < len1; j++) {
+    start = gst_caps_name_index_find (index, len2,
+        gst_caps_get_structure_unchecked (caps1, j)->name, &n);
+    for (k = start; k < start + n; k++) {
+      pairs[n_pairs].j = j;
+      pairs[n_pairs].k = index[k].index;
+      n_pairs++;
+    }
+  }
+  g_free (index);
+
+  g_qsort_with_data (pairs, n_pairs, sizeof (CapsPair), zig_zag_compare, NULL);
+
+  dest = gst_caps_new_empty ();
+  for (j = 0; j < n_pairs; j++)
+    dest = gst_caps_intersect_pair (dest, caps1, pairs[j].j, caps2,
+        pairs[j].k);
+  g_free (pairs);
+
+  return dest;
+}
+
 static GstCaps *
 gst_caps_intersect_zig_zag (GstCaps * caps1, GstCaps * caps2)
 {
   guint64 i;                    /* index can be up to 2 * G_MAX_UINT */
   guint j, k, len1, len2;
-  GstStructure *struct1;
-  GstStructure *struct2;
-  GstCapsFeatures *features1;
-  GstCapsFeatures *features2;
   GstCaps *dest;
-  GstStructure *istruct;
 
   /* caps are exactly the same pointers, just copy one caps */
   if (G_UNLIKELY (caps1 == caps2))
@@ -1479,6 +2056,13 @@ gst_caps_intersect_zig_zag (GstCaps * caps1, GstCaps * caps2)
   if (G_UNLIKELY (CAPS_IS_ANY (caps2)))
     return gst_caps_ref (caps1);
 
+  len1 = GST_CAPS_LEN (caps1);
+  len2 = GST_CAPS_LEN (caps2);
+
+  if ((guint64) len1 * len2 >= NAME_INDEX_MIN_PAIRS &&
+      (dest = gst_caps_intersect_zig_zag_indexed (caps1, caps2)))
+    return dest;
+
   dest = gst_caps_new_empty ();
   /* run zigzag on top line then right line, this preserves the caps order
    * much better than a simple loop.
@@ -1496,8 +2080,6 @@ gst_caps_intersect_zig_zag (GstCaps * caps1, GstCaps * caps2)
    * the structures diagonally down, then we iterate over the caps2
    * structures.
    */
-  len1 = GST_CAPS_LEN (caps1);
-  len2 = GST_CAPS_LEN (caps2);
   for (i = 0; i < len1 + len2 - 1; i++) {
     /* caps1 index goes from 0 to GST_CAPS_LEN (caps1)-1 */
     j = MIN (i, len1 - 1);
@@ -1507,27 +2089,7 @@ gst_caps_intersect_zig_zag (GstCaps * caps1, GstCaps * caps2)
     /* now run the diagonal line, end condition is the left or bottom
      * border */
     while (k < len2) {
-      struct1 = gst_caps_get_structure_unchecked (caps1, j);
-      features1 = gst_caps_get_features_unchecked (caps1, j);
-      if (!features1)
-        features1 = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
-      struct2 = gst_caps_get_structure_unchecked (caps2, k);
-      features2 = gst_caps_get_features_unchecked (caps2, k);
-      if (!features2)
-        features2 = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
-      if (gst_caps_features_is_equal (features1, features2)) {
-        istruct = gst_structure_intersect (struct1, struct2);
-        if (istruct) {
-          if (gst_caps_features_is_any (features1))
-            dest =
-                gst_caps_merge_structure_full (dest, istruct,
-                gst_caps_features_copy_conditional (features2));
-          else
-            dest =
-                gst_caps_merge_structure_full (dest, istruct,
-                gst_caps_features_copy_conditional (features1));
-        }
-      }
+      dest = gst_caps_intersect_pair (dest, caps1, j, caps2, k);
       /* move down left */
       k++;
       if (G_UNLIKELY (j == 0))
@@ -1556,12 +2118,7 @@ gst_caps_intersect_first (GstCaps * caps1, GstCaps * caps2)
 {
   guint i;
   guint j, len1, len2;
-  GstStructure *struct1;
-  GstStructure *struct2;
-  GstCapsFeatures *features1;
-  GstCapsFeatures *features2;
   GstCaps *dest;
-  GstStructure *istruct;
 
   /* caps are exactly the same pointers, just copy one caps */
   if (G_UNLIKELY (caps1 == caps2))
@@ -1581,35 +2138,58 @@ gst_caps_intersect_first (GstCaps * caps1, GstCaps * caps2)
   dest = gst_caps_new_empty ();
   len1 = GST_CAPS_LEN (caps1);
   len2 = GST_CAPS_LEN (caps2);
-  for (i = 0; i < len1; i++) {
-    struct1 = gst_caps_get_structure_unchecked (caps1, i);
-    features1 = gst_caps_get_features_unchecked (caps1, i);
-    if (!features1)
-      features1 = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
-    for (j = 0; j < len2; j++) {
-      struct2 = gst_caps_get_structure_unchecked (caps2, j);
-      features2 = gst_caps_get_features_unchecked (caps2, j);
-      if (!features2)
-        features2 = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
-      if (gst_caps_features_is_equal (features1, features2)) {
-        istruct = gst_structure_intersect (struct1, struct2);
-        if (istruct) {
-          if (gst_caps_features_is_any (features1))
-            dest =
-                gst_caps_merge_structure_full (dest, istruct,
-                gst_caps_features_copy_conditional (features2));
-          else
-            dest =
-                gst_caps_merge_structure_full (dest, istruct,
-                gst_caps_features_copy_conditional (features1));
-        }
-      }
+
+  /* for large caps, only visit the structures of caps2 with the same name,
+   * the index keeps them in caps order */
+  if ((guint64) len1 * len2 >= NAME_INDEX_MIN_PAIRS) {
+    CapsNameIndex *index;
+    guint start, n;
+
+    index = gst_caps_name_index_new (caps2);
+    for (i = 0; i < len1; i++) {
+      start = gst_caps_name_index_find (index, len2,
+          gst_caps_get_structure_unchecked (caps1, i)->name, &n);
+      for (j = start; j < start + n; j++)
+        dest = gst_caps_intersect_pair (dest, caps1, i, caps2, index[j].index);
     }
+    g_free (index);
+
+    return dest;
+  }
+
+  for (i = 0; i < len1; i++) {
+    for (j = 0; j < len2; j++)
+      dest = gst_caps_intersect_pair (dest, caps1, i, caps2, j);
   }
 
   return dest;
 }
 
+/* intersect two interned caps, the result is interned and cached */
+static GstCaps *
+gst_caps_intersect_interned (GstCaps * caps1, GstCaps * caps2,
+    GstCapsIntersectMode mode)
+{
+  GstCaps *result;
+  MemoOp op;
+
+  op = mode == GST_CAPS_INTERSECT_FIRST ? MEMO_INTERSECT_FIRST :
+      MEMO_INTERSECT_ZIG_ZAG;
+
+  if (memo_lookup (caps1, caps2, op, NULL, &result))
+    return result;
+
+  if (mode == GST_CAPS_INTERSECT_FIRST)
+    result = gst_caps_intersect_first (caps1, caps2);
+  else
+    result = gst_caps_intersect_zig_zag (caps1, caps2);
+
+  result = gst_caps_intern (result);
+  memo_store (caps1, caps2, op, FALSE, result);
+
+  return result;
+}
+
 /**
  * gst_caps_intersect_full:
  * @caps1: a #GstCaps to intersect
@@ -1629,6 +2209,11 @@ gst_caps_intersect_full (GstCaps * caps1, GstCaps * caps2,
   g_return_val_if_fail (GST_IS_CAPS (caps1), NULL);
   g_return_val_if_fail (GST_IS_CAPS (caps2), NULL);
 
+  if (CAPS_IS_INTERNED (caps1) && CAPS_IS_INTERNED (caps2) && caps1 != caps2
+      && (mode == GST_CAPS_INTERSECT_FIRST
+          || mode == GST_CAPS_INTERSECT_ZIG_ZAG))
+    return gst_caps_intersect_interned (caps1, caps2, mode);
+
   switch (mode) {
     case GST_CAPS_INTERSECT_FIRST:
       return gst_caps_intersect_first (caps1, caps2);
@@ -1886,12 +2471,46 @@ gst_caps_normalize (GstCaps * caps)
   return nf.caps;
 }
 
+/* orders features so that equal features are next to each other */
+static gint
+gst_caps_compare_features (const GstCapsFeatures * f1,
+    const GstCapsFeatures * f2)
+{
+  guint i, n1, n2;
+
+  if (!f1)
+    f1 = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
+  if (!f2)
+    f2 = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
+
+  if (gst_caps_features_is_any (f1) != gst_caps_features_is_any (f2))
+    return gst_caps_features_is_any (f1) ? 1 : -1;
+  if (gst_caps_features_is_equal (f1, f2))
+    return 0;
+
+  n1 = gst_caps_features_get_size (f1);
+  n2 = gst_caps_features_get_size (f2);
+  if (n1 != n2)
+    return n1 < n2 ? -1 : 1;
+
+  for (i = 0; i < n1; i++) {
+    GQuark id1 = gst_caps_features_get_nth_id (f1, i);
+    GQuark id2 = gst_caps_features_get_nth_id (f2, i);
+
+    if (id1 != id2)
+      return id1 < id2 ? -1 : 1;
+  }
+  return 0;
+}
+
 static gint
 gst_caps_compare_structures (gconstpointer one, gconstpointer two)
 {
   gint ret;
-  const GstStructure *struct1 = ((const GstCapsArrayElement *) one)->structure;
-  const GstStructure *struct2 = ((const GstCapsArrayElement *) two)->structure;
+  const GstCapsArrayElement *elem1 = one;
+  const GstCapsArrayElement *elem2 = two;
+  const GstStructure *struct1 = elem1->structure;
+  const GstStructure *struct2 = elem2->structure;
 
   /* FIXME: this orders alphabetically, but ordering the quarks might be faster
      So what's the best way? */
@@ -1901,6 +2520,12 @@ gst_caps_compare_structures (gconstpointer one, gconstpointer two)
   if (ret)
     return ret;
 
+  /* only structures with the same features can be merged, keep them
+   * together */
+  ret = gst_caps_compare_features (elem1->features, elem2->features);
+  if (ret)
+    return ret;
+
   return gst_structure_n_fields (struct2) - gst_structure_n_fields (struct1);
 }
 
@@ -2009,6 +2634,252 @@ gst_caps_switch_structures (GstCaps * caps, GstStructure * old,
   g_array_index (GST_CAPS_ARRAY (caps), GstCapsArrayElement, i).structure = new;
 }
 
+/* a structure in gst_caps_simplify_merge() */
+typedef struct
+{
+  GstStructure *structure;
+  GstCapsFeatures *features;
+  /* the field that is merged in the current pass */
+  GQuark field;
+  /* the hash of the name, features and all fields but field */
+  guint hash;
+  /* the union of field of the structures merged into this one */
+  GValue merged;
+  gboolean removed;
+} SimplifyEntry;
+
+typedef struct
+{
+  const GstStructure *other;
+  GQuark field;
+} SimplifyCompare;
+
+static guint
+simplify_entry_hash (gconstpointer key)
+{
+  return ((const SimplifyEntry *) key)->hash;
+}
+
+static gboolean
+simplify_compare_field (GQuark field_id, const GValue * value,
+    gpointer user_data)
+{
+  SimplifyCompare *c = user_data;
+  const GValue *other;
+
+  if (!(other = gst_structure_id_get_value (c->other, field_id)))
+    return FALSE;
+
+  return field_id == c->field ||
+      gst_value_compare (value, other) == GST_VALUE_EQUAL;
+}
+
+/* entries are equal when their structures have the same name, features and
+ * fields, and only the values of field are different */
+static gboolean
+simplify_entry_equal (gconstpointer a, gconstpointer b)
+{
+  const SimplifyEntry *e1 = a, *e2 = b;
+  const GstCapsFeatures *f1, *f2;
+  SimplifyCompare c;
+
+  if (gst_structure_get_name_id (e1->structure) !=
+      gst_structure_get_name_id (e2->structure) ||
+      gst_structure_n_fields (e1->structure) !=
+      gst_structure_n_fields (e2->structure))
+    return FALSE;
+
+  f1 = e1->features ? e1->features : GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
+  f2 = e2->features ? e2->features : GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
+  /* ANY features are only merged with ANY features */
+  if (gst_caps_features_is_any (f1) != gst_caps_features_is_any (f2) ||
+      !gst_caps_features_is_equal (f1, f2))
+    return FALSE;
+
+  c.other = e2->structure;
+  c.field = e1->field;
+  return gst_structure_foreach (e1->structure, simplify_compare_field, &c);
+}
+
+/* add @value to the union in @merged */
+static void
+simplify_merge_value (GValue * merged, const GValue * value)
+{
+  GValue res = G_VALUE_INIT;
+
+  /* add fixed values to lists in place, copying the list for every value
+   * would be quadratic */
+  if (GST_VALUE_HOLDS_LIST (merged) && gst_value_is_fixed (value)) {
+    guint i, n = gst_value_list_get_size (merged);
+
+    for (i = 0; i < n; i++) {
+      if (gst_value_compare (gst_value_list_get_value (merged, i),
+              value) == GST_VALUE_EQUAL)
+        return;
+    }
+    gst_value_list_append_value (merged, value);
+    return;
+  }
+
+  if (gst_value_compare (merged, value) == GST_VALUE_EQUAL)
+    return;
+
+  gst_value_union (&res, merged, value);
+  g_value_unset (merged);
+  *merged = res;
+}
+
+static gboolean
+simplify_collect_field (GQuark field_id, const GValue * value,
+    gpointer user_data)
+{
+  GArray *fields = user_data;
+  guint i;
+
+  for (i = 0; i < fields->len; i++) {
+    if (g_array_index (fields, GQuark, i) == field_id)
+      return TRUE;
+  }
+  g_array_append_val (fields, field_id);
+
+  return TRUE;
+}
+
+/* merge the structures of @caps that have the same name, features and
+ * fields and only differ in the value of one field into one structure with
+ * the union of the values. For every field, the structures are hashed on
+ * everything but that field so that this is linear in the number of
+ * structures. */
+static void
+gst_caps_simplify_merge (GstCaps * caps)
+{
+  SimplifyEntry *entries;
+  GHashTable *table;
+  GArray *fields;
+  gboolean removed = FALSE;
+  guint i, j, k, n;
+
+  n = GST_CAPS_LEN (caps);
+  entries = g_new0 (SimplifyEntry, n);
+  fields = g_array_new (FALSE, FALSE, sizeof (GQuark));
+  for (i = 0; i < n; i++) {
+    entries[i].structure = gst_caps_get_structure_unchecked (caps, i);
+    entries[i].features = gst_caps_get_features_unchecked (caps, i);
+    gst_structure_foreach (entries[i].structure, simplify_collect_field,
+        fields);
+  }
+
+  table = g_hash_table_new (simplify_entry_hash, simplify_entry_equal);
+  for (k = 0; k < fields->len; k++) {
+    GQuark field = g_array_index (fields, GQuark, k);
+
+    for (i = 0; i < n; i++) {
+      SimplifyEntry *e = &entries[i], *first;
+      const GValue *value;
+      guint h = 0;
+
+      if (e->removed ||
+          !(value = gst_structure_id_get_value (e->structure, field)))
+        continue;
+
+      /* the field hashes are added, remove the one of field */
+      e->field = field;
+      e->hash = intern_hash_structure_name (e->structure, e->features);
+      gst_structure_foreach (e->structure, intern_hash_field, &e->hash);
+      intern_hash_field (field, value, &h);
+      e->hash -= h;
+
+      if (!(first = g_hash_table_lookup (table, e))) {
+        g_hash_table_add (table, e);
+        continue;
+      }
+
+      if (!G_IS_VALUE (&first->merged))
+        gst_value_init_and_copy (&first->merged,
+            gst_structure_id_get_value (first->structure, field));
+      simplify_merge_value (&first->merged, value);
+      e->removed = removed = TRUE;
+    }
+
+    for (i = 0; i < n; i++) {
+      if (G_IS_VALUE (&entries[i].merged)) {
+        gst_structure_id_take_value (entries[i].structure, field,
+            &entries[i].merged);
+        memset (&entries[i].merged, 0, sizeof (GValue));
+      }
+    }
+    g_hash_table_remove_all (table);
+  }
+  g_hash_table_destroy (table);
+  g_array_free (fields, TRUE);
+
+  if (removed) {
+    GArray *array = GST_CAPS_ARRAY (caps);
+
+    for (i = 0, j = 0; i < n; i++) {
+      GstCapsArrayElement *elem = &g_array_index (array, GstCapsArrayElement,
+          i);
+
+      if (entries[i].removed) {
+        gst_structure_set_parent_refcount (elem->structure, NULL);
+        gst_structure_free (elem->structure);
+        if (elem->features) {
+          gst_caps_features_set_parent_refcount (elem->features, NULL);
+          gst_caps_features_free_conditional (elem->features);
+        }
+      } else {
+        g_array_index (array, GstCapsArrayElement, j++) = *elem;
+      }
+    }
+    g_array_set_size (array, j);
+  }
+  g_free (entries);
+}
+
+/* check if all structures of @caps have a different name, then none of them
+ * can be merged */
+static gboolean
+gst_caps_has_unique_names (const GstCaps * caps)
+{
+  GHashTable *names;
+  gboolean res = TRUE;
+  guint i, j, n;
+
+  n = GST_CAPS_LEN (caps);
+  if (n < 2)
+    return TRUE;
+
+  if (n <= 16) {
+    for (i = 1; i < n; i++) {
+      GQuark name =
+          gst_structure_get_name_id (gst_caps_get_structure_unchecked (caps,
+              i));
+
+      for (j = 0; j < i; j++) {
+        if (gst_structure_get_name_id (gst_caps_get_structure_unchecked (caps,
+                    j)) == name)
+          return FALSE;
+      }
+    }
+    return TRUE;
+  }
+
+  names = g_hash_table_new (NULL, NULL);
+  for (i = 0; i < n && res; i++) {
+    gpointer name =
+        GUINT_TO_POINTER (gst_structure_get_name_id
+        (gst_caps_get_structure_unchecked (caps, i)));
+
+    if (g_hash_table_contains (names, name))
+      res = FALSE;
+    else
+      g_hash_table_add (names, name);
+  }
+  g_hash_table_destroy (names);
+
+  return res;
+}
+
 /**
  * gst_caps_simplify:
  * @caps: (transfer full): a #GstCaps to simplify
@@ -2031,13 +2902,21 @@ gst_caps_simplify (GstCaps * caps)
 
   g_return_val_if_fail (GST_IS_CAPS (caps), NULL);
 
-  start = GST_CAPS_LEN (caps) - 1;
-  /* one caps, already as simple as can be */
-  if (start == 0)
+  /* structures with different names can't be merged, this also covers
+   * caps with less than two structures */
+  if (gst_caps_has_unique_names (caps))
     return caps;
 
   caps = gst_caps_make_writable (caps);
 
+  /* first merge the structures that only differ in one field, which is the
+   * common case and leaves few structures for the pairwise merging */
+  gst_caps_simplify_merge (caps);
+  if (gst_caps_has_unique_names (caps))
+    return caps;
+
+  start = GST_CAPS_LEN (caps) - 1;
+
   g_array_sort (GST_CAPS_ARRAY (caps), gst_caps_compare_structures);
 
   for (i = start; i >= 0; i--) {
@@ -2105,7 +2984,7 @@ gst_caps_fixate (GstCaps * caps)
   gst_structure_fixate (s);
 
   /* Set features to sysmem if they're still ANY */
-  f = gst_caps_get_features (caps, 0);
+  f = gst_caps_get_features_unchecked (caps, 0);
   if (f && gst_caps_features_is_any (f)) {
     f = gst_caps_features_new_empty ();
     gst_caps_set_features (caps, 0, f);
@@ -2201,7 +3080,9 @@ static gboolean
 gst_caps_from_string_inplace (GstCaps * caps, const gchar * string)
 {
   GstStructure *structure;
+  gchar buf[PRIV_GST_PARSE_BUFFER_SIZE];
   gchar *s, *copy, *end, *next, save;
+  gboolean ret = FALSE;
 
   if (strcmp ("ANY", string) == 0) {
     GST_CAPS_FLAGS (caps) = GST_CAPS_FLAG_ANY;
@@ -2212,7 +3093,8 @@ gst_caps_from_string_inplace (GstCaps * caps, const gchar * string)
     return TRUE;
   }
 
-  copy = s = g_strdup (string);
+  /* parse in place in a copy of the string, on the stack for most caps */
+  copy = s = priv_gst_parse_buffer_init (buf, string);
   do {
     GstCapsFeatures *features = NULL;
 
@@ -2223,8 +3105,7 @@ gst_caps_from_string_inplace (GstCaps * caps, const gchar * string)
     }
 
     if (!priv_gst_structure_parse_name (s, &s, &end, &next)) {
-      g_free (copy);
-      return FALSE;
+      goto done;
     }
 
     save = *end;
@@ -2233,8 +3114,7 @@ gst_caps_from_string_inplace (GstCaps * caps, const gchar * string)
     *end = save;
 
     if (structure == NULL) {
-      g_free (copy);
-      return FALSE;
+      goto done;
     }
 
     s = next;
@@ -2262,8 +3142,7 @@ gst_caps_from_string_inplace (GstCaps * caps, const gchar * string)
       features = gst_caps_features_from_string (s);
       if (!features) {
         gst_structure_free (structure);
-        g_free (copy);
-        return FALSE;
+        goto done;
       }
       *end = save;
       s = end;
@@ -2277,19 +3156,23 @@ gst_caps_from_string_inplace (GstCaps * caps, const gchar * string)
 
     if (!priv_gst_structure_parse_fields (s, &s, structure)) {
       gst_structure_free (structure);
-      g_free (copy);
-      return FALSE;
+      goto done;
     }
 
   append:
+    if (features)
+      features = priv_gst_caps_features_intern (features);
     gst_caps_append_structure_unchecked (caps, structure, features);
     if (*s == '\0')
       break;
   } while (TRUE);
+  ret = TRUE;
 
-  g_free (copy);
+done:
+  if (copy != buf)
+    g_free (copy);
 
-  return TRUE;
+  return ret;
 }
 
 /**
@@ -2316,6 +3199,120 @@ gst_caps_from_string (const gchar * string)
   }
 }
 
+/* binary caps: the magic, a version and flags byte, the number of structures
+ * and the structures */
+#define CAPS_BINARY_MAGIC       "GstC"
+#define CAPS_BINARY_VERSION     1
+#define CAPS_BINARY_HEADER_SIZE 10
+#define CAPS_BINARY_FLAG_ANY    (1 << 0)
+
+/**
+ * gst_caps_to_binary:
+ * @caps: a #GstCaps
+ * @size: (out): the size of the returned data
+ *
+ * Converts @caps to a compact binary representation that can be converted
+ * back with gst_caps_from_binary() much faster than the string
+ * representation can be parsed. The format doesn't depend on the byte order
+ * of the machine but it is only meant to be read by the same version of
+ * GStreamer, for example in a cache.
+ *
+ * Returns: (transfer full) (array length=size): a newly allocated buffer
+ *     with the binary representation of @caps. Free with g_free() after use.
+ *
+ * Since: 1.2
+ */
+guint8 *
+gst_caps_to_binary (const GstCaps * caps, gsize * size)
+{
+  GByteArray *data;
+  guint8 header[CAPS_BINARY_HEADER_SIZE];
+  guint i, n;
+
+  g_return_val_if_fail (GST_IS_CAPS (caps), NULL);
+  g_return_val_if_fail (size != NULL, NULL);
+
+  n = GST_CAPS_LEN (caps);
+
+  memcpy (header, CAPS_BINARY_MAGIC, 4);
+  header[4] = CAPS_BINARY_VERSION;
+  header[5] = CAPS_IS_ANY (caps) ? CAPS_BINARY_FLAG_ANY : 0;
+  GST_WRITE_UINT32_LE (header + 6, n);
+
+  data = g_byte_array_sized_new (CAPS_BINARY_HEADER_SIZE + n * 64);
+  g_byte_array_append (data, header, CAPS_BINARY_HEADER_SIZE);
+  for (i = 0; i < n; i++) {
+    priv_gst_structure_write_binary (gst_caps_get_structure_unchecked (caps,
+            i), gst_caps_get_features_unchecked (caps, i), data);
+  }
+
+  *size = data->len;
+  return g_byte_array_free (data, FALSE);
+}
+
+/**
+ * gst_caps_from_binary:
+ * @data: (array length=size): the binary representation of a #GstCaps
+ * @size: the size of @data
+ *
+ * Converts @data, which was made with gst_caps_to_binary(), back to a
+ * #GstCaps. No string parsing is done except for field values of types that
+ * have no compact representation. All reads are checked against @size.
+ *
+ * Returns: (transfer full): a newly allocated #GstCaps or %NULL when @data
+ *     is invalid.
+ *
+ * Since: 1.2
+ */
+GstCaps *
+gst_caps_from_binary (const guint8 * data, gsize size)
+{
+  const guint8 *end;
+  GstCaps *caps;
+  guint32 i, n;
+
+  g_return_val_if_fail (data != NULL || size == 0, NULL);
+
+  if (size < CAPS_BINARY_HEADER_SIZE ||
+      memcmp (data, CAPS_BINARY_MAGIC, 4) != 0 ||
+      data[4] != CAPS_BINARY_VERSION)
+    return NULL;
+
+  end = data + size;
+  n = GST_READ_UINT32_LE (data + 6);
+
+  if (data[5] & CAPS_BINARY_FLAG_ANY) {
+    if (n != 0 || size != CAPS_BINARY_HEADER_SIZE)
+      return NULL;
+    return gst_caps_new_any ();
+  }
+
+  data += CAPS_BINARY_HEADER_SIZE;
+  /* every structure takes at least 10 bytes */
+  if (n > (gsize) (end - data) / 10)
+    return NULL;
+
+  caps = gst_caps_new_empty ();
+  for (i = 0; i < n; i++) {
+    GstStructure *structure;
+    GstCapsFeatures *features = NULL;
+
+    if (!(structure = priv_gst_structure_read_binary (&data, end, &features)))
+      goto error;
+    if (features)
+      features = priv_gst_caps_features_intern (features);
+    gst_caps_append_structure_unchecked (caps, structure, features);
+  }
+  if (data != end)
+    goto error;
+
+  return caps;
+
+error:
+  gst_caps_unref (caps);
+  return NULL;
+}
+
 static void
 gst_caps_transform_to_string (const GValue * src_value, GValue * dest_value)
 {
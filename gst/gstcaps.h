@@ -439,6 +439,8 @@ gboolean          gst_caps_can_intersect           (const GstCaps * caps1,
 gboolean          gst_caps_is_strictly_equal	   (const GstCaps *caps1,
 						    const GstCaps *caps2);
 
+GstCaps *         gst_caps_intern                  (GstCaps *caps) G_GNUC_WARN_UNUSED_RESULT;
+
 
 /* operations */
 GstCaps *         gst_caps_intersect               (GstCaps *caps1,
@@ -456,6 +458,10 @@ GstCaps *         gst_caps_fixate                  (GstCaps *caps) G_GNUC_WARN_U
 /* utility */
 gchar *           gst_caps_to_string               (const GstCaps *caps) G_GNUC_MALLOC;
 GstCaps *         gst_caps_from_string             (const gchar   *string) G_GNUC_WARN_UNUSED_RESULT;
+guint8 *          gst_caps_to_binary               (const GstCaps *caps,
+                                                    gsize         *size) G_GNUC_MALLOC;
+GstCaps *         gst_caps_from_binary             (const guint8  *data,
+                                                    gsize          size) G_GNUC_WARN_UNUSED_RESULT;
 
 G_END_DECLS
 
@@ -63,6 +63,8 @@ struct _GstCapsFeatures
   gint *parent_refcount;
   GArray *array;
   gboolean is_any;
+  /* shared canonical instance, see priv_gst_caps_features_intern() */
+  gboolean interned;
 };
 
 GType _gst_caps_features_type = 0;
@@ -70,12 +72,22 @@ GstCapsFeatures *_gst_caps_features_any = NULL;
 GstCapsFeatures *_gst_caps_features_memory_system_memory = NULL;
 static GQuark _gst_caps_feature_memory_system_memory = 0;
 
+/* Nearly all caps use the same few feature sets, so caps keep canonical
+ * instances of them that are shared between structures and never freed.
+ * Interned features are immutable and ignore the parent refcount, which makes
+ * copying them free and lets equal feature sets be compared by pointer. The
+ * table is bounded, rarely used sets beyond the limit are copied as before. */
+#define MAX_INTERNED_FEATURES 64
+G_LOCK_DEFINE_STATIC (interned_lock);
+static GstCapsFeatures *interned_features[MAX_INTERNED_FEATURES];
+static volatile gint n_interned_features = 0;
+
 G_DEFINE_BOXED_TYPE (GstCapsFeatures, gst_caps_features,
     gst_caps_features_copy, gst_caps_features_free);
 
 #define IS_MUTABLE(features) \
-    (!features->parent_refcount || \
-     g_atomic_int_get (features->parent_refcount) == 1)
+    (!features->interned && (!features->parent_refcount || \
+     g_atomic_int_get (features->parent_refcount) == 1))
 
 static void
 gst_caps_features_transform_to_string (const GValue * src_value,
@@ -94,9 +106,138 @@ _priv_gst_caps_features_initialize (void)
   g_value_register_transform_func (_gst_caps_features_type, G_TYPE_STRING,
       gst_caps_features_transform_to_string);
 
-  _gst_caps_features_any = gst_caps_features_new_any ();
+  _gst_caps_features_any =
+      priv_gst_caps_features_intern (gst_caps_features_new_any ());
   _gst_caps_features_memory_system_memory =
-      gst_caps_features_new_id (_gst_caps_feature_memory_system_memory, 0);
+      priv_gst_caps_features_intern (gst_caps_features_new_id
+      (_gst_caps_feature_memory_system_memory, 0));
+}
+
+/* exact comparison, unlike gst_caps_features_is_equal() ANY is only equal to
+ * ANY and empty features are not equal to system memory */
+static gboolean
+gst_caps_features_is_identical (const GstCapsFeatures * features1,
+    const GstCapsFeatures * features2)
+{
+  guint i, n;
+
+  if (features1->is_any != features2->is_any)
+    return FALSE;
+  if (features1->array->len != features2->array->len)
+    return FALSE;
+
+  n = features1->array->len;
+  for (i = 0; i < n; i++)
+    if (!gst_caps_features_contains_id (features2,
+            gst_caps_features_get_nth_id (features1, i)))
+      return FALSE;
+
+  return TRUE;
+}
+
+static GstCapsFeatures *
+gst_caps_features_find_interned (const GstCapsFeatures * features)
+{
+  gint i, n;
+
+  /* entries are only ever appended, so everything below the count can be
+   * read without the lock */
+  n = g_atomic_int_get (&n_interned_features);
+  for (i = 0; i < n; i++) {
+    if (gst_caps_features_is_identical (interned_features[i], features))
+      return interned_features[i];
+  }
+  return NULL;
+}
+
+/* must be called with the interned lock */
+static gboolean
+gst_caps_features_add_interned (GstCapsFeatures * features)
+{
+  gint n = n_interned_features;
+
+  if (n == MAX_INTERNED_FEATURES)
+    return FALSE;
+
+  features->interned = TRUE;
+  interned_features[n] = features;
+  g_atomic_int_set (&n_interned_features, n + 1);
+
+  GST_DEBUG ("interned caps features %p", features);
+
+  return TRUE;
+}
+
+/*
+ * priv_gst_caps_features_intern:
+ * @features: (transfer full): a #GstCapsFeatures without a parent
+ *
+ * Replaces @features with the canonical instance of the same feature set.
+ *
+ * Returns: (transfer full): the interned features, or @features itself when
+ *     no more feature sets can be interned.
+ */
+GstCapsFeatures *
+priv_gst_caps_features_intern (GstCapsFeatures * features)
+{
+  GstCapsFeatures *res;
+
+  if (features->interned)
+    return features;
+
+  g_return_val_if_fail (features->parent_refcount == NULL, features);
+
+  if ((res = gst_caps_features_find_interned (features)) == NULL) {
+    G_LOCK (interned_lock);
+    if ((res = gst_caps_features_find_interned (features)) == NULL) {
+      if (gst_caps_features_add_interned (features))
+        res = features;
+    }
+    G_UNLOCK (interned_lock);
+    if (res == NULL)
+      return features;
+  }
+
+  if (res != features)
+    gst_caps_features_free (features);
+
+  return res;
+}
+
+/*
+ * priv_gst_caps_features_share:
+ * @features: a #GstCapsFeatures
+ *
+ * Like gst_caps_features_copy() but returns the canonical instance of the
+ * feature set when there is one, which costs nothing to copy and free.
+ *
+ * Returns: (transfer full): the interned features or a copy of @features
+ */
+GstCapsFeatures *
+priv_gst_caps_features_share (const GstCapsFeatures * features)
+{
+  GstCapsFeatures *res;
+
+  if (features->interned)
+    return (GstCapsFeatures *) features;
+
+  if ((res = gst_caps_features_find_interned (features)))
+    return res;
+
+  return priv_gst_caps_features_intern (gst_caps_features_copy (features));
+}
+
+/*
+ * priv_gst_caps_features_is_interned:
+ * @features: a #GstCapsFeatures
+ *
+ * Returns: %TRUE if @features is a shared canonical instance that must be
+ *     copied before it can be modified.
+ */
+gboolean
+priv_gst_caps_features_is_interned (const GstCapsFeatures * features)
+{
+  return features->interned;
 }
 
 gboolean
@@ -161,6 +302,7 @@ gst_caps_features_new_empty (void)
   features->parent_refcount = NULL;
   features->array = g_array_new (FALSE, FALSE, sizeof (GQuark));
   features->is_any = FALSE;
+  features->interned = FALSE;
 
   GST_TRACE ("created caps features %p", features);
 
@@ -329,6 +471,10 @@ gst_caps_features_set_parent_refcount (GstCapsFeatures * features,
 {
   g_return_val_if_fail (features != NULL, FALSE);
 
+  /* interned features are shared between parents and never owned by one */
+  if (features->interned)
+    return TRUE;
+
   /* if we have a parent_refcount already, we can only clear
    * if with a NULL refcount */
   if (features->parent_refcount) {
@@ -390,6 +536,8 @@ void
 gst_caps_features_free (GstCapsFeatures * features)
 {
   g_return_if_fail (features != NULL);
+  /* interned features are shared by caps and live as long as the process */
+  g_return_if_fail (!features->interned);
   g_return_if_fail (features->parent_refcount == NULL);
 
   g_array_free (features->array, TRUE);
@@ -693,6 +841,9 @@ gst_caps_features_is_equal (const GstCapsFeatures * features1,
   g_return_val_if_fail (features1 != NULL, FALSE);
   g_return_val_if_fail (features2 != NULL, FALSE);
 
+  if (features1 == features2)
+    return TRUE;
+
   if (features1->is_any || features2->is_any)
     return TRUE;
 
@@ -708,6 +859,10 @@ gst_caps_features_is_equal (const GstCapsFeatures * features1,
           _gst_caps_feature_memory_system_memory))
     return TRUE;
 
+  /* there is only one interned instance of every feature set */
+  if (features1->interned && features2->interned)
+    return FALSE;
+
   if (features1->array->len != features2->array->len)
     return FALSE;
 
@@ -73,6 +73,7 @@ GST_DEBUG_CATEGORY_STATIC (element_factory_debug);
 
 static void gst_element_factory_finalize (GObject * object);
 static void gst_element_factory_cleanup (GstElementFactory * factory);
+static void factory_index_free (GArray * index);
 
 /* static guint gst_element_factory_signals[LAST_SIGNAL] = { 0 }; */
 
@@ -107,6 +108,8 @@ gst_element_factory_init (GstElementFactory * factory)
   factory->uri_protocols = NULL;
 
   factory->interfaces = NULL;
+
+  factory->template_index = NULL;
 }
 
 static void
@@ -175,6 +178,11 @@ gst_element_factory_cleanup (GstElementFactory * factory)
 
   g_list_free (factory->interfaces);
   factory->interfaces = NULL;
+
+  if (factory->template_index) {
+    factory_index_free (factory->template_index);
+    factory->template_index = NULL;
+  }
 }
 
 #define CHECK_METADATA_FIELD(klass, name, key)                                 \
@@ -256,11 +264,12 @@ gst_element_register (GstPlugin * plugin, const gchar * name, guint rank,
     GstStaticPadTemplate *newt;
     gchar *caps_string = gst_caps_to_string (templ->caps);
 
-    newt = g_slice_new (GstStaticPadTemplate);
+    newt = g_slice_new0 (GstStaticPadTemplate);
     newt->name_template = g_intern_string (templ->name_template);
     newt->direction = templ->direction;
     newt->presence = templ->presence;
-    newt->static_caps.caps = NULL;
+    /* we have the caps already, no need to parse the string later */
+    newt->static_caps.caps = gst_caps_ref (templ->caps);
     newt->static_caps.string = g_intern_string (caps_string);
     factory->staticpadtemplates =
         g_list_append (factory->staticpadtemplates, newt);
@@ -802,6 +811,146 @@ gst_element_factory_list_get_elements (GstElementFactoryListType type,
   return result;
 }
 
+/* The template index of a factory lists the structure names of its pad
+ * template caps, so that filtering only needs to check the factories that
+ * have a template with the same name and compatible caps features as the
+ * filter caps. It is made the first time a filter looks at the factory,
+ * which costs no more than checking the factory without it because that
+ * gets the caps of all templates too. The index is immutable once it is
+ * set on the factory.
+ *
+ * There is no registry-wide map from media types to factories. The filter
+ * gets an arbitrary list and has to keep its order, so it visits every
+ * factory in the list anyway, and such a map would only replace the short
+ * scan of the factory index with a hash lookup. Building it would also need
+ * the template caps of every factory in the registry up front, and again
+ * after every feature that is added or removed. */
+typedef struct
+{
+  /* 0 for ANY caps */
+  GQuark name;
+  /* NULL for system memory, usually a shared instance */
+  GstCapsFeatures *features;
+  GstPadDirection direction;
+} FactoryIndexEntry;
+
+static void
+factory_index_free (GArray * index)
+{
+  guint i;
+
+  for (i = 0; i < index->len; i++) {
+    FactoryIndexEntry *entry = &g_array_index (index, FactoryIndexEntry, i);
+
+    if (entry->features &&
+        !priv_gst_caps_features_is_interned (entry->features))
+      gst_caps_features_free (entry->features);
+  }
+  g_array_free (index, TRUE);
+}
+
+static void
+factory_index_add (GArray * index, GQuark name,
+    const GstCapsFeatures * features, GstPadDirection direction)
+{
+  FactoryIndexEntry entry;
+
+  entry.name = name;
+  entry.features = NULL;
+  if (features && (gst_caps_features_is_any (features) ||
+          !gst_caps_features_is_equal (features,
+              GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY)))
+    entry.features = priv_gst_caps_features_share (features);
+  entry.direction = direction;
+
+  g_array_append_val (index, entry);
+}
+
+/* get the template index of @factory, make it when it is first needed */
+static GArray *
+factory_index_get (GstElementFactory * factory)
+{
+  GArray *index;
+  GList *templates;
+
+  index = g_atomic_pointer_get (&factory->template_index);
+  if (G_LIKELY (index))
+    return index;
+
+  index = g_array_new (FALSE, FALSE, sizeof (FactoryIndexEntry));
+  for (templates = factory->staticpadtemplates; templates;
+      templates = templates->next) {
+    GstStaticPadTemplate *templ = templates->data;
+    GstCaps *caps;
+    guint i, n;
+
+    caps = gst_static_caps_get (&templ->static_caps);
+    if (caps == NULL)
+      continue;
+
+    if (gst_caps_is_any (caps)) {
+      factory_index_add (index, 0, NULL, templ->direction);
+      gst_caps_unref (caps);
+      continue;
+    }
+
+    n = gst_caps_get_size (caps);
+    for (i = 0; i < n; i++) {
+      GstStructure *s = gst_caps_get_structure (caps, i);
+
+      factory_index_add (index, gst_structure_get_name_id (s),
+          gst_caps_get_features (caps, i), templ->direction);
+    }
+    gst_caps_unref (caps);
+  }
+
+  /* another thread might have made it in the meantime, keep the first one */
+  if (!g_atomic_pointer_compare_and_exchange (&factory->template_index, NULL,
+          index)) {
+    factory_index_free (index);
+    index = g_atomic_pointer_get (&factory->template_index);
+  }
+  return index;
+}
+
+/* check if @factory has a @direction template that can intersect with
+ * @caps */
+static gboolean
+factory_index_lookup (GstElementFactory * factory, const GstCaps * caps,
+    GstPadDirection direction)
+{
+  GArray *index = factory_index_get (factory);
+  guint i, j, n;
+
+  n = gst_caps_get_size (caps);
+  for (i = 0; i < index->len; i++) {
+    FactoryIndexEntry *entry = &g_array_index (index, FactoryIndexEntry, i);
+
+    if (entry->direction != direction)
+      continue;
+    if (entry->name == 0)
+      return TRUE;
+    if (entry->features && gst_caps_features_is_any (entry->features))
+      return TRUE;
+
+    for (j = 0; j < n; j++) {
+      GstStructure *s = gst_caps_get_structure (caps, j);
+      GstCapsFeatures *features = gst_caps_get_features (caps, j);
+
+      if (gst_structure_get_name_id (s) != entry->name)
+        continue;
+      if (features == NULL)
+        features = GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY;
+      if (gst_caps_features_is_any (features) ||
+          gst_caps_features_is_equal (features,
+              entry->features ? entry->features :
+              GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY))
+        return TRUE;
+    }
+  }
+  return FALSE;
+}
+
 /**
  * gst_element_factory_list_filter:
  * @list: (transfer none) (element-type Gst.ElementFactory): a #GList of
@@ -817,6 +966,11 @@ gst_element_factory_list_get_elements (GstElementFactoryListType type,
  * are a complete superset of @caps will be returned. Else any element
  * whose pad templates caps can intersect with @caps will be returned.
  *
+ * Each factory keeps an index of the media types of its pad templates, only
+ * the factories with a pad template for one of the media types of @caps are
+ * checked further. The index of a factory is made the first time it is
+ * filtered. Every factory in @list is still visited.
+ *
  * Returns: (transfer full) (element-type Gst.ElementFactory): a #GList of
  *     #GstElementFactory elements that match the given requisits.
  *     Use #gst_plugin_feature_list_free after usage.
@@ -826,9 +980,13 @@ gst_element_factory_list_filter (GList * list,
     const GstCaps * caps, GstPadDirection direction, gboolean subsetonly)
 {
   GQueue results = G_QUEUE_INIT;
+  gboolean use_index;
 
   GST_DEBUG ("finding factories");
 
+  /* ANY and EMPTY caps can match templates of all media types */
+  use_index = !gst_caps_is_any (caps) && !gst_caps_is_empty (caps);
+
   /* loop over all the factories */
   for (; list; list = list->next) {
     GstElementFactory *factory;
@@ -837,6 +995,9 @@ gst_element_factory_list_filter (GList * list,
 
     factory = (GstElementFactory *) list->data;
 
+    if (use_index && !factory_index_lookup (factory, caps, direction))
+      continue;
+
     GST_DEBUG ("Trying %s",
         gst_plugin_feature_get_name ((GstPluginFeature *) factory));
 
@@ -867,5 +1028,6 @@ gst_element_factory_list_filter (GList * list,
       }
     }
   }
+
   return results.head;
 }
@@ -85,17 +85,42 @@
 #include "gstutils.h"
 #include "gstquark.h"
 #include "gstvalue.h"
+#include "gstmagazine.h"
 
 GType _gst_event_type = 0;
 
+/* the core events keep their values in typed fields so that they can be
+ * made and parsed without a structure. The structure is only made from these
+ * fields when it is asked for. */
+typedef union
+{
+  GstSegment segment;
+  GstCaps *caps;
+  struct
+  {
+    GstQOSType type;
+    gdouble proportion;
+    GstClockTimeDiff diff;
+    GstClockTime timestamp;
+  } qos;
+  GstClockTime latency;
+} GstEventPayload;
+
 typedef struct
 {
   GstEvent event;
 
   GstStructure *structure;
+
+  /* the payload is only valid while has_payload is set, which is cleared
+   * when the structure is made writable */
+  gboolean has_payload;
+  GstEventPayload payload;
 } GstEventImpl;
 
 #define GST_EVENT_STRUCTURE(e)  (((GstEventImpl *)(e))->structure)
+#define GST_EVENT_HAS_PAYLOAD(e) (((GstEventImpl *)(e))->has_payload)
+#define GST_EVENT_PAYLOAD(e)    (&((GstEventImpl *)(e))->payload)
 
 typedef struct
 {
@@ -136,8 +161,43 @@ static GstEventQuarks event_quarks[] = {
   {0, NULL, 0}
 };
 
+/* events of these types are created and freed at a high rate, they keep
+ * their values in typed fields and are recycled without a structure */
+typedef struct
+{
+  const GstEventType type;
+  const gchar *cache_name;
+  GstMagazineCache *cache;
+} GstEventRecycle;
+
+static GstEventRecycle event_recycle[] = {
+  {GST_EVENT_SEGMENT, "GstEvent-segment", NULL},
+  {GST_EVENT_CAPS, "GstEvent-caps", NULL},
+  {GST_EVENT_QOS, "GstEvent-qos", NULL},
+  {GST_EVENT_LATENCY, "GstEvent-latency", NULL}
+};
+
 GST_DEFINE_MINI_OBJECT_TYPE (GstEvent, gst_event);
 
+/* free an event that is removed from the recycle cache */
+static void
+_gst_event_free_recycled (GstEventImpl * event)
+{
+  g_slice_free1 (sizeof (GstEventImpl), event);
+}
+
+static inline GstEventRecycle *
+event_recycle_find (GstEventType type)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (event_recycle); i++) {
+    if (event_recycle[i].type == type)
+      return &event_recycle[i];
+  }
+  return NULL;
+}
+
 void
 _priv_gst_event_initialize (void)
 {
@@ -151,6 +211,12 @@ _priv_gst_event_initialize (void)
   for (i = 0; event_quarks[i].name; i++) {
     event_quarks[i].quark = g_quark_from_static_string (event_quarks[i].name);
   }
+
+  for (i = 0; i < (gint) G_N_ELEMENTS (event_recycle); i++) {
+    event_recycle[i].cache =
+        _priv_gst_magazine_cache_new_full (event_recycle[i].cache_name,
+        sizeof (GstEventImpl), (GDestroyNotify) _gst_event_free_recycled);
+  }
 }
 
 /**
@@ -214,6 +280,7 @@ gst_event_type_get_flags (GstEventType type)
 static void
 _gst_event_free (GstEvent * event)
 {
+  GstEventRecycle *recycle;
   GstStructure *s;
 
   g_return_if_fail (event != NULL);
@@ -222,6 +289,10 @@ _gst_event_free (GstEvent * event)
   GST_CAT_LOG (GST_CAT_EVENT, "freeing event %p type %s", event,
       GST_EVENT_TYPE_NAME (event));
 
+  if (GST_EVENT_HAS_PAYLOAD (event) &&
+      GST_EVENT_TYPE (event) == GST_EVENT_CAPS)
+    gst_caps_unref (GST_EVENT_PAYLOAD (event)->caps);
+
   s = GST_EVENT_STRUCTURE (event);
 
   if (s) {
@@ -229,6 +300,12 @@ _gst_event_free (GstEvent * event)
     gst_structure_free (s);
   }
 
+  recycle = event_recycle_find (GST_EVENT_TYPE (event));
+  if (recycle && recycle->cache) {
+    _priv_gst_magazine_cache_free (recycle->cache, event);
+    return;
+  }
+
   g_slice_free1 (sizeof (GstEventImpl), event);
 }
 
@@ -247,14 +324,22 @@ _gst_event_copy (GstEvent * event)
   GST_EVENT_TIMESTAMP (copy) = GST_EVENT_TIMESTAMP (event);
   GST_EVENT_SEQNUM (copy) = GST_EVENT_SEQNUM (event);
 
+  /* the structure of an event with typed fields is made again when needed */
   s = GST_EVENT_STRUCTURE (event);
-  if (s) {
+  if (s && !GST_EVENT_HAS_PAYLOAD (event)) {
     GST_EVENT_STRUCTURE (copy) = gst_structure_copy (s);
     gst_structure_set_parent_refcount (GST_EVENT_STRUCTURE (copy),
         &copy->event.mini_object.refcount);
   } else {
     GST_EVENT_STRUCTURE (copy) = NULL;
   }
+
+  if (GST_EVENT_HAS_PAYLOAD (event)) {
+    copy->payload = *GST_EVENT_PAYLOAD (event);
+    copy->has_payload = TRUE;
+    if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS)
+      gst_caps_ref (copy->payload.caps);
+  }
   return GST_EVENT_CAST (copy);
 }
 
@@ -268,6 +353,8 @@ gst_event_init (GstEventImpl * event, GstEventType type)
   GST_EVENT_TYPE (event) = type;
   GST_EVENT_TIMESTAMP (event) = GST_CLOCK_TIME_NONE;
   GST_EVENT_SEQNUM (event) = gst_util_seqnum_next ();
+  event->structure = NULL;
+  event->has_payload = FALSE;
 }
 
 
@@ -322,6 +409,79 @@ had_parent:
   }
 }
 
+/* make a new event of one of the recycled types without a structure, the
+ * caller sets the typed fields. The event is reused from the cache when
+ * possible */
+static GstEvent *
+gst_event_new_recycled (GstEventType type)
+{
+  GstEventRecycle *recycle = event_recycle_find (type);
+  GstEventImpl *event;
+
+  if (G_LIKELY (recycle->cache) &&
+      (event = _priv_gst_magazine_cache_get (recycle->cache))) {
+    GST_CAT_DEBUG (GST_CAT_EVENT, "recycling event %p %s", event,
+        gst_event_type_get_name (type));
+
+    gst_event_init (event, type);
+  } else {
+    event = (GstEventImpl *) gst_event_new_custom (type, NULL);
+  }
+  event->has_payload = TRUE;
+
+  return GST_EVENT_CAST (event);
+}
+
+/* get the structure of @event, make it from the typed fields when needed.
+ * Events can be shared between threads, the first structure that is set
+ * wins */
+static GstStructure *
+gst_event_ensure_structure (GstEvent * event)
+{
+  GstEventImpl *impl = (GstEventImpl *) event;
+  GstEventPayload *payload = &impl->payload;
+  GstStructure *structure;
+
+  structure = g_atomic_pointer_get (&impl->structure);
+  if (structure || !impl->has_payload)
+    return structure;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_CAPS:
+      structure = gst_structure_new_id (GST_QUARK (EVENT_CAPS),
+          GST_QUARK (CAPS), GST_TYPE_CAPS, payload->caps, NULL);
+      break;
+    case GST_EVENT_SEGMENT:
+      structure = gst_structure_new_id (GST_QUARK (EVENT_SEGMENT),
+          GST_QUARK (SEGMENT), GST_TYPE_SEGMENT, &payload->segment, NULL);
+      break;
+    case GST_EVENT_QOS:
+      structure = gst_structure_new_id (GST_QUARK (EVENT_QOS),
+          GST_QUARK (TYPE), GST_TYPE_QOS_TYPE, payload->qos.type,
+          GST_QUARK (PROPORTION), G_TYPE_DOUBLE, payload->qos.proportion,
+          GST_QUARK (DIFF), G_TYPE_INT64, payload->qos.diff,
+          GST_QUARK (TIMESTAMP), G_TYPE_UINT64, payload->qos.timestamp, NULL);
+      break;
+    case GST_EVENT_LATENCY:
+      structure = gst_structure_new_id (GST_QUARK (EVENT_LATENCY),
+          GST_QUARK (LATENCY), G_TYPE_UINT64, payload->latency, NULL);
+      break;
+    default:
+      g_assert_not_reached ();
+      return NULL;
+  }
+  gst_structure_set_parent_refcount (structure,
+      &event->mini_object.refcount);
+
+  if (!g_atomic_pointer_compare_and_exchange (&impl->structure, NULL,
+          structure)) {
+    gst_structure_set_parent_refcount (structure, NULL);
+    gst_structure_free (structure);
+    structure = g_atomic_pointer_get (&impl->structure);
+  }
+  return structure;
+}
+
 /**
  * gst_event_get_structure:
  * @event: The #GstEvent.
@@ -339,7 +499,7 @@ gst_event_get_structure (GstEvent * event)
 {
   g_return_val_if_fail (GST_IS_EVENT (event), NULL);
 
-  return GST_EVENT_STRUCTURE (event);
+  return gst_event_ensure_structure (event);
 }
 
 /**
@@ -363,7 +523,7 @@ gst_event_writable_structure (GstEvent * event)
   g_return_val_if_fail (GST_IS_EVENT (event), NULL);
   g_return_val_if_fail (gst_event_is_writable (event), NULL);
 
-  structure = GST_EVENT_STRUCTURE (event);
+  structure = gst_event_ensure_structure (event);
 
   if (structure == NULL) {
     structure =
@@ -372,6 +532,13 @@ gst_event_writable_structure (GstEvent * event)
     gst_structure_set_parent_refcount (structure, &event->mini_object.refcount);
     GST_EVENT_STRUCTURE (event) = structure;
   }
+  /* the caller can change any field, parse from the structure from now on */
+  if (GST_EVENT_HAS_PAYLOAD (event)) {
+    if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS)
+      gst_caps_unref (GST_EVENT_PAYLOAD (event)->caps);
+    GST_EVENT_HAS_PAYLOAD (event) = FALSE;
+  }
+
   return structure;
 }
 
@@ -388,12 +555,15 @@ gst_event_writable_structure (GstEvent * event)
 gboolean
 gst_event_has_name (GstEvent * event, const gchar * name)
 {
+  GstStructure *structure;
+
   g_return_val_if_fail (GST_IS_EVENT (event), FALSE);
 
-  if (GST_EVENT_STRUCTURE (event) == NULL)
+  structure = gst_event_ensure_structure (event);
+  if (structure == NULL)
     return FALSE;
 
-  return gst_structure_has_name (GST_EVENT_STRUCTURE (event), name);
+  return gst_structure_has_name (structure, name);
 }
 
 /**
@@ -628,9 +798,8 @@ gst_event_new_caps (GstCaps * caps)
 
   GST_CAT_INFO (GST_CAT_EVENT, "creating caps event %" GST_PTR_FORMAT, caps);
 
-  event = gst_event_new_custom (GST_EVENT_CAPS,
-      gst_structure_new_id (GST_QUARK (EVENT_CAPS),
-          GST_QUARK (CAPS), GST_TYPE_CAPS, caps, NULL));
+  event = gst_event_new_recycled (GST_EVENT_CAPS);
+  GST_EVENT_PAYLOAD (event)->caps = gst_caps_ref (caps);
 
   return event;
 }
@@ -651,11 +820,16 @@ gst_event_parse_caps (GstEvent * event, GstCaps ** caps)
   g_return_if_fail (GST_IS_EVENT (event));
   g_return_if_fail (GST_EVENT_TYPE (event) == GST_EVENT_CAPS);
 
-  structure = GST_EVENT_STRUCTURE (event);
-  if (G_LIKELY (caps))
-    *caps =
-        g_value_get_boxed (gst_structure_id_get_value (structure,
-            GST_QUARK (CAPS)));
+  if (G_LIKELY (caps)) {
+    if (G_LIKELY (GST_EVENT_HAS_PAYLOAD (event))) {
+      *caps = GST_EVENT_PAYLOAD (event)->caps;
+    } else {
+      structure = GST_EVENT_STRUCTURE (event);
+      *caps =
+          g_value_get_boxed (gst_structure_id_get_value (structure,
+              GST_QUARK (CAPS)));
+    }
+  }
 }
 
 /**
@@ -709,9 +883,8 @@ gst_event_new_segment (const GstSegment * segment)
   GST_CAT_INFO (GST_CAT_EVENT, "creating segment event %" GST_SEGMENT_FORMAT,
       segment);
 
-  event = gst_event_new_custom (GST_EVENT_SEGMENT,
-      gst_structure_new_id (GST_QUARK (EVENT_SEGMENT),
-          GST_QUARK (SEGMENT), GST_TYPE_SEGMENT, segment, NULL));
+  event = gst_event_new_recycled (GST_EVENT_SEGMENT);
+  gst_segment_copy_into (segment, &GST_EVENT_PAYLOAD (event)->segment);
 
   return event;
 }
@@ -734,9 +907,13 @@ gst_event_parse_segment (GstEvent * event, const GstSegment ** segment)
   g_return_if_fail (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT);
 
   if (segment) {
-    structure = GST_EVENT_STRUCTURE (event);
-    *segment = g_value_get_boxed (gst_structure_id_get_value (structure,
-            GST_QUARK (SEGMENT)));
+    if (G_LIKELY (GST_EVENT_HAS_PAYLOAD (event))) {
+      *segment = &GST_EVENT_PAYLOAD (event)->segment;
+    } else {
+      structure = GST_EVENT_STRUCTURE (event);
+      *segment = g_value_get_boxed (gst_structure_id_get_value (structure,
+              GST_QUARK (SEGMENT)));
+    }
   }
 }
 
@@ -950,7 +1127,6 @@ gst_event_new_qos (GstQOSType type, gdouble proportion,
     GstClockTimeDiff diff, GstClockTime timestamp)
 {
   GstEvent *event;
-  GstStructure *structure;
 
   /* diff must be positive or timestamp + diff must be positive */
   g_return_val_if_fail (diff >= 0 || -diff <= timestamp, NULL);
@@ -960,12 +1136,11 @@ gst_event_new_qos (GstQOSType type, gdouble proportion,
       ", timestamp %" GST_TIME_FORMAT, type, proportion,
       diff, GST_TIME_ARGS (timestamp));
 
-  structure = gst_structure_new_id (GST_QUARK (EVENT_QOS),
-      GST_QUARK (TYPE), GST_TYPE_QOS_TYPE, type,
-      GST_QUARK (PROPORTION), G_TYPE_DOUBLE, proportion,
-      GST_QUARK (DIFF), G_TYPE_INT64, diff,
-      GST_QUARK (TIMESTAMP), G_TYPE_UINT64, timestamp, NULL);
-  event = gst_event_new_custom (GST_EVENT_QOS, structure);
+  event = gst_event_new_recycled (GST_EVENT_QOS);
+  GST_EVENT_PAYLOAD (event)->qos.type = type;
+  GST_EVENT_PAYLOAD (event)->qos.proportion = proportion;
+  GST_EVENT_PAYLOAD (event)->qos.diff = diff;
+  GST_EVENT_PAYLOAD (event)->qos.timestamp = timestamp;
 
   return event;
 }
@@ -990,6 +1165,18 @@ gst_event_parse_qos (GstEvent * event, GstQOSType * type,
   g_return_if_fail (GST_IS_EVENT (event));
   g_return_if_fail (GST_EVENT_TYPE (event) == GST_EVENT_QOS);
 
+  if (G_LIKELY (GST_EVENT_HAS_PAYLOAD (event))) {
+    if (type)
+      *type = GST_EVENT_PAYLOAD (event)->qos.type;
+    if (proportion)
+      *proportion = GST_EVENT_PAYLOAD (event)->qos.proportion;
+    if (diff)
+      *diff = GST_EVENT_PAYLOAD (event)->qos.diff;
+    if (timestamp)
+      *timestamp = GST_EVENT_PAYLOAD (event)->qos.timestamp;
+    return;
+  }
+
   structure = GST_EVENT_STRUCTURE (event);
   if (type)
     *type = (GstQOSType)
@@ -1179,14 +1366,12 @@ GstEvent *
 gst_event_new_latency (GstClockTime latency)
 {
   GstEvent *event;
-  GstStructure *structure;
 
   GST_CAT_INFO (GST_CAT_EVENT,
       "creating latency event %" GST_TIME_FORMAT, GST_TIME_ARGS (latency));
 
-  structure = gst_structure_new_id (GST_QUARK (EVENT_LATENCY),
-      GST_QUARK (LATENCY), G_TYPE_UINT64, latency, NULL);
-  event = gst_event_new_custom (GST_EVENT_LATENCY, structure);
+  event = gst_event_new_recycled (GST_EVENT_LATENCY);
+  GST_EVENT_PAYLOAD (event)->latency = latency;
 
   return event;
 }
@@ -1204,7 +1389,12 @@ gst_event_parse_latency (GstEvent * event, GstClockTime * latency)
   g_return_if_fail (GST_IS_EVENT (event));
   g_return_if_fail (GST_EVENT_TYPE (event) == GST_EVENT_LATENCY);
 
-  if (latency)
+  if (!latency)
+    return;
+
+  if (G_LIKELY (GST_EVENT_HAS_PAYLOAD (event)))
+    *latency = GST_EVENT_PAYLOAD (event)->latency;
+  else
     *latency =
         g_value_get_uint64 (gst_structure_id_get_value (GST_EVENT_STRUCTURE
             (event), GST_QUARK (LATENCY)));
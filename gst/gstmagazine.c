@@ -0,0 +1,464 @@
+/* GStreamer
+ *
+ * gstmagazine.c: per-thread caches for fixed size memory blocks
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* A magazine cache keeps freed blocks of one size in small per-thread arrays
+ * (magazines) so that most allocations and frees don't touch any shared
+ * state. Each thread has a loaded and a previous magazine per cache, when
+ * both are empty (alloc) or full (free) a magazine is exchanged with the
+ * depot of the cache, which is protected by a mutex and rebalances blocks
+ * between threads. When the depot is full, blocks go back to GSlice.
+ *
+ * All blocks are allocated with g_slice_alloc() so that they can always be
+ * released with g_slice_free1(), also when the caching is disabled. Caches
+ * that recycle initialized objects are made with a free function that is
+ * called instead of g_slice_free1() for the blocks that leave the cache.
+ */
+
+#include "gst_private.h"
+#include "gstmagazine.h"
+
+#include <string.h>
+
+#define MAX_CACHES              32
+#define DEFAULT_MAGAZINE_SIZE   32
+#define DEFAULT_DEPOT_SIZE      16
+
+typedef struct _Magazine Magazine;
+
+struct _Magazine
+{
+  Magazine *next;
+  guint size;
+  guint count;
+  gpointer blocks[1];
+};
+
+struct _GstMagazineCache
+{
+  const gchar *name;
+  guint id;
+  gsize block_size;
+  GDestroyNotify free_block;
+
+  GMutex lock;
+  /* the depot */
+  Magazine *full;
+  guint n_full;
+  Magazine *empty;
+
+  /* stats */
+  guint64 hits;
+  guint64 misses;
+  guint64 exchanges;
+  guint64 trimmed;
+};
+
+/* the magazines of one thread for one cache */
+typedef struct
+{
+  Magazine *loaded;
+  Magazine *previous;
+  /* hits not yet added to the cache stats */
+  guint64 hits;
+} ThreadMagazines;
+
+typedef struct
+{
+  ThreadMagazines mags[MAX_CACHES];
+} ThreadState;
+
+static void thread_state_free (ThreadState * state);
+
+static GPrivate thread_state = G_PRIVATE_INIT ((GDestroyNotify)
+    thread_state_free);
+
+G_LOCK_DEFINE_STATIC (caches_lock);
+static GstMagazineCache *caches[MAX_CACHES];
+static guint n_caches = 0;
+
+static guint cache_magazine_size = DEFAULT_MAGAZINE_SIZE;
+static guint cache_depot_size = DEFAULT_DEPOT_SIZE;
+/* written when the first cache is made and by set_limits() while other
+ * threads might use the caches, always use atomic access */
+static gint debugging = FALSE;
+static gint disabled = FALSE;
+
+static Magazine *
+magazine_new (void)
+{
+  Magazine *mag;
+  guint size;
+
+  size = MAX ((guint) g_atomic_int_get (&cache_magazine_size), 1);
+  mag = g_malloc (sizeof (Magazine) + (size - 1) * sizeof (gpointer));
+  mag->next = NULL;
+  mag->size = size;
+  mag->count = 0;
+
+  return mag;
+}
+
+static inline void
+block_free (GstMagazineCache * cache, gpointer block)
+{
+  if (cache->free_block)
+    cache->free_block (block);
+  else
+    g_slice_free1 (cache->block_size, block);
+}
+
+static void
+magazine_free_blocks (GstMagazineCache * cache, Magazine * mag)
+{
+  guint i;
+
+  for (i = 0; i < mag->count; i++)
+    block_free (cache, mag->blocks[i]);
+  mag->count = 0;
+}
+
+/* called with the cache lock, returns magazines that don't fit in the depot,
+ * they need to be freed without the lock */
+static Magazine *
+depot_put (GstMagazineCache * cache, Magazine * mag, Magazine * trash)
+{
+  if (mag == NULL)
+    return trash;
+
+  if (mag->count == 0) {
+    mag->next = cache->empty;
+    cache->empty = mag;
+  } else if (cache->n_full < (guint) g_atomic_int_get (&cache_depot_size)) {
+    mag->next = cache->full;
+    cache->full = mag;
+    cache->n_full++;
+  } else {
+    cache->trimmed += mag->count;
+    mag->next = trash;
+    trash = mag;
+  }
+  return trash;
+}
+
+static void
+trash_free (GstMagazineCache * cache, Magazine * trash)
+{
+  while (trash) {
+    Magazine *next = trash->next;
+
+    magazine_free_blocks (cache, trash);
+    g_free (trash);
+    trash = next;
+  }
+}
+
+static void
+thread_state_free (ThreadState * state)
+{
+  guint i, n;
+
+  n = g_atomic_int_get (&n_caches);
+  for (i = 0; i < n; i++) {
+    GstMagazineCache *cache = caches[i];
+    ThreadMagazines *tm = &state->mags[i];
+    Magazine *trash;
+
+    g_mutex_lock (&cache->lock);
+    cache->hits += tm->hits;
+    trash = depot_put (cache, tm->loaded, NULL);
+    trash = depot_put (cache, tm->previous, trash);
+    g_mutex_unlock (&cache->lock);
+
+    trash_free (cache, trash);
+  }
+  g_free (state);
+}
+
+static inline ThreadMagazines *
+get_thread_magazines (GstMagazineCache * cache)
+{
+  ThreadState *state;
+
+  state = g_private_get (&thread_state);
+  if (G_UNLIKELY (state == NULL)) {
+    state = g_new0 (ThreadState, 1);
+    g_private_set (&thread_state, state);
+  }
+  return &state->mags[cache->id];
+}
+
+/*
+ * _priv_gst_magazine_cache_new:
+ * @name: the name of the cache, used in the stats
+ * @block_size: the size of the blocks
+ *
+ * Make a new cache for blocks of @block_size bytes. Caches are never freed.
+ *
+ * Returns: a new #GstMagazineCache or %NULL when no more caches can be made.
+ */
+GstMagazineCache *
+_priv_gst_magazine_cache_new (const gchar * name, gsize block_size)
+{
+  return _priv_gst_magazine_cache_new_full (name, block_size, NULL);
+}
+
+/*
+ * _priv_gst_magazine_cache_new_full:
+ * @name: the name of the cache, used in the stats
+ * @block_size: the size of the blocks
+ * @free_block: (allow-none): function to free a block
+ *
+ * Make a new cache for blocks of @block_size bytes. When @free_block is not
+ * %NULL, it is called to release the blocks that are removed from the cache
+ * or that are freed when caching is disabled, it should also free the block
+ * with g_slice_free1().
+ *
+ * Returns: a new #GstMagazineCache or %NULL when no more caches can be made.
+ */
+GstMagazineCache *
+_priv_gst_magazine_cache_new_full (const gchar * name, gsize block_size,
+    GDestroyNotify free_block)
+{
+  GstMagazineCache *cache;
+
+  G_LOCK (caches_lock);
+  if (n_caches == 0) {
+    const gchar *env = g_getenv ("G_SLICE");
+
+    /* let the memory debuggers see all allocations */
+    if (_priv_gst_in_valgrind () || (env && strstr (env, "always-malloc"))) {
+      g_atomic_int_set (&debugging, TRUE);
+      g_atomic_int_set (&disabled, TRUE);
+    }
+  }
+  if (n_caches == MAX_CACHES) {
+    G_UNLOCK (caches_lock);
+    g_warning ("too many magazine caches");
+    return NULL;
+  }
+
+  cache = g_new0 (GstMagazineCache, 1);
+  cache->name = name;
+  cache->id = n_caches;
+  cache->block_size = block_size;
+  cache->free_block = free_block;
+  g_mutex_init (&cache->lock);
+
+  caches[n_caches] = cache;
+  g_atomic_int_inc (&n_caches);
+  G_UNLOCK (caches_lock);
+
+  return cache;
+}
+
+/*
+ * _priv_gst_magazine_cache_get:
+ * @cache: a #GstMagazineCache
+ *
+ * Get a cached block from @cache.
+ *
+ * Returns: a block that was previously given to
+ *     _priv_gst_magazine_cache_free() or %NULL when @cache is empty.
+ */
+gpointer
+_priv_gst_magazine_cache_get (GstMagazineCache * cache)
+{
+  ThreadMagazines *tm;
+  Magazine *mag;
+
+  if (G_UNLIKELY (g_atomic_int_get (&disabled)))
+    return NULL;
+
+  tm = get_thread_magazines (cache);
+
+  if (G_LIKELY (tm->loaded && tm->loaded->count > 0))
+    goto pop;
+
+  if (tm->previous && tm->previous->count > 0) {
+    mag = tm->loaded;
+    tm->loaded = tm->previous;
+    tm->previous = mag;
+    goto pop;
+  }
+
+  /* both magazines are empty, try to get a full one from the depot */
+  g_mutex_lock (&cache->lock);
+  cache->hits += tm->hits;
+  tm->hits = 0;
+  if ((mag = cache->full) == NULL) {
+    cache->misses++;
+    g_mutex_unlock (&cache->lock);
+
+    return NULL;
+  }
+  cache->full = mag->next;
+  cache->n_full--;
+  cache->exchanges++;
+  /* previous is empty here, it always fits in the depot */
+  depot_put (cache, tm->previous, NULL);
+  tm->previous = tm->loaded;
+  tm->loaded = mag;
+  g_mutex_unlock (&cache->lock);
+
+pop:
+  tm->hits++;
+  return tm->loaded->blocks[--tm->loaded->count];
+}
+
+/*
+ * _priv_gst_magazine_cache_alloc:
+ * @cache: a #GstMagazineCache
+ *
+ * Get a block of memory from @cache.
+ *
+ * Returns: a block of memory that should be released with
+ *     _priv_gst_magazine_cache_free() or g_slice_free1().
+ */
+gpointer
+_priv_gst_magazine_cache_alloc (GstMagazineCache * cache)
+{
+  gpointer block;
+
+  if (G_LIKELY ((block = _priv_gst_magazine_cache_get (cache))))
+    return block;
+
+  return g_slice_alloc (cache->block_size);
+}
+
+/*
+ * _priv_gst_magazine_cache_free:
+ * @cache: a #GstMagazineCache
+ * @block: a block from _priv_gst_magazine_cache_alloc()
+ *
+ * Give @block back to @cache.
+ */
+void
+_priv_gst_magazine_cache_free (GstMagazineCache * cache, gpointer block)
+{
+  ThreadMagazines *tm;
+  Magazine *mag, *trash;
+
+  if (G_UNLIKELY (g_atomic_int_get (&disabled))) {
+    block_free (cache, block);
+    return;
+  }
+
+  tm = get_thread_magazines (cache);
+
+  if (G_LIKELY (tm->loaded && tm->loaded->count < tm->loaded->size))
+    goto push;
+
+  if (tm->previous && tm->previous->count < tm->previous->size) {
+    mag = tm->loaded;
+    tm->loaded = tm->previous;
+    tm->previous = mag;
+    goto push;
+  }
+
+  /* both magazines are full (or missing), move the previous one to the depot
+   * and load an empty one */
+  g_mutex_lock (&cache->lock);
+  cache->hits += tm->hits;
+  tm->hits = 0;
+  if (tm->previous)
+    cache->exchanges++;
+  trash = depot_put (cache, tm->previous, NULL);
+  tm->previous = tm->loaded;
+  if ((mag = cache->empty))
+    cache->empty = mag->next;
+  g_mutex_unlock (&cache->lock);
+
+  trash_free (cache, trash);
+
+  if (mag == NULL ||
+      mag->size != (guint) g_atomic_int_get (&cache_magazine_size)) {
+    g_free (mag);
+    mag = magazine_new ();
+  }
+  tm->loaded = mag;
+
+push:
+  tm->loaded->blocks[tm->loaded->count++] = block;
+}
+
+/*
+ * _priv_gst_magazine_set_limits:
+ * @magazine_size: the number of blocks in a magazine, 0 disables caching
+ * @depot_size: the maximum number of full magazines in the depot of a cache
+ *
+ * Configure the high-water marks of all caches. Each thread keeps at most
+ * 2 * @magazine_size blocks per cache, each depot at most @depot_size *
+ * @magazine_size blocks. The new limits apply to new magazines, existing
+ * magazines are replaced as they are cycled through the depot.
+ */
+void
+_priv_gst_magazine_set_limits (guint magazine_size, guint depot_size)
+{
+  if (magazine_size == 0) {
+    g_atomic_int_set (&disabled, TRUE);
+    return;
+  }
+  g_atomic_int_set (&cache_magazine_size, magazine_size);
+  g_atomic_int_set (&cache_depot_size, depot_size);
+  g_atomic_int_set (&disabled, g_atomic_int_get (&debugging));
+}
+
+/*
+ * _priv_gst_magazine_get_stats:
+ *
+ * Get the statistics of all caches. There is a #GstStructure for each cache
+ * with the number of hits, misses, depot exchanges and trimmed blocks. The hits
+ * of a thread are only added to the stats when it uses the depot, the values
+ * can lag behind a little.
+ *
+ * Returns: (transfer full): a new #GstStructure
+ */
+GstStructure *
+_priv_gst_magazine_get_stats (void)
+{
+  GstStructure *stats;
+  guint i, n;
+
+  stats = gst_structure_new ("magazine-stats",
+      "enabled", G_TYPE_BOOLEAN, !g_atomic_int_get (&disabled),
+      "magazine-size", G_TYPE_UINT,
+      (guint) g_atomic_int_get (&cache_magazine_size), "depot-size",
+      G_TYPE_UINT, (guint) g_atomic_int_get (&cache_depot_size), NULL);
+
+  n = g_atomic_int_get (&n_caches);
+  for (i = 0; i < n; i++) {
+    GstMagazineCache *cache = caches[i];
+    GstStructure *s;
+
+    g_mutex_lock (&cache->lock);
+    s = gst_structure_new (cache->name,
+        "block-size", G_TYPE_UINT64, (guint64) cache->block_size,
+        "hits", G_TYPE_UINT64, cache->hits,
+        "misses", G_TYPE_UINT64, cache->misses,
+        "exchanges", G_TYPE_UINT64, cache->exchanges,
+        "trimmed", G_TYPE_UINT64, cache->trimmed,
+        "depot-magazines", G_TYPE_UINT, cache->n_full, NULL);
+    g_mutex_unlock (&cache->lock);
+
+    gst_structure_set (stats, cache->name, GST_TYPE_STRUCTURE, s, NULL);
+    gst_structure_free (s);
+  }
+  return stats;
+}
@@ -0,0 +1,55 @@
+/* GStreamer
+ *
+ * gstmagazine.h: per-thread caches for fixed size memory blocks
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_MAGAZINE_H__
+#define __GST_MAGAZINE_H__
+
+#include <glib.h>
+#include "gststructure.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GstMagazineCache GstMagazineCache;
+
+G_GNUC_INTERNAL
+GstMagazineCache * _priv_gst_magazine_cache_new    (const gchar * name, gsize block_size);
+
+G_GNUC_INTERNAL
+GstMagazineCache * _priv_gst_magazine_cache_new_full (const gchar * name, gsize block_size,
+                                                      GDestroyNotify free_block);
+
+G_GNUC_INTERNAL
+gpointer           _priv_gst_magazine_cache_get    (GstMagazineCache * cache);
+
+G_GNUC_INTERNAL
+gpointer           _priv_gst_magazine_cache_alloc  (GstMagazineCache * cache);
+
+G_GNUC_INTERNAL
+void               _priv_gst_magazine_cache_free   (GstMagazineCache * cache, gpointer block);
+
+G_GNUC_INTERNAL
+void               _priv_gst_magazine_set_limits   (guint magazine_size, guint depot_size);
+
+G_GNUC_INTERNAL
+GstStructure *     _priv_gst_magazine_get_stats    (void);
+
+G_END_DECLS
+
+#endif /* __GST_MAGAZINE_H__ */
@@ -58,6 +58,63 @@ static GRWLock lock;
 GQuark _gst_meta_transform_copy;
 GQuark _gst_meta_tag_memory;
 
+/* map from API type to the direct lookup slot on buffers. This is an open
+ * addressed hash table that only grows, entries are published with an atomic
+ * store of the api so that lookups don't need a lock. */
+#define API_SLOT_TABLE_SIZE 64
+
+typedef struct
+{
+  volatile gsize api;
+  gint slot;
+} GstMetaApiSlot;
+
+static GstMetaApiSlot api_slots[API_SLOT_TABLE_SIZE];
+static gint n_api_slots = 0;
+G_LOCK_DEFINE_STATIC (api_slots_lock);
+
+static inline guint
+api_slot_hash (GType api)
+{
+  /* api types are pointers to the type nodes */
+  return ((guint) (api >> 3) * 2654435761u) % API_SLOT_TABLE_SIZE;
+}
+
+static void
+api_slot_add (GType api)
+{
+  guint i;
+
+  G_LOCK (api_slots_lock);
+  if (n_api_slots < GST_META_API_SLOTS) {
+    i = api_slot_hash (api);
+    while (api_slots[i].api != 0)
+      i = (i + 1) % API_SLOT_TABLE_SIZE;
+
+    GST_CAT_DEBUG (GST_CAT_META, "API \"%s\" uses slot %d", g_type_name (api),
+        n_api_slots);
+    api_slots[i].slot = n_api_slots++;
+    g_atomic_pointer_set (&api_slots[i].api, api);
+  }
+  G_UNLOCK (api_slots_lock);
+}
+
+/* get the direct lookup slot of @api on a buffer or -1 when @api has no slot */
+gint
+_priv_gst_meta_api_get_slot (GType api)
+{
+  guint i;
+  GType t;
+
+  i = api_slot_hash (api);
+  while ((t = (GType) g_atomic_pointer_get (&api_slots[i].api)) != 0) {
+    if (t == api)
+      return api_slots[i].slot;
+    i = (i + 1) % API_SLOT_TABLE_SIZE;
+  }
+  return -1;
+}
+
 void
 _priv_gst_meta_initialize (void)
 {
@@ -76,6 +133,9 @@ _priv_gst_meta_initialize (void)
  * Register and return a GType for the @api and associate it with
  * @tags.
  *
+ * The first APIs that are registered can be looked up on a buffer with
+ * gst_buffer_get_meta() without walking the list of metadata.
+ *
  * Returns: a unique GType for @api.
  */
 GType
@@ -97,6 +157,7 @@ gst_meta_api_type_register (const gchar * api, const gchar ** tags)
       g_type_set_qdata (type, g_quark_from_string (tags[i]),
           GINT_TO_POINTER (TRUE));
     }
+    api_slot_add (type);
   }
   return type;
 }
@@ -132,6 +132,29 @@ typedef struct
   GstEvent *event;
 } PadEvent;
 
+/* a cached CAPS query result for @filter, only valid while @cookie is equal
+ * to the caps_cache_cookie of the pad */
+typedef struct
+{
+  GstCaps *filter;
+  GstCaps *caps;
+  guint cookie;
+} CapsCacheEntry;
+
+#define CAPS_CACHE_SIZE 4
+
+/* the number of pads that cache CAPS query results. The results of other pads
+ * only need to be invalidated when there are any, see
+ * caps_cache_invalidate_link() */
+static volatile gint caps_cache_pads = 0;
+
+/* weak refs to the pads whose link was marked for reconfiguration, the other
+ * pads are invalidated at the next CAPS query on a caching pad, see
+ * caps_cache_invalidate_link_later() */
+static GMutex caps_cache_pending_lock;
+static GSList *caps_cache_pending = NULL;
+static volatile gint caps_cache_n_pending = 0;
+
 struct _GstPadPrivate
 {
   guint events_cookie;
@@ -140,6 +163,23 @@ struct _GstPadPrivate
   gint using;
   guint probe_list_cookie;
   guint probe_cookie;
+
+  /* peer for the unlocked push fast path and the number of threads that are
+   * taking a ref to it, see fast_peer_enter() */
+  GstPad *fast_peer;
+  gint fast_readers;
+  /* events_cookie when the last chain passed all checks, see
+   * chain_cookie_invalidate() */
+  guint chain_cookie;
+
+  /* CAPS query results when GST_PAD_FLAG_CACHE_CAPS is set, valid while
+   * their cookie is equal to caps_cache_cookie */
+  CapsCacheEntry caps_cache[CAPS_CACHE_SIZE];
+  guint caps_cache_next;
+  gint caps_cache_cookie;
+  gboolean caps_cache_used;
+  /* the pad is in caps_cache_pending */
+  gint caps_cache_link_pending;
 };
 
 typedef struct
@@ -349,6 +389,9 @@ gst_pad_init (GstPad * pad)
 
   GST_PAD_SET_FLUSHING (pad);
 
+  /* make sure the first chain goes through all the checks */
+  pad->priv->chain_cookie = pad->priv->events_cookie - 1;
+
   g_rec_mutex_init (&pad->stream_rec_lock);
 
   g_cond_init (&pad->block_cond);
@@ -358,6 +401,11 @@ gst_pad_init (GstPad * pad)
   pad->priv->events = g_array_sized_new (FALSE, TRUE, sizeof (PadEvent), 16);
 }
 
+/* the events_cookie and the chain_cookie are only changed with the OBJECT
+ * lock, the chain fast path reads them without it */
+#define EVENTS_COOKIE_BUMP(pad) \
+    g_atomic_int_inc ((gint *) &(pad)->priv->events_cookie)
+
 /* called when setting the pad inactive. It removes all sticky events from
  * the pad. must be called with object lock */
 static void
@@ -387,7 +435,261 @@ remove_events (GstPad * pad)
   }
   GST_OBJECT_FLAG_UNSET (pad, GST_PAD_FLAG_PENDING_EVENTS);
   g_array_set_size (events, 0);
-  pad->priv->events_cookie++;
+  EVENTS_COOKIE_BUMP (pad);
+}
+
+/* invalidate the cached CAPS query results of @pad */
+static inline void
+caps_cache_invalidate (GstPad * pad)
+{
+  g_atomic_int_inc (&pad->priv->caps_cache_cookie);
+}
+
+/* invalidate the cached CAPS query results of @pad and of all pads whose CAPS
+ * query goes out through the link of @pad: the pads that are internally
+ * linked to @pad, the peers of those, their internally linked pads and so
+ * on. Call this when the link of @pad or anything behind it changes. Must be
+ * called without locks because the internal links are iterated. */
+static void
+caps_cache_invalidate_link (GstPad * pad)
+{
+  GQueue queue = G_QUEUE_INIT;
+  GHashTable *visited;
+
+  caps_cache_invalidate (pad);
+
+  /* nobody caches, no need to walk the pipeline */
+  if (g_atomic_int_get (&caps_cache_pads) == 0)
+    return;
+
+  /* owns a ref to the pads in the queue */
+  visited = g_hash_table_new_full (NULL, NULL, gst_object_unref, NULL);
+  g_hash_table_insert (visited, gst_object_ref (pad), pad);
+  g_queue_push_tail (&queue, pad);
+
+  while ((pad = g_queue_pop_head (&queue))) {
+    GstIterator *it;
+    GValue item = G_VALUE_INIT;
+    gboolean done = FALSE;
+
+    if (!(it = gst_pad_iterate_internal_links (pad)))
+      continue;
+
+    while (!done) {
+      switch (gst_iterator_next (it, &item)) {
+        case GST_ITERATOR_OK:
+        {
+          GstPad *intpad = g_value_get_object (&item);
+          GstPad *peer;
+
+          caps_cache_invalidate (intpad);
+          if ((peer = gst_pad_get_peer (intpad))) {
+            if (g_hash_table_lookup (visited, peer)) {
+              gst_object_unref (peer);
+            } else {
+              caps_cache_invalidate (peer);
+              g_hash_table_insert (visited, peer, peer);
+              g_queue_push_tail (&queue, peer);
+            }
+          }
+          g_value_reset (&item);
+          break;
+        }
+        case GST_ITERATOR_RESYNC:
+          gst_iterator_resync (it);
+          break;
+        default:
+          done = TRUE;
+          break;
+      }
+    }
+    g_value_unset (&item);
+    gst_iterator_free (it);
+  }
+  g_hash_table_destroy (visited);
+}
+
+/* like caps_cache_invalidate_link() but only invalidates @pad now and the
+ * other pads before the next CAPS query on a caching pad. This can be called
+ * with locks. */
+static void
+caps_cache_invalidate_link_later (GstPad * pad)
+{
+  GWeakRef *ref;
+
+  caps_cache_invalidate (pad);
+
+  if (g_atomic_int_get (&caps_cache_pads) == 0)
+    return;
+  if (!g_atomic_int_compare_and_exchange (&pad->priv->caps_cache_link_pending,
+          0, 1))
+    return;
+
+  ref = g_slice_new (GWeakRef);
+  g_weak_ref_init (ref, pad);
+
+  g_mutex_lock (&caps_cache_pending_lock);
+  caps_cache_pending = g_slist_prepend (caps_cache_pending, ref);
+  g_atomic_int_inc (&caps_cache_n_pending);
+  g_mutex_unlock (&caps_cache_pending_lock);
+}
+
+/* do the invalidations that were left for later by
+ * caps_cache_invalidate_link_later(). Must be called without locks. */
+static void
+caps_cache_invalidate_pending (void)
+{
+  GSList *pending, *walk;
+
+  if (G_LIKELY (g_atomic_int_get (&caps_cache_n_pending) == 0))
+    return;
+
+  g_mutex_lock (&caps_cache_pending_lock);
+  pending = caps_cache_pending;
+  caps_cache_pending = NULL;
+  g_atomic_int_set (&caps_cache_n_pending, 0);
+  g_mutex_unlock (&caps_cache_pending_lock);
+
+  for (walk = pending; walk; walk = walk->next) {
+    GWeakRef *ref = walk->data;
+    GstPad *pad;
+
+    if ((pad = g_weak_ref_get (ref))) {
+      /* marks from now on have to queue the pad again */
+      g_atomic_int_set (&pad->priv->caps_cache_link_pending, 0);
+      caps_cache_invalidate_link (pad);
+      gst_object_unref (pad);
+    }
+    g_weak_ref_clear (ref);
+    g_slice_free (GWeakRef, ref);
+  }
+  g_slist_free (pending);
+}
+
+/* invalidate the cached CAPS query results that depend on the caps that @pad
+ * can handle: the ones of @pad and of the pads whose query reaches @pad
+ * through its peer. Must be called without locks. */
+static void
+caps_cache_invalidate_pad (GstPad * pad)
+{
+  GstPad *peer;
+
+  caps_cache_invalidate (pad);
+
+  if ((peer = gst_pad_get_peer (pad))) {
+    caps_cache_invalidate_link (peer);
+    gst_object_unref (peer);
+  }
+}
+
+/* must be called with the object lock */
+static void
+caps_cache_clear (GstPad * pad)
+{
+  guint i;
+
+  for (i = 0; i < CAPS_CACHE_SIZE; i++) {
+    CapsCacheEntry *entry = &pad->priv->caps_cache[i];
+
+    if (entry->filter)
+      gst_caps_unref (entry->filter);
+    if (entry->caps)
+      gst_caps_unref (entry->caps);
+    entry->filter = NULL;
+    entry->caps = NULL;
+  }
+}
+
+/* set the result of the CAPS @query from the cache. Must be called with the
+ * object lock */
+static gboolean
+caps_cache_lookup (GstPad * pad, GstQuery * query)
+{
+  GstCaps *filter;
+  guint i, cookie;
+
+  cookie = g_atomic_int_get (&pad->priv->caps_cache_cookie);
+  gst_query_parse_caps (query, &filter);
+
+  for (i = 0; i < CAPS_CACHE_SIZE; i++) {
+    CapsCacheEntry *entry = &pad->priv->caps_cache[i];
+
+    if (entry->caps == NULL || entry->cookie != cookie)
+      continue;
+
+    if (entry->filter == filter || (entry->filter && filter &&
+            gst_caps_is_strictly_equal (entry->filter, filter))) {
+      GST_CAT_LOG_OBJECT (GST_CAT_CAPS, pad, "cached caps %" GST_PTR_FORMAT,
+          entry->caps);
+      gst_query_set_caps_result (query, entry->caps);
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/* store the result of the CAPS @query that was done when the caps_cache_cookie
+ * of @pad was @cookie. Must be called with the object lock */
+static void
+caps_cache_store (GstPad * pad, GstQuery * query, guint cookie)
+{
+  CapsCacheEntry *entry = NULL;
+  GstCaps *filter, *caps;
+  guint i;
+
+  gst_query_parse_caps (query, &filter);
+  gst_query_parse_caps_result (query, &caps);
+  if (caps == NULL)
+    return;
+
+  /* reuse an invalid entry or replace the oldest one */
+  for (i = 0; i < CAPS_CACHE_SIZE; i++) {
+    if (pad->priv->caps_cache[i].caps == NULL ||
+        pad->priv->caps_cache[i].cookie != cookie) {
+      entry = &pad->priv->caps_cache[i];
+      break;
+    }
+  }
+  if (entry == NULL) {
+    entry = &pad->priv->caps_cache[pad->priv->caps_cache_next];
+    pad->priv->caps_cache_next =
+        (pad->priv->caps_cache_next + 1) % CAPS_CACHE_SIZE;
+  }
+
+  gst_caps_replace (&entry->filter, filter);
+  gst_caps_replace (&entry->caps, caps);
+  entry->cookie = cookie;
+}
+
+/* should be called with OBJECT lock. Makes the next chain on @pad go through
+ * all the checks again, for when the link changes. */
+static inline void
+chain_cookie_invalidate (GstPad * pad)
+{
+  g_atomic_int_set ((gint *) & pad->priv->chain_cookie,
+      pad->priv->events_cookie - 1);
+}
+
+/* should be called with OBJECT lock. Disables the push fast path, after this
+ * function returns no thread can get to the old peer without the lock. */
+static void
+fast_peer_unset (GstPad * pad)
+{
+  GstPad *peer;
+
+  peer = pad->priv->fast_peer;
+  if (peer == NULL)
+    return;
+
+  GST_CAT_LOG_OBJECT (GST_CAT_SCHEDULING, pad, "disable push fast path");
+
+  /* full barrier, the readers need to be checked after clearing the peer */
+  g_atomic_pointer_compare_and_exchange (&pad->priv->fast_peer, peer, NULL);
+
+  /* wait for the threads that are taking a ref to the old peer, this is only
+   * a couple of instructions in fast_peer_enter() */
+  while (g_atomic_int_get (&pad->priv->fast_readers) > 0)
+    g_thread_yield ();
 }
 
 /* should be called with object lock */
@@ -461,7 +763,7 @@ remove_event_by_type (GstPad * pad, GstEventType type)
     gst_event_unref (ev->event);
     g_array_remove_index (events, i);
     len--;
-    pad->priv->events_cookie++;
+    EVENTS_COOKIE_BUMP (pad);
     continue;
 
   next:
@@ -546,7 +848,8 @@ restart:
         /* function unreffed and set the event to NULL, remove it */
         g_array_remove_index (events, i);
         len--;
-        cookie = ++pad->priv->events_cookie;
+        EVENTS_COOKIE_BUMP (pad);
+        cookie = pad->priv->events_cookie;
         continue;
       } else {
         /* function gave a new event for us */
@@ -621,6 +924,7 @@ gst_pad_dispose (GObject * object)
 
   GST_OBJECT_LOCK (pad);
   remove_events (pad);
+  caps_cache_clear (pad);
   GST_OBJECT_UNLOCK (pad);
 
   g_hook_list_clear (&pad->probes);
@@ -641,6 +945,9 @@ gst_pad_finalize (GObject * object)
     gst_object_unref (task);
   }
 
+  if (pad->priv->caps_cache_used)
+    g_atomic_int_add (&caps_cache_pads, -1);
+
   if (pad->activatenotify)
     pad->activatenotify (pad->activatedata);
   if (pad->activatemodenotify)
@@ -1229,7 +1536,8 @@ gst_pad_add_probe (GstPad * pad, GstPadProbeType mask,
 
   /* add the probe */
   g_hook_prepend (&pad->probes, hook);
-  pad->num_probes++;
+  /* atomic, the push fast path checks this without the lock */
+  g_atomic_int_inc (&pad->num_probes);
   /* incremenent cookie so that the new hook get's called */
   pad->priv->probe_list_cookie++;
 
@@ -1249,7 +1557,7 @@ gst_pad_add_probe (GstPad * pad, GstPadProbeType mask,
 
   /* call the callback if we need to be called for idle callbacks */
   if ((mask & GST_PAD_PROBE_TYPE_IDLE) && (callback != NULL)) {
-    if (pad->priv->using > 0) {
+    if (g_atomic_int_get (&pad->priv->using) > 0) {
       /* the pad is in use, we can't signal the idle callback yet. Since we set the
        * flag above, the last thread to leave the push will do the callback. New
        * threads going into the push will block. */
@@ -1294,7 +1602,7 @@ cleanup_hook (GstPad * pad, GHook * hook)
     }
   }
   g_hook_destroy_link (&pad->probes, hook);
-  pad->num_probes--;
+  g_atomic_int_add (&pad->num_probes, -1);
 }
 
 /**
@@ -1452,6 +1760,34 @@ gst_pad_mark_reconfigure (GstPad * pad)
   GST_OBJECT_LOCK (pad);
   GST_OBJECT_FLAG_SET (pad, GST_PAD_FLAG_NEED_RECONFIGURE);
   GST_OBJECT_UNLOCK (pad);
+
+  /* callers can hold the lock of the element, the other pads are only
+   * invalidated at the next cached CAPS query */
+  caps_cache_invalidate_link_later (pad);
+}
+
+/**
+ * gst_pad_invalidate_caps_cache:
+ * @pad: the #GstPad
+ *
+ * Drop the cached caps query results of @pad and invalidate the results that
+ * are cached on the pads whose caps query reaches @pad through its peer.
+ * Elements should call this on each pad whose caps change without the pad
+ * being linked, unlinked or reconfigured, for example after a property
+ * change.
+ *
+ * Since: 1.2
+ */
+void
+gst_pad_invalidate_caps_cache (GstPad * pad)
+{
+  g_return_if_fail (GST_IS_PAD (pad));
+
+  GST_OBJECT_LOCK (pad);
+  caps_cache_clear (pad);
+  GST_OBJECT_UNLOCK (pad);
+
+  caps_cache_invalidate_pad (pad);
 }
 
 /**
@@ -1881,10 +2217,15 @@ no_sink_parent:
   /* first clear peers */
   GST_PAD_PEER (srcpad) = NULL;
   GST_PAD_PEER (sinkpad) = NULL;
+  fast_peer_unset (srcpad);
+  chain_cookie_invalidate (sinkpad);
 
   GST_OBJECT_UNLOCK (sinkpad);
   GST_OBJECT_UNLOCK (srcpad);
 
+  caps_cache_invalidate_link (srcpad);
+  caps_cache_invalidate_link (sinkpad);
+
   /* fire off a signal to each of the pads telling them
    * that they've been unlinked */
   g_signal_emit (srcpad, gst_pad_signals[PAD_UNLINKED], 0, sinkpad);
@@ -2232,6 +2573,7 @@ gst_pad_link_full (GstPad * srcpad, GstPad * sinkpad, GstPadLinkCheck flags)
   /* must set peers before calling the link function */
   GST_PAD_PEER (srcpad) = sinkpad;
   GST_PAD_PEER (sinkpad) = srcpad;
+  chain_cookie_invalidate (sinkpad);
 
   /* check events, when something is different, mark pending */
   schedule_events (srcpad, sinkpad);
@@ -2276,6 +2618,9 @@ gst_pad_link_full (GstPad * srcpad, GstPad * sinkpad, GstPadLinkCheck flags)
   GST_OBJECT_UNLOCK (sinkpad);
   GST_OBJECT_UNLOCK (srcpad);
 
+  caps_cache_invalidate_link (srcpad);
+  caps_cache_invalidate_link (sinkpad);
+
   /* fire off a signal to each of the pads telling them
    * that they've been linked */
   g_signal_emit (srcpad, gst_pad_signals[PAD_LINKED], 0, sinkpad);
@@ -2315,6 +2660,8 @@ link_failed:
 
     GST_PAD_PEER (srcpad) = NULL;
     GST_PAD_PEER (sinkpad) = NULL;
+    /* a push could have enabled the fast path while we were unlocked */
+    fast_peer_unset (srcpad);
 
     GST_OBJECT_UNLOCK (sinkpad);
     GST_OBJECT_UNLOCK (srcpad);
@@ -2353,6 +2700,8 @@ gst_pad_set_pad_template (GstPad * pad, GstPadTemplate * templ)
   gst_object_replace ((GstObject **) template_p, (GstObject *) templ);
   GST_OBJECT_UNLOCK (pad);
 
+  caps_cache_invalidate_pad (pad);
+
   if (templ)
     gst_pad_template_pad_created (templ, pad);
 }
@@ -3426,6 +3775,8 @@ gst_pad_query (GstPad * pad, GstQuery * query)
   GstPadQueryFunction func;
   GstPadProbeType type;
   GstFlowReturn ret;
+  gboolean cache_caps = FALSE;
+  guint cookie = 0;
 
   g_return_val_if_fail (GST_IS_PAD (pad), FALSE);
   g_return_val_if_fail (GST_IS_QUERY (query), FALSE);
@@ -3448,11 +3799,31 @@ gst_pad_query (GstPad * pad, GstQuery * query)
   if (G_UNLIKELY (serialized))
     GST_PAD_STREAM_LOCK (pad);
 
+  /* the results of a reconfiguration must be invalid before we look */
+  if (G_UNLIKELY (GST_QUERY_TYPE (query) == GST_QUERY_CAPS &&
+          GST_PAD_IS_CACHE_CAPS (pad)))
+    caps_cache_invalidate_pending ();
+
   GST_OBJECT_LOCK (pad);
   PROBE_PUSH (pad, type | GST_PAD_PROBE_TYPE_PUSH |
       GST_PAD_PROBE_TYPE_BLOCK, query, probe_stopped);
   PROBE_PUSH (pad, type | GST_PAD_PROBE_TYPE_PUSH, query, probe_stopped);
 
+  if (G_UNLIKELY (GST_QUERY_TYPE (query) == GST_QUERY_CAPS &&
+          GST_PAD_IS_CACHE_CAPS (pad))) {
+    if (caps_cache_lookup (pad, query)) {
+      res = TRUE;
+      goto query_done;
+    }
+    if (G_UNLIKELY (!pad->priv->caps_cache_used)) {
+      pad->priv->caps_cache_used = TRUE;
+      g_atomic_int_inc (&caps_cache_pads);
+    }
+    /* the result is only valid for the cookie from before the query */
+    cookie = g_atomic_int_get (&pad->priv->caps_cache_cookie);
+    cache_caps = TRUE;
+  }
+
   ACQUIRE_PARENT (pad, parent, no_parent);
   GST_OBJECT_UNLOCK (pad);
 
@@ -3470,6 +3841,10 @@ gst_pad_query (GstPad * pad, GstQuery * query)
     goto query_failed;
 
   GST_OBJECT_LOCK (pad);
+  if (G_UNLIKELY (cache_caps))
+    caps_cache_store (pad, query, cookie);
+
+query_done:
   PROBE_PUSH (pad, type | GST_PAD_PROBE_TYPE_PULL, query, probe_stopped);
   GST_OBJECT_UNLOCK (pad);
 
@@ -3652,6 +4027,78 @@ probe_stopped:
  * Data passing functions
  */
 
+#define FAST_PATH_FLAGS (GST_PAD_FLAG_FLUSHING | GST_PAD_FLAG_EOS | \
+    GST_PAD_FLAG_PENDING_EVENTS | GST_PAD_FLAG_BLOCKED)
+
+/* check if data can pass @pad without taking the object lock. The flags,
+ * probes and mode are only changed with the lock, a push that races with a
+ * change behaves as if it happened right before the change. */
+static inline gboolean
+fast_path_allowed (GstPad * pad)
+{
+  return (g_atomic_int_get ((gint *) & GST_OBJECT_FLAGS (pad)) &
+      FAST_PATH_FLAGS) == 0 && g_atomic_int_get (&pad->num_probes) == 0 &&
+      GST_PAD_MODE (pad) == GST_PAD_MODE_PUSH;
+}
+
+/* should be called with OBJECT lock when all checks of a push passed */
+static inline void
+fast_peer_set (GstPad * pad, GstPad * peer)
+{
+  GST_CAT_LOG_OBJECT (GST_CAT_SCHEDULING, pad, "enable push fast path to %"
+      GST_PTR_FORMAT, peer);
+  g_atomic_pointer_set (&pad->priv->fast_peer, peer);
+}
+
+static void
+fast_peer_leave (GstPad * pad, GstPad * peer)
+{
+  if (peer)
+    gst_object_unref (peer);
+
+  if (!g_atomic_int_dec_and_test (&pad->priv->using))
+    return;
+
+  /* we were the last user, trigger the idle callbacks like the locked path
+   * does */
+  if (G_UNLIKELY (g_atomic_int_get (&pad->num_probes))) {
+    GstPadProbeInfo info = { GST_PAD_PROBE_TYPE_PUSH |
+          GST_PAD_PROBE_TYPE_IDLE, 0, NULL, 0, 0
+    };
+
+    GST_OBJECT_LOCK (pad);
+    if (g_atomic_int_get (&pad->priv->using) == 0)
+      do_probe_callbacks (pad, &info, GST_FLOW_OK);
+    GST_OBJECT_UNLOCK (pad);
+  }
+}
+
+/* returns a ref to the peer of @pad when data can be pushed without taking
+ * the object lock, fast_peer_leave() must be called when done. */
+static inline GstPad *
+fast_peer_enter (GstPad * pad)
+{
+  GstPad *peer = NULL;
+
+  if (!fast_path_allowed (pad))
+    return NULL;
+
+  /* count ourselves as a user first so that idle probes are delayed */
+  g_atomic_int_inc (&pad->priv->using);
+
+  /* fast_peer_unset() waits for us while we take the ref */
+  g_atomic_int_inc (&pad->priv->fast_readers);
+  if (G_LIKELY (fast_path_allowed (pad) &&
+          (peer = g_atomic_pointer_get (&pad->priv->fast_peer))))
+    gst_object_ref (peer);
+  g_atomic_int_add (&pad->priv->fast_readers, -1);
+
+  if (G_UNLIKELY (peer == NULL))
+    fast_peer_leave (pad, NULL);
+
+  return peer;
+}
+
 /* this is the chain function that does not perform the additional argument
  * checking for that little extra speed.
  */
@@ -3660,9 +4107,21 @@ gst_pad_chain_data_unchecked (GstPad * pad, GstPadProbeType type, void *data)
 {
   GstFlowReturn ret;
   GstObject *parent;
+  gboolean checked = TRUE;
 
   GST_PAD_STREAM_LOCK (pad);
 
+  /* the pad passed all checks before and neither the sticky events nor the
+   * link changed since. They are changed with the OBJECT lock, possibly from
+   * another thread than the streaming thread, a chain that races with a
+   * change behaves as if it happened right before the change. */
+  if (G_LIKELY (g_atomic_int_get ((gint *) & pad->priv->chain_cookie) ==
+          g_atomic_int_get ((gint *) & pad->priv->events_cookie) &&
+          fast_path_allowed (pad))) {
+    parent = GST_OBJECT_PARENT (pad);
+    goto do_chain;
+  }
+
   GST_OBJECT_LOCK (pad);
   if (G_UNLIKELY (GST_PAD_IS_FLUSHING (pad)))
     goto flushing;
@@ -3678,11 +4137,13 @@ gst_pad_chain_data_unchecked (GstPad * pad, GstPadProbeType type, void *data)
     g_warning (G_STRLOC
         ":%s:<%s:%s> Got data flow before stream-start event",
         G_STRFUNC, GST_DEBUG_PAD_NAME (pad));
+    checked = FALSE;
   }
   if (!find_event_by_type (pad, GST_EVENT_SEGMENT, 0)) {
     g_warning (G_STRLOC
         ":%s:<%s:%s> Got data flow before segment event",
         G_STRFUNC, GST_DEBUG_PAD_NAME (pad));
+    checked = FALSE;
   }
 #endif
 
@@ -3690,9 +4151,16 @@ gst_pad_chain_data_unchecked (GstPad * pad, GstPadProbeType type, void *data)
 
   PROBE_PUSH (pad, type, data, probe_stopped);
 
+  /* skip the checks for the next buffers until the events change */
+  if (checked)
+    g_atomic_int_set ((gint *) & pad->priv->chain_cookie,
+        pad->priv->events_cookie);
+
   parent = GST_OBJECT_PARENT (pad);
   GST_OBJECT_UNLOCK (pad);
 
+do_chain:
+
   /* NOTE: we read the chainfunc unlocked.
    * we cannot hold the lock for the pad so we might send
    * the data to the wrong function. This is not really a
@@ -3894,6 +4362,15 @@ gst_pad_push_data (GstPad * pad, GstPadProbeType type, void *data)
   GstPad *peer;
   GstFlowReturn ret;
 
+  /* fast path, the link did not change since the last push and there are no
+   * probes, pending events, flushing or EOS */
+  if (G_LIKELY ((peer = fast_peer_enter (pad)))) {
+    ret = gst_pad_chain_data_unchecked (peer, type, data);
+    fast_peer_leave (pad, peer);
+
+    return ret;
+  }
+
   GST_OBJECT_LOCK (pad);
   if (G_UNLIKELY (GST_PAD_IS_FLUSHING (pad)))
     goto flushing;
@@ -3933,9 +4410,14 @@ gst_pad_push_data (GstPad * pad, GstPadProbeType type, void *data)
   if (G_UNLIKELY ((peer = GST_PAD_PEER (pad)) == NULL))
     goto not_linked;
 
+  /* all checks passed, the next pushes can use the fast path until something
+   * changes */
+  if (G_UNLIKELY (pad->priv->fast_peer == NULL) && pad->num_probes == 0)
+    fast_peer_set (pad, peer);
+
   /* take ref to peer pad before releasing the lock */
   gst_object_ref (peer);
-  pad->priv->using++;
+  g_atomic_int_inc (&pad->priv->using);
   GST_OBJECT_UNLOCK (pad);
 
   ret = gst_pad_chain_data_unchecked (peer, type, data);
@@ -3943,11 +4425,10 @@ gst_pad_push_data (GstPad * pad, GstPadProbeType type, void *data)
   gst_object_unref (peer);
 
   GST_OBJECT_LOCK (pad);
-  pad->priv->using--;
-  if (pad->priv->using == 0) {
+  if (g_atomic_int_dec_and_test (&pad->priv->using)) {
     /* pad is not active anymore, trigger idle callbacks */
     PROBE_NO_DATA (pad, GST_PAD_PROBE_TYPE_PUSH | GST_PAD_PROBE_TYPE_IDLE,
-        probe_stopped, ret);
+        idle_probe_stopped, ret);
   }
   GST_OBJECT_UNLOCK (pad);
 
@@ -4010,6 +4491,12 @@ not_linked:
     gst_mini_object_unref (GST_MINI_OBJECT_CAST (data));
     return GST_FLOW_NOT_LINKED;
   }
+idle_probe_stopped:
+  {
+    GST_OBJECT_UNLOCK (pad);
+    GST_DEBUG_OBJECT (pad, "Idle probe returned %s", gst_flow_get_name (ret));
+    return ret;
+  }
 }
 
 /**
@@ -4351,7 +4838,7 @@ gst_pad_pull_range (GstPad * pad, guint64 offset, guint size,
     goto not_linked;
 
   gst_object_ref (peer);
-  pad->priv->using++;
+  g_atomic_int_inc (&pad->priv->using);
   GST_OBJECT_UNLOCK (pad);
 
   ret = gst_pad_get_range_unchecked (peer, offset, size, &res_buf);
@@ -4359,8 +4846,7 @@ gst_pad_pull_range (GstPad * pad, guint64 offset, guint size,
   gst_object_unref (peer);
 
   GST_OBJECT_LOCK (pad);
-  pad->priv->using--;
-  if (pad->priv->using == 0) {
+  if (g_atomic_int_dec_and_test (&pad->priv->using)) {
     /* pad is not active anymore, trigger idle callbacks */
     PROBE_NO_DATA (pad, GST_PAD_PROBE_TYPE_PULL | GST_PAD_PROBE_TYPE_IDLE,
         probe_stopped_unref, ret);
@@ -4516,7 +5002,7 @@ store_sticky_event (GstPad * pad, GstEvent * event)
   }
 
   if (res) {
-    pad->priv->events_cookie++;
+    EVENTS_COOKIE_BUMP (pad);
     GST_OBJECT_FLAG_SET (pad, GST_PAD_FLAG_PENDING_EVENTS);
 
     GST_LOG_OBJECT (pad, "stored sticky event %s", GST_EVENT_TYPE_NAME (event));
@@ -4525,6 +5011,8 @@ store_sticky_event (GstPad * pad, GstEvent * event)
       case GST_EVENT_CAPS:
         GST_OBJECT_UNLOCK (pad);
 
+        caps_cache_invalidate_pad (pad);
+
         GST_DEBUG_OBJECT (pad, "notify caps");
         g_object_notify_by_pspec ((GObject *) pad, pspec_caps);
 
@@ -4642,6 +5130,9 @@ gst_pad_push_event_unchecked (GstPad * pad, GstEvent * event,
         case GST_EVENT_RECONFIGURE:
           if (GST_PAD_IS_SINK (pad))
             GST_OBJECT_FLAG_SET (pad, GST_PAD_FLAG_NEED_RECONFIGURE);
+          /* the event travels upstream through all pads that depend on the
+           * pads downstream */
+          caps_cache_invalidate (pad);
           break;
         default:
           break;
@@ -4673,7 +5164,7 @@ gst_pad_push_event_unchecked (GstPad * pad, GstEvent * event,
     goto not_linked;
 
   gst_object_ref (peerpad);
-  pad->priv->using++;
+  g_atomic_int_inc (&pad->priv->using);
   GST_OBJECT_UNLOCK (pad);
 
   GST_LOG_OBJECT (pad, "sending event %p (%s) to peerpad %" GST_PTR_FORMAT,
@@ -4689,8 +5180,7 @@ gst_pad_push_event_unchecked (GstPad * pad, GstEvent * event,
   gst_object_unref (peerpad);
 
   GST_OBJECT_LOCK (pad);
-  pad->priv->using--;
-  if (pad->priv->using == 0) {
+  if (g_atomic_int_dec_and_test (&pad->priv->using)) {
     /* pad is not active anymore, trigger idle callbacks */
     PROBE_NO_DATA (pad, GST_PAD_PROBE_TYPE_PUSH | GST_PAD_PROBE_TYPE_IDLE,
         idle_probe_stopped, ret);
@@ -4930,6 +5420,7 @@ gst_pad_send_event_unchecked (GstPad * pad, GstEvent * event,
     case GST_EVENT_RECONFIGURE:
       if (GST_PAD_IS_SRC (pad))
         GST_OBJECT_FLAG_SET (pad, GST_PAD_FLAG_NEED_RECONFIGURE);
+      caps_cache_invalidate (pad);
     default:
       GST_CAT_DEBUG_OBJECT (GST_CAT_EVENT, pad,
           "have event type %" GST_PTR_FORMAT, event);
@@ -620,6 +620,9 @@ typedef gboolean  (*GstPadStickyEventsForeachFunction) (GstPad *pad, GstEvent **
  * @GST_PAD_FLAG_PROXY_SCHEDULING: the default query handler will forward
  *                      scheduling queries to the internally linked pads
  *                      instead of discarding them.
+ * @GST_PAD_FLAG_CACHE_CAPS: the results of caps queries on the pad are cached
+ *                      until something that can change negotiation happens.
+ *                      Since: 1.2
  * @GST_PAD_FLAG_LAST: offset to define more flags
  *
  * Pad state flags
@@ -636,6 +639,7 @@ typedef enum {
   GST_PAD_FLAG_PROXY_CAPS       = (GST_OBJECT_FLAG_LAST << 8),
   GST_PAD_FLAG_PROXY_ALLOCATION = (GST_OBJECT_FLAG_LAST << 9),
   GST_PAD_FLAG_PROXY_SCHEDULING = (GST_OBJECT_FLAG_LAST << 10),
+  GST_PAD_FLAG_CACHE_CAPS       = (GST_OBJECT_FLAG_LAST << 11),
   /* padding */
   GST_PAD_FLAG_LAST        = (GST_OBJECT_FLAG_LAST << 16)
 } GstPadFlags;
@@ -789,6 +793,10 @@ struct _GstPadClass {
 #define GST_PAD_SET_PROXY_SCHEDULING(pad)   (GST_OBJECT_FLAG_SET (pad, GST_PAD_FLAG_PROXY_SCHEDULING))
 #define GST_PAD_UNSET_PROXY_SCHEDULING(pad) (GST_OBJECT_FLAG_UNSET (pad, GST_PAD_FLAG_PROXY_SCHEDULING))
 
+#define GST_PAD_IS_CACHE_CAPS(pad)      (GST_OBJECT_FLAG_IS_SET (pad, GST_PAD_FLAG_CACHE_CAPS))
+#define GST_PAD_SET_CACHE_CAPS(pad)     (GST_OBJECT_FLAG_SET (pad, GST_PAD_FLAG_CACHE_CAPS))
+#define GST_PAD_UNSET_CACHE_CAPS(pad)   (GST_OBJECT_FLAG_UNSET (pad, GST_PAD_FLAG_CACHE_CAPS))
+
 /**
  * GST_PAD_GET_STREAM_LOCK:
  * @pad: a #GstPad
@@ -875,6 +883,8 @@ void                    gst_pad_mark_reconfigure                (GstPad *pad);
 gboolean		gst_pad_needs_reconfigure               (GstPad *pad);
 gboolean		gst_pad_check_reconfigure               (GstPad *pad);
 
+void                    gst_pad_invalidate_caps_cache           (GstPad *pad);
+
 void			gst_pad_set_element_private		(GstPad *pad, gpointer priv);
 gpointer		gst_pad_get_element_private		(GstPad *pad);
 
@@ -304,7 +304,8 @@ gst_static_pad_template_get (GstStaticPadTemplate * pad_template)
  * @caps: (transfer none): a #GstCaps set for the template.
  *
  * Creates a new pad template with a name according to the given template
- * and with the given arguments.
+ * and with the given arguments. The template keeps the interned instance of
+ * @caps, see gst_caps_intern().
  *
  * Returns: (transfer floating): a new #GstPadTemplate.
  */
@@ -402,8 +403,15 @@ gst_pad_template_set_property (GObject * object, guint prop_id,
           (GstPadPresence) g_value_get_enum (value);
       break;
     case PROP_CAPS:
-      GST_PAD_TEMPLATE_CAPS (object) = g_value_dup_boxed (value);
+    {
+      GstCaps *caps = g_value_dup_boxed (value);
+
+      /* template caps never change, share them with equal templates */
+      if (caps)
+        caps = gst_caps_intern (caps);
+      GST_PAD_TEMPLATE_CAPS (object) = caps;
       break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -87,6 +87,11 @@
 GST_DEBUG_CATEGORY_STATIC (pipeline_debug);
 #define GST_CAT_DEFAULT pipeline_debug
 
+/* the number of pipelines that prepared a task pool is kept on the pool,
+ * only the first prepares it and only the last cleans it up */
+static GQuark pool_users_quark;
+static GMutex pool_users_lock;
+
 /* Pipeline signals and args */
 enum
 {
@@ -101,7 +106,8 @@ enum
 {
   PROP_0,
   PROP_DELAY,
-  PROP_AUTO_FLUSH_BUS
+  PROP_AUTO_FLUSH_BUS,
+  PROP_TASK_POOL
 };
 
 #define GST_PIPELINE_GET_PRIVATE(obj)  \
@@ -116,10 +122,19 @@ struct _GstPipelinePrivate
    * PLAYING*/
   GstClockTime last_start_time;
   gboolean update_clock;
+
+  /* pool for the tasks of the elements, with LOCK */
+  GstTaskPool *task_pool;
+  /* the pool we prepared in NULL to READY, cleaned up in READY to NULL */
+  GstTaskPool *prepared_pool;
+
+  /* thread policies of the tasks, by target, with LOCK */
+  GHashTable *thread_policies;
 };
 
 
 static void gst_pipeline_dispose (GObject * object);
+static void gst_pipeline_cleanup_task_pool (GstPipeline * pipeline);
 static void gst_pipeline_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 static void gst_pipeline_get_property (GObject * object, guint prop_id,
@@ -137,6 +152,7 @@ static void gst_pipeline_handle_message (GstBin * bin, GstMessage * message);
 { \
   GST_DEBUG_CATEGORY_INIT (pipeline_debug, "pipeline", GST_DEBUG_BOLD, \
       "debugging info for the 'pipeline' container element"); \
+  pool_users_quark = g_quark_from_static_string ("GstPipeline.pool-users"); \
 }
 
 #define gst_pipeline_parent_class parent_class
@@ -180,6 +196,20 @@ gst_pipeline_class_init (GstPipelineClass * klass)
           "from READY into NULL state", DEFAULT_AUTO_FLUSH_BUS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstPipeline:task-pool:
+   *
+   * The #GstTaskPool used for the streaming threads of the elements in the
+   * pipeline. Please see gst_pipeline_set_task_pool() for more information
+   * on this option.
+   *
+   * Since: 1.2
+   **/
+  g_object_class_install_property (gobject_class, PROP_TASK_POOL,
+      g_param_spec_object ("task-pool", "Task Pool",
+          "The pool for the streaming threads of the elements (NULL=default)",
+          GST_TYPE_TASK_POOL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gobject_class->dispose = gst_pipeline_dispose;
 
   gst_element_class_set_static_metadata (gstelement_class, "Pipeline object",
@@ -230,6 +260,12 @@ gst_pipeline_dispose (GObject * object)
 
   /* clear and unref any fixed clock */
   gst_object_replace ((GstObject **) clock_p, NULL);
+  gst_pipeline_cleanup_task_pool (pipeline);
+  gst_object_replace ((GstObject **) & pipeline->priv->task_pool, NULL);
+  if (pipeline->priv->thread_policies) {
+    g_hash_table_unref (pipeline->priv->thread_policies);
+    pipeline->priv->thread_policies = NULL;
+  }
 
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
@@ -247,6 +283,9 @@ gst_pipeline_set_property (GObject * object, guint prop_id,
     case PROP_AUTO_FLUSH_BUS:
       gst_pipeline_set_auto_flush_bus (pipeline, g_value_get_boolean (value));
       break;
+    case PROP_TASK_POOL:
+      gst_pipeline_set_task_pool (pipeline, g_value_get_object (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -266,6 +305,9 @@ gst_pipeline_get_property (GObject * object, guint prop_id,
     case PROP_AUTO_FLUSH_BUS:
       g_value_set_boolean (value, gst_pipeline_get_auto_flush_bus (pipeline));
       break;
+    case PROP_TASK_POOL:
+      g_value_take_object (value, gst_pipeline_get_task_pool (pipeline));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -348,6 +390,53 @@ pipeline_update_start_time (GstElement * element)
   GST_OBJECT_UNLOCK (element);
 }
 
+/* prepare @pool for one more pipeline, the pool can be shared */
+static gboolean
+gst_pipeline_prepare_task_pool (GstTaskPool * pool, GError ** error)
+{
+  guint users;
+
+  g_mutex_lock (&pool_users_lock);
+  users = GPOINTER_TO_UINT (g_object_get_qdata (G_OBJECT (pool),
+          pool_users_quark));
+  if (users == 0) {
+    gst_task_pool_prepare (pool, error);
+    if (*error != NULL)
+      goto done;
+  }
+  g_object_set_qdata (G_OBJECT (pool), pool_users_quark,
+      GUINT_TO_POINTER (users + 1));
+
+done:
+  g_mutex_unlock (&pool_users_lock);
+
+  return *error == NULL;
+}
+
+/* clean up the pool that was prepared when going to READY, when no other
+ * pipeline still uses it */
+static void
+gst_pipeline_cleanup_task_pool (GstPipeline * pipeline)
+{
+  GstTaskPool *pool;
+  guint users;
+
+  if ((pool = pipeline->priv->prepared_pool)) {
+    pipeline->priv->prepared_pool = NULL;
+
+    g_mutex_lock (&pool_users_lock);
+    users = GPOINTER_TO_UINT (g_object_get_qdata (G_OBJECT (pool),
+            pool_users_quark)) - 1;
+    g_object_set_qdata (G_OBJECT (pool), pool_users_quark,
+        GUINT_TO_POINTER (users));
+    if (users == 0)
+      gst_task_pool_cleanup (pool);
+    g_mutex_unlock (&pool_users_lock);
+
+    gst_object_unref (pool);
+  }
+}
+
 /* MT safe */
 static GstStateChangeReturn
 gst_pipeline_change_state (GstElement * element, GstStateChange transition)
@@ -355,13 +444,24 @@ gst_pipeline_change_state (GstElement * element, GstStateChange transition)
   GstStateChangeReturn result = GST_STATE_CHANGE_SUCCESS;
   GstPipeline *pipeline = GST_PIPELINE_CAST (element);
   GstClock *clock;
+  GstTaskPool *pool;
+  GError *error = NULL;
 
   switch (transition) {
     case GST_STATE_CHANGE_NULL_TO_READY:
       GST_OBJECT_LOCK (element);
       if (element->bus)
         gst_bus_set_flushing (element->bus, FALSE);
+      if ((pool = pipeline->priv->task_pool))
+        gst_object_ref (pool);
       GST_OBJECT_UNLOCK (element);
+
+      /* the tasks of the children take their threads from the pool */
+      if (pool) {
+        if (!gst_pipeline_prepare_task_pool (pool, &error))
+          goto pool_prepare_failed;
+        pipeline->priv->prepared_pool = pool;
+      }
       break;
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       GST_OBJECT_LOCK (element);
@@ -472,6 +572,8 @@ gst_pipeline_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_NULL_TO_READY:
+      if (result == GST_STATE_CHANGE_FAILURE)
+        gst_pipeline_cleanup_task_pool (pipeline);
       break;
     case GST_STATE_CHANGE_READY_TO_PAUSED:
     {
@@ -511,6 +613,8 @@ gst_pipeline_change_state (GstElement * element, GstStateChange transition)
         }
         gst_object_unref (bus);
       }
+      /* the children stopped their tasks */
+      gst_pipeline_cleanup_task_pool (pipeline);
       break;
     }
   }
@@ -530,6 +634,44 @@ invalid_clock:
       gst_object_unref (clock);
     return GST_STATE_CHANGE_FAILURE;
   }
+pool_prepare_failed:
+  {
+    GST_ELEMENT_ERROR (pipeline, CORE, THREAD, (NULL),
+        ("Failed to prepare the task pool: %s", error->message));
+    g_error_free (error);
+    gst_object_unref (pool);
+    return GST_STATE_CHANGE_FAILURE;
+  }
+}
+
+/* find the thread policy for the task of @src, a pad of @owner or @owner
+ * itself, with LOCK */
+static GstStructure *
+gst_pipeline_find_thread_policy (GstPipeline * pipeline, GstObject * src,
+    GstElement * owner)
+{
+  GHashTable *policies = pipeline->priv->thread_policies;
+  GstStructure *policy = NULL;
+
+  if (policies == NULL)
+    return NULL;
+
+  if (owner) {
+    if (GST_IS_PAD (src)) {
+      gchar *target;
+
+      target = g_strdup_printf ("%s.%s", GST_OBJECT_NAME (owner),
+          GST_OBJECT_NAME (src));
+      policy = g_hash_table_lookup (policies, target);
+      g_free (target);
+    }
+    if (policy == NULL)
+      policy = g_hash_table_lookup (policies, GST_OBJECT_NAME (owner));
+  }
+  if (policy == NULL)
+    policy = g_hash_table_lookup (policies, "*");
+
+  return policy ? gst_structure_copy (policy) : NULL;
 }
 
 /* intercept the bus messages from our children. We watch for the ASYNC_START
@@ -568,6 +710,48 @@ gst_pipeline_handle_message (GstBin * bin, GstMessage * message)
         pipeline->priv->update_clock = TRUE;
       }
       GST_OBJECT_UNLOCK (bin);
+    }
+      break;
+    case GST_MESSAGE_STREAM_STATUS:
+    {
+      GstStreamStatusType type;
+      GstElement *owner;
+      GstTaskPool *pool;
+      GstStructure *policy;
+      const GValue *val;
+      GstTask *task;
+
+      /* the message of a new task is posted before its thread is started,
+       * configure our pool and thread policy on it */
+      gst_message_parse_stream_status (message, &type, &owner);
+      if (type != GST_STREAM_STATUS_TYPE_CREATE)
+        break;
+
+      val = gst_message_get_stream_status_object (message);
+      if (val == NULL || !G_VALUE_HOLDS (val, GST_TYPE_TASK))
+        break;
+      task = g_value_get_object (val);
+
+      GST_OBJECT_LOCK (bin);
+      if ((pool = pipeline->priv->task_pool))
+        gst_object_ref (pool);
+      policy = gst_pipeline_find_thread_policy (pipeline,
+          GST_MESSAGE_SRC (message), owner);
+      GST_OBJECT_UNLOCK (bin);
+
+      if (pool) {
+        GST_DEBUG_OBJECT (pipeline, "setting task pool %" GST_PTR_FORMAT
+            " on task %p", pool, task);
+        gst_task_set_pool (task, pool);
+        gst_object_unref (pool);
+      }
+      if (policy) {
+        GST_DEBUG_OBJECT (pipeline, "setting thread policy %" GST_PTR_FORMAT
+            " on task %p", policy, task);
+        gst_task_set_thread_policy (task, policy);
+        gst_structure_free (policy);
+      }
+      break;
     }
     default:
       break;
@@ -839,3 +1023,172 @@ gst_pipeline_get_auto_flush_bus (GstPipeline * pipeline)
 
   return res;
 }
+
+/**
+ * gst_pipeline_set_task_pool:
+ * @pipeline: a #GstPipeline
+ * @pool: (transfer none) (allow-none): a #GstTaskPool, or %NULL
+ *
+ * Use @pool for the streaming threads of the elements in @pipeline, like a
+ * #GstWorkStealingTaskPool. Elements that start their tasks with
+ * gst_pad_start_task() use it without changes, the pool is configured on each
+ * task when the task is created and before its thread is started. Tasks
+ * with a nice value, see gst_task_set_nice(), don't use @pool nor the CPUs
+ * it pins its threads to, they run in a thread of their own. Tasks
+ * that already exist keep their pool, so this is best done while the
+ * pipeline is in the NULL state. Passing %NULL makes new tasks use the
+ * default pool again.
+ *
+ * The pipeline prepares the pool when it goes from NULL to READY and cleans
+ * it up again when it goes back to NULL, the application must not do this
+ * itself. A pool can be shared by several pipelines, it is prepared by the
+ * first one that goes to READY and cleaned up by the last one that goes
+ * back to NULL.
+ *
+ * A sync handler on the bus can still pick another pool for a task from the
+ * %GST_STREAM_STATUS_TYPE_CREATE stream-status message, it runs after this.
+ *
+ * MT safe.
+ *
+ * Since: 1.2
+ */
+void
+gst_pipeline_set_task_pool (GstPipeline * pipeline, GstTaskPool * pool)
+{
+  GstTaskPool **pool_p;
+
+  g_return_if_fail (GST_IS_PIPELINE (pipeline));
+  g_return_if_fail (pool == NULL || GST_IS_TASK_POOL (pool));
+
+  pool_p = &pipeline->priv->task_pool;
+
+  GST_OBJECT_LOCK (pipeline);
+  gst_object_replace ((GstObject **) pool_p, (GstObject *) pool);
+  GST_OBJECT_UNLOCK (pipeline);
+}
+
+/**
+ * gst_pipeline_get_task_pool:
+ * @pipeline: a #GstPipeline
+ *
+ * Get the #GstTaskPool that @pipeline configures on the tasks of its
+ * elements.
+ *
+ * Returns: (transfer full): the #GstTaskPool of @pipeline, or %NULL when the
+ * default pool is used. gst_object_unref() after usage.
+ *
+ * MT safe.
+ *
+ * Since: 1.2
+ */
+GstTaskPool *
+gst_pipeline_get_task_pool (GstPipeline * pipeline)
+{
+  GstTaskPool *pool;
+
+  g_return_val_if_fail (GST_IS_PIPELINE (pipeline), NULL);
+
+  GST_OBJECT_LOCK (pipeline);
+  if ((pool = pipeline->priv->task_pool))
+    gst_object_ref (pool);
+  GST_OBJECT_UNLOCK (pipeline);
+
+  return pool;
+}
+
+/**
+ * gst_pipeline_set_thread_policy:
+ * @pipeline: a #GstPipeline
+ * @target: (allow-none): the name of an element, "element.pad" for the
+ *     task of a pad, or %NULL for all tasks
+ * @policy: (transfer none) (allow-none): the thread policy, or %NULL
+ *
+ * Apply @policy to the streaming threads of @target in @pipeline, see
+ * gst_task_set_thread_policy() for the fields of @policy. Like the task pool,
+ * the policy is configured on each task when it is created, so this is best
+ * done while the pipeline is in the NULL state. Passing %NULL for @policy
+ * removes the policy of @target.
+ *
+ * @policy is checked with gst_task_thread_policy_is_valid() first, a wrong
+ * policy is reported here and not only when the tasks are created.
+ *
+ * The policy of the pad of a task is used first, then the policy of the
+ * element that owns the task and last the policy for all tasks. Only the
+ * first policy that is found is applied.
+ *
+ * A sync handler on the bus can still change the policy of a task from the
+ * %GST_STREAM_STATUS_TYPE_CREATE stream-status message, or from an enter
+ * callback with gst_task_set_enter_callback().
+ *
+ * Returns: %TRUE when the policy of @target was changed, %FALSE when @policy
+ * is invalid.
+ *
+ * MT safe.
+ *
+ * Since: 1.2
+ */
+gboolean
+gst_pipeline_set_thread_policy (GstPipeline * pipeline, const gchar * target,
+    const GstStructure * policy)
+{
+  GstPipelinePrivate *priv;
+
+  g_return_val_if_fail (GST_IS_PIPELINE (pipeline), FALSE);
+
+  if (policy && !gst_task_thread_policy_is_valid (policy))
+    return FALSE;
+
+  priv = pipeline->priv;
+
+  if (target == NULL)
+    target = "*";
+
+  GST_OBJECT_LOCK (pipeline);
+  if (policy) {
+    if (priv->thread_policies == NULL)
+      priv->thread_policies = g_hash_table_new_full (g_str_hash, g_str_equal,
+          g_free, (GDestroyNotify) gst_structure_free);
+    g_hash_table_insert (priv->thread_policies, g_strdup (target),
+        gst_structure_copy (policy));
+  } else if (priv->thread_policies) {
+    g_hash_table_remove (priv->thread_policies, target);
+  }
+  GST_OBJECT_UNLOCK (pipeline);
+
+  return TRUE;
+}
+
+/**
+ * gst_pipeline_get_thread_policy:
+ * @pipeline: a #GstPipeline
+ * @target: (allow-none): the name of an element, "element.pad" or %NULL
+ *
+ * Get the thread policy that was set for @target with
+ * gst_pipeline_set_thread_policy().
+ *
+ * Returns: (transfer full): a copy of the policy of @target, or %NULL when
+ * @target has no policy. gst_structure_free() after usage.
+ *
+ * MT safe.
+ *
+ * Since: 1.2
+ */
+GstStructure *
+gst_pipeline_get_thread_policy (GstPipeline * pipeline, const gchar * target)
+{
+  GstStructure *policy = NULL;
+
+  g_return_val_if_fail (GST_IS_PIPELINE (pipeline), NULL);
+
+  if (target == NULL)
+    target = "*";
+
+  GST_OBJECT_LOCK (pipeline);
+  if (pipeline->priv->thread_policies)
+    policy = g_hash_table_lookup (pipeline->priv->thread_policies, target);
+  if (policy)
+    policy = gst_structure_copy (policy);
+  GST_OBJECT_UNLOCK (pipeline);
+
+  return policy;
+}
@@ -104,6 +104,13 @@ GstClockTime    gst_pipeline_get_delay          (GstPipeline *pipeline);
 void            gst_pipeline_set_auto_flush_bus (GstPipeline *pipeline, gboolean auto_flush);
 gboolean        gst_pipeline_get_auto_flush_bus (GstPipeline *pipeline);
 
+void            gst_pipeline_set_task_pool      (GstPipeline *pipeline, GstTaskPool *pool);
+GstTaskPool*    gst_pipeline_get_task_pool      (GstPipeline *pipeline);
+
+gboolean        gst_pipeline_set_thread_policy  (GstPipeline *pipeline, const gchar *target,
+                                                 const GstStructure *policy);
+GstStructure*   gst_pipeline_get_thread_policy  (GstPipeline *pipeline, const gchar *target);
+
 G_END_DECLS
 
 #endif /* __GST_PIPELINE_H__ */
@@ -843,8 +843,11 @@ handle_rx_packet (GstPluginLoader * l,
 
       if (payload_len > 0) {
         GstPlugin *newplugin = NULL;
+
+        /* the receive buffer is reused, so the pad templates can't point into
+         * it and use their caps string */
         if (!_priv_gst_registry_chunks_load_plugin (l->registry, &tmp,
-                tmp + payload_len, &newplugin)) {
+                tmp + payload_len, FALSE, &newplugin)) {
           /* Got garbage from the child, so fail and trigger replay of plugins */
           GST_ERROR_OBJECT (l->registry,
               "Problems loading plugin details with tag %u from scanner", tag);
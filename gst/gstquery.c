@@ -68,6 +68,7 @@
 #include "gstquark.h"
 #include "gsturi.h"
 #include "gstbufferpool.h"
+#include "gstmagazine.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_query_debug);
 #define GST_CAT_DEFAULT gst_query_debug
@@ -79,9 +80,32 @@ typedef struct
   GstQuery query;
 
   GstStructure *structure;
+
+  /* the position, duration and latency queries keep their values in typed
+   * fields that are made, set and parsed without a structure. The structure
+   * is only made from these fields when it is asked for and is then kept up
+   * to date. The fields are only valid while has_payload is set, which is
+   * cleared when the structure is made writable. */
+  gboolean has_payload;
+  union
+  {
+    struct
+    {
+      GstFormat format;
+      gint64 value;
+    } position;                 /* also used for duration */
+    struct
+    {
+      gboolean live;
+      GstClockTime min;
+      GstClockTime max;
+    } latency;
+  } payload;
 } GstQueryImpl;
 
 #define GST_QUERY_STRUCTURE(q)  (((GstQueryImpl *)(q))->structure)
+#define GST_QUERY_HAS_PAYLOAD(q) (((GstQueryImpl *)(q))->has_payload)
+#define GST_QUERY_PAYLOAD(q)    (&((GstQueryImpl *)(q))->payload)
 
 
 typedef struct
@@ -115,8 +139,61 @@ static GstQueryQuarks query_quarks[] = {
   {0, NULL, 0}
 };
 
+/* queries of these types are created and freed at a high rate. Queries with
+ * typed fields are recycled without a structure, the others together with
+ * their structure when it has no more than RECYCLE_MAX_FIELDS fields */
+#define RECYCLE_MAX_FIELDS 8
+
+typedef struct
+{
+  const GstQueryType type;
+  const GstQuarkId name;
+  const gboolean typed;
+  const gchar *cache_name;
+  GstMagazineCache *cache;
+} GstQueryRecycle;
+
+static GstQueryRecycle query_recycle[] = {
+  {GST_QUERY_POSITION, GST_QUARK_QUERY_POSITION, TRUE, "GstQuery-position",
+      NULL},
+  {GST_QUERY_DURATION, GST_QUARK_QUERY_DURATION, TRUE, "GstQuery-duration",
+      NULL},
+  {GST_QUERY_LATENCY, GST_QUARK_QUERY_LATENCY, TRUE, "GstQuery-latency", NULL},
+  {GST_QUERY_ALLOCATION, GST_QUARK_QUERY_ALLOCATION, FALSE,
+      "GstQuery-allocation", NULL},
+  {GST_QUERY_ACCEPT_CAPS, GST_QUARK_QUERY_ACCEPT_CAPS, FALSE,
+      "GstQuery-accept-caps", NULL},
+  {GST_QUERY_CAPS, GST_QUARK_QUERY_CAPS, FALSE, "GstQuery-caps", NULL}
+};
+
 GST_DEFINE_MINI_OBJECT_TYPE (GstQuery, gst_query);
 
+/* free a query that is removed from the recycle cache */
+static void
+_gst_query_free_recycled (GstQueryImpl * query)
+{
+  GstStructure *s = GST_QUERY_STRUCTURE (query);
+
+  if (s) {
+    gst_structure_set_parent_refcount (s, NULL);
+    gst_structure_free (s);
+  }
+
+  g_slice_free1 (sizeof (GstQueryImpl), query);
+}
+
+static inline GstQueryRecycle *
+query_recycle_find (GstQueryType type)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (query_recycle); i++) {
+    if (query_recycle[i].type == type)
+      return &query_recycle[i];
+  }
+  return NULL;
+}
+
 void
 _priv_gst_query_initialize (void)
 {
@@ -129,6 +206,12 @@ _priv_gst_query_initialize (void)
   for (i = 0; query_quarks[i].name; i++) {
     query_quarks[i].quark = g_quark_from_static_string (query_quarks[i].name);
   }
+
+  for (i = 0; i < (gint) G_N_ELEMENTS (query_recycle); i++) {
+    query_recycle[i].cache =
+        _priv_gst_magazine_cache_new_full (query_recycle[i].cache_name,
+        sizeof (GstQueryImpl), (GDestroyNotify) _gst_query_free_recycled);
+  }
 }
 
 /**
@@ -192,11 +275,32 @@ gst_query_type_get_flags (GstQueryType type)
 static void
 _gst_query_free (GstQuery * query)
 {
+  GstQueryRecycle *recycle;
   GstStructure *s;
 
   g_return_if_fail (query != NULL);
 
   s = GST_QUERY_STRUCTURE (query);
+  recycle = query_recycle_find (GST_QUERY_TYPE (query));
+
+  if (recycle && recycle->cache) {
+    /* keep queries with typed fields without a structure, the others with
+     * the storage of their structure */
+    if (recycle->typed) {
+      if (s) {
+        gst_structure_set_parent_refcount (s, NULL);
+        gst_structure_free (s);
+        GST_QUERY_STRUCTURE (query) = NULL;
+      }
+      _priv_gst_magazine_cache_free (recycle->cache, query);
+      return;
+    } else if (s && priv_gst_structure_reset (s,
+            _priv_gst_quark_table[recycle->name], RECYCLE_MAX_FIELDS)) {
+      _priv_gst_magazine_cache_free (recycle->cache, query);
+      return;
+    }
+  }
+
   if (s) {
     gst_structure_set_parent_refcount (s, NULL);
     gst_structure_free (s);
@@ -211,15 +315,108 @@ _gst_query_copy (GstQuery * query)
   GstQuery *copy;
   GstStructure *s;
 
+  /* the structure of a query with typed fields is made again when needed */
   s = GST_QUERY_STRUCTURE (query);
-  if (s) {
+  if (s && !GST_QUERY_HAS_PAYLOAD (query)) {
     s = gst_structure_copy (s);
+  } else {
+    s = NULL;
   }
   copy = gst_query_new_custom (query->type, s);
 
+  if (copy && GST_QUERY_HAS_PAYLOAD (query)) {
+    *GST_QUERY_PAYLOAD (copy) = *GST_QUERY_PAYLOAD (query);
+    GST_QUERY_HAS_PAYLOAD (copy) = TRUE;
+  }
   return copy;
 }
 
+static void
+gst_query_init (GstQueryImpl * query, GstQueryType type)
+{
+  gst_mini_object_init (GST_MINI_OBJECT_CAST (query), 0, _gst_query_type,
+      (GstMiniObjectCopyFunction) _gst_query_copy, NULL,
+      (GstMiniObjectFreeFunction) _gst_query_free);
+
+  GST_QUERY_TYPE (query) = type;
+  query->has_payload = FALSE;
+}
+
+/* make a new query of one of the recycled types. Queries with typed fields
+ * have no structure, the caller sets the fields. The others have an empty
+ * structure. The query and its structure are reused from the cache when
+ * possible */
+static GstQuery *
+gst_query_new_recycled (GstQueryType type)
+{
+  GstQueryRecycle *recycle = query_recycle_find (type);
+  GstQueryImpl *query;
+
+  if (G_LIKELY (recycle->cache) &&
+      (query = _priv_gst_magazine_cache_get (recycle->cache))) {
+    GST_DEBUG ("recycling query %p %s", query, gst_query_type_get_name (type));
+
+    gst_query_init (query, type);
+  } else if (recycle->typed) {
+    query = (GstQueryImpl *) gst_query_new_custom (type, NULL);
+  } else {
+    query = (GstQueryImpl *) gst_query_new_custom (type,
+        gst_structure_new_id_empty (_priv_gst_quark_table[recycle->name]));
+  }
+  query->has_payload = recycle->typed;
+
+  return GST_QUERY_CAST (query);
+}
+
+/* get the structure of @query, make it from the typed fields when needed */
+static GstStructure *
+gst_query_ensure_structure (GstQuery * query)
+{
+  GstQueryImpl *impl = (GstQueryImpl *) query;
+  GstStructure *structure;
+
+  structure = g_atomic_pointer_get (&impl->structure);
+  if (structure || !impl->has_payload)
+    return structure;
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_POSITION:
+      structure = gst_structure_new_id (GST_QUARK (QUERY_POSITION),
+          GST_QUARK (FORMAT), GST_TYPE_FORMAT, impl->payload.position.format,
+          GST_QUARK (CURRENT), G_TYPE_INT64, impl->payload.position.value,
+          NULL);
+      break;
+    case GST_QUERY_DURATION:
+      structure = gst_structure_new_id (GST_QUARK (QUERY_DURATION),
+          GST_QUARK (FORMAT), GST_TYPE_FORMAT, impl->payload.position.format,
+          GST_QUARK (DURATION), G_TYPE_INT64, impl->payload.position.value,
+          NULL);
+      break;
+    case GST_QUERY_LATENCY:
+      structure = gst_structure_new_id (GST_QUARK (QUERY_LATENCY),
+          GST_QUARK (LIVE), G_TYPE_BOOLEAN, impl->payload.latency.live,
+          GST_QUARK (MIN_LATENCY), G_TYPE_UINT64, impl->payload.latency.min,
+          GST_QUARK (MAX_LATENCY), G_TYPE_UINT64, impl->payload.latency.max,
+          NULL);
+      break;
+    default:
+      g_assert_not_reached ();
+      return NULL;
+  }
+  gst_structure_set_parent_refcount (structure,
+      &query->mini_object.refcount);
+
+  /* readers of a shared query can race to make the structure, keep the
+   * first one */
+  if (!g_atomic_pointer_compare_and_exchange (&impl->structure, NULL,
+          structure)) {
+    gst_structure_set_parent_refcount (structure, NULL);
+    gst_structure_free (structure);
+    structure = g_atomic_pointer_get (&impl->structure);
+  }
+  return structure;
+}
+
 /**
  * gst_query_new_position:
  * @format: the default #GstFormat for the new query
@@ -236,13 +433,10 @@ GstQuery *
 gst_query_new_position (GstFormat format)
 {
   GstQuery *query;
-  GstStructure *structure;
 
-  structure = gst_structure_new_id (GST_QUARK (QUERY_POSITION),
-      GST_QUARK (FORMAT), GST_TYPE_FORMAT, format,
-      GST_QUARK (CURRENT), G_TYPE_INT64, G_GINT64_CONSTANT (-1), NULL);
-
-  query = gst_query_new_custom (GST_QUERY_POSITION, structure);
+  query = gst_query_new_recycled (GST_QUERY_POSITION);
+  GST_QUERY_PAYLOAD (query)->position.format = format;
+  GST_QUERY_PAYLOAD (query)->position.value = -1;
 
   return query;
 }
@@ -263,8 +457,16 @@ gst_query_set_position (GstQuery * query, GstFormat format, gint64 cur)
   g_return_if_fail (GST_QUERY_TYPE (query) == GST_QUERY_POSITION);
 
   s = GST_QUERY_STRUCTURE (query);
-  g_return_if_fail (format == g_value_get_enum (gst_structure_id_get_value (s,
-              GST_QUARK (FORMAT))));
+  if (G_LIKELY (GST_QUERY_HAS_PAYLOAD (query))) {
+    g_return_if_fail (format == GST_QUERY_PAYLOAD (query)->position.format);
+    GST_QUERY_PAYLOAD (query)->position.value = cur;
+    /* only update the structure if it was made */
+    if (G_LIKELY (s == NULL))
+      return;
+  } else {
+    g_return_if_fail (format ==
+        g_value_get_enum (gst_structure_id_get_value (s, GST_QUARK (FORMAT))));
+  }
 
   gst_structure_id_set (s,
       GST_QUARK (FORMAT), GST_TYPE_FORMAT, format,
@@ -288,6 +490,14 @@ gst_query_parse_position (GstQuery * query, GstFormat * format, gint64 * cur)
 
   g_return_if_fail (GST_QUERY_TYPE (query) == GST_QUERY_POSITION);
 
+  if (G_LIKELY (GST_QUERY_HAS_PAYLOAD (query))) {
+    if (format)
+      *format = GST_QUERY_PAYLOAD (query)->position.format;
+    if (cur)
+      *cur = GST_QUERY_PAYLOAD (query)->position.value;
+    return;
+  }
+
   structure = GST_QUERY_STRUCTURE (query);
   if (format)
     *format =
@@ -315,13 +525,10 @@ GstQuery *
 gst_query_new_duration (GstFormat format)
 {
   GstQuery *query;
-  GstStructure *structure;
 
-  structure = gst_structure_new_id (GST_QUARK (QUERY_DURATION),
-      GST_QUARK (FORMAT), GST_TYPE_FORMAT, format,
-      GST_QUARK (DURATION), G_TYPE_INT64, G_GINT64_CONSTANT (-1), NULL);
-
-  query = gst_query_new_custom (GST_QUERY_DURATION, structure);
+  query = gst_query_new_recycled (GST_QUERY_DURATION);
+  GST_QUERY_PAYLOAD (query)->position.format = format;
+  GST_QUERY_PAYLOAD (query)->position.value = -1;
 
   return query;
 }
@@ -342,8 +549,16 @@ gst_query_set_duration (GstQuery * query, GstFormat format, gint64 duration)
   g_return_if_fail (GST_QUERY_TYPE (query) == GST_QUERY_DURATION);
 
   s = GST_QUERY_STRUCTURE (query);
-  g_return_if_fail (format == g_value_get_enum (gst_structure_id_get_value (s,
-              GST_QUARK (FORMAT))));
+  if (G_LIKELY (GST_QUERY_HAS_PAYLOAD (query))) {
+    g_return_if_fail (format == GST_QUERY_PAYLOAD (query)->position.format);
+    GST_QUERY_PAYLOAD (query)->position.value = duration;
+    /* only update the structure if it was made */
+    if (G_LIKELY (s == NULL))
+      return;
+  } else {
+    g_return_if_fail (format ==
+        g_value_get_enum (gst_structure_id_get_value (s, GST_QUARK (FORMAT))));
+  }
   gst_structure_id_set (s, GST_QUARK (FORMAT), GST_TYPE_FORMAT, format,
       GST_QUARK (DURATION), G_TYPE_INT64, duration, NULL);
 }
@@ -366,6 +581,14 @@ gst_query_parse_duration (GstQuery * query, GstFormat * format,
 
   g_return_if_fail (GST_QUERY_TYPE (query) == GST_QUERY_DURATION);
 
+  if (G_LIKELY (GST_QUERY_HAS_PAYLOAD (query))) {
+    if (format)
+      *format = GST_QUERY_PAYLOAD (query)->position.format;
+    if (duration)
+      *duration = GST_QUERY_PAYLOAD (query)->position.value;
+    return;
+  }
+
   structure = GST_QUERY_STRUCTURE (query);
   if (format)
     *format =
@@ -392,14 +615,11 @@ GstQuery *
 gst_query_new_latency (void)
 {
   GstQuery *query;
-  GstStructure *structure;
-
-  structure = gst_structure_new_id (GST_QUARK (QUERY_LATENCY),
-      GST_QUARK (LIVE), G_TYPE_BOOLEAN, FALSE,
-      GST_QUARK (MIN_LATENCY), G_TYPE_UINT64, G_GUINT64_CONSTANT (0),
-      GST_QUARK (MAX_LATENCY), G_TYPE_UINT64, G_GUINT64_CONSTANT (-1), NULL);
 
-  query = gst_query_new_custom (GST_QUERY_LATENCY, structure);
+  query = gst_query_new_recycled (GST_QUERY_LATENCY);
+  GST_QUERY_PAYLOAD (query)->latency.live = FALSE;
+  GST_QUERY_PAYLOAD (query)->latency.min = 0;
+  GST_QUERY_PAYLOAD (query)->latency.max = GST_CLOCK_TIME_NONE;
 
   return query;
 }
@@ -422,6 +642,15 @@ gst_query_set_latency (GstQuery * query, gboolean live,
   g_return_if_fail (GST_QUERY_TYPE (query) == GST_QUERY_LATENCY);
 
   structure = GST_QUERY_STRUCTURE (query);
+  if (G_LIKELY (GST_QUERY_HAS_PAYLOAD (query))) {
+    GST_QUERY_PAYLOAD (query)->latency.live = live;
+    GST_QUERY_PAYLOAD (query)->latency.min = min_latency;
+    GST_QUERY_PAYLOAD (query)->latency.max = max_latency;
+    /* only update the structure if it was made */
+    if (G_LIKELY (structure == NULL))
+      return;
+  }
+
   gst_structure_id_set (structure,
       GST_QUARK (LIVE), G_TYPE_BOOLEAN, live,
       GST_QUARK (MIN_LATENCY), G_TYPE_UINT64, min_latency,
@@ -445,6 +674,16 @@ gst_query_parse_latency (GstQuery * query, gboolean * live,
 
   g_return_if_fail (GST_QUERY_TYPE (query) == GST_QUERY_LATENCY);
 
+  if (G_LIKELY (GST_QUERY_HAS_PAYLOAD (query))) {
+    if (live)
+      *live = GST_QUERY_PAYLOAD (query)->latency.live;
+    if (min_latency)
+      *min_latency = GST_QUERY_PAYLOAD (query)->latency.min;
+    if (max_latency)
+      *max_latency = GST_QUERY_PAYLOAD (query)->latency.max;
+    return;
+  }
+
   structure = GST_QUERY_STRUCTURE (query);
   if (live)
     *live =
@@ -686,11 +925,8 @@ gst_query_new_custom (GstQueryType type, GstStructure * structure)
       goto had_parent;
   }
 
-  gst_mini_object_init (GST_MINI_OBJECT_CAST (query), 0, _gst_query_type,
-      (GstMiniObjectCopyFunction) _gst_query_copy, NULL,
-      (GstMiniObjectFreeFunction) _gst_query_free);
+  gst_query_init (query, type);
 
-  GST_QUERY_TYPE (query) = type;
   GST_QUERY_STRUCTURE (query) = structure;
 
   return GST_QUERY_CAST (query);
@@ -719,7 +955,7 @@ gst_query_get_structure (GstQuery * query)
 {
   g_return_val_if_fail (GST_IS_QUERY (query), NULL);
 
-  return GST_QUERY_STRUCTURE (query);
+  return gst_query_ensure_structure (query);
 }
 
 /**
@@ -736,10 +972,17 @@ gst_query_get_structure (GstQuery * query)
 GstStructure *
 gst_query_writable_structure (GstQuery * query)
 {
+  GstStructure *structure;
+
   g_return_val_if_fail (GST_IS_QUERY (query), NULL);
   g_return_val_if_fail (gst_query_is_writable (query), NULL);
 
-  return GST_QUERY_STRUCTURE (query);
+  structure = gst_query_ensure_structure (query);
+
+  /* the caller can change any field, parse from the structure from now on */
+  GST_QUERY_HAS_PAYLOAD (query) = FALSE;
+
+  return structure;
 }
 
 /**
@@ -1435,12 +1678,12 @@ gst_query_new_allocation (GstCaps * caps, gboolean need_pool)
   GstQuery *query;
   GstStructure *structure;
 
-  structure = gst_structure_new_id (GST_QUARK (QUERY_ALLOCATION),
+  query = gst_query_new_recycled (GST_QUERY_ALLOCATION);
+  structure = GST_QUERY_STRUCTURE (query);
+  gst_structure_id_set (structure,
       GST_QUARK (CAPS), GST_TYPE_CAPS, caps,
       GST_QUARK (NEED_POOL), G_TYPE_BOOLEAN, need_pool, NULL);
 
-  query = gst_query_new_custom (GST_QUERY_ALLOCATION, structure);
-
   return query;
 }
 
@@ -2232,10 +2475,11 @@ gst_query_new_accept_caps (GstCaps * caps)
 
   g_return_val_if_fail (gst_caps_is_fixed (caps), NULL);
 
-  structure = gst_structure_new_id (GST_QUARK (QUERY_ACCEPT_CAPS),
+  query = gst_query_new_recycled (GST_QUERY_ACCEPT_CAPS);
+  structure = GST_QUERY_STRUCTURE (query);
+  gst_structure_id_set (structure,
       GST_QUARK (CAPS), GST_TYPE_CAPS, caps,
       GST_QUARK (RESULT), G_TYPE_BOOLEAN, FALSE, NULL);
-  query = gst_query_new_custom (GST_QUERY_ACCEPT_CAPS, structure);
 
   return query;
 }
@@ -2333,10 +2577,11 @@ gst_query_new_caps (GstCaps * filter)
   GstQuery *query;
   GstStructure *structure;
 
-  structure = gst_structure_new_id (GST_QUARK (QUERY_CAPS),
+  query = gst_query_new_recycled (GST_QUERY_CAPS);
+  structure = GST_QUERY_STRUCTURE (query);
+  gst_structure_id_set (structure,
       GST_QUARK (FILTER), GST_TYPE_CAPS, filter,
       GST_QUARK (CAPS), GST_TYPE_CAPS, NULL, NULL);
-  query = gst_query_new_custom (GST_QUERY_CAPS, structure);
 
   return query;
 }
@@ -125,6 +125,7 @@
 #include "gstregistry.h"
 
 #include "gstpluginloader.h"
+#include "gstregistrychunks.h"
 
 #include "gst-i18n-lib.h"
 
@@ -1401,6 +1402,9 @@ _priv_gst_registry_cleanup (void)
   /* unref outside of the lock because we can. */
   if (registry)
     gst_object_unref (registry);
+
+  /* the pad templates of the registry pointed into this */
+  _priv_gst_registry_chunks_cleanup ();
 }
 
 /**
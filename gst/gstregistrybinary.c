@@ -23,9 +23,8 @@
  */
 
 /* FIXME:
- * - keep registry binary blob and reference strings
- *   - don't free/unmmap contents when leaving gst_registry_binary_read_cache()
- *     - free at gst_deinit() / _priv_gst_registry_cleanup() ?
+ * - reference the strings in the registry binary blob, it is kept already for
+ *   the binary caps of the pad templates
  *   - GstPlugin:
  *     - GST_PLUGIN_FLAG_CONST
  *   - GstPluginFeature, GstIndexFactory, GstElementFactory
@@ -514,7 +513,7 @@ priv_gst_registry_binary_read_cache (GstRegistry * registry,
   gchar *in = NULL;
   gsize size;
   GError *err = NULL;
-  gboolean res = FALSE;
+  gboolean res = FALSE, keep = FALSE;
   guint32 filter_env_hash = 0;
   gint check_magic_result;
 #ifndef GST_DISABLE_GST_DEBUG
@@ -593,6 +592,10 @@ priv_gst_registry_binary_read_cache (GstRegistry * registry,
     /* empty file, this is not an error */
   } else {
     gchar *end = contents + size;
+
+    /* the loaded pad templates point into the contents from now on */
+    keep = TRUE;
+
     /* read as long as we still have space for a GstRegistryChunkPluginElement */
     for (;
         ((gsize) in + sizeof (GstRegistryChunkPluginElement)) <
@@ -600,7 +603,8 @@ priv_gst_registry_binary_read_cache (GstRegistry * registry,
       GST_DEBUG ("reading binary registry %" G_GSIZE_FORMAT "(%x)/%"
           G_GSIZE_FORMAT, (gsize) in - (gsize) contents,
           (guint) ((gsize) in - (gsize) contents), size);
-      if (!_priv_gst_registry_chunks_load_plugin (registry, &in, end, NULL)) {
+      if (!_priv_gst_registry_chunks_load_plugin (registry, &in, end, TRUE,
+              NULL)) {
         GST_ERROR ("Problem while reading binary registry %s", location);
         goto Error;
       }
@@ -617,13 +621,18 @@ done:
   GST_INFO ("loaded %s in %lf seconds", location, seconds);
 
   res = TRUE;
-  /* TODO: once we re-use the pointers to registry contents, return here */
 
 Error:
 #ifndef GST_DISABLE_GST_DEBUG
   g_timer_destroy (timer);
 #endif
-  if (mapped) {
+  if (keep) {
+    if (mapped)
+      _priv_gst_registry_chunks_keep_data (mapped,
+          (GDestroyNotify) g_mapped_file_unref);
+    else
+      _priv_gst_registry_chunks_keep_data (contents, g_free);
+  } else if (mapped) {
     g_mapped_file_unref (mapped);
   } else {
     g_free (contents);
@@ -96,6 +96,76 @@ _strnlen (const gchar * str, gint maxlen)
 #define alignment(_address)  (gsize)_address%ALIGNMENT
 #define align(_ptr)          _ptr += (( alignment(_ptr) == 0) ? 0 : ALIGNMENT-alignment(_ptr))
 
+#define unpack_binary(inptr, outptr, outsize, endptr, error_label) G_STMT_START{\
+  guint32 *_size; \
+  align (inptr); \
+  unpack_element (inptr, _size, guint32, endptr, error_label); \
+  if (*_size > (gsize) (endptr - inptr)) \
+    goto error_label; \
+  outptr = (const guint8 *) inptr; \
+  outsize = *_size; \
+  inptr += *_size; \
+}G_STMT_END
+
+/* registry data that loaded pad templates point into, see
+ * _priv_gst_registry_chunks_keep_data() */
+typedef struct
+{
+  gpointer data;
+  GDestroyNotify notify;
+} GstRegistryKeptData;
+
+G_LOCK_DEFINE_STATIC (kept_data_lock);
+static GSList *kept_data = NULL;
+
+/*
+ * _priv_gst_registry_chunks_keep_data:
+ * @data: data that plugins were loaded from
+ * @notify: frees @data
+ *
+ * The binary caps of the pad templates that are loaded with
+ * _priv_gst_registry_chunks_load_plugin() are not copied. Keep the registry
+ * data they were loaded from until _priv_gst_registry_chunks_cleanup().
+ */
+void
+_priv_gst_registry_chunks_keep_data (gpointer data, GDestroyNotify notify)
+{
+  GstRegistryKeptData *kept;
+
+  kept = g_slice_new (GstRegistryKeptData);
+  kept->data = data;
+  kept->notify = notify;
+
+  G_LOCK (kept_data_lock);
+  kept_data = g_slist_prepend (kept_data, kept);
+  G_UNLOCK (kept_data_lock);
+}
+
+/*
+ * _priv_gst_registry_chunks_cleanup:
+ *
+ * Free the data kept with _priv_gst_registry_chunks_keep_data(), after the
+ * registry was freed.
+ */
+void
+_priv_gst_registry_chunks_cleanup (void)
+{
+  GSList *list;
+
+  G_LOCK (kept_data_lock);
+  list = kept_data;
+  kept_data = NULL;
+  G_UNLOCK (kept_data_lock);
+
+  while (list) {
+    GstRegistryKeptData *kept = list->data;
+
+    kept->notify (kept->data);
+    g_slice_free (GstRegistryKeptData, kept);
+    list = g_slist_delete_link (list, list);
+  }
+}
+
 void
 _priv_gst_registry_chunk_free (GstRegistryChunk * chunk)
 {
@@ -175,6 +245,57 @@ gst_registry_chunks_make_data (gpointer data, gulong size)
   return chunk;
 }
 
+/*
+ * gst_registry_chunks_save_binary:
+ *
+ * Store binary data in chunks, the size followed by the data. When @take is
+ * %FALSE the data is not freed, otherwise it is freed with g_free().
+ *
+ * Returns: %TRUE for success
+ */
+static gboolean
+gst_registry_chunks_save_binary (GList ** list, const guint8 * data,
+    gsize size, gboolean take)
+{
+  GstRegistryChunk *chunk;
+  guint32 *len;
+
+  if (size > 0) {
+    chunk = g_slice_new (GstRegistryChunk);
+    chunk->data = (gpointer) data;
+    chunk->size = size;
+    chunk->flags = take ? GST_REGISTRY_CHUNK_FLAG_MALLOC :
+        GST_REGISTRY_CHUNK_FLAG_CONST;
+    chunk->align = FALSE;
+    *list = g_list_prepend (*list, chunk);
+  }
+
+  len = g_slice_new (guint32);
+  *len = size;
+  *list = g_list_prepend (*list, gst_registry_chunks_make_data (len,
+          sizeof (guint32)));
+  return TRUE;
+}
+
+/*
+ * gst_registry_chunks_save_caps:
+ *
+ * Store the binary representation of @caps, or empty data when @caps is
+ * %NULL.
+ *
+ * Returns: %TRUE for success
+ */
+static gboolean
+gst_registry_chunks_save_caps (GList ** list, const GstCaps * caps)
+{
+  guint8 *data = NULL;
+  gsize size = 0;
+
+  if (caps)
+    data = gst_caps_to_binary (caps, &size);
+
+  return gst_registry_chunks_save_binary (list, data, size, TRUE);
+}
 
 /*
  * gst_registry_chunks_save_pad_template:
@@ -189,6 +310,8 @@ gst_registry_chunks_save_pad_template (GList ** list,
 {
   GstRegistryChunkPadTemplate *pt;
   GstRegistryChunk *chk;
+  const guint8 *caps_data;
+  gsize caps_size;
 
   pt = g_slice_new (GstRegistryChunkPadTemplate);
   chk =
@@ -197,7 +320,26 @@ gst_registry_chunks_save_pad_template (GList ** list,
   pt->presence = template->presence;
   pt->direction = template->direction;
 
-  /* pack pad template strings */
+  /* pack the binary caps, they are converted faster than the string when the
+   * caps are needed. Templates that were loaded from the registry still have
+   * theirs. */
+  caps_data = priv_gst_static_caps_get_binary (&template->static_caps,
+      &caps_size);
+  if (caps_data) {
+    gst_registry_chunks_save_binary (list, caps_data, caps_size, FALSE);
+  } else {
+    GstCaps *caps = NULL;
+
+    if (template->static_caps.caps)
+      caps = gst_caps_ref (template->static_caps.caps);
+    else if (template->static_caps.string)
+      caps = gst_caps_from_string (template->static_caps.string);
+    gst_registry_chunks_save_caps (list, caps);
+    if (caps)
+      gst_caps_unref (caps);
+  }
+
+  /* pack pad template strings, the caps string is public API */
   gst_registry_chunks_save_const_string (list,
       (gchar *) (template->static_caps.string));
   gst_registry_chunks_save_const_string (list, template->name_template);
@@ -300,7 +442,6 @@ gst_registry_chunks_save_feature (GList ** list, GstPluginFeature * feature)
   } else if (GST_IS_TYPE_FIND_FACTORY (feature)) {
     GstRegistryChunkTypeFindFactory *tff;
     GstTypeFindFactory *factory = GST_TYPE_FIND_FACTORY (feature);
-    gchar *str;
 
     /* Initialize with zeroes because of struct padding and
      * valgrind complaining about copying unitialized memory
@@ -325,12 +466,10 @@ gst_registry_chunks_save_feature (GList ** list, GstPluginFeature * feature)
       /* we simplify the caps before saving. This is a lot faster
        * when loading them later on */
       fcaps = gst_caps_simplify (fcaps);
-      str = gst_caps_to_string (fcaps);
+      gst_registry_chunks_save_caps (list, fcaps);
       gst_caps_unref (fcaps);
-
-      gst_registry_chunks_save_string (list, str);
     } else {
-      gst_registry_chunks_save_const_string (list, "");
+      gst_registry_chunks_save_caps (list, NULL);
     }
   } else {
     GST_WARNING ("unhandled feature type '%s'", type_name);
@@ -480,17 +619,19 @@ fail:
  */
 static gboolean
 gst_registry_chunks_load_pad_template (GstElementFactory * factory, gchar ** in,
-    gchar * end)
+    gchar * end, gboolean binary_caps)
 {
   GstRegistryChunkPadTemplate *pt;
   GstStaticPadTemplate *template = NULL;
+  const guint8 *caps_data;
+  gsize caps_size;
 
   align (*in);
   GST_DEBUG ("Reading/casting for GstRegistryChunkPadTemplate at address %p",
       *in);
   unpack_element (*in, pt, GstRegistryChunkPadTemplate, end, fail);
 
-  template = g_slice_new (GstStaticPadTemplate);
+  template = g_slice_new0 (GstStaticPadTemplate);
   template->presence = pt->presence;
   template->direction = (GstPadDirection) pt->direction;
   template->static_caps.caps = NULL;
@@ -499,14 +640,24 @@ gst_registry_chunks_load_pad_template (GstElementFactory * factory, gchar ** in,
   unpack_const_string (*in, template->name_template, end, fail);
   unpack_const_string (*in, template->static_caps.string, end, fail);
 
+  /* the binary caps point into the registry data and are only converted
+   * when the caps are needed. When the data is not kept the string is
+   * parsed instead. */
+  unpack_binary (*in, caps_data, caps_size, end, fail);
+  if (caps_size > 0 && binary_caps)
+    priv_gst_static_caps_set_binary (&template->static_caps, caps_data,
+        caps_size);
+
   __gst_element_factory_add_static_pad_template (factory, template);
   GST_DEBUG ("Added pad_template %s", template->name_template);
 
   return TRUE;
 fail:
   GST_INFO ("Reading pad template failed");
-  if (template)
+  if (template) {
+    gst_static_caps_cleanup (&template->static_caps);
     g_slice_free (GstStaticPadTemplate, template);
+  }
   return FALSE;
 }
 
@@ -519,7 +670,7 @@ fail:
  */
 static gboolean
 gst_registry_chunks_load_feature (GstRegistry * registry, gchar ** in,
-    gchar * end, GstPlugin * plugin)
+    gchar * end, GstPlugin * plugin, gboolean binary_caps)
 {
   GstRegistryChunkPluginFeature *pf = NULL;
   GstPluginFeature *feature = NULL;
@@ -592,7 +743,7 @@ gst_registry_chunks_load_feature (GstRegistry * registry, gchar ** in,
     /* load pad templates */
     for (i = 0; i < n; i++) {
       if (G_UNLIKELY (!gst_registry_chunks_load_pad_template (factory, in,
-                  end))) {
+                  end, binary_caps))) {
         GST_ERROR ("Error while loading binary pad template");
         goto fail;
       }
@@ -624,6 +775,8 @@ gst_registry_chunks_load_feature (GstRegistry * registry, gchar ** in,
   } else if (GST_IS_TYPE_FIND_FACTORY (feature)) {
     GstRegistryChunkTypeFindFactory *tff;
     GstTypeFindFactory *factory = GST_TYPE_FIND_FACTORY (feature);
+    const guint8 *caps_data;
+    gsize caps_size;
 
     align (*in);
     GST_DEBUG
@@ -633,11 +786,16 @@ gst_registry_chunks_load_feature (GstRegistry * registry, gchar ** in,
     pf = (GstRegistryChunkPluginFeature *) tff;
 
     /* load typefinder caps */
-    unpack_string_nocopy (*in, const_str, end, fail);
-    if (const_str != NULL && *const_str != '\0')
-      factory->caps = gst_caps_from_string (const_str);
-    else
+    unpack_binary (*in, caps_data, caps_size, end, fail);
+    if (caps_size > 0) {
+      factory->caps = gst_caps_from_binary (caps_data, caps_size);
+      if (!factory->caps) {
+        GST_ERROR ("Error when trying to load binary typefinder caps");
+        goto fail;
+      }
+    } else {
       factory->caps = NULL;
+    }
 
     /* load extensions */
     if (tff->nextensions) {
@@ -747,10 +905,14 @@ fail:
  * Make a new GstPlugin from current GstRegistryChunkPluginElement structure
  * and add it to the GstRegistry. Return an offset to the next
  * GstRegistryChunkPluginElement structure.
+ *
+ * With @binary_caps the pad templates use the binary caps in @in, which must
+ * then be kept with _priv_gst_registry_chunks_keep_data(). Otherwise they
+ * parse their caps string.
  */
 gboolean
 _priv_gst_registry_chunks_load_plugin (GstRegistry * registry, gchar ** in,
-    gchar * end, GstPlugin ** out_plugin)
+    gchar * end, gboolean binary_caps, GstPlugin ** out_plugin)
 {
 #ifndef GST_DISABLE_GST_DEBUG
   gchar *start = *in;
@@ -817,7 +979,7 @@ _priv_gst_registry_chunks_load_plugin (GstRegistry * registry, gchar ** in,
   /* Load plugin features */
   for (i = 0; i < n; i++) {
     if (G_UNLIKELY (!gst_registry_chunks_load_feature (registry, in, end,
-                plugin))) {
+                plugin, binary_caps))) {
       GST_ERROR ("Error while loading binary feature for plugin '%s'",
           GST_STR_NULL (plugin->desc.name));
       gst_registry_remove_plugin (registry, plugin);
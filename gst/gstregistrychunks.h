@@ -150,7 +150,13 @@ _priv_gst_registry_chunks_save_plugin (GList ** list, GstRegistry * registry,
 
 gboolean
 _priv_gst_registry_chunks_load_plugin (GstRegistry * registry, gchar ** in,
-    gchar *end, GstPlugin **out_plugin);
+    gchar *end, gboolean binary_caps, GstPlugin **out_plugin);
+
+void
+_priv_gst_registry_chunks_keep_data (gpointer data, GDestroyNotify notify);
+
+void
+_priv_gst_registry_chunks_cleanup (void);
 
 void
 _priv_gst_registry_chunks_save_global_header (GList ** list,
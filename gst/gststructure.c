@@ -78,6 +78,13 @@ struct _GstStructureField
   GValue value;
 };
 
+/* number of fields that are stored in the structure itself, most caps and
+ * event structures don't need more */
+#define STRUCTURE_INLINE_FIELDS 4
+/* structures with more fields keep an index of the fields sorted by quark so
+ * that lookups don't need to scan all the fields */
+#define STRUCTURE_INDEX_THRESHOLD 12
+
 typedef struct
 {
   GstStructure s;
@@ -85,14 +92,23 @@ typedef struct
   /* owned by parent structure, NULL if no parent */
   gint *parent_refcount;
 
-  GArray *fields;
+  guint fields_len;
+  guint fields_alloc;
+  /* the fields in the order they were added, points to arr or to an array
+   * on the heap when there are more than STRUCTURE_INLINE_FIELDS fields */
+  GstStructureField *fields;
+  /* positions in fields sorted by quark, with room for fields_alloc items,
+   * only when there are more than STRUCTURE_INDEX_THRESHOLD fields */
+  guint *index;
+
+  GstStructureField arr[STRUCTURE_INLINE_FIELDS];
 } GstStructureImpl;
 
 #define GST_STRUCTURE_REFCOUNT(s) (((GstStructureImpl*)(s))->parent_refcount)
-#define GST_STRUCTURE_FIELDS(s) (((GstStructureImpl*)(s))->fields)
+#define GST_STRUCTURE_LEN(s) (((GstStructureImpl*)(s))->fields_len)
 
 #define GST_STRUCTURE_FIELD(structure, index) \
-    &g_array_index(GST_STRUCTURE_FIELDS(structure), GstStructureField, (index))
+    (&((GstStructureImpl*)(structure))->fields[(index)])
 
 #define IS_MUTABLE(structure) \
     (!GST_STRUCTURE_REFCOUNT(structure) || \
@@ -142,14 +158,149 @@ gst_structure_new_id_empty_with_size (GQuark quark, guint prealloc)
   ((GstStructure *) structure)->type = _gst_structure_type;
   ((GstStructure *) structure)->name = quark;
   GST_STRUCTURE_REFCOUNT (structure) = NULL;
-  GST_STRUCTURE_FIELDS (structure) =
-      g_array_sized_new (FALSE, FALSE, sizeof (GstStructureField), prealloc);
+  structure->fields_len = 0;
+  structure->index = NULL;
+  if (prealloc > STRUCTURE_INLINE_FIELDS) {
+    structure->fields = g_new (GstStructureField, prealloc);
+    structure->fields_alloc = prealloc;
+  } else {
+    structure->fields = structure->arr;
+    structure->fields_alloc = STRUCTURE_INLINE_FIELDS;
+  }
 
   GST_TRACE ("created structure %p", structure);
 
   return GST_STRUCTURE_CAST (structure);
 }
 
+static gint
+index_compare (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  GstStructureField *fields = user_data;
+  GQuark q1 = fields[*(const guint *) a].name;
+  GQuark q2 = fields[*(const guint *) b].name;
+
+  return q1 < q2 ? -1 : (q1 > q2 ? 1 : 0);
+}
+
+static void
+gst_structure_index_build (GstStructureImpl * structure)
+{
+  guint i;
+
+  g_free (structure->index);
+  structure->index = g_new (guint, structure->fields_alloc);
+  for (i = 0; i < structure->fields_len; i++)
+    structure->index[i] = i;
+
+  g_qsort_with_data (structure->index, structure->fields_len, sizeof (guint),
+      index_compare, structure->fields);
+}
+
+/* position in the index of the first field with a quark >= @name */
+static guint
+gst_structure_index_search (const GstStructureImpl * structure, GQuark name)
+{
+  guint lo = 0, hi = structure->fields_len;
+
+  while (lo < hi) {
+    guint mid = (lo + hi) / 2;
+
+    if (structure->fields[structure->index[mid]].name < name)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* append @field to the fields without checking for an existing field with the
+ * same name */
+static void
+gst_structure_append_field (GstStructure * structure, GstStructureField * field)
+{
+  GstStructureImpl *impl = (GstStructureImpl *) structure;
+
+  if (G_UNLIKELY (impl->fields_len == impl->fields_alloc)) {
+    impl->fields_alloc *= 2;
+    if (impl->fields == impl->arr) {
+      impl->fields = g_new (GstStructureField, impl->fields_alloc);
+      memcpy (impl->fields, impl->arr, sizeof (impl->arr));
+    } else {
+      impl->fields = g_renew (GstStructureField, impl->fields,
+          impl->fields_alloc);
+    }
+    if (impl->index)
+      impl->index = g_renew (guint, impl->index, impl->fields_alloc);
+  }
+
+  impl->fields[impl->fields_len] = *field;
+
+  if (impl->index) {
+    guint pos = gst_structure_index_search (impl, field->name);
+
+    memmove (&impl->index[pos + 1], &impl->index[pos],
+        (impl->fields_len - pos) * sizeof (guint));
+    impl->index[pos] = impl->fields_len;
+    impl->fields_len++;
+  } else {
+    impl->fields_len++;
+    if (impl->fields_len > STRUCTURE_INDEX_THRESHOLD)
+      gst_structure_index_build (impl);
+  }
+}
+
+/* remove the field at position @i, the value must be unset already */
+static void
+gst_structure_remove_field_index (GstStructure * structure, guint i)
+{
+  GstStructureImpl *impl = (GstStructureImpl *) structure;
+  guint j, k;
+
+  impl->fields_len--;
+  memmove (&impl->fields[i], &impl->fields[i + 1],
+      (impl->fields_len - i) * sizeof (GstStructureField));
+
+  if (impl->index == NULL)
+    return;
+
+  if (impl->fields_len <= STRUCTURE_INDEX_THRESHOLD) {
+    g_free (impl->index);
+    impl->index = NULL;
+    return;
+  }
+
+  /* drop the position of the removed field and fix the positions of the
+   * fields that moved */
+  for (j = 0, k = 0; j <= impl->fields_len; j++) {
+    guint pos = impl->index[j];
+
+    if (pos == i)
+      continue;
+    impl->index[k++] = pos > i ? pos - 1 : pos;
+  }
+}
+
+/* unset all values and remove all fields, keeps the storage */
+static void
+gst_structure_clear_fields (GstStructure * structure)
+{
+  GstStructureImpl *impl = (GstStructureImpl *) structure;
+  GstStructureField *field;
+  guint i;
+
+  for (i = 0; i < impl->fields_len; i++) {
+    field = GST_STRUCTURE_FIELD (structure, i);
+
+    if (G_IS_VALUE (&field->value)) {
+      g_value_unset (&field->value);
+    }
+  }
+  impl->fields_len = 0;
+  g_free (impl->index);
+  impl->index = NULL;
+}
+
 /**
  * gst_structure_new_id_empty:
  * @quark: name of new structure
@@ -332,22 +483,31 @@ GstStructure *
 gst_structure_copy (const GstStructure * structure)
 {
   GstStructure *new_structure;
-  GstStructureField *field;
+  GstStructureField *field, *new_field;
+  const guint *index;
   guint i, len;
 
   g_return_val_if_fail (structure != NULL, NULL);
 
-  len = GST_STRUCTURE_FIELDS (structure)->len;
+  len = GST_STRUCTURE_LEN (structure);
   new_structure = gst_structure_new_id_empty_with_size (structure->name, len);
 
   for (i = 0; i < len; i++) {
-    GstStructureField new_field = { 0 };
-
     field = GST_STRUCTURE_FIELD (structure, i);
+    new_field = GST_STRUCTURE_FIELD (new_structure, i);
 
-    new_field.name = field->name;
-    gst_value_init_and_copy (&new_field.value, &field->value);
-    g_array_append_val (GST_STRUCTURE_FIELDS (new_structure), new_field);
+    new_field->name = field->name;
+    memset (&new_field->value, 0, sizeof (GValue));
+    gst_value_init_and_copy (&new_field->value, &field->value);
+  }
+  GST_STRUCTURE_LEN (new_structure) = len;
+
+  /* the fields are at the same positions, so is the index */
+  if ((index = ((GstStructureImpl *) structure)->index)) {
+    GstStructureImpl *impl = (GstStructureImpl *) new_structure;
+
+    impl->index = g_new (guint, impl->fields_alloc);
+    memcpy (impl->index, index, len * sizeof (guint));
   }
   GST_CAT_TRACE (GST_CAT_PERFORMANCE, "doing copy %p -> %p",
       structure, new_structure);
@@ -365,21 +525,14 @@ gst_structure_copy (const GstStructure * structure)
 void
 gst_structure_free (GstStructure * structure)
 {
-  GstStructureField *field;
-  guint i, len;
+  GstStructureImpl *impl = (GstStructureImpl *) structure;
 
   g_return_if_fail (structure != NULL);
   g_return_if_fail (GST_STRUCTURE_REFCOUNT (structure) == NULL);
 
-  len = GST_STRUCTURE_FIELDS (structure)->len;
-  for (i = 0; i < len; i++) {
-    field = GST_STRUCTURE_FIELD (structure, i);
-
-    if (G_IS_VALUE (&field->value)) {
-      g_value_unset (&field->value);
-    }
-  }
-  g_array_free (GST_STRUCTURE_FIELDS (structure), TRUE);
+  gst_structure_clear_fields (structure);
+  if (impl->fields != impl->arr)
+    g_free (impl->fields);
 #ifdef USE_POISONING
   memset (structure, 0xff, sizeof (GstStructure));
 #endif
@@ -388,6 +541,23 @@ gst_structure_free (GstStructure * structure)
   g_slice_free1 (sizeof (GstStructureImpl), structure);
 }
 
+/* remove all fields of @structure and rename it to @name so that the structure
+ * and its field storage can be reused. Structures with more than @max_fields
+ * fields are not reset, FALSE is returned for them. */
+gboolean
+priv_gst_structure_reset (GstStructure * structure, GQuark name,
+    guint max_fields)
+{
+  if (GST_STRUCTURE_LEN (structure) > max_fields)
+    return FALSE;
+
+  /* keeps the allocated storage */
+  gst_structure_clear_fields (structure);
+  structure->name = name;
+
+  return TRUE;
+}
+
 /**
  * gst_structure_get_name:
  * @structure: a #GstStructure
@@ -771,7 +941,6 @@ static void
 gst_structure_set_field (GstStructure * structure, GstStructureField * field)
 {
   GstStructureField *f;
-  guint i, len = GST_STRUCTURE_FIELDS (structure)->len;
 
   if (G_UNLIKELY (G_VALUE_HOLDS_STRING (&field->value))) {
     const gchar *s;
@@ -821,17 +990,14 @@ gst_structure_set_field (GstStructure * structure, GstStructureField * field)
     }
   }
 
-  for (i = 0; i < len; i++) {
-    f = GST_STRUCTURE_FIELD (structure, i);
-
-    if (G_UNLIKELY (f->name == field->name)) {
-      g_value_unset (&f->value);
-      memcpy (f, field, sizeof (GstStructureField));
-      return;
-    }
+  f = gst_structure_id_get_field (structure, field->name);
+  if (G_UNLIKELY (f != NULL)) {
+    g_value_unset (&f->value);
+    memcpy (f, field, sizeof (GstStructureField));
+    return;
   }
 
-  g_array_append_val (GST_STRUCTURE_FIELDS (structure), *field);
+  gst_structure_append_field (structure, field);
 }
 
 /* If there is no field with the given ID, NULL is returned.
@@ -839,10 +1005,21 @@ gst_structure_set_field (GstStructure * structure, GstStructureField * field)
 static GstStructureField *
 gst_structure_id_get_field (const GstStructure * structure, GQuark field_id)
 {
+  const GstStructureImpl *impl = (const GstStructureImpl *) structure;
   GstStructureField *field;
   guint i, len;
 
-  len = GST_STRUCTURE_FIELDS (structure)->len;
+  len = impl->fields_len;
+
+  if (impl->index) {
+    i = gst_structure_index_search (impl, field_id);
+    if (i < len) {
+      field = GST_STRUCTURE_FIELD (structure, impl->index[i]);
+      if (field->name == field_id)
+        return field;
+    }
+    return NULL;
+  }
 
   for (i = 0; i < len; i++) {
     field = GST_STRUCTURE_FIELD (structure, i);
@@ -928,28 +1105,21 @@ void
 gst_structure_remove_field (GstStructure * structure, const gchar * fieldname)
 {
   GstStructureField *field;
-  GQuark id;
-  guint i, len;
 
   g_return_if_fail (structure != NULL);
   g_return_if_fail (fieldname != NULL);
   g_return_if_fail (IS_MUTABLE (structure));
 
-  id = g_quark_from_string (fieldname);
-  len = GST_STRUCTURE_FIELDS (structure)->len;
-
-  for (i = 0; i < len; i++) {
-    field = GST_STRUCTURE_FIELD (structure, i);
+  field = gst_structure_id_get_field (structure,
+      g_quark_from_string (fieldname));
+  if (field == NULL)
+    return;
 
-    if (field->name == id) {
-      if (G_IS_VALUE (&field->value)) {
-        g_value_unset (&field->value);
-      }
-      GST_STRUCTURE_FIELDS (structure) =
-          g_array_remove_index (GST_STRUCTURE_FIELDS (structure), i);
-      return;
-    }
+  if (G_IS_VALUE (&field->value)) {
+    g_value_unset (&field->value);
   }
+  gst_structure_remove_field_index (structure,
+      field - GST_STRUCTURE_FIELD (structure, 0));
 }
 
 /**
@@ -1009,21 +1179,10 @@ gst_structure_remove_fields_valist (GstStructure * structure,
 void
 gst_structure_remove_all_fields (GstStructure * structure)
 {
-  GstStructureField *field;
-  int i;
-
   g_return_if_fail (structure != NULL);
   g_return_if_fail (IS_MUTABLE (structure));
 
-  for (i = GST_STRUCTURE_FIELDS (structure)->len - 1; i >= 0; i--) {
-    field = GST_STRUCTURE_FIELD (structure, i);
-
-    if (G_IS_VALUE (&field->value)) {
-      g_value_unset (&field->value);
-    }
-    GST_STRUCTURE_FIELDS (structure) =
-        g_array_remove_index (GST_STRUCTURE_FIELDS (structure), i);
-  }
+  gst_structure_clear_fields (structure);
 }
 
 /**
@@ -1066,7 +1225,7 @@ gst_structure_n_fields (const GstStructure * structure)
 {
   g_return_val_if_fail (structure != NULL, 0);
 
-  return GST_STRUCTURE_FIELDS (structure)->len;
+  return GST_STRUCTURE_LEN (structure);
 }
 
 /**
@@ -1084,7 +1243,7 @@ gst_structure_nth_field_name (const GstStructure * structure, guint index)
   GstStructureField *field;
 
   g_return_val_if_fail (structure != NULL, NULL);
-  g_return_val_if_fail (index < GST_STRUCTURE_FIELDS (structure)->len, NULL);
+  g_return_val_if_fail (index < GST_STRUCTURE_LEN (structure), NULL);
 
   field = GST_STRUCTURE_FIELD (structure, index);
 
@@ -1114,7 +1273,7 @@ gst_structure_foreach (const GstStructure * structure,
   g_return_val_if_fail (structure != NULL, FALSE);
   g_return_val_if_fail (func != NULL, FALSE);
 
-  len = GST_STRUCTURE_FIELDS (structure)->len;
+  len = GST_STRUCTURE_LEN (structure);
 
   for (i = 0; i < len; i++) {
     field = GST_STRUCTURE_FIELD (structure, i);
@@ -1151,7 +1310,7 @@ gst_structure_map_in_place (GstStructure * structure,
   g_return_val_if_fail (structure != NULL, FALSE);
   g_return_val_if_fail (IS_MUTABLE (structure), FALSE);
   g_return_val_if_fail (func != NULL, FALSE);
-  len = GST_STRUCTURE_FIELDS (structure)->len;
+  len = GST_STRUCTURE_LEN (structure);
 
   for (i = 0; i < len; i++) {
     field = GST_STRUCTURE_FIELD (structure, i);
@@ -1781,7 +1940,7 @@ priv_gst_structure_append_to_gstring (const GstStructure * structure,
 
   g_return_val_if_fail (s != NULL, FALSE);
 
-  len = GST_STRUCTURE_FIELDS (structure)->len;
+  len = GST_STRUCTURE_LEN (structure);
   for (i = 0; i < len; i++) {
     char *t;
     GType type;
@@ -2136,6 +2295,56 @@ gst_structure_parse_field (gchar * str,
   return TRUE;
 }
 
+/* check if @s is one of the words that the number and boolean types can
+ * deserialize, other words can only be strings */
+static gboolean
+gst_structure_is_value_keyword (const gchar * s)
+{
+  static const gchar *keywords[] = { "min", "max", "little_endian",
+    "big_endian", "byte_order", "true", "false", "yes", "no", "t", "f"
+  };
+  guint i;
+
+  /* infinity and nan for doubles */
+  if (g_ascii_strncasecmp (s, "inf", 3) == 0 ||
+      g_ascii_strncasecmp (s, "nan", 3) == 0)
+    return TRUE;
+
+  for (i = 0; i < G_N_ELEMENTS (keywords); i++) {
+    if (g_ascii_strcasecmp (s, keywords[i]) == 0)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/* plain decimal numbers are the most common values, parse the ones that
+ * surely fit in an int without going through the deserializers. Numbers
+ * with a leading 0 are octal for the int deserializer and are left to it. */
+static gboolean
+gst_structure_parse_simple_int (const gchar * s, gint * result)
+{
+  gint v = 0, sign = 1, len = 0;
+
+  if (*s == '-') {
+    sign = -1;
+    s++;
+  }
+  if (s[0] == '0' && s[1] != '\0')
+    return FALSE;
+
+  while (g_ascii_isdigit (*s)) {
+    if (++len > 9)
+      return FALSE;
+    v = v * 10 + (*s - '0');
+    s++;
+  }
+  if (len == 0 || *s != '\0')
+    return FALSE;
+
+  *result = sign * v;
+  return TRUE;
+}
+
 static gboolean
 gst_structure_parse_value (gchar * str,
     gchar ** after, GValue * value, GType default_type)
@@ -2147,6 +2356,7 @@ gst_structure_parse_value (gchar * str,
   gchar *s;
   gchar c;
   int ret = 0;
+  gint int_value;
   GType type = default_type;
 
   s = str;
@@ -2199,7 +2409,7 @@ gst_structure_parse_value (gchar * str,
           { G_TYPE_INT, G_TYPE_DOUBLE, GST_TYPE_FRACTION, G_TYPE_BOOLEAN,
         G_TYPE_STRING
       };
-      int i;
+      int i = 0;
 
       if (G_UNLIKELY (!gst_structure_parse_string (s, &value_end, &s, TRUE)))
         return FALSE;
@@ -2207,7 +2417,18 @@ gst_structure_parse_value (gchar * str,
       c = *value_end;
       *value_end = '\0';
 
-      for (i = 0; i < G_N_ELEMENTS (try_types); i++) {
+      /* words that start with a letter are strings unless they are one of
+       * the keywords, don't try to deserialize them as the other types */
+      if (g_ascii_isalpha (*value_s) && !gst_structure_is_value_keyword (value_s)) {
+        i = G_N_ELEMENTS (try_types) - 1;
+      } else if (gst_structure_parse_simple_int (value_s, &int_value)) {
+        g_value_init (value, G_TYPE_INT);
+        g_value_set_int (value, int_value);
+        ret = TRUE;
+        i = G_N_ELEMENTS (try_types);
+      }
+
+      for (; i < G_N_ELEMENTS (try_types); i++) {
         g_value_init (value, try_types[i]);
         ret = gst_value_deserialize (value, value_s);
         if (ret)
@@ -2224,7 +2445,13 @@ gst_structure_parse_value (gchar * str,
       c = *value_end;
       *value_end = '\0';
 
-      ret = gst_value_deserialize (value, value_s);
+      if (type == G_TYPE_INT &&
+          gst_structure_parse_simple_int (value_s, &int_value)) {
+        g_value_set_int (value, int_value);
+        ret = TRUE;
+      } else {
+        ret = gst_value_deserialize (value, value_s);
+      }
       if (G_UNLIKELY (!ret))
         g_value_unset (value);
     }
@@ -2328,6 +2555,21 @@ gst_structure_new_from_string (const gchar * string)
   return gst_structure_from_string (string, NULL);
 }
 
+/* copy @string into @buf when it fits or into a newly allocated string,
+ * free the result with g_free() when it is not @buf */
+gchar *
+priv_gst_parse_buffer_init (gchar buf[PRIV_GST_PARSE_BUFFER_SIZE],
+    const gchar * string)
+{
+  gsize len = strlen (string);
+
+  if (G_UNLIKELY (len >= PRIV_GST_PARSE_BUFFER_SIZE))
+    return g_strndup (string, len);
+
+  memcpy (buf, string, len + 1);
+  return buf;
+}
+
 /**
  * gst_structure_from_string:
  * @string: a string representation of a #GstStructure.
@@ -2345,6 +2587,7 @@ gst_structure_new_from_string (const gchar * string)
 GstStructure *
 gst_structure_from_string (const gchar * string, gchar ** end)
 {
+  gchar buf[PRIV_GST_PARSE_BUFFER_SIZE];
   char *name;
   char *copy;
   char *w;
@@ -2354,7 +2597,8 @@ gst_structure_from_string (const gchar * string, gchar ** end)
 
   g_return_val_if_fail (string != NULL, NULL);
 
-  copy = g_strdup (string);
+  /* the parser works in place on a copy of the string */
+  copy = priv_gst_parse_buffer_init (buf, string);
   r = copy;
 
   if (!priv_gst_structure_parse_name (r, &name, &w, &r))
@@ -2377,13 +2621,580 @@ gst_structure_from_string (const gchar * string, gchar ** end)
     g_warning ("gst_structure_from_string did not consume whole string,"
         " but caller did not provide end pointer (\"%s\")", string);
 
-  g_free (copy);
+  if (copy != buf)
+    g_free (copy);
+  return structure;
+
+error:
+  if (structure)
+    gst_structure_free (structure);
+  if (copy != buf)
+    g_free (copy);
+  return NULL;
+}
+
+/* binary serialization
+ *
+ * All numbers are little endian. Strings are a 32 bit length followed by the
+ * bytes and a terminating 0 so that they can be used in place, a length of
+ * G_MAXUINT32 is a NULL string. A structure is its name, its features, the
+ * number of fields and the fields. A field is its name and its value, which
+ * starts with a tag byte. The basic types, ranges, lists and arrays have
+ * their own tags, the other values are stored as their type name and
+ * serialized string.
+ */
+typedef enum
+{
+  BINARY_TAG_GENERIC = 0,
+  BINARY_TAG_INT,
+  BINARY_TAG_UINT,
+  BINARY_TAG_INT64,
+  BINARY_TAG_UINT64,
+  BINARY_TAG_DOUBLE,
+  BINARY_TAG_FLOAT,
+  BINARY_TAG_BOOLEAN,
+  BINARY_TAG_STRING,
+  BINARY_TAG_FRACTION,
+  BINARY_TAG_INT_RANGE,
+  BINARY_TAG_INT64_RANGE,
+  BINARY_TAG_DOUBLE_RANGE,
+  BINARY_TAG_FRACTION_RANGE,
+  BINARY_TAG_LIST,
+  BINARY_TAG_ARRAY
+} GstStructureBinaryTag;
+
+typedef enum
+{
+  BINARY_FEATURES_NONE = 0,
+  BINARY_FEATURES_ANY,
+  BINARY_FEATURES_LIST
+} GstStructureBinaryFeatures;
+
+/* lists and arrays can't be nested deeper than this when reading */
+#define BINARY_MAX_DEPTH 64
+
+static inline void
+binary_write_uint8 (GByteArray * data, guint8 v)
+{
+  g_byte_array_append (data, &v, 1);
+}
+
+static inline void
+binary_write_uint32 (GByteArray * data, guint32 v)
+{
+  guint8 b[4];
+
+  GST_WRITE_UINT32_LE (b, v);
+  g_byte_array_append (data, b, 4);
+}
+
+static inline void
+binary_write_uint64 (GByteArray * data, guint64 v)
+{
+  guint8 b[8];
+
+  GST_WRITE_UINT64_LE (b, v);
+  g_byte_array_append (data, b, 8);
+}
+
+static inline void
+binary_write_double (GByteArray * data, gdouble v)
+{
+  guint8 b[8];
+
+  GST_WRITE_DOUBLE_LE (b, v);
+  g_byte_array_append (data, b, 8);
+}
+
+static void
+binary_write_string (GByteArray * data, const gchar * str)
+{
+  gsize len;
+
+  if (str == NULL) {
+    binary_write_uint32 (data, G_MAXUINT32);
+    return;
+  }
+  len = strlen (str);
+  binary_write_uint32 (data, len);
+  g_byte_array_append (data, (const guint8 *) str, len + 1);
+}
+
+static void
+binary_write_value (GByteArray * data, const GValue * value)
+{
+  GType type = G_VALUE_TYPE (value);
+
+  if (type == G_TYPE_INT) {
+    binary_write_uint8 (data, BINARY_TAG_INT);
+    binary_write_uint32 (data, g_value_get_int (value));
+  } else if (type == G_TYPE_UINT) {
+    binary_write_uint8 (data, BINARY_TAG_UINT);
+    binary_write_uint32 (data, g_value_get_uint (value));
+  } else if (type == G_TYPE_INT64) {
+    binary_write_uint8 (data, BINARY_TAG_INT64);
+    binary_write_uint64 (data, g_value_get_int64 (value));
+  } else if (type == G_TYPE_UINT64) {
+    binary_write_uint8 (data, BINARY_TAG_UINT64);
+    binary_write_uint64 (data, g_value_get_uint64 (value));
+  } else if (type == G_TYPE_DOUBLE) {
+    binary_write_uint8 (data, BINARY_TAG_DOUBLE);
+    binary_write_double (data, g_value_get_double (value));
+  } else if (type == G_TYPE_FLOAT) {
+    binary_write_uint8 (data, BINARY_TAG_FLOAT);
+    binary_write_double (data, g_value_get_float (value));
+  } else if (type == G_TYPE_BOOLEAN) {
+    binary_write_uint8 (data, BINARY_TAG_BOOLEAN);
+    binary_write_uint8 (data, g_value_get_boolean (value) ? 1 : 0);
+  } else if (type == G_TYPE_STRING) {
+    binary_write_uint8 (data, BINARY_TAG_STRING);
+    binary_write_string (data, g_value_get_string (value));
+  } else if (type == GST_TYPE_FRACTION) {
+    binary_write_uint8 (data, BINARY_TAG_FRACTION);
+    binary_write_uint32 (data, gst_value_get_fraction_numerator (value));
+    binary_write_uint32 (data, gst_value_get_fraction_denominator (value));
+  } else if (type == GST_TYPE_INT_RANGE) {
+    binary_write_uint8 (data, BINARY_TAG_INT_RANGE);
+    binary_write_uint32 (data, gst_value_get_int_range_min (value));
+    binary_write_uint32 (data, gst_value_get_int_range_max (value));
+    binary_write_uint32 (data, gst_value_get_int_range_step (value));
+  } else if (type == GST_TYPE_INT64_RANGE) {
+    binary_write_uint8 (data, BINARY_TAG_INT64_RANGE);
+    binary_write_uint64 (data, gst_value_get_int64_range_min (value));
+    binary_write_uint64 (data, gst_value_get_int64_range_max (value));
+    binary_write_uint64 (data, gst_value_get_int64_range_step (value));
+  } else if (type == GST_TYPE_DOUBLE_RANGE) {
+    binary_write_uint8 (data, BINARY_TAG_DOUBLE_RANGE);
+    binary_write_double (data, gst_value_get_double_range_min (value));
+    binary_write_double (data, gst_value_get_double_range_max (value));
+  } else if (type == GST_TYPE_FRACTION_RANGE) {
+    const GValue *min = gst_value_get_fraction_range_min (value);
+    const GValue *max = gst_value_get_fraction_range_max (value);
+
+    binary_write_uint8 (data, BINARY_TAG_FRACTION_RANGE);
+    binary_write_uint32 (data, gst_value_get_fraction_numerator (min));
+    binary_write_uint32 (data, gst_value_get_fraction_denominator (min));
+    binary_write_uint32 (data, gst_value_get_fraction_numerator (max));
+    binary_write_uint32 (data, gst_value_get_fraction_denominator (max));
+  } else if (type == GST_TYPE_LIST) {
+    guint i, n = gst_value_list_get_size (value);
+
+    binary_write_uint8 (data, BINARY_TAG_LIST);
+    binary_write_uint32 (data, n);
+    for (i = 0; i < n; i++)
+      binary_write_value (data, gst_value_list_get_value (value, i));
+  } else if (type == GST_TYPE_ARRAY) {
+    guint i, n = gst_value_array_get_size (value);
+
+    binary_write_uint8 (data, BINARY_TAG_ARRAY);
+    binary_write_uint32 (data, n);
+    for (i = 0; i < n; i++)
+      binary_write_value (data, gst_value_array_get_value (value, i));
+  } else {
+    gchar *str;
+
+    /* NULL when the value can't be serialized, the field is skipped when
+     * reading */
+    str = gst_value_serialize (value);
+    binary_write_uint8 (data, BINARY_TAG_GENERIC);
+    binary_write_string (data, g_type_name (type));
+    binary_write_string (data, str);
+    g_free (str);
+  }
+}
+
+/*
+ * priv_gst_structure_write_binary:
+ * @structure: a #GstStructure
+ * @features: (allow-none): the #GstCapsFeatures of @structure
+ * @data: a #GByteArray
+ *
+ * Append the binary representation of @structure and @features to @data.
+ */
+void
+priv_gst_structure_write_binary (const GstStructure * structure,
+    const GstCapsFeatures * features, GByteArray * data)
+{
+  guint i, len;
+
+  binary_write_string (data, g_quark_to_string (structure->name));
+
+  if (features == NULL) {
+    binary_write_uint8 (data, BINARY_FEATURES_NONE);
+  } else if (gst_caps_features_is_any (features)) {
+    binary_write_uint8 (data, BINARY_FEATURES_ANY);
+  } else {
+    guint n = gst_caps_features_get_size (features);
+
+    binary_write_uint8 (data, BINARY_FEATURES_LIST);
+    binary_write_uint32 (data, n);
+    for (i = 0; i < n; i++)
+      binary_write_string (data, gst_caps_features_get_nth (features, i));
+  }
+
+  len = GST_STRUCTURE_LEN (structure);
+  binary_write_uint32 (data, len);
+  for (i = 0; i < len; i++) {
+    GstStructureField *field = GST_STRUCTURE_FIELD (structure, i);
+
+    binary_write_string (data, g_quark_to_string (field->name));
+    binary_write_value (data, &field->value);
+  }
+}
+
+static inline gboolean
+binary_read_uint8 (const guint8 ** data, const guint8 * end, guint8 * v)
+{
+  if (G_UNLIKELY (end - *data < 1))
+    return FALSE;
+  *v = **data;
+  *data += 1;
+  return TRUE;
+}
+
+static inline gboolean
+binary_read_uint32 (const guint8 ** data, const guint8 * end, guint32 * v)
+{
+  if (G_UNLIKELY (end - *data < 4))
+    return FALSE;
+  *v = GST_READ_UINT32_LE (*data);
+  *data += 4;
+  return TRUE;
+}
+
+static inline gboolean
+binary_read_uint64 (const guint8 ** data, const guint8 * end, guint64 * v)
+{
+  if (G_UNLIKELY (end - *data < 8))
+    return FALSE;
+  *v = GST_READ_UINT64_LE (*data);
+  *data += 8;
+  return TRUE;
+}
+
+static inline gboolean
+binary_read_double (const guint8 ** data, const guint8 * end, gdouble * v)
+{
+  if (G_UNLIKELY (end - *data < 8))
+    return FALSE;
+  *v = GST_READ_DOUBLE_LE (*data);
+  *data += 8;
+  return TRUE;
+}
+
+/* the string points into @data, it is not copied */
+static gboolean
+binary_read_string (const guint8 ** data, const guint8 * end,
+    const gchar ** str)
+{
+  guint32 len;
+
+  if (!binary_read_uint32 (data, end, &len))
+    return FALSE;
+
+  if (len == G_MAXUINT32) {
+    *str = NULL;
+    return TRUE;
+  }
+  if (G_UNLIKELY ((gsize) (end - *data) <= len || (*data)[len] != '\0'))
+    return FALSE;
+
+  *str = (const gchar *) * data;
+  *data += len + 1;
+  return TRUE;
+}
+
+static gboolean
+binary_read_fraction (const guint8 ** data, const guint8 * end, gint * num,
+    gint * denom)
+{
+  guint32 n, d;
+
+  if (!binary_read_uint32 (data, end, &n) ||
+      !binary_read_uint32 (data, end, &d))
+    return FALSE;
+
+  *num = n;
+  *denom = d;
+
+  return *denom != 0 && *denom >= -G_MAXINT && *num >= -G_MAXINT;
+}
+
+/* reads a value into @value, which is left unset when the value is skipped
+ * or on errors */
+static gboolean
+binary_read_value (const guint8 ** data, const guint8 * end, GValue * value,
+    guint depth)
+{
+  guint8 tag;
+
+  if (!binary_read_uint8 (data, end, &tag))
+    return FALSE;
+
+  switch (tag) {
+    case BINARY_TAG_INT:
+    case BINARY_TAG_UINT:{
+      guint32 v;
+
+      if (!binary_read_uint32 (data, end, &v))
+        return FALSE;
+      if (tag == BINARY_TAG_INT) {
+        g_value_init (value, G_TYPE_INT);
+        g_value_set_int (value, (gint32) v);
+      } else {
+        g_value_init (value, G_TYPE_UINT);
+        g_value_set_uint (value, v);
+      }
+      break;
+    }
+    case BINARY_TAG_INT64:
+    case BINARY_TAG_UINT64:{
+      guint64 v;
+
+      if (!binary_read_uint64 (data, end, &v))
+        return FALSE;
+      if (tag == BINARY_TAG_INT64) {
+        g_value_init (value, G_TYPE_INT64);
+        g_value_set_int64 (value, (gint64) v);
+      } else {
+        g_value_init (value, G_TYPE_UINT64);
+        g_value_set_uint64 (value, v);
+      }
+      break;
+    }
+    case BINARY_TAG_DOUBLE:
+    case BINARY_TAG_FLOAT:{
+      gdouble v;
+
+      if (!binary_read_double (data, end, &v))
+        return FALSE;
+      if (tag == BINARY_TAG_DOUBLE) {
+        g_value_init (value, G_TYPE_DOUBLE);
+        g_value_set_double (value, v);
+      } else {
+        g_value_init (value, G_TYPE_FLOAT);
+        g_value_set_float (value, v);
+      }
+      break;
+    }
+    case BINARY_TAG_BOOLEAN:{
+      guint8 v;
+
+      if (!binary_read_uint8 (data, end, &v))
+        return FALSE;
+      g_value_init (value, G_TYPE_BOOLEAN);
+      g_value_set_boolean (value, v != 0);
+      break;
+    }
+    case BINARY_TAG_STRING:{
+      const gchar *str;
+
+      if (!binary_read_string (data, end, &str))
+        return FALSE;
+      g_value_init (value, G_TYPE_STRING);
+      g_value_set_string (value, str);
+      break;
+    }
+    case BINARY_TAG_FRACTION:{
+      gint num, denom;
+
+      if (!binary_read_fraction (data, end, &num, &denom))
+        return FALSE;
+      g_value_init (value, GST_TYPE_FRACTION);
+      gst_value_set_fraction (value, num, denom);
+      break;
+    }
+    case BINARY_TAG_INT_RANGE:{
+      guint32 min, max, step;
+
+      if (!binary_read_uint32 (data, end, &min) ||
+          !binary_read_uint32 (data, end, &max) ||
+          !binary_read_uint32 (data, end, &step))
+        return FALSE;
+      if ((gint) min >= (gint) max || (gint) step <= 0 ||
+          (gint) min % (gint) step != 0 || (gint) max % (gint) step != 0)
+        return FALSE;
+      g_value_init (value, GST_TYPE_INT_RANGE);
+      gst_value_set_int_range_step (value, min, max, step);
+      break;
+    }
+    case BINARY_TAG_INT64_RANGE:{
+      guint64 min, max, step;
+
+      if (!binary_read_uint64 (data, end, &min) ||
+          !binary_read_uint64 (data, end, &max) ||
+          !binary_read_uint64 (data, end, &step))
+        return FALSE;
+      if ((gint64) min >= (gint64) max || (gint64) step <= 0 ||
+          (gint64) min % (gint64) step != 0 ||
+          (gint64) max % (gint64) step != 0)
+        return FALSE;
+      g_value_init (value, GST_TYPE_INT64_RANGE);
+      gst_value_set_int64_range_step (value, min, max, step);
+      break;
+    }
+    case BINARY_TAG_DOUBLE_RANGE:{
+      gdouble min, max;
+
+      if (!binary_read_double (data, end, &min) ||
+          !binary_read_double (data, end, &max))
+        return FALSE;
+      if (!(min < max))
+        return FALSE;
+      g_value_init (value, GST_TYPE_DOUBLE_RANGE);
+      gst_value_set_double_range (value, min, max);
+      break;
+    }
+    case BINARY_TAG_FRACTION_RANGE:{
+      gint n1, d1, n2, d2;
+
+      if (!binary_read_fraction (data, end, &n1, &d1) ||
+          !binary_read_fraction (data, end, &n2, &d2))
+        return FALSE;
+      if (gst_util_fraction_compare (n1, d1, n2, d2) >= 0)
+        return FALSE;
+      g_value_init (value, GST_TYPE_FRACTION_RANGE);
+      gst_value_set_fraction_range_full (value, n1, d1, n2, d2);
+      break;
+    }
+    case BINARY_TAG_LIST:
+    case BINARY_TAG_ARRAY:{
+      guint32 i, n;
+
+      if (depth >= BINARY_MAX_DEPTH || !binary_read_uint32 (data, end, &n))
+        return FALSE;
+      /* every value takes at least one byte */
+      if (n > (gsize) (end - *data))
+        return FALSE;
+
+      g_value_init (value,
+          tag == BINARY_TAG_LIST ? GST_TYPE_LIST : GST_TYPE_ARRAY);
+      for (i = 0; i < n; i++) {
+        GValue v = G_VALUE_INIT;
+
+        if (!binary_read_value (data, end, &v, depth + 1)) {
+          g_value_unset (value);
+          return FALSE;
+        }
+        if (!G_IS_VALUE (&v))
+          continue;
+        if (tag == BINARY_TAG_LIST)
+          gst_value_list_append_and_take_value (value, &v);
+        else
+          gst_value_array_append_and_take_value (value, &v);
+      }
+      break;
+    }
+    case BINARY_TAG_GENERIC:{
+      const gchar *type_name, *str;
+      GType type;
+
+      if (!binary_read_string (data, end, &type_name) ||
+          !binary_read_string (data, end, &str))
+        return FALSE;
+      /* the value could not be serialized, skip it */
+      if (str == NULL)
+        break;
+      if (type_name == NULL || !(type = g_type_from_name (type_name)))
+        return FALSE;
+
+      g_value_init (value, type);
+      if (!gst_value_deserialize (value, str)) {
+        g_value_unset (value);
+        return FALSE;
+      }
+      break;
+    }
+    default:
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/*
+ * priv_gst_structure_read_binary:
+ * @data: (inout): a pointer to the data
+ * @end: the end of the data
+ * @features: (out) (allow-none): the #GstCapsFeatures of the structure
+ *
+ * Read a structure that was written with priv_gst_structure_write_binary()
+ * from @data and advance @data to after the structure. All reads are bounds
+ * checked against @end.
+ *
+ * Returns: (transfer full): a new #GstStructure or %NULL when @data is
+ *     invalid or truncated.
+ */
+GstStructure *
+priv_gst_structure_read_binary (const guint8 ** data, const guint8 * end,
+    GstCapsFeatures ** features)
+{
+  GstStructure *structure = NULL;
+  GstCapsFeatures *f = NULL;
+  const gchar *str;
+  guint8 kind;
+  guint32 i, n;
+
+  if (!binary_read_string (data, end, &str) || str == NULL ||
+      !g_ascii_isalpha (*str))
+    return NULL;
+
+  if (!binary_read_uint8 (data, end, &kind))
+    return NULL;
+
+  switch (kind) {
+    case BINARY_FEATURES_NONE:
+      break;
+    case BINARY_FEATURES_ANY:
+      f = gst_caps_features_new_any ();
+      break;
+    case BINARY_FEATURES_LIST:{
+      const gchar *feature;
+
+      if (!binary_read_uint32 (data, end, &n))
+        return NULL;
+      f = gst_caps_features_new_empty ();
+      for (i = 0; i < n; i++) {
+        if (!binary_read_string (data, end, &feature) || feature == NULL)
+          goto error;
+        gst_caps_features_add (f, feature);
+      }
+      break;
+    }
+    default:
+      return NULL;
+  }
+
+  /* every field takes at least 5 bytes */
+  if (!binary_read_uint32 (data, end, &n) || n > (end - *data) / 5)
+    goto error;
+
+  structure = gst_structure_new_id_empty_with_size (g_quark_from_string (str),
+      n);
+  for (i = 0; i < n; i++) {
+    GstStructureField field = { 0, G_VALUE_INIT };
+
+    if (!binary_read_string (data, end, &str) || str == NULL ||
+        !binary_read_value (data, end, &field.value, 0))
+      goto error;
+    if (!G_IS_VALUE (&field.value))
+      continue;
+
+    field.name = g_quark_from_string (str);
+    gst_structure_set_field (structure, &field);
+  }
+
+  if (features)
+    *features = f;
+  else if (f)
+    gst_caps_features_free (f);
+
   return structure;
 
 error:
   if (structure)
     gst_structure_free (structure);
-  g_free (copy);
+  if (f)
+    gst_caps_features_free (f);
   return NULL;
 }
 
@@ -3050,8 +3861,7 @@ gst_structure_is_equal (const GstStructure * structure1,
   if (structure1->name != structure2->name) {
     return FALSE;
   }
-  if (GST_STRUCTURE_FIELDS (structure1)->len !=
-      GST_STRUCTURE_FIELDS (structure2)->len) {
+  if (GST_STRUCTURE_LEN (structure1) != GST_STRUCTURE_LEN (structure2)) {
     return FALSE;
   }
 
@@ -65,21 +65,63 @@
  * task is started; changing the object name after the task has been started, has
  * no effect on the thread name.
  *
+ * The thread of a task can run with a real-time scheduling policy, a nice
+ * value and on a set of CPUs, see gst_task_set_scheduling(),
+ * gst_task_set_nice() and gst_task_set_cpus(). The policy is applied when the
+ * task function is entered, before the enter callback, and the previous
+ * settings of the thread are restored when it is left, after the leave
+ * callback. Tasks with a nice value don't use the pool, they run in a thread
+ * of their own. gst_pipeline_set_thread_policy() configures the policy of the
+ * tasks of the elements in a pipeline.
+ *
  * Last reviewed on 2012-03-29 (0.11.3)
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE             /* for sched_setaffinity() */
+#endif
+
 #include "gst_private.h"
 
 #include "gstinfo.h"
 #include "gsttask.h"
+#include "gstenumtypes.h"
 #include "glib-compat-private.h"
 
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
 
 #ifdef HAVE_SYS_PRCTL_H
 #include <sys/prctl.h>
 #endif
 
+#ifdef HAVE_PTHREAD_SETSCHEDPARAM
+#include <pthread.h>
+#endif
+#if defined(HAVE_PTHREAD_SETSCHEDPARAM) || defined(HAVE_SCHED_SETAFFINITY)
+#include <sched.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
+
+/* the nice value is per thread on Linux only */
+#if defined(HAVE_SETPRIORITY) && defined(HAVE_SYS_RESOURCE_H) && defined(SYS_gettid)
+#define HAVE_THREAD_NICE 1
+#endif
+
+/* the range of nice values */
+#define NICE_MIN                (-20)
+#define NICE_MAX                19
+
 GST_DEBUG_CATEGORY_STATIC (task_debug);
 #define GST_CAT_DEFAULT (task_debug)
 
@@ -102,12 +144,39 @@ struct _GstTaskPrivate
 
   /* configured pool */
   GstTaskPool *pool;
+  GstTaskPoolPriority priority;
 
-  /* remember the pool and id that is currently running. */
+  /* thread policy, with LOCK */
+  GstTaskScheduling scheduling;
+  gint sched_priority;
+  gint nice;
+  guint *cpus;
+  guint n_cpus;
+
+  /* remember the pool and id that is currently running. The pool is NULL
+   * when the task runs in its own thread, the id is that #GThread then. */
   gpointer id;
   GstTaskPool *pool_id;
 };
 
+/* the settings of the thread before the policy of the task was applied,
+ * pool threads get them back when the task function is left. The nice value
+ * is not in here, raising it again can't be undone without privileges and
+ * tasks with a nice value run in their own thread instead. */
+typedef struct
+{
+  gboolean sched_changed;
+#ifdef HAVE_PTHREAD_SETSCHEDPARAM
+  int policy;
+  struct sched_param param;
+#endif
+
+  gboolean cpus_changed;
+#ifdef HAVE_SCHED_SETAFFINITY
+  cpu_set_t cpus;
+#endif
+} GstTaskThreadState;
+
 #ifdef _MSC_VER
 #include <windows.h>
 
@@ -197,6 +266,9 @@ gst_task_init (GstTask * task)
   g_mutex_lock (&pool_lock);
   task->priv->pool = gst_object_ref (klass->pool);
   g_mutex_unlock (&pool_lock);
+  task->priv->priority = GST_TASK_POOL_PRIORITY_NORMAL;
+  task->priv->scheduling = GST_TASK_SCHEDULING_INHERIT;
+  task->priv->nice = GST_TASK_NICE_INHERIT;
 }
 
 static void
@@ -217,6 +289,10 @@ gst_task_finalize (GObject * object)
     task->notify (task->user_data);
 
   gst_object_unref (priv->pool);
+  g_free (priv->cpus);
+  /* the own thread of a task that was not joined */
+  if (priv->pool_id == NULL && priv->id != NULL)
+    g_thread_unref (priv->id);
 
   /* task thread cannot be running here since it holds a ref
    * to the task so that the finalize could not have happened */
@@ -256,12 +332,114 @@ gst_task_configure_name (GstTask * task)
 #endif
 }
 
+/* apply the thread policy of @task to the current thread and remember the
+ * old settings in @state, should be called with the object LOCK */
+static void
+gst_task_apply_policy (GstTask * task, GstTaskThreadState * state)
+{
+  GstTaskPrivate *priv = task->priv;
+
+  memset (state, 0, sizeof (GstTaskThreadState));
+
+  if (priv->scheduling != GST_TASK_SCHEDULING_INHERIT) {
+#ifdef HAVE_PTHREAD_SETSCHEDPARAM
+    struct sched_param param = { 0, };
+    int policy, res;
+
+    switch (priv->scheduling) {
+      case GST_TASK_SCHEDULING_FIFO:
+        policy = SCHED_FIFO;
+        param.sched_priority = priv->sched_priority;
+        break;
+      case GST_TASK_SCHEDULING_RR:
+        policy = SCHED_RR;
+        param.sched_priority = priv->sched_priority;
+        break;
+      default:
+        policy = SCHED_OTHER;
+        break;
+    }
+    res = pthread_getschedparam (pthread_self (), &state->policy,
+        &state->param);
+    if (res == 0)
+      res = pthread_setschedparam (pthread_self (), policy, &param);
+    if (res == 0) {
+      GST_DEBUG_OBJECT (task, "scheduling policy %d, priority %d", policy,
+          param.sched_priority);
+      state->sched_changed = TRUE;
+    } else {
+      GST_WARNING_OBJECT (task, "failed to set scheduling policy %d, "
+          "priority %d: %s", policy, param.sched_priority, g_strerror (res));
+    }
+#else
+    GST_WARNING_OBJECT (task, "setting the scheduling policy is not supported");
+#endif
+  }
+
+  if (priv->nice != GST_TASK_NICE_INHERIT) {
+#ifdef HAVE_THREAD_NICE
+    if (setpriority (PRIO_PROCESS, syscall (SYS_gettid), priv->nice) == 0) {
+      GST_DEBUG_OBJECT (task, "nice value %d", priv->nice);
+    } else {
+      GST_WARNING_OBJECT (task, "failed to set nice value %d: %s", priv->nice,
+          g_strerror (errno));
+    }
+#else
+    GST_WARNING_OBJECT (task, "setting the nice value is not supported");
+#endif
+  }
+
+#ifdef HAVE_SCHED_SETAFFINITY
+  if (priv->n_cpus > 0) {
+    cpu_set_t set;
+    guint i;
+
+    CPU_ZERO (&set);
+    for (i = 0; i < priv->n_cpus; i++)
+      CPU_SET (priv->cpus[i], &set);
+
+    if (sched_getaffinity (0, sizeof (cpu_set_t), &state->cpus) == 0 &&
+        sched_setaffinity (0, sizeof (cpu_set_t), &set) == 0) {
+      GST_DEBUG_OBJECT (task, "running on %u CPUs", priv->n_cpus);
+      state->cpus_changed = TRUE;
+    } else {
+      GST_WARNING_OBJECT (task, "failed to set CPU affinity: %s",
+          g_strerror (errno));
+    }
+  }
+#endif
+}
+
+/* restore the settings of the current thread from @state */
+static void
+gst_task_restore_policy (GstTask * task, GstTaskThreadState * state)
+{
+#ifdef HAVE_SCHED_SETAFFINITY
+  if (state->cpus_changed &&
+      sched_setaffinity (0, sizeof (cpu_set_t), &state->cpus) != 0)
+    GST_WARNING_OBJECT (task, "failed to restore CPU affinity: %s",
+        g_strerror (errno));
+#endif
+#ifdef HAVE_PTHREAD_SETSCHEDPARAM
+  if (state->sched_changed) {
+    int res;
+
+    res = pthread_setschedparam (pthread_self (), state->policy,
+        &state->param);
+    if (res != 0)
+      GST_WARNING_OBJECT (task, "failed to restore scheduling policy: %s",
+          g_strerror (res));
+  }
+#endif
+}
+
 static void
 gst_task_func (GstTask * task)
 {
   GRecMutex *lock;
   GThread *tself;
   GstTaskPrivate *priv;
+  GstTaskThreadState state;
 
   priv = task->priv;
 
@@ -273,12 +451,16 @@ gst_task_func (GstTask * task)
    * mark our state running so that nobody can mess with
    * the mutex. */
   GST_OBJECT_LOCK (task);
+  memset (&state, 0, sizeof (GstTaskThreadState));
   if (GET_TASK_STATE (task) == GST_TASK_STOPPED)
     goto exit;
   lock = GST_TASK_GET_LOCK (task);
   if (G_UNLIKELY (lock == NULL))
     goto no_lock;
   task->thread = tself;
+  /* configure the thread policy before the enter callback so that it can
+   * still change it */
+  gst_task_apply_policy (task, &state);
   GST_OBJECT_UNLOCK (task);
 
   /* fire the enter_func callback when we need to */
@@ -329,6 +511,8 @@ exit:
     priv->leave_func (task, tself, priv->leave_user_data);
     GST_OBJECT_LOCK (task);
   }
+  /* the thread can be reused by the pool, give it its settings back */
+  gst_task_restore_policy (task, &state);
   /* now we allow messing with the lock again by setting the running flag to
    * FALSE. Together with the SIGNAL this is the sign for the _join() to
    * complete.
@@ -352,6 +536,15 @@ no_lock:
   }
 }
 
+/* runs the task in a thread of its own */
+static gpointer
+gst_task_thread_func (GstTask * task)
+{
+  gst_task_func (task);
+
+  return NULL;
+}
+
 /**
  * gst_task_cleanup_all:
  *
@@ -504,6 +697,428 @@ gst_task_set_pool (GstTask * task, GstTaskPool * pool)
     gst_object_unref (old);
 }
 
+/**
+ * gst_task_get_priority_class:
+ * @task: a #GstTask
+ *
+ * Get the priority class that @task uses when it pushes its streaming
+ * thread on its #GstTaskPool.
+ *
+ * Returns: the #GstTaskPoolPriority of @task.
+ *
+ * MT safe.
+ *
+ * Since: 1.2
+ */
+GstTaskPoolPriority
+gst_task_get_priority_class (GstTask * task)
+{
+  GstTaskPoolPriority result;
+
+  g_return_val_if_fail (GST_IS_TASK (task), GST_TASK_POOL_PRIORITY_NORMAL);
+
+  GST_OBJECT_LOCK (task);
+  result = task->priv->priority;
+  GST_OBJECT_UNLOCK (task);
+
+  return result;
+}
+
+/**
+ * gst_task_set_priority_class:
+ * @task: a #GstTask
+ * @priority: a #GstTaskPoolPriority
+ *
+ * Set the priority class that @task uses for new streaming threads, see
+ * gst_task_pool_push_full(). The default is %GST_TASK_POOL_PRIORITY_NORMAL.
+ *
+ * MT safe.
+ *
+ * Since: 1.2
+ */
+void
+gst_task_set_priority_class (GstTask * task, GstTaskPoolPriority priority)
+{
+  g_return_if_fail (GST_IS_TASK (task));
+  g_return_if_fail (priority <= GST_TASK_POOL_PRIORITY_HIGH);
+
+  GST_OBJECT_LOCK (task);
+  task->priv->priority = priority;
+  GST_OBJECT_UNLOCK (task);
+}
+
+/**
+ * gst_task_set_scheduling:
+ * @task: a #GstTask
+ * @scheduling: a #GstTaskScheduling
+ * @priority: the real-time priority for %GST_TASK_SCHEDULING_FIFO and
+ *     %GST_TASK_SCHEDULING_RR, ignored for the other policies
+ *
+ * Run the thread of @task with the scheduling policy @scheduling. The policy
+ * is applied when the thread enters the task function, a task that is
+ * already running keeps its current policy until it is restarted. Real-time
+ * policies usually need privileges, a warning is logged when the policy
+ * can't be applied and the task runs with the policy of the thread.
+ *
+ * The default is %GST_TASK_SCHEDULING_INHERIT.
+ *
+ * MT safe.
+ *
+ * Since: 1.2
+ */
+void
+gst_task_set_scheduling (GstTask * task, GstTaskScheduling scheduling,
+    gint priority)
+{
+  g_return_if_fail (GST_IS_TASK (task));
+  g_return_if_fail (scheduling <= GST_TASK_SCHEDULING_RR);
+  g_return_if_fail (priority >= 0);
+
+  GST_OBJECT_LOCK (task);
+  task->priv->scheduling = scheduling;
+  task->priv->sched_priority = priority;
+  GST_OBJECT_UNLOCK (task);
+}
+
+/**
+ * gst_task_get_scheduling:
+ * @task: a #GstTask
+ * @priority: (out) (allow-none): the real-time priority
+ *
+ * Get the scheduling policy of @task, see gst_task_set_scheduling().
+ *
+ * Returns: the #GstTaskScheduling of @task.
+ *
+ * MT safe.
+ *
+ * Since: 1.2
+ */
+GstTaskScheduling
+gst_task_get_scheduling (GstTask * task, gint * priority)
+{
+  GstTaskScheduling result;
+
+  g_return_val_if_fail (GST_IS_TASK (task), GST_TASK_SCHEDULING_INHERIT);
+
+  GST_OBJECT_LOCK (task);
+  result = task->priv->scheduling;
+  if (priority)
+    *priority = task->priv->sched_priority;
+  GST_OBJECT_UNLOCK (task);
+
+  return result;
+}
+
+/**
+ * gst_task_set_nice:
+ * @task: a #GstTask
+ * @nice: the nice value between -20 and 19 or %GST_TASK_NICE_INHERIT
+ *
+ * Run the thread of @task with the nice value @nice. Like the scheduling
+ * policy, the nice value is applied when the thread enters the task function.
+ * This is only supported on Linux, where the nice value is per thread.
+ *
+ * Raising the nice value of a thread can't be undone without privileges, so
+ * a task with a nice value does not run in a thread of its #GstTaskPool but
+ * in a new thread that exits when the task stops.
+ *
+ * The default is %GST_TASK_NICE_INHERIT.
+ *
+ * MT safe.
+ *
+ * Since: 1.2
+ */
+void
+gst_task_set_nice (GstTask * task, gint nice)
+{
+  g_return_if_fail (GST_IS_TASK (task));
+  g_return_if_fail (nice == GST_TASK_NICE_INHERIT || (nice >= NICE_MIN
+          && nice <= NICE_MAX));
+
+  GST_OBJECT_LOCK (task);
+  task->priv->nice = nice;
+  GST_OBJECT_UNLOCK (task);
+}
+
+/**
+ * gst_task_get_nice:
+ * @task: a #GstTask
+ *
+ * Get the nice value of @task, see gst_task_set_nice().
+ *
+ * Returns: the nice value of @task or %GST_TASK_NICE_INHERIT.
+ *
+ * MT safe.
+ *
+ * Since: 1.2
+ */
+gint
+gst_task_get_nice (GstTask * task)
+{
+  gint result;
+
+  g_return_val_if_fail (GST_IS_TASK (task), GST_TASK_NICE_INHERIT);
+
+  GST_OBJECT_LOCK (task);
+  result = task->priv->nice;
+  GST_OBJECT_UNLOCK (task);
+
+  return result;
+}
+
+static gboolean
+gst_task_check_cpus (GstTask * task, const guint * cpus, guint n_cpus)
+{
+#ifdef HAVE_SCHED_SETAFFINITY
+  guint i;
+
+  for (i = 0; i < n_cpus; i++) {
+    if (cpus[i] >= CPU_SETSIZE) {
+      GST_WARNING_OBJECT (task, "invalid CPU %u", cpus[i]);
+      return FALSE;
+    }
+  }
+  return TRUE;
+#else
+  if (n_cpus == 0)
+    return TRUE;
+
+  GST_WARNING_OBJECT (task, "setting the CPU affinity is not supported");
+  return FALSE;
+#endif
+}
+
+/* with LOCK */
+static void
+gst_task_replace_cpus (GstTask * task, const guint * cpus, guint n_cpus)
+{
+  g_free (task->priv->cpus);
+  task->priv->cpus = n_cpus ? g_memdup (cpus, n_cpus * sizeof (guint)) : NULL;
+  task->priv->n_cpus = n_cpus;
+}
+
+/**
+ * gst_task_set_cpus:
+ * @task: a #GstTask
+ * @cpus: (array length=n_cpus) (allow-none): the CPU numbers
+ * @n_cpus: the number of elements in @cpus, 0 to not pin the thread
+ *
+ * Pin the thread of @task to @cpus. Like the scheduling policy, the CPU
+ * affinity is applied when the thread enters the task function. This
+ * overrides the CPUs of a #GstWorkStealingTaskPool while the task runs.
+ *
+ * Returns: %TRUE when the CPUs were configured, %FALSE when a CPU number is
+ * invalid or when the platform does not support setting the CPU affinity.
+ *
+ * MT safe.
+ *
+ * Since: 1.2
+ */
+gboolean
+gst_task_set_cpus (GstTask * task, const guint * cpus, guint n_cpus)
+{
+  g_return_val_if_fail (GST_IS_TASK (task), FALSE);
+  g_return_val_if_fail (cpus != NULL || n_cpus == 0, FALSE);
+
+  if (!gst_task_check_cpus (task, cpus, n_cpus))
+    return FALSE;
+
+  GST_OBJECT_LOCK (task);
+  gst_task_replace_cpus (task, cpus, n_cpus);
+  GST_OBJECT_UNLOCK (task);
+
+  return TRUE;
+}
+
+/**
+ * gst_task_get_cpus:
+ * @task: a #GstTask
+ * @n_cpus: (out): the number of CPUs
+ *
+ * Get the CPUs that the thread of @task is pinned to, see
+ * gst_task_set_cpus().
+ *
+ * Returns: (transfer full) (array length=n_cpus): the CPU numbers or %NULL
+ * when the thread is not pinned. g_free() after usage.
+ *
+ * MT safe.
+ *
+ * Since: 1.2
+ */
+guint *
+gst_task_get_cpus (GstTask * task, guint * n_cpus)
+{
+  guint *result;
+
+  g_return_val_if_fail (GST_IS_TASK (task), NULL);
+  g_return_val_if_fail (n_cpus != NULL, NULL);
+
+  GST_OBJECT_LOCK (task);
+  result = g_memdup (task->priv->cpus, task->priv->n_cpus * sizeof (guint));
+  *n_cpus = task->priv->n_cpus;
+  GST_OBJECT_UNLOCK (task);
+
+  return result;
+}
+
+/* parse the fields of @policy, @cpus is only set when %TRUE is returned */
+static gboolean
+gst_task_parse_thread_policy (GstTask * task, const GstStructure * policy,
+    GstTaskScheduling * scheduling, gint * priority, gint * nice,
+    GArray ** cpus)
+{
+  const GValue *value;
+  GArray *array;
+
+  *scheduling = GST_TASK_SCHEDULING_INHERIT;
+  *priority = 0;
+  *nice = GST_TASK_NICE_INHERIT;
+
+  if ((value = gst_structure_get_value (policy, "scheduling"))) {
+    if (G_VALUE_HOLDS (value, GST_TYPE_TASK_SCHEDULING)) {
+      *scheduling = g_value_get_enum (value);
+    } else if (G_VALUE_HOLDS_STRING (value)) {
+      GEnumClass *klass;
+      GEnumValue *val;
+
+      klass = g_type_class_ref (GST_TYPE_TASK_SCHEDULING);
+      val = g_enum_get_value_by_nick (klass, g_value_get_string (value));
+      if (val)
+        *scheduling = val->value;
+      g_type_class_unref (klass);
+      if (val == NULL)
+        goto wrong_field;
+    } else {
+      goto wrong_field;
+    }
+  }
+  if (gst_structure_has_field (policy, "priority") &&
+      (!gst_structure_get_int (policy, "priority", priority) || *priority < 0))
+    goto wrong_field;
+  if (gst_structure_has_field (policy, "nice") &&
+      (!gst_structure_get_int (policy, "nice", nice) || *nice < NICE_MIN
+          || *nice > NICE_MAX))
+    goto wrong_field;
+
+  array = g_array_new (FALSE, FALSE, sizeof (guint));
+  if ((value = gst_structure_get_value (policy, "cpus"))) {
+    if (G_VALUE_HOLDS_INT (value) && g_value_get_int (value) >= 0) {
+      guint cpu = g_value_get_int (value);
+
+      g_array_append_val (array, cpu);
+    } else if (G_VALUE_HOLDS_STRING (value)) {
+      g_array_free (array, TRUE);
+      array = _priv_gst_parse_cpu_list (g_value_get_string (value));
+    }
+    if (array->len == 0)
+      goto wrong_cpus;
+  }
+  if (!gst_task_check_cpus (task, (guint *) array->data, array->len))
+    goto wrong_cpus;
+
+  *cpus = array;
+
+  return TRUE;
+
+  /* ERRORS */
+wrong_cpus:
+  {
+    g_array_free (array, TRUE);
+    goto wrong_field;
+  }
+wrong_field:
+  {
+    GST_WARNING_OBJECT (task, "invalid thread policy %" GST_PTR_FORMAT,
+        policy);
+    return FALSE;
+  }
+}
+
+/**
+ * gst_task_thread_policy_is_valid:
+ * @policy: (transfer none): a thread policy
+ *
+ * Check the fields of @policy, see gst_task_set_thread_policy(). This can be
+ * used to report a wrong policy before the tasks that use it are created.
+ *
+ * Returns: %TRUE when gst_task_set_thread_policy() accepts @policy.
+ *
+ * Since: 1.2
+ */
+gboolean
+gst_task_thread_policy_is_valid (const GstStructure * policy)
+{
+  GstTaskScheduling scheduling;
+  gint priority, nice;
+  GArray *cpus;
+
+  g_return_val_if_fail (policy != NULL, FALSE);
+
+  if (!gst_task_parse_thread_policy (NULL, policy, &scheduling, &priority,
+          &nice, &cpus))
+    return FALSE;
+
+  g_array_free (cpus, TRUE);
+
+  return TRUE;
+}
+
+/**
+ * gst_task_set_thread_policy:
+ * @task: a #GstTask
+ * @policy: (transfer none): the thread policy
+ *
+ * Configure the scheduling policy, the nice value and the CPUs of @task at
+ * once from @policy. The name of @policy is not used, the fields are:
+ *
+ * <itemizedlist>
+ *   <listitem><para>"scheduling": a #GstTaskScheduling or its nick as a
+ *   string, like "fifo"</para></listitem>
+ *   <listitem><para>"priority": a #gint with the real-time
+ *   priority</para></listitem>
+ *   <listitem><para>"nice": a #gint with the nice value, between -20 and
+ *   19</para></listitem>
+ *   <listitem><para>"cpus": a CPU list as a string, like "0-3,8", or a
+ *   single CPU as a #gint</para></listitem>
+ * </itemizedlist>
+ *
+ * Fields that are missing from @policy are reset to their defaults, which
+ * keep the setting of the thread. A policy looks like
+ * "thread-policy, scheduling=fifo, priority=50, cpus=2-3" when serialized.
+ *
+ * Returns: %TRUE when @policy was applied, %FALSE when a field is invalid.
+ * @task is not changed in that case.
+ *
+ * MT safe.
+ *
+ * Since: 1.2
+ */
+gboolean
+gst_task_set_thread_policy (GstTask * task, const GstStructure * policy)
+{
+  GstTaskScheduling scheduling;
+  gint priority, nice;
+  GArray *cpus;
+
+  g_return_val_if_fail (GST_IS_TASK (task), FALSE);
+  g_return_val_if_fail (policy != NULL, FALSE);
+
+  if (!gst_task_parse_thread_policy (task, policy, &scheduling, &priority,
+          &nice, &cpus))
+    return FALSE;
+
+  GST_OBJECT_LOCK (task);
+  task->priv->scheduling = scheduling;
+  task->priv->sched_priority = priority;
+  task->priv->nice = nice;
+  gst_task_replace_cpus (task, (guint *) cpus->data, cpus->len);
+  GST_OBJECT_UNLOCK (task);
+
+  g_array_free (cpus, TRUE);
+
+  return TRUE;
+}
+
 /**
  * gst_task_set_enter_callback:
  * @task: The #GstTask to use
@@ -620,12 +1235,25 @@ start_task (GstTask * task)
    * and exit the task function. */
   task->running = TRUE;
 
-  /* push on the thread pool, we remember the original pool because the user
-   * could change it later on and then we join to the wrong pool. */
-  priv->pool_id = gst_object_ref (priv->pool);
-  priv->id =
-      gst_task_pool_push (priv->pool_id, (GstTaskPoolFunction) gst_task_func,
-      task, &error);
+  /* a thread from the previous run that was not joined is done already */
+  if (priv->pool_id == NULL && priv->id != NULL)
+    g_thread_unref (priv->id);
+
+  if (priv->nice != GST_TASK_NICE_INHERIT) {
+    /* the nice value of a pool thread can't always be lowered again when the
+     * task is done with it, give the task a thread of its own that exits
+     * with it */
+    priv->pool_id = NULL;
+    priv->id = g_thread_try_new ("task", (GThreadFunc) gst_task_thread_func,
+        task, &error);
+  } else {
+    /* push on the thread pool, we remember the original pool because the user
+     * could change it later on and then we join to the wrong pool. */
+    priv->pool_id = gst_object_ref (priv->pool);
+    priv->id =
+        gst_task_pool_push_full (priv->pool_id, priv->priority,
+        (GstTaskPoolFunction) gst_task_func, task, &error);
+  }
 
   if (error != NULL) {
     g_warning ("failed to create thread: %s", error->message);
@@ -814,6 +1442,8 @@ gst_task_join (GstTask * task)
     if (id)
       gst_task_pool_join (pool, id);
     gst_object_unref (pool);
+  } else if (id) {
+    g_thread_join (id);
   }
 
   GST_DEBUG_OBJECT (task, "Joined task %p", task);
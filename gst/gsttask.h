@@ -25,6 +25,7 @@
 
 #include <gst/gstobject.h>
 #include <gst/gsttaskpool.h>
+#include <gst/gststructure.h>
 
 G_BEGIN_DECLS
 
@@ -64,6 +65,36 @@ typedef enum {
   GST_TASK_PAUSED
 } GstTaskState;
 
+/**
+ * GstTaskScheduling:
+ * @GST_TASK_SCHEDULING_INHERIT: keep the scheduling policy of the thread
+ * @GST_TASK_SCHEDULING_OTHER: the default time-sharing scheduling policy
+ * @GST_TASK_SCHEDULING_FIFO: the first-in first-out real-time scheduling
+ *     policy
+ * @GST_TASK_SCHEDULING_RR: the round-robin real-time scheduling policy
+ *
+ * The scheduling policy of the thread of a task, see
+ * gst_task_set_scheduling().
+ *
+ * Since: 1.2
+ */
+typedef enum {
+  GST_TASK_SCHEDULING_INHERIT,
+  GST_TASK_SCHEDULING_OTHER,
+  GST_TASK_SCHEDULING_FIFO,
+  GST_TASK_SCHEDULING_RR
+} GstTaskScheduling;
+
+/**
+ * GST_TASK_NICE_INHERIT:
+ *
+ * Nice value to keep the nice value of the thread of a task, see
+ * gst_task_set_nice().
+ *
+ * Since: 1.2
+ */
+#define GST_TASK_NICE_INHERIT           G_MAXINT
+
 /**
  * GST_TASK_STATE:
  * @task: Task to get the state of
@@ -176,6 +207,22 @@ void            gst_task_set_lock       (GstTask *task, GRecMutex *mutex);
 GstTaskPool *   gst_task_get_pool       (GstTask *task);
 void            gst_task_set_pool       (GstTask *task, GstTaskPool *pool);
 
+GstTaskPoolPriority gst_task_get_priority_class (GstTask *task);
+void            gst_task_set_priority_class (GstTask *task, GstTaskPoolPriority priority);
+
+void            gst_task_set_scheduling (GstTask *task, GstTaskScheduling scheduling,
+                                         gint priority);
+GstTaskScheduling gst_task_get_scheduling (GstTask *task, gint *priority);
+
+void            gst_task_set_nice       (GstTask *task, gint nice);
+gint            gst_task_get_nice       (GstTask *task);
+
+gboolean        gst_task_set_cpus       (GstTask *task, const guint *cpus, guint n_cpus);
+guint *         gst_task_get_cpus       (GstTask *task, guint *n_cpus);
+
+gboolean        gst_task_set_thread_policy (GstTask *task, const GstStructure *policy);
+gboolean        gst_task_thread_policy_is_valid (const GstStructure *policy);
+
 void            gst_task_set_enter_callback  (GstTask *task,
                                               GstTaskThreadFunc enter_func,
                                               gpointer user_data,
@@ -29,14 +29,36 @@
  *
  * Subclasses can be made to create custom threads.
  *
+ * #GstWorkStealingTaskPool keeps a fixed set of worker threads with a queue
+ * each. Functions pushed from a worker go to the queue of that worker,
+ * functions pushed from other threads are spread over the workers. Idle
+ * workers steal functions from the queues of the others, higher priority
+ * classes first, see gst_task_pool_push_full(). The workers can be pinned to
+ * CPUs with gst_work_stealing_task_pool_set_cpus() or to a NUMA node with
+ * gst_work_stealing_task_pool_set_numa_node(). To use it for all the tasks of
+ * a pipeline, see gst_pipeline_set_task_pool().
+ *
  * Last reviewed on 2009-04-23 (0.10.24)
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE             /* for sched_setaffinity() */
+#endif
+
 #include "gst_private.h"
 
 #include "gstinfo.h"
 #include "gsttaskpool.h"
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#include <errno.h>
+#endif
+#include <stdlib.h>
+
 GST_DEBUG_CATEGORY_STATIC (taskpool_debug);
 #define GST_CAT_DEFAULT (taskpool_debug)
 
@@ -74,7 +96,10 @@ static void
 default_prepare (GstTaskPool * pool, GError ** error)
 {
   GST_OBJECT_LOCK (pool);
-  pool->pool = g_thread_pool_new ((GFunc) default_func, pool, -1, FALSE, NULL);
+  /* preparing again keeps the threads we have */
+  if (pool->pool == NULL)
+    pool->pool =
+        g_thread_pool_new ((GFunc) default_func, pool, -1, FALSE, NULL);
   GST_OBJECT_UNLOCK (pool);
 }
 
@@ -119,6 +144,19 @@ default_join (GstTaskPool * pool, gpointer id)
   /* we do nothing here, we can't join from the pools */
 }
 
+static gpointer
+default_push_full (GstTaskPool * pool, GstTaskPoolPriority priority,
+    GstTaskPoolFunction func, gpointer user_data, GError ** error)
+{
+  GstTaskPoolClass *klass = GST_TASK_POOL_GET_CLASS (pool);
+
+  /* all functions start right away, there is nothing to prioritize */
+  if (klass->push == NULL)
+    return NULL;
+
+  return klass->push (pool, func, user_data, error);
+}
+
 static void
 gst_task_pool_class_init (GstTaskPoolClass * klass)
 {
@@ -136,6 +174,7 @@ gst_task_pool_class_init (GstTaskPoolClass * klass)
   gsttaskpool_class->cleanup = default_cleanup;
   gsttaskpool_class->push = default_push;
   gsttaskpool_class->join = default_join;
+  gsttaskpool_class->push_full = default_push_full;
 }
 
 static void
@@ -250,6 +289,48 @@ not_supported:
   }
 }
 
+/**
+ * gst_task_pool_push_full:
+ * @pool: a #GstTaskPool
+ * @priority: the priority class of @func
+ * @func: (scope async): the function to call
+ * @user_data: (closure): data to pass to @func
+ * @error: return location for an error
+ *
+ * Start the execution of a new thread from @pool, like gst_task_pool_push().
+ * When @pool can not start @func right away, functions with a higher
+ * @priority are started first.
+ *
+ * Returns: (transfer none): a pointer that should be used for the
+ * gst_task_pool_join function. This pointer can be NULL, you must
+ * check @error to detect errors.
+ *
+ * Since: 1.2
+ */
+gpointer
+gst_task_pool_push_full (GstTaskPool * pool, GstTaskPoolPriority priority,
+    GstTaskPoolFunction func, gpointer user_data, GError ** error)
+{
+  GstTaskPoolClass *klass;
+
+  g_return_val_if_fail (GST_IS_TASK_POOL (pool), NULL);
+  g_return_val_if_fail (priority <= GST_TASK_POOL_PRIORITY_HIGH, NULL);
+
+  klass = GST_TASK_POOL_GET_CLASS (pool);
+
+  if (klass->push_full == NULL)
+    goto not_supported;
+
+  return klass->push_full (pool, priority, func, user_data, error);
+
+  /* ERRORS */
+not_supported:
+  {
+    g_warning ("pushing tasks on pool %p is not supported", pool);
+    return NULL;
+  }
+}
+
 /**
  * gst_task_pool_join:
  * @pool: a #GstTaskPool
@@ -270,3 +351,548 @@ gst_task_pool_join (GstTaskPool * pool, gpointer id)
   if (klass->join)
     klass->join (pool, id);
 }
+
+/*
+ * Work stealing pool
+ */
+
+#define N_PRIORITIES (GST_TASK_POOL_PRIORITY_HIGH + 1)
+
+/* how long a worker started beyond n_workers stays around without work */
+#define OVERFLOW_IDLE_TIME (5 * G_TIME_SPAN_SECOND)
+
+typedef struct
+{
+  GstWorkStealingTaskPool *pool;
+  guint index;                  /* position in the workers array */
+  gboolean overflow;            /* started because all workers were busy */
+  GQueue queues[N_PRIORITIES];  /* TaskData, per priority class */
+} Worker;
+
+struct _GstWorkStealingTaskPoolPrivate
+{
+  guint n_workers;
+
+  /* CPUs to pin the workers to. With spread, each worker gets one of them,
+   * else all workers get all of them */
+  guint *cpus;
+  guint n_cpus;
+  gboolean spread;
+
+  /* protects everything below and the queues of the workers. Functions run
+   * for the whole life of a streaming thread, so this is not contended */
+  GMutex lock;
+  GCond cond;
+  gboolean running;
+  GPtrArray *workers;
+  guint n_threads;              /* number of worker threads alive */
+  guint n_idle;                 /* number of workers not running a function,
+                                 * also the woken ones that did not take one
+                                 * yet */
+  guint n_queued;               /* number of functions in the queues */
+  guint next;                   /* worker for the next push from outside */
+};
+
+#define GST_WORK_STEALING_TASK_POOL_GET_PRIVATE(obj)  \
+   (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GST_TYPE_WORK_STEALING_TASK_POOL, \
+       GstWorkStealingTaskPoolPrivate))
+
+/* the worker running in the current thread */
+static GPrivate current_worker;
+
+static void gst_work_stealing_task_pool_finalize (GObject * object);
+
+G_DEFINE_TYPE (GstWorkStealingTaskPool, gst_work_stealing_task_pool,
+    GST_TYPE_TASK_POOL);
+
+static guint
+get_n_processors (void)
+{
+#if defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+  glong n = sysconf (_SC_NPROCESSORS_ONLN);
+
+  if (n > 0)
+    return n;
+#endif
+  return 1;
+}
+
+/* WITH LOCK */
+static void
+worker_set_affinity (GstWorkStealingTaskPoolPrivate * priv, Worker * worker)
+{
+#ifdef HAVE_SCHED_SETAFFINITY
+  cpu_set_t set;
+  guint i;
+
+  if (priv->n_cpus == 0)
+    return;
+
+  CPU_ZERO (&set);
+  if (priv->spread && !worker->overflow) {
+    CPU_SET (priv->cpus[worker->index % priv->n_cpus], &set);
+  } else {
+    for (i = 0; i < priv->n_cpus; i++)
+      CPU_SET (priv->cpus[i], &set);
+  }
+  if (sched_setaffinity (0, sizeof (set), &set) != 0)
+    GST_WARNING ("worker %u: failed to set CPU affinity: %s", worker->index,
+        g_strerror (errno));
+#endif
+}
+
+/* take the next function for @worker. Its own functions come first, the
+ * ones pushed last first. Otherwise steal the oldest function of another
+ * worker. Higher priority classes go before everything else.
+ * WITH LOCK */
+static TaskData *
+worker_take (GstWorkStealingTaskPoolPrivate * priv, Worker * worker)
+{
+  TaskData *tdata;
+  guint i, n;
+  gint prio;
+
+  if (priv->n_queued == 0)
+    return NULL;
+
+  n = priv->workers->len;
+  for (prio = N_PRIORITIES - 1; prio >= 0; prio--) {
+    if ((tdata = g_queue_pop_head (&worker->queues[prio])))
+      goto found;
+
+    for (i = 1; i < n; i++) {
+      Worker *victim;
+
+      victim = g_ptr_array_index (priv->workers, (worker->index + i) % n);
+      if ((tdata = g_queue_pop_tail (&victim->queues[prio]))) {
+        GST_LOG ("worker %u stole from worker %u", worker->index,
+            victim->index);
+        goto found;
+      }
+    }
+  }
+  return NULL;
+
+found:
+  priv->n_queued--;
+  priv->n_idle--;
+  return tdata;
+}
+
+static gpointer
+worker_func (Worker * worker)
+{
+  GstWorkStealingTaskPool *pool = worker->pool;
+  GstWorkStealingTaskPoolPrivate *priv = pool->priv;
+  gboolean timed_out = FALSE;
+  TaskData *tdata;
+  Worker *last;
+
+  g_private_set (&current_worker, worker);
+
+  g_mutex_lock (&priv->lock);
+  worker_set_affinity (priv, worker);
+
+  while (TRUE) {
+    if ((tdata = worker_take (priv, worker))) {
+      g_mutex_unlock (&priv->lock);
+
+      tdata->func (tdata->user_data);
+      g_slice_free (TaskData, tdata);
+
+      g_mutex_lock (&priv->lock);
+      priv->n_idle++;
+      timed_out = FALSE;
+      continue;
+    }
+    if (!priv->running || timed_out)
+      break;
+
+    if (worker->overflow)
+      timed_out = !g_cond_wait_until (&priv->cond, &priv->lock,
+          g_get_monotonic_time () + OVERFLOW_IDLE_TIME);
+    else
+      g_cond_wait (&priv->cond, &priv->lock);
+  }
+
+  /* leave the pool, our queues are empty */
+  GST_DEBUG ("worker %u exits", worker->index);
+  last = g_ptr_array_index (priv->workers, priv->workers->len - 1);
+  g_ptr_array_remove_index_fast (priv->workers, worker->index);
+  last->index = worker->index;
+  priv->n_threads--;
+  priv->n_idle--;
+  g_cond_broadcast (&priv->cond);
+  g_mutex_unlock (&priv->lock);
+
+  g_private_set (&current_worker, NULL);
+  g_slice_free (Worker, worker);
+  gst_object_unref (pool);
+
+  return NULL;
+}
+
+/* WITH LOCK */
+static gboolean
+start_worker (GstWorkStealingTaskPool * pool, gboolean overflow,
+    GError ** error)
+{
+  GstWorkStealingTaskPoolPrivate *priv = pool->priv;
+  GThread *thread;
+  Worker *worker;
+  gint i;
+
+  worker = g_slice_new0 (Worker);
+  worker->pool = gst_object_ref (pool);
+  worker->overflow = overflow;
+  worker->index = priv->workers->len;
+  for (i = 0; i < N_PRIORITIES; i++)
+    g_queue_init (&worker->queues[i]);
+
+  g_ptr_array_add (priv->workers, worker);
+  priv->n_threads++;
+  priv->n_idle++;
+
+  thread = g_thread_try_new ("taskpool", (GThreadFunc) worker_func, worker,
+      error);
+  if (thread == NULL)
+    goto no_thread;
+
+  g_thread_unref (thread);
+
+  GST_DEBUG_OBJECT (pool, "started %sworker %u", overflow ? "overflow " : "",
+      worker->index);
+
+  return TRUE;
+
+  /* ERRORS */
+no_thread:
+  {
+    GST_WARNING_OBJECT (pool, "failed to start a worker");
+    g_ptr_array_remove_index (priv->workers, worker->index);
+    priv->n_threads--;
+    priv->n_idle--;
+    gst_object_unref (pool);
+    g_slice_free (Worker, worker);
+    return FALSE;
+  }
+}
+
+static void
+ws_prepare (GstTaskPool * pool, GError ** error)
+{
+  GstWorkStealingTaskPool *wspool = GST_WORK_STEALING_TASK_POOL_CAST (pool);
+  GstWorkStealingTaskPoolPrivate *priv = wspool->priv;
+  guint i;
+
+  g_mutex_lock (&priv->lock);
+  if (!priv->running) {
+    for (i = 0; i < priv->n_workers; i++) {
+      if (!start_worker (wspool, FALSE, error))
+        break;
+    }
+    priv->running = priv->workers->len > 0;
+  }
+  g_mutex_unlock (&priv->lock);
+}
+
+static void
+ws_cleanup (GstTaskPool * pool)
+{
+  GstWorkStealingTaskPoolPrivate *priv =
+      GST_WORK_STEALING_TASK_POOL_CAST (pool)->priv;
+
+  /* the workers first run what is still queued, then exit */
+  g_mutex_lock (&priv->lock);
+  priv->running = FALSE;
+  g_cond_broadcast (&priv->cond);
+  while (priv->n_threads > 0)
+    g_cond_wait (&priv->cond, &priv->lock);
+  g_mutex_unlock (&priv->lock);
+}
+
+static gpointer
+ws_push_full (GstTaskPool * pool, GstTaskPoolPriority priority,
+    GstTaskPoolFunction func, gpointer user_data, GError ** error)
+{
+  GstWorkStealingTaskPool *wspool = GST_WORK_STEALING_TASK_POOL_CAST (pool);
+  GstWorkStealingTaskPoolPrivate *priv = wspool->priv;
+  TaskData *tdata;
+  Worker *worker;
+
+  g_mutex_lock (&priv->lock);
+  if (!priv->running)
+    goto not_prepared;
+
+  /* functions can keep their worker for a long time, every queued function
+   * needs an idle worker or it could wait forever. The idle workers that
+   * were already woken for the queued functions are not free anymore, only
+   * start a new one when none is left. */
+  if (priv->n_idle > priv->n_queued) {
+    g_cond_signal (&priv->cond);
+  } else {
+    if (!start_worker (wspool, TRUE, error))
+      goto done;
+  }
+
+  tdata = g_slice_new (TaskData);
+  tdata->func = func;
+  tdata->user_data = user_data;
+
+  worker = g_private_get (&current_worker);
+  if (worker && worker->pool == wspool) {
+    /* keep it close to the function that pushed it */
+    g_queue_push_head (&worker->queues[priority], tdata);
+  } else {
+    worker = g_ptr_array_index (priv->workers,
+        priv->next++ % priv->workers->len);
+    g_queue_push_tail (&worker->queues[priority], tdata);
+  }
+  priv->n_queued++;
+
+done:
+  g_mutex_unlock (&priv->lock);
+
+  return NULL;
+
+  /* ERRORS */
+not_prepared:
+  {
+    g_set_error (error, G_THREAD_ERROR, G_THREAD_ERROR_AGAIN,
+        "task pool is not prepared");
+    goto done;
+  }
+}
+
+static gpointer
+ws_push (GstTaskPool * pool, GstTaskPoolFunction func, gpointer user_data,
+    GError ** error)
+{
+  return ws_push_full (pool, GST_TASK_POOL_PRIORITY_NORMAL, func, user_data,
+      error);
+}
+
+static void
+gst_work_stealing_task_pool_class_init (GstWorkStealingTaskPoolClass * klass)
+{
+  GObjectClass *gobject_class;
+  GstTaskPoolClass *gsttaskpool_class;
+
+  gobject_class = (GObjectClass *) klass;
+  gsttaskpool_class = (GstTaskPoolClass *) klass;
+
+  g_type_class_add_private (klass, sizeof (GstWorkStealingTaskPoolPrivate));
+
+  gobject_class->finalize = gst_work_stealing_task_pool_finalize;
+
+  gsttaskpool_class->prepare = ws_prepare;
+  gsttaskpool_class->cleanup = ws_cleanup;
+  gsttaskpool_class->push = ws_push;
+  gsttaskpool_class->push_full = ws_push_full;
+}
+
+static void
+gst_work_stealing_task_pool_init (GstWorkStealingTaskPool * pool)
+{
+  GstWorkStealingTaskPoolPrivate *priv;
+
+  pool->priv = priv = GST_WORK_STEALING_TASK_POOL_GET_PRIVATE (pool);
+
+  priv->n_workers = 1;
+  g_mutex_init (&priv->lock);
+  g_cond_init (&priv->cond);
+  priv->workers = g_ptr_array_new ();
+}
+
+static void
+gst_work_stealing_task_pool_finalize (GObject * object)
+{
+  GstWorkStealingTaskPoolPrivate *priv =
+      GST_WORK_STEALING_TASK_POOL_CAST (object)->priv;
+
+  /* the workers keep a ref, there are none left here */
+  g_ptr_array_free (priv->workers, TRUE);
+  g_free (priv->cpus);
+  g_cond_clear (&priv->cond);
+  g_mutex_clear (&priv->lock);
+
+  G_OBJECT_CLASS (gst_work_stealing_task_pool_parent_class)->finalize (object);
+}
+
+/**
+ * gst_work_stealing_task_pool_new:
+ * @n_workers: the number of worker threads, 0 for one per processor
+ *
+ * Create a new work stealing task pool. gst_task_pool_prepare() starts
+ * @n_workers threads. When a function is pushed while all of them are busy,
+ * an extra worker is started, it exits again after being idle for a while.
+ *
+ * gst_task_pool_cleanup() must be called before the last ref is dropped,
+ * the workers keep the pool alive.
+ *
+ * Returns: (transfer full): a new #GstTaskPool. gst_object_unref() after usage.
+ *
+ * Since: 1.2
+ */
+GstTaskPool *
+gst_work_stealing_task_pool_new (guint n_workers)
+{
+  GstWorkStealingTaskPool *pool;
+
+  pool = g_object_newv (GST_TYPE_WORK_STEALING_TASK_POOL, 0, NULL);
+  pool->priv->n_workers = n_workers > 0 ? n_workers : get_n_processors ();
+
+  return GST_TASK_POOL_CAST (pool);
+}
+
+static gboolean
+ws_set_cpus (GstWorkStealingTaskPool * pool, const guint * cpus,
+    guint n_cpus, gboolean spread)
+{
+  GstWorkStealingTaskPoolPrivate *priv = pool->priv;
+  guint i;
+
+  for (i = 0; i < n_cpus; i++) {
+#ifdef HAVE_SCHED_SETAFFINITY
+    if (cpus[i] >= CPU_SETSIZE)
+      goto invalid_cpu;
+#else
+    goto not_supported;
+#endif
+  }
+
+  g_mutex_lock (&priv->lock);
+  if (priv->running)
+    goto is_running;
+  g_free (priv->cpus);
+  priv->cpus = g_memdup (cpus, n_cpus * sizeof (guint));
+  priv->n_cpus = n_cpus;
+  priv->spread = spread;
+  g_mutex_unlock (&priv->lock);
+
+  return TRUE;
+
+  /* ERRORS */
+#ifdef HAVE_SCHED_SETAFFINITY
+invalid_cpu:
+  {
+    GST_WARNING_OBJECT (pool, "invalid CPU %u", cpus[i]);
+    return FALSE;
+  }
+#else
+not_supported:
+  {
+    GST_WARNING_OBJECT (pool, "setting the CPU affinity is not supported");
+    return FALSE;
+  }
+#endif
+is_running:
+  {
+    g_mutex_unlock (&priv->lock);
+    GST_WARNING_OBJECT (pool, "can't change the CPUs of a prepared pool");
+    return FALSE;
+  }
+}
+
+/**
+ * gst_work_stealing_task_pool_set_cpus:
+ * @pool: a #GstWorkStealingTaskPool
+ * @cpus: (array length=n_cpus) (allow-none): the CPU numbers
+ * @n_cpus: the number of elements in @cpus, 0 to not pin the workers
+ *
+ * Pin each worker of @pool to one of @cpus, the workers are spread over
+ * them in turn. Extra workers that are started because all workers were busy
+ * can run on all of @cpus.
+ *
+ * This must be called before gst_task_pool_prepare().
+ *
+ * Returns: %TRUE when the CPUs were configured, %FALSE when a CPU number is
+ * invalid or when the platform does not support setting the CPU affinity.
+ *
+ * Since: 1.2
+ */
+gboolean
+gst_work_stealing_task_pool_set_cpus (GstWorkStealingTaskPool * pool,
+    const guint * cpus, guint n_cpus)
+{
+  g_return_val_if_fail (GST_IS_WORK_STEALING_TASK_POOL (pool), FALSE);
+  g_return_val_if_fail (cpus != NULL || n_cpus == 0, FALSE);
+
+  return ws_set_cpus (pool, cpus, n_cpus, TRUE);
+}
+
+/* parse a CPU list like "0-3,8,10-11", also used for the CPUs of tasks */
+GArray *
+_priv_gst_parse_cpu_list (const gchar * str)
+{
+  GArray *cpus;
+  gchar *end;
+  guint first, last, i;
+
+  cpus = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  while (g_ascii_isdigit (*str)) {
+    first = last = strtoul (str, &end, 10);
+    str = end;
+    if (*str == '-') {
+      last = strtoul (str + 1, &end, 10);
+      str = end;
+    }
+    for (i = first; i <= MIN (last, G_MAXUINT16); i++)
+      g_array_append_val (cpus, i);
+    if (*str == ',')
+      str++;
+  }
+  return cpus;
+}
+
+/**
+ * gst_work_stealing_task_pool_set_numa_node:
+ * @pool: a #GstWorkStealingTaskPool
+ * @node: a NUMA node number
+ *
+ * Make all workers of @pool run on the CPUs of NUMA node @node. Unlike
+ * gst_work_stealing_task_pool_set_cpus(), the workers are not pinned to a
+ * single CPU of the node.
+ *
+ * This must be called before gst_task_pool_prepare().
+ *
+ * Returns: %TRUE when the CPUs of @node were configured, %FALSE when the
+ * node does not exist or when the platform does not support it.
+ *
+ * Since: 1.2
+ */
+gboolean
+gst_work_stealing_task_pool_set_numa_node (GstWorkStealingTaskPool * pool,
+    guint node)
+{
+  gchar *path, *contents = NULL;
+  GArray *cpus;
+  gboolean res = FALSE;
+
+  g_return_val_if_fail (GST_IS_WORK_STEALING_TASK_POOL (pool), FALSE);
+
+  path = g_strdup_printf ("/sys/devices/system/node/node%u/cpulist", node);
+  if (!g_file_get_contents (path, &contents, NULL, NULL))
+    goto no_node;
+
+  cpus = _priv_gst_parse_cpu_list (contents);
+  if (cpus->len > 0)
+    res = ws_set_cpus (pool, (guint *) cpus->data, cpus->len, FALSE);
+  else
+    GST_WARNING_OBJECT (pool, "NUMA node %u has no CPUs", node);
+  g_array_free (cpus, TRUE);
+
+done:
+  g_free (contents);
+  g_free (path);
+
+  return res;
+
+  /* ERRORS */
+no_node:
+  {
+    GST_WARNING_OBJECT (pool, "no CPU list for NUMA node %u", node);
+    goto done;
+  }
+}
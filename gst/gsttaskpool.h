@@ -46,6 +46,24 @@ typedef struct _GstTaskPoolClass GstTaskPoolClass;
  */
 typedef void   (*GstTaskPoolFunction)          (void *user_data);
 
+/**
+ * GstTaskPoolPriority:
+ * @GST_TASK_POOL_PRIORITY_LOW: run after the other queued functions
+ * @GST_TASK_POOL_PRIORITY_NORMAL: the default priority class
+ * @GST_TASK_POOL_PRIORITY_HIGH: run before the other queued functions
+ *
+ * The priority class of a function pushed with gst_task_pool_push_full().
+ * Pools that start every function right away, like the default pool,
+ * ignore it.
+ *
+ * Since: 1.2
+ */
+typedef enum {
+  GST_TASK_POOL_PRIORITY_LOW,
+  GST_TASK_POOL_PRIORITY_NORMAL,
+  GST_TASK_POOL_PRIORITY_HIGH
+} GstTaskPoolPriority;
+
 /**
  * GstTaskPool:
  *
@@ -67,6 +85,8 @@ struct _GstTaskPool {
  * @cleanup: make sure all threads are stopped
  * @push: start a new thread
  * @join: join a thread
+ * @push_full: start a new thread for a function with a priority class.
+ *     The default implementation calls @push. Since: 1.2
  *
  * The #GstTaskPoolClass object.
  */
@@ -81,8 +101,12 @@ struct _GstTaskPoolClass {
                          gpointer user_data, GError **error);
   void      (*join)     (GstTaskPool *pool, gpointer id);
 
+  gpointer  (*push_full) (GstTaskPool *pool, GstTaskPoolPriority priority,
+                          GstTaskPoolFunction func, gpointer user_data,
+                          GError **error);
+
   /*< private >*/
-  gpointer _gst_reserved[GST_PADDING];
+  gpointer _gst_reserved[GST_PADDING - 1];
 };
 
 GType           gst_task_pool_get_type    (void);
@@ -92,10 +116,66 @@ void            gst_task_pool_prepare     (GstTaskPool *pool, GError **error);
 
 gpointer        gst_task_pool_push        (GstTaskPool *pool, GstTaskPoolFunction func,
                                            gpointer user_data, GError **error);
+gpointer        gst_task_pool_push_full   (GstTaskPool *pool, GstTaskPoolPriority priority,
+                                           GstTaskPoolFunction func, gpointer user_data,
+                                           GError **error);
 void            gst_task_pool_join        (GstTaskPool *pool, gpointer id);
 
 void		gst_task_pool_cleanup     (GstTaskPool *pool);
 
+/* work stealing pool */
+#define GST_TYPE_WORK_STEALING_TASK_POOL             (gst_work_stealing_task_pool_get_type ())
+#define GST_WORK_STEALING_TASK_POOL(pool)            (G_TYPE_CHECK_INSTANCE_CAST ((pool), GST_TYPE_WORK_STEALING_TASK_POOL, GstWorkStealingTaskPool))
+#define GST_IS_WORK_STEALING_TASK_POOL(pool)         (G_TYPE_CHECK_INSTANCE_TYPE ((pool), GST_TYPE_WORK_STEALING_TASK_POOL))
+#define GST_WORK_STEALING_TASK_POOL_CLASS(pclass)    (G_TYPE_CHECK_CLASS_CAST ((pclass), GST_TYPE_WORK_STEALING_TASK_POOL, GstWorkStealingTaskPoolClass))
+#define GST_IS_WORK_STEALING_TASK_POOL_CLASS(pclass) (G_TYPE_CHECK_CLASS_TYPE ((pclass), GST_TYPE_WORK_STEALING_TASK_POOL))
+#define GST_WORK_STEALING_TASK_POOL_GET_CLASS(pool)  (G_TYPE_INSTANCE_GET_CLASS ((pool), GST_TYPE_WORK_STEALING_TASK_POOL, GstWorkStealingTaskPoolClass))
+#define GST_WORK_STEALING_TASK_POOL_CAST(pool)       ((GstWorkStealingTaskPool*)(pool))
+
+typedef struct _GstWorkStealingTaskPool GstWorkStealingTaskPool;
+typedef struct _GstWorkStealingTaskPoolClass GstWorkStealingTaskPoolClass;
+typedef struct _GstWorkStealingTaskPoolPrivate GstWorkStealingTaskPoolPrivate;
+
+/**
+ * GstWorkStealingTaskPool:
+ *
+ * The #GstWorkStealingTaskPool object.
+ *
+ * Since: 1.2
+ */
+struct _GstWorkStealingTaskPool {
+  GstTaskPool    pool;
+
+  /*< private >*/
+  GstWorkStealingTaskPoolPrivate *priv;
+
+  gpointer _gst_reserved[GST_PADDING];
+};
+
+/**
+ * GstWorkStealingTaskPoolClass:
+ * @parent_class: the parent class structure
+ *
+ * The #GstWorkStealingTaskPoolClass object.
+ *
+ * Since: 1.2
+ */
+struct _GstWorkStealingTaskPoolClass {
+  GstTaskPoolClass parent_class;
+
+  /*< private >*/
+  gpointer _gst_reserved[GST_PADDING];
+};
+
+GType           gst_work_stealing_task_pool_get_type       (void);
+
+GstTaskPool *   gst_work_stealing_task_pool_new            (guint n_workers);
+
+gboolean        gst_work_stealing_task_pool_set_cpus       (GstWorkStealingTaskPool *pool,
+                                                            const guint *cpus, guint n_cpus);
+gboolean        gst_work_stealing_task_pool_set_numa_node  (GstWorkStealingTaskPool *pool,
+                                                            guint node);
+
 G_END_DECLS
 
 #endif /* __GST_TASK_POOL_H__ */
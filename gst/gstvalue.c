@@ -94,44 +94,43 @@ static void gst_value_register_intersect_func (GType type1,
 static void gst_value_register_subtract_func (GType minuend_type,
     GType subtrahend_type, GstValueSubtractFunc func);
 
-typedef struct _GstValueUnionInfo GstValueUnionInfo;
-struct _GstValueUnionInfo
+typedef struct
 {
-  GType type1;
-  GType type2;
   GstValueUnionFunc func;
-};
+  gboolean swap;
+} GstValueUnionDispatch;
 
-typedef struct _GstValueIntersectInfo GstValueIntersectInfo;
-struct _GstValueIntersectInfo
+typedef struct
 {
-  GType type1;
-  GType type2;
   GstValueIntersectFunc func;
-};
-
-typedef struct _GstValueSubtractInfo GstValueSubtractInfo;
-struct _GstValueSubtractInfo
-{
-  GType minuend;
-  GType subtrahend;
-  GstValueSubtractFunc func;
-};
+  gboolean swap;
+} GstValueIntersectDispatch;
 
 #define FUNDAMENTAL_TYPE_ID_MAX \
     (G_TYPE_FUNDAMENTAL_MAX >> G_TYPE_FUNDAMENTAL_SHIFT)
 #define FUNDAMENTAL_TYPE_ID(type) \
     ((type) >> G_TYPE_FUNDAMENTAL_SHIFT)
 
+/* the union, intersect and subtract functions are looked up in tables that
+ * are indexed with a compact id of the types they were registered for. All
+ * these types are fundamental types, other types have id 0 and no
+ * functions. */
+#define DISPATCH_ID_MAX 16
+
 #define VALUE_LIST_SIZE(v) (((GArray *) (v)->data[0].v_pointer)->len)
 #define VALUE_LIST_GET_VALUE(v, index) ((const GValue *) &g_array_index ((GArray *) (v)->data[0].v_pointer, GValue, (index)))
 
 static GArray *gst_value_table;
 static GHashTable *gst_value_hash;
 static GstValueTable *gst_value_tables_fundamental[FUNDAMENTAL_TYPE_ID_MAX + 1];
-static GArray *gst_value_union_funcs;
-static GArray *gst_value_intersect_funcs;
-static GArray *gst_value_subtract_funcs;
+static guint8 gst_value_dispatch_ids[FUNDAMENTAL_TYPE_ID_MAX + 1];
+static guint gst_value_n_dispatch_ids = 1;
+static GstValueUnionDispatch
+    gst_value_union_funcs[DISPATCH_ID_MAX][DISPATCH_ID_MAX];
+static GstValueIntersectDispatch
+    gst_value_intersect_funcs[DISPATCH_ID_MAX][DISPATCH_ID_MAX];
+static GstValueSubtractFunc
+    gst_value_subtract_funcs[DISPATCH_ID_MAX][DISPATCH_ID_MAX];
 
 /* Forward declarations */
 static gchar *gst_value_serialize_fraction (const GValue * value);
@@ -168,6 +167,34 @@ gst_value_hash_add_type (GType type, const GstValueTable * table)
   g_hash_table_insert (gst_value_hash, (gpointer) type, (gpointer) table);
 }
 
+static inline guint
+gst_value_dispatch_id (GType type)
+{
+  if (G_LIKELY (G_TYPE_IS_FUNDAMENTAL (type)))
+    return gst_value_dispatch_ids[FUNDAMENTAL_TYPE_ID (type)];
+
+  return 0;
+}
+
+/* get the dispatch id of @type, allocating one when needed. Returns 0 when
+ * no functions can be registered for @type */
+static guint
+gst_value_dispatch_id_register (GType type)
+{
+  guint id;
+
+  g_return_val_if_fail (G_TYPE_IS_FUNDAMENTAL (type), 0);
+
+  id = gst_value_dispatch_ids[FUNDAMENTAL_TYPE_ID (type)];
+  if (id == 0) {
+    g_return_val_if_fail (gst_value_n_dispatch_ids < DISPATCH_ID_MAX, 0);
+
+    id = gst_value_n_dispatch_ids++;
+    gst_value_dispatch_ids[FUNDAMENTAL_TYPE_ID (type)] = id;
+  }
+  return id;
+}
+
 /********
  * list *
  ********/
@@ -4535,25 +4562,15 @@ gst_value_compare_with_func (const GValue * value1, const GValue * value2,
 gboolean
 gst_value_can_union (const GValue * value1, const GValue * value2)
 {
-  GstValueUnionInfo *union_info;
-  guint i, len;
+  guint id1, id2;
 
   g_return_val_if_fail (G_IS_VALUE (value1), FALSE);
   g_return_val_if_fail (G_IS_VALUE (value2), FALSE);
 
-  len = gst_value_union_funcs->len;
+  id1 = gst_value_dispatch_id (G_VALUE_TYPE (value1));
+  id2 = gst_value_dispatch_id (G_VALUE_TYPE (value2));
 
-  for (i = 0; i < len; i++) {
-    union_info = &g_array_index (gst_value_union_funcs, GstValueUnionInfo, i);
-    if (union_info->type1 == G_VALUE_TYPE (value1) &&
-        union_info->type2 == G_VALUE_TYPE (value2))
-      return TRUE;
-    if (union_info->type1 == G_VALUE_TYPE (value2) &&
-        union_info->type2 == G_VALUE_TYPE (value1))
-      return TRUE;
-  }
-
-  return FALSE;
+  return gst_value_union_funcs[id1][id2].func != NULL;
 }
 
 /**
@@ -4569,9 +4586,7 @@ gst_value_can_union (const GValue * value1, const GValue * value2)
 gboolean
 gst_value_union (GValue * dest, const GValue * value1, const GValue * value2)
 {
-  const GstValueUnionInfo *union_info;
-  guint i, len;
-  GType type1, type2;
+  const GstValueUnionDispatch *union_info;
 
   g_return_val_if_fail (dest != NULL, FALSE);
   g_return_val_if_fail (G_IS_VALUE (value1), FALSE);
@@ -4579,18 +4594,13 @@ gst_value_union (GValue * dest, const GValue * value1, const GValue * value2)
   g_return_val_if_fail (gst_value_list_or_array_are_compatible (value1, value2),
       FALSE);
 
-  len = gst_value_union_funcs->len;
-  type1 = G_VALUE_TYPE (value1);
-  type2 = G_VALUE_TYPE (value2);
-
-  for (i = 0; i < len; i++) {
-    union_info = &g_array_index (gst_value_union_funcs, GstValueUnionInfo, i);
-    if (union_info->type1 == type1 && union_info->type2 == type2) {
-      return union_info->func (dest, value1, value2);
-    }
-    if (union_info->type1 == type2 && union_info->type2 == type1) {
+  union_info =
+      &gst_value_union_funcs[gst_value_dispatch_id (G_VALUE_TYPE (value1))]
+      [gst_value_dispatch_id (G_VALUE_TYPE (value2))];
+  if (union_info->func) {
+    if (union_info->swap)
       return union_info->func (dest, value2, value1);
-    }
+    return union_info->func (dest, value1, value2);
   }
 
   gst_value_list_concat (dest, value1, value2);
@@ -4612,13 +4622,25 @@ gst_value_union (GValue * dest, const GValue * value1, const GValue * value2)
 static void
 gst_value_register_union_func (GType type1, GType type2, GstValueUnionFunc func)
 {
-  GstValueUnionInfo union_info;
+  GstValueUnionDispatch *union_info;
+  guint id1, id2;
 
-  union_info.type1 = type1;
-  union_info.type2 = type2;
-  union_info.func = func;
+  if (!(id1 = gst_value_dispatch_id_register (type1)) ||
+      !(id2 = gst_value_dispatch_id_register (type2)))
+    return;
 
-  g_array_append_val (gst_value_union_funcs, union_info);
+  /* the first registered function wins, like in a lookup in registration
+   * order */
+  union_info = &gst_value_union_funcs[id1][id2];
+  if (union_info->func == NULL) {
+    union_info->func = func;
+    union_info->swap = FALSE;
+  }
+  union_info = &gst_value_union_funcs[id2][id1];
+  if (union_info->func == NULL) {
+    union_info->func = func;
+    union_info->swap = TRUE;
+  }
 }
 
 /* intersection */
@@ -4638,8 +4660,6 @@ gst_value_register_union_func (GType type1, GType type2, GstValueUnionFunc func)
 gboolean
 gst_value_can_intersect (const GValue * value1, const GValue * value2)
 {
-  GstValueIntersectInfo *intersect_info;
-  guint i, len;
   GType ltype, type1, type2;
 
   g_return_val_if_fail (G_IS_VALUE (value1), FALSE);
@@ -4660,14 +4680,9 @@ gst_value_can_intersect (const GValue * value1, const GValue * value2)
     return TRUE;
 
   /* check registered intersect functions */
-  len = gst_value_intersect_funcs->len;
-  for (i = 0; i < len; i++) {
-    intersect_info = &g_array_index (gst_value_intersect_funcs,
-        GstValueIntersectInfo, i);
-    if ((intersect_info->type1 == type1 && intersect_info->type2 == type2) ||
-        (intersect_info->type1 == type2 && intersect_info->type2 == type1))
-      return TRUE;
-  }
+  if (gst_value_intersect_funcs[gst_value_dispatch_id (type1)]
+      [gst_value_dispatch_id (type2)].func)
+    return TRUE;
 
   return gst_value_can_compare (value1, value2);
 }
@@ -4690,9 +4705,8 @@ gboolean
 gst_value_intersect (GValue * dest, const GValue * value1,
     const GValue * value2)
 {
-  GstValueIntersectInfo *intersect_info;
-  guint i, len;
-  GType ltype, type1, type2;
+  const GstValueIntersectDispatch *intersect_info;
+  GType ltype;
 
   g_return_val_if_fail (G_IS_VALUE (value1), FALSE);
   g_return_val_if_fail (G_IS_VALUE (value2), FALSE);
@@ -4711,19 +4725,13 @@ gst_value_intersect (GValue * dest, const GValue * value1,
     return TRUE;
   }
 
-  type1 = G_VALUE_TYPE (value1);
-  type2 = G_VALUE_TYPE (value2);
-
-  len = gst_value_intersect_funcs->len;
-  for (i = 0; i < len; i++) {
-    intersect_info = &g_array_index (gst_value_intersect_funcs,
-        GstValueIntersectInfo, i);
-    if (intersect_info->type1 == type1 && intersect_info->type2 == type2) {
-      return intersect_info->func (dest, value1, value2);
-    }
-    if (intersect_info->type1 == type2 && intersect_info->type2 == type1) {
+  intersect_info =
+      &gst_value_intersect_funcs[gst_value_dispatch_id (G_VALUE_TYPE (value1))]
+      [gst_value_dispatch_id (G_VALUE_TYPE (value2))];
+  if (intersect_info->func) {
+    if (intersect_info->swap)
       return intersect_info->func (dest, value2, value1);
-    }
+    return intersect_info->func (dest, value1, value2);
   }
   return FALSE;
 }
@@ -4747,13 +4755,25 @@ static void
 gst_value_register_intersect_func (GType type1, GType type2,
     GstValueIntersectFunc func)
 {
-  GstValueIntersectInfo intersect_info;
+  GstValueIntersectDispatch *intersect_info;
+  guint id1, id2;
 
-  intersect_info.type1 = type1;
-  intersect_info.type2 = type2;
-  intersect_info.func = func;
+  if (!(id1 = gst_value_dispatch_id_register (type1)) ||
+      !(id2 = gst_value_dispatch_id_register (type2)))
+    return;
 
-  g_array_append_val (gst_value_intersect_funcs, intersect_info);
+  /* the first registered function wins, like in a lookup in registration
+   * order */
+  intersect_info = &gst_value_intersect_funcs[id1][id2];
+  if (intersect_info->func == NULL) {
+    intersect_info->func = func;
+    intersect_info->swap = FALSE;
+  }
+  intersect_info = &gst_value_intersect_funcs[id2][id1];
+  if (intersect_info->func == NULL) {
+    intersect_info->func = func;
+    intersect_info->swap = TRUE;
+  }
 }
 
 
@@ -4776,9 +4796,8 @@ gboolean
 gst_value_subtract (GValue * dest, const GValue * minuend,
     const GValue * subtrahend)
 {
-  GstValueSubtractInfo *info;
-  guint i, len;
-  GType ltype, mtype, stype;
+  GstValueSubtractFunc func;
+  GType ltype;
 
   g_return_val_if_fail (G_IS_VALUE (minuend), FALSE);
   g_return_val_if_fail (G_IS_VALUE (subtrahend), FALSE);
@@ -4791,16 +4810,11 @@ gst_value_subtract (GValue * dest, const GValue * minuend,
   if (G_VALUE_HOLDS (subtrahend, ltype))
     return gst_value_subtract_list (dest, minuend, subtrahend);
 
-  mtype = G_VALUE_TYPE (minuend);
-  stype = G_VALUE_TYPE (subtrahend);
-
-  len = gst_value_subtract_funcs->len;
-  for (i = 0; i < len; i++) {
-    info = &g_array_index (gst_value_subtract_funcs, GstValueSubtractInfo, i);
-    if (info->minuend == mtype && info->subtrahend == stype) {
-      return info->func (dest, minuend, subtrahend);
-    }
-  }
+  func =
+      gst_value_subtract_funcs[gst_value_dispatch_id (G_VALUE_TYPE (minuend))]
+      [gst_value_dispatch_id (G_VALUE_TYPE (subtrahend))];
+  if (func)
+    return func (dest, minuend, subtrahend);
 
   if (gst_value_compare (minuend, subtrahend) != GST_VALUE_EQUAL) {
     if (dest)
@@ -4837,9 +4851,7 @@ gst_value_subtract (GValue * dest, const GValue * minuend,
 gboolean
 gst_value_can_subtract (const GValue * minuend, const GValue * subtrahend)
 {
-  GstValueSubtractInfo *info;
-  guint i, len;
-  GType ltype, mtype, stype;
+  GType ltype;
 
   g_return_val_if_fail (G_IS_VALUE (minuend), FALSE);
   g_return_val_if_fail (G_IS_VALUE (subtrahend), FALSE);
@@ -4850,15 +4862,9 @@ gst_value_can_subtract (const GValue * minuend, const GValue * subtrahend)
   if (G_VALUE_HOLDS (minuend, ltype) || G_VALUE_HOLDS (subtrahend, ltype))
     return TRUE;
 
-  mtype = G_VALUE_TYPE (minuend);
-  stype = G_VALUE_TYPE (subtrahend);
-
-  len = gst_value_subtract_funcs->len;
-  for (i = 0; i < len; i++) {
-    info = &g_array_index (gst_value_subtract_funcs, GstValueSubtractInfo, i);
-    if (info->minuend == mtype && info->subtrahend == stype)
-      return TRUE;
-  }
+  if (gst_value_subtract_funcs[gst_value_dispatch_id (G_VALUE_TYPE (minuend))]
+      [gst_value_dispatch_id (G_VALUE_TYPE (subtrahend))])
+    return TRUE;
 
   return gst_value_can_compare (minuend, subtrahend);
 }
@@ -4879,16 +4885,17 @@ static void
 gst_value_register_subtract_func (GType minuend_type, GType subtrahend_type,
     GstValueSubtractFunc func)
 {
-  GstValueSubtractInfo info;
+  guint id1, id2;
 
   g_return_if_fail (!gst_type_is_fixed (minuend_type)
       || !gst_type_is_fixed (subtrahend_type));
 
-  info.minuend = minuend_type;
-  info.subtrahend = subtrahend_type;
-  info.func = func;
+  if (!(id1 = gst_value_dispatch_id_register (minuend_type)) ||
+      !(id2 = gst_value_dispatch_id_register (subtrahend_type)))
+    return;
 
-  g_array_append_val (gst_value_subtract_funcs, info);
+  if (gst_value_subtract_funcs[id1][id2] == NULL)
+    gst_value_subtract_funcs[id1][id2] = func;
 }
 
 /**
@@ -5970,12 +5977,6 @@ _priv_gst_value_initialize (void)
 {
   gst_value_table = g_array_new (FALSE, FALSE, sizeof (GstValueTable));
   gst_value_hash = g_hash_table_new (NULL, NULL);
-  gst_value_union_funcs = g_array_new (FALSE, FALSE,
-      sizeof (GstValueUnionInfo));
-  gst_value_intersect_funcs = g_array_new (FALSE, FALSE,
-      sizeof (GstValueIntersectInfo));
-  gst_value_subtract_funcs = g_array_new (FALSE, FALSE,
-      sizeof (GstValueSubtractInfo));
 
   {
     static GstValueTable gst_value = {
@@ -37,6 +37,8 @@
 #include "gstfunnel.h"
 #include "gstidentity.h"
 #include "gstinputselector.h"
+#include "gstmemfdsink.h"
+#include "gstmemfdsrc.h"
 #include "gstoutputselector.h"
 #include "gstmultiqueue.h"
 #include "gstqueue.h"
@@ -77,6 +79,14 @@ plugin_init (GstPlugin * plugin)
   if (!gst_element_register (plugin, "input-selector", GST_RANK_NONE,
           gst_input_selector_get_type ()))
     return FALSE;
+#if defined(HAVE_SYS_SOCKET_H) && !defined(G_OS_WIN32)
+  if (!gst_element_register (plugin, "memfdsink", GST_RANK_NONE,
+          gst_memfd_sink_get_type ()))
+    return FALSE;
+  if (!gst_element_register (plugin, "memfdsrc", GST_RANK_NONE,
+          gst_memfd_src_get_type ()))
+    return FALSE;
+#endif
   if (!gst_element_register (plugin, "output-selector", GST_RANK_NONE,
           gst_output_selector_get_type ()))
     return FALSE;
@@ -0,0 +1,444 @@
+/* GStreamer
+ *
+ * gstmemfdsink.c:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:element-memfdsink
+ * @see_also: #GstMemfdSrc, #GstFdSink
+ *
+ * Pass buffers to another process over a connected unix socket without
+ * copying the data. Instead of the data, memfdsink sends the file descriptor
+ * of the memory (see gst_memory_get_fd()) with a small header that contains
+ * the offset, size and timestamps of the buffer. A #GstMemfdSrc in the other
+ * process maps the same memory.
+ *
+ * memfdsink proposes the #GST_ALLOCATOR_MEMFD allocator to upstream, buffers
+ * with other memory are copied into fd backed memory first.
+ *
+ * The memory is shared and not copied. memfdsink keeps a ref to each buffer
+ * it sent until the receiver sends a release message for it back over the
+ * same socket, so a buffer pool upstream can't reuse the memory while the
+ * receiver is still reading it. Upstream must still not write into buffers
+ * that it keeps a ref to after pushing them. Use a SOCK_SEQPACKET socket to
+ * keep the boundaries of the messages.
+ *
+ * <refsect2>
+ * <title>Example code</title>
+ * |[
+ * socketpair (AF_UNIX, SOCK_SEQPACKET, 0, fds);
+ * g_object_set (memfdsink, "fd", fds[0], NULL);
+ * // pass fds[1] to the process with the memfdsrc
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <sys/types.h>
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#include <errno.h>
+#include <string.h>
+
+#include "gstmemfdsink.h"
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+GST_DEBUG_CATEGORY_STATIC (gst_memfd_sink_debug);
+#define GST_CAT_DEFAULT gst_memfd_sink_debug
+
+#define _do_init \
+  GST_DEBUG_CATEGORY_INIT (gst_memfd_sink_debug, "memfdsink", 0, "memfdsink element");
+#define gst_memfd_sink_parent_class parent_class
+G_DEFINE_TYPE_WITH_CODE (GstMemfdSink, gst_memfd_sink, GST_TYPE_FD_SINK,
+    _do_init);
+
+static void gst_memfd_sink_finalize (GObject * obj);
+
+static gboolean gst_memfd_sink_start (GstBaseSink * sink);
+static gboolean gst_memfd_sink_stop (GstBaseSink * sink);
+
+static gboolean gst_memfd_sink_propose_allocation (GstBaseSink * sink,
+    GstQuery * query);
+static GstFlowReturn gst_memfd_sink_render (GstBaseSink * sink,
+    GstBuffer * buffer);
+
+static void
+gst_memfd_sink_class_init (GstMemfdSinkClass * klass)
+{
+  GObjectClass *gobject_class;
+  GstElementClass *gstelement_class;
+  GstBaseSinkClass *gstbasesink_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gstelement_class = GST_ELEMENT_CLASS (klass);
+  gstbasesink_class = GST_BASE_SINK_CLASS (klass);
+
+  gobject_class->finalize = gst_memfd_sink_finalize;
+
+  gst_element_class_set_static_metadata (gstelement_class,
+      "Memory file descriptor Sink",
+      "Sink",
+      "Pass the memory of buffers to another process over a unix socket",
+      "Wim Taymans <wim.taymans@gmail.com>");
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&sinktemplate));
+
+  gstbasesink_class->start = GST_DEBUG_FUNCPTR (gst_memfd_sink_start);
+  gstbasesink_class->stop = GST_DEBUG_FUNCPTR (gst_memfd_sink_stop);
+  gstbasesink_class->propose_allocation =
+      GST_DEBUG_FUNCPTR (gst_memfd_sink_propose_allocation);
+  gstbasesink_class->render = GST_DEBUG_FUNCPTR (gst_memfd_sink_render);
+}
+
+static void
+gst_memfd_sink_init (GstMemfdSink * memfdsink)
+{
+  memfdsink->allocator = gst_allocator_find (GST_ALLOCATOR_MEMFD);
+
+  g_mutex_init (&memfdsink->lock);
+  memfdsink->pending = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) gst_buffer_unref);
+  memfdsink->release_fd = -1;
+}
+
+static void
+gst_memfd_sink_finalize (GObject * obj)
+{
+  GstMemfdSink *memfdsink = GST_MEMFD_SINK (obj);
+
+  if (memfdsink->allocator)
+    gst_object_unref (memfdsink->allocator);
+
+  g_hash_table_unref (memfdsink->pending);
+  g_mutex_clear (&memfdsink->lock);
+
+  G_OBJECT_CLASS (parent_class)->finalize (obj);
+}
+
+static gboolean
+gst_memfd_sink_propose_allocation (GstBaseSink * sink, GstQuery * query)
+{
+  GstMemfdSink *memfdsink = GST_MEMFD_SINK (sink);
+
+  if (memfdsink->allocator)
+    gst_query_add_allocation_param (query, memfdsink->allocator, NULL);
+
+  return TRUE;
+}
+
+#ifdef HAVE_SYS_SOCKET_H
+/* read the release messages of the receiver and drop our ref to the buffers
+ * it no longer uses */
+static gpointer
+gst_memfd_sink_release_func (GstMemfdSink * memfdsink)
+{
+  GstMemfdRelease release;
+  gssize received;
+
+  while (TRUE) {
+    if (gst_poll_wait (memfdsink->release_set, GST_CLOCK_TIME_NONE) < 0) {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+      /* EBUSY when stopping */
+      break;
+    }
+
+    received = recv (memfdsink->release_fd, &release, sizeof (release),
+        MSG_DONTWAIT);
+    if (received < 0) {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+      GST_WARNING_OBJECT (memfdsink, "failed to read release message: %s",
+          g_strerror (errno));
+      break;
+    }
+    if (received == 0) {
+      GST_DEBUG_OBJECT (memfdsink, "receiver closed the socket");
+      break;
+    }
+    if (received != sizeof (release)) {
+      GST_WARNING_OBJECT (memfdsink, "invalid release message of %"
+          G_GSSIZE_FORMAT " bytes", received);
+      continue;
+    }
+
+    GST_LOG_OBJECT (memfdsink, "released packet %u", release.id);
+
+    g_mutex_lock (&memfdsink->lock);
+    if (!g_hash_table_remove (memfdsink->pending,
+            GUINT_TO_POINTER (release.id)))
+      GST_WARNING_OBJECT (memfdsink, "release of unknown packet %u",
+          release.id);
+    g_mutex_unlock (&memfdsink->lock);
+  }
+  return NULL;
+}
+#endif
+
+static gboolean
+gst_memfd_sink_start (GstBaseSink * sink)
+{
+#ifdef HAVE_SYS_SOCKET_H
+  GstMemfdSink *memfdsink = GST_MEMFD_SINK (sink);
+  GstPollFD pfd = GST_POLL_FD_INIT;
+#endif
+
+  if (!GST_BASE_SINK_CLASS (parent_class)->start (sink))
+    return FALSE;
+
+#ifdef HAVE_SYS_SOCKET_H
+  if ((memfdsink->release_set = gst_poll_new (TRUE)) == NULL)
+    goto no_poll;
+
+  memfdsink->release_fd = pfd.fd = GST_FD_SINK (sink)->fd;
+  gst_poll_add_fd (memfdsink->release_set, &pfd);
+  gst_poll_fd_ctl_read (memfdsink->release_set, &pfd, TRUE);
+
+  memfdsink->release_thread = g_thread_try_new ("memfdsink-release",
+      (GThreadFunc) gst_memfd_sink_release_func, memfdsink, NULL);
+  if (memfdsink->release_thread == NULL)
+    goto no_thread;
+#endif
+
+  return TRUE;
+
+  /* ERRORS */
+#ifdef HAVE_SYS_SOCKET_H
+no_poll:
+  {
+    GST_ELEMENT_ERROR (memfdsink, RESOURCE, OPEN_READ_WRITE, (NULL),
+        GST_ERROR_SYSTEM);
+    GST_BASE_SINK_CLASS (parent_class)->stop (sink);
+    return FALSE;
+  }
+no_thread:
+  {
+    GST_ELEMENT_ERROR (memfdsink, RESOURCE, FAILED, (NULL),
+        ("Could not start the thread for the release messages"));
+    gst_poll_free (memfdsink->release_set);
+    memfdsink->release_set = NULL;
+    GST_BASE_SINK_CLASS (parent_class)->stop (sink);
+    return FALSE;
+  }
+#endif
+}
+
+static gboolean
+gst_memfd_sink_stop (GstBaseSink * sink)
+{
+  GstMemfdSink *memfdsink = GST_MEMFD_SINK (sink);
+
+  if (memfdsink->release_thread) {
+    gst_poll_set_flushing (memfdsink->release_set, TRUE);
+    g_thread_join (memfdsink->release_thread);
+    memfdsink->release_thread = NULL;
+  }
+  if (memfdsink->release_set) {
+    gst_poll_free (memfdsink->release_set);
+    memfdsink->release_set = NULL;
+  }
+  memfdsink->release_fd = -1;
+
+  /* the stream is over, the receiver can't expect the memory to stay */
+  g_mutex_lock (&memfdsink->lock);
+  g_hash_table_remove_all (memfdsink->pending);
+  g_mutex_unlock (&memfdsink->lock);
+
+  return GST_BASE_SINK_CLASS (parent_class)->stop (sink);
+}
+
+/* get a buffer with a single fd memory with the contents of buffer, we keep
+ * it until the receiver released it */
+static GstBuffer *
+gst_memfd_sink_get_fd_buffer (GstMemfdSink * memfdsink, GstBuffer * buffer)
+{
+  GstBuffer *outbuf;
+  GstMemory *mem;
+  GstMapInfo info;
+  gsize size;
+
+  /* keep the buffer itself so that it does not go back to its pool */
+  if (gst_buffer_n_memory (buffer) == 1) {
+    mem = gst_buffer_peek_memory (buffer, 0);
+    if (gst_memory_get_fd (mem, NULL) >= 0)
+      return gst_buffer_ref (buffer);
+  }
+
+  if (memfdsink->allocator == NULL)
+    return NULL;
+
+  size = gst_buffer_get_size (buffer);
+
+  GST_CAT_DEBUG_OBJECT (GST_CAT_PERFORMANCE, memfdsink,
+      "copy %" G_GSIZE_FORMAT " bytes into fd memory", size);
+
+  mem = gst_allocator_alloc (memfdsink->allocator, size, NULL);
+  if (mem == NULL)
+    return NULL;
+
+  gst_memory_map (mem, &info, GST_MAP_WRITE);
+  gst_buffer_extract (buffer, 0, info.data, size);
+  gst_memory_unmap (mem, &info);
+
+  outbuf = gst_buffer_new ();
+  gst_buffer_append_memory (outbuf, mem);
+
+  return outbuf;
+}
+
+#ifdef HAVE_SYS_SOCKET_H
+/* forget a buffer that could not be sent */
+static void
+gst_memfd_sink_drop_pending (GstMemfdSink * memfdsink, guint32 id)
+{
+  g_mutex_lock (&memfdsink->lock);
+  g_hash_table_remove (memfdsink->pending, GUINT_TO_POINTER (id));
+  g_mutex_unlock (&memfdsink->lock);
+}
+#endif
+
+static GstFlowReturn
+gst_memfd_sink_render (GstBaseSink * sink, GstBuffer * buffer)
+{
+#ifdef HAVE_SYS_SOCKET_H
+  GstMemfdSink *memfdsink;
+  GstFdSink *fdsink;
+  GstBuffer *fdbuf;
+  GstMemory *mem;
+  GstMemfdPacket packet;
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  gchar control[CMSG_SPACE (sizeof (gint))];
+  gsize offset, size;
+  gint fd, retval;
+  gssize sent;
+
+  memfdsink = GST_MEMFD_SINK (sink);
+  fdsink = GST_FD_SINK (sink);
+
+  fdbuf = gst_memfd_sink_get_fd_buffer (memfdsink, buffer);
+  if (fdbuf == NULL)
+    goto no_memory;
+
+  mem = gst_buffer_peek_memory (fdbuf, 0);
+  fd = gst_memory_get_fd (mem, &offset);
+  size = gst_memory_get_sizes (mem, NULL, NULL);
+
+  memset (&packet, 0, sizeof (packet));
+  packet.maxsize = offset + size;
+  packet.offset = offset;
+  packet.size = size;
+  packet.pts = GST_BUFFER_PTS (buffer);
+  packet.dts = GST_BUFFER_DTS (buffer);
+  packet.duration = GST_BUFFER_DURATION (buffer);
+  packet.flags = GST_BUFFER_FLAGS (buffer);
+
+  /* keep the buffer until it is released, before sending so that the release
+   * can't come before we stored it */
+  g_mutex_lock (&memfdsink->lock);
+  packet.id = memfdsink->next_id++;
+  g_hash_table_insert (memfdsink->pending, GUINT_TO_POINTER (packet.id),
+      fdbuf);
+  g_mutex_unlock (&memfdsink->lock);
+
+  iov.iov_base = &packet;
+  iov.iov_len = sizeof (packet);
+
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof (control);
+
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (gint));
+  memcpy (CMSG_DATA (cmsg), &fd, sizeof (gint));
+
+again:
+  do {
+    GST_DEBUG_OBJECT (memfdsink, "going into select");
+    retval = gst_poll_wait (fdsink->fdset, GST_CLOCK_TIME_NONE);
+  } while (retval == -1 && (errno == EINTR || errno == EAGAIN));
+
+  if (retval == -1) {
+    if (errno == EBUSY)
+      goto stopped;
+    else
+      goto select_error;
+  }
+
+  GST_DEBUG_OBJECT (memfdsink, "sending fd %d, offset %" G_GSIZE_FORMAT
+      ", size %" G_GSIZE_FORMAT " to %d", fd, offset, size, fdsink->fd);
+
+  sent = sendmsg (fdsink->fd, &msg, 0);
+  if (G_UNLIKELY (sent < 0)) {
+    if (errno == EAGAIN || errno == EINTR)
+      goto again;
+    goto write_error;
+  }
+
+  fdsink->bytes_written += size;
+  fdsink->current_pos += size;
+
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+no_memory:
+  {
+    GST_ELEMENT_ERROR (memfdsink, RESOURCE, NO_SPACE_LEFT, (NULL),
+        ("Could not allocate memory with a file descriptor"));
+    return GST_FLOW_ERROR;
+  }
+select_error:
+  {
+    GST_ELEMENT_ERROR (memfdsink, RESOURCE, READ, (NULL),
+        ("select on file descriptor: %s.", g_strerror (errno)));
+    gst_memfd_sink_drop_pending (memfdsink, packet.id);
+    return GST_FLOW_ERROR;
+  }
+stopped:
+  {
+    GST_DEBUG_OBJECT (memfdsink, "Select stopped");
+    gst_memfd_sink_drop_pending (memfdsink, packet.id);
+    return GST_FLOW_FLUSHING;
+  }
+write_error:
+  {
+    GST_ELEMENT_ERROR (memfdsink, RESOURCE, WRITE, (NULL),
+        ("Error while sending to file descriptor %d: %s",
+            fdsink->fd, g_strerror (errno)));
+    gst_memfd_sink_drop_pending (memfdsink, packet.id);
+    return GST_FLOW_ERROR;
+  }
+#else
+  GST_ELEMENT_ERROR (sink, RESOURCE, WRITE, (NULL),
+      ("Passing file descriptors is not supported on this platform"));
+  return GST_FLOW_ERROR;
+#endif
+}
@@ -0,0 +1,96 @@
+/* GStreamer
+ *
+ * gstmemfdsink.h:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __GST_MEMFD_SINK_H__
+#define __GST_MEMFD_SINK_H__
+
+#include <gst/gst.h>
+#include "gstfdsink.h"
+
+G_BEGIN_DECLS
+
+
+#define GST_TYPE_MEMFD_SINK \
+  (gst_memfd_sink_get_type())
+#define GST_MEMFD_SINK(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_MEMFD_SINK,GstMemfdSink))
+#define GST_MEMFD_SINK_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_MEMFD_SINK,GstMemfdSinkClass))
+#define GST_IS_MEMFD_SINK(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_MEMFD_SINK))
+#define GST_IS_MEMFD_SINK_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_MEMFD_SINK))
+
+typedef struct _GstMemfdSink GstMemfdSink;
+typedef struct _GstMemfdSinkClass GstMemfdSinkClass;
+
+/* the message that memfdsink sends with each fd, memfdsrc expects the same
+ * layout, both ends have to run on the same machine anyway */
+typedef struct
+{
+  guint64 maxsize;
+  guint64 offset;
+  guint64 size;
+  guint64 pts;
+  guint64 dts;
+  guint64 duration;
+  guint32 flags;
+  guint32 id;
+} GstMemfdPacket;
+
+/* the message that memfdsrc sends back when it no longer uses the memory of
+ * the packet with @id */
+typedef struct
+{
+  guint32 id;
+} GstMemfdRelease;
+
+/**
+ * GstMemfdSink:
+ *
+ * The opaque #GstMemfdSink data structure.
+ */
+struct _GstMemfdSink {
+  GstFdSink parent;
+
+  /*< private >*/
+  GstAllocator *allocator;
+
+  /* buffers that were sent and not released yet, by id */
+  GMutex lock;
+  GHashTable *pending;
+  guint32 next_id;
+
+  /* reads the release messages */
+  GThread *release_thread;
+  GstPoll *release_set;
+  gint release_fd;
+};
+
+struct _GstMemfdSinkClass {
+  GstFdSinkClass parent_class;
+};
+
+G_GNUC_INTERNAL GType gst_memfd_sink_get_type (void);
+
+G_END_DECLS
+
+#endif /* __GST_MEMFD_SINK_H__ */
@@ -0,0 +1,425 @@
+/* GStreamer
+ *
+ * gstmemfdsrc.c:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:element-memfdsrc
+ * @see_also: #GstMemfdSink, #GstFdSrc
+ *
+ * Receive buffers from a #GstMemfdSink in another process over a connected
+ * unix socket. Each buffer wraps the file descriptor that was passed with
+ * gst_memory_new_fd() so that the data is not copied. The buffers are
+ * read-only because the memory is shared with the sending process.
+ *
+ * When the memory of a buffer is freed, memfdsrc sends a release message
+ * back to the #GstMemfdSink over the same socket, so that the sender can
+ * reuse the memory.
+ *
+ * The #GstFdSrc:fd property is the socket to receive from, the
+ * #GstFdSrc:timeout property works as in #GstFdSrc.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <errno.h>
+#include <string.h>
+
+#include "gstmemfdsrc.h"
+#include "gstmemfdsink.h"
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+GST_DEBUG_CATEGORY_STATIC (gst_memfd_src_debug);
+#define GST_CAT_DEFAULT gst_memfd_src_debug
+
+#define _do_init \
+  GST_DEBUG_CATEGORY_INIT (gst_memfd_src_debug, "memfdsrc", 0, "memfdsrc element");
+#define gst_memfd_src_parent_class parent_class
+G_DEFINE_TYPE_WITH_CODE (GstMemfdSrc, gst_memfd_src, GST_TYPE_FD_SRC,
+    _do_init);
+
+static gboolean gst_memfd_src_start (GstBaseSrc * bsrc);
+static gboolean gst_memfd_src_stop (GstBaseSrc * bsrc);
+static GstFlowReturn gst_memfd_src_create (GstPushSrc * psrc,
+    GstBuffer ** outbuf);
+
+/* the socket for the release messages, refcounted because the memory of the
+ * buffers can be freed after the element was stopped */
+typedef struct
+{
+  volatile gint refcount;
+  gint fd;
+} GstMemfdChannel;
+
+/* the memory of a received packet */
+typedef struct
+{
+  GstMemfdChannel *channel;
+  guint32 id;
+} GstMemfdRef;
+
+static GstMemfdChannel *
+gst_memfd_channel_new (gint fd)
+{
+  GstMemfdChannel *channel;
+
+  channel = g_slice_new (GstMemfdChannel);
+  channel->refcount = 1;
+  channel->fd = fd;
+
+  return channel;
+}
+
+static void
+gst_memfd_channel_unref (GstMemfdChannel * channel)
+{
+  if (g_atomic_int_dec_and_test (&channel->refcount)) {
+    close (channel->fd);
+    g_slice_free (GstMemfdChannel, channel);
+  }
+}
+
+#ifdef HAVE_SYS_SOCKET_H
+static GstMemfdChannel *
+gst_memfd_channel_ref (GstMemfdChannel * channel)
+{
+  g_atomic_int_inc (&channel->refcount);
+
+  return channel;
+}
+
+/* called when the memory of a packet is freed */
+static void
+gst_memfd_src_release (GstMemfdRef * ref, GstMiniObject * obj)
+{
+  GstMemfdRelease release;
+  gint flags = MSG_DONTWAIT;
+
+#ifdef MSG_NOSIGNAL
+  flags |= MSG_NOSIGNAL;
+#endif
+
+  release.id = ref->id;
+  if (send (ref->channel->fd, &release, sizeof (release), flags) < 0)
+    GST_DEBUG ("could not release packet %u: %s", ref->id,
+        g_strerror (errno));
+
+  gst_memfd_channel_unref (ref->channel);
+  g_slice_free (GstMemfdRef, ref);
+}
+#endif
+
+static void
+gst_memfd_src_class_init (GstMemfdSrcClass * klass)
+{
+  GstElementClass *gstelement_class;
+  GstBaseSrcClass *gstbasesrc_class;
+  GstPushSrcClass *gstpush_src_class;
+
+  gstelement_class = GST_ELEMENT_CLASS (klass);
+  gstbasesrc_class = GST_BASE_SRC_CLASS (klass);
+  gstpush_src_class = GST_PUSH_SRC_CLASS (klass);
+
+  gst_element_class_set_static_metadata (gstelement_class,
+      "Memory file descriptor Source",
+      "Source",
+      "Receive the memory of buffers from another process over a unix socket",
+      "Wim Taymans <wim.taymans@gmail.com>");
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&srctemplate));
+
+  gstbasesrc_class->start = GST_DEBUG_FUNCPTR (gst_memfd_src_start);
+  gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_memfd_src_stop);
+
+  gstpush_src_class->create = GST_DEBUG_FUNCPTR (gst_memfd_src_create);
+}
+
+static void
+gst_memfd_src_init (GstMemfdSrc * memfdsrc)
+{
+  /* the timestamps come from the sender */
+  gst_base_src_set_format (GST_BASE_SRC (memfdsrc), GST_FORMAT_TIME);
+}
+
+static gboolean
+gst_memfd_src_start (GstBaseSrc * bsrc)
+{
+  GstMemfdSrc *memfdsrc = GST_MEMFD_SRC (bsrc);
+  gint fd;
+
+  if (!GST_BASE_SRC_CLASS (parent_class)->start (bsrc))
+    return FALSE;
+
+  /* our own fd for the release messages, the application can close the
+   * socket while buffers are still in use */
+  if ((fd = dup (GST_FD_SRC (bsrc)->fd)) < 0)
+    goto dup_failed;
+
+  memfdsrc->channel = gst_memfd_channel_new (fd);
+
+  return TRUE;
+
+  /* ERRORS */
+dup_failed:
+  {
+    GST_ELEMENT_ERROR (memfdsrc, RESOURCE, OPEN_READ_WRITE, (NULL),
+        GST_ERROR_SYSTEM);
+    GST_BASE_SRC_CLASS (parent_class)->stop (bsrc);
+    return FALSE;
+  }
+}
+
+static gboolean
+gst_memfd_src_stop (GstBaseSrc * bsrc)
+{
+  GstMemfdSrc *memfdsrc = GST_MEMFD_SRC (bsrc);
+
+  if (memfdsrc->channel) {
+    gst_memfd_channel_unref (memfdsrc->channel);
+    memfdsrc->channel = NULL;
+  }
+
+  return GST_BASE_SRC_CLASS (parent_class)->stop (bsrc);
+}
+
+#ifdef HAVE_SYS_SOCKET_H
+/* take the first fd of the SCM_RIGHTS data of @msg and close all others,
+ * returns -1 when there is none */
+static gint
+gst_memfd_src_take_fd (struct msghdr *msg)
+{
+  struct cmsghdr *cmsg;
+  gint fd = -1, tmp;
+  guint i, n;
+
+  for (cmsg = CMSG_FIRSTHDR (msg); cmsg; cmsg = CMSG_NXTHDR (msg, cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+      continue;
+
+    n = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (gint);
+    for (i = 0; i < n; i++) {
+      memcpy (&tmp, CMSG_DATA (cmsg) + i * sizeof (gint), sizeof (gint));
+      if (fd == -1)
+        fd = tmp;
+      else
+        close (tmp);
+    }
+  }
+  return fd;
+}
+#endif
+
+static GstFlowReturn
+gst_memfd_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
+{
+#ifdef HAVE_SYS_SOCKET_H
+  GstFdSrc *src;
+  GstBuffer *buf;
+  GstMemory *mem;
+  GstMemfdPacket packet;
+  GstMemfdRef *ref;
+  struct msghdr msg;
+  struct iovec iov;
+  gchar control[CMSG_SPACE (sizeof (gint))];
+  gint recv_flags = 0;
+  GstClockTime timeout;
+  gboolean try_again;
+  gssize received;
+  gint retval, fd;
+  struct stat st;
+
+  src = GST_FD_SRC (psrc);
+
+  if (src->timeout > 0) {
+    timeout = src->timeout * GST_USECOND;
+  } else {
+    timeout = GST_CLOCK_TIME_NONE;
+  }
+
+  do {
+    try_again = FALSE;
+
+    retval = gst_poll_wait (src->fdset, timeout);
+    GST_LOG_OBJECT (src, "poll returned %d", retval);
+
+    if (G_UNLIKELY (retval == -1)) {
+      if (errno == EINTR || errno == EAGAIN) {
+        try_again = TRUE;
+      } else if (errno == EBUSY) {
+        goto stopped;
+      } else {
+        goto poll_error;
+      }
+    } else if (G_UNLIKELY (retval == 0)) {
+      try_again = TRUE;
+      gst_element_post_message (GST_ELEMENT_CAST (src),
+          gst_message_new_element (GST_OBJECT_CAST (src),
+              gst_structure_new ("GstFdSrcTimeout",
+                  "timeout", G_TYPE_UINT64, src->timeout, NULL)));
+    }
+  } while (G_UNLIKELY (try_again));
+
+  iov.iov_base = &packet;
+  iov.iov_len = sizeof (packet);
+
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof (control);
+
+#ifdef MSG_CMSG_CLOEXEC
+  recv_flags |= MSG_CMSG_CLOEXEC;
+#endif
+
+  do {
+    received = recvmsg (src->fd, &msg, recv_flags);
+  } while (received == -1 && errno == EINTR);
+
+  if (received < 0)
+    goto read_error;
+  if (received == 0)
+    goto eos;
+
+  fd = gst_memfd_src_take_fd (&msg);
+
+  /* the kernel dropped the fds that did not fit, or part of the packet */
+  if (msg.msg_flags & (MSG_CTRUNC | MSG_TRUNC))
+    goto truncated;
+
+  if (fd < 0)
+    goto no_fd;
+
+  if (received != sizeof (packet) || packet.size > packet.maxsize ||
+      packet.offset > packet.maxsize - packet.size)
+    goto invalid_packet;
+
+  /* accessing the mapping past the end of the file raises SIGBUS */
+  if (fstat (fd, &st) < 0 || st.st_size < 0 ||
+      (guint64) st.st_size < packet.maxsize)
+    goto short_fd;
+
+  GST_LOG_OBJECT (src, "received fd %d, offset %" G_GUINT64_FORMAT
+      ", size %" G_GUINT64_FORMAT, fd, packet.offset, packet.size);
+
+  /* takes ownership of the fd */
+  mem = gst_memory_new_fd (GST_MEMORY_FLAG_READONLY, fd, packet.maxsize,
+      packet.offset, packet.size);
+  if (mem == NULL)
+    goto map_failed;
+
+  /* tell the sender when we no longer use the memory */
+  ref = g_slice_new (GstMemfdRef);
+  ref->channel = gst_memfd_channel_ref (GST_MEMFD_SRC (src)->channel);
+  ref->id = packet.id;
+  gst_mini_object_weak_ref (GST_MINI_OBJECT_CAST (mem),
+      (GstMiniObjectNotify) gst_memfd_src_release, ref);
+
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf, mem);
+
+  GST_BUFFER_PTS (buf) = packet.pts;
+  GST_BUFFER_DTS (buf) = packet.dts;
+  GST_BUFFER_DURATION (buf) = packet.duration;
+  GST_BUFFER_FLAGS (buf) = packet.flags;
+  GST_BUFFER_OFFSET (buf) = src->curoffset;
+  src->curoffset += packet.size;
+
+  *outbuf = buf;
+
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+poll_error:
+  {
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+        ("poll on file descriptor: %s.", g_strerror (errno)));
+    return GST_FLOW_ERROR;
+  }
+stopped:
+  {
+    GST_DEBUG_OBJECT (src, "Poll stopped");
+    return GST_FLOW_FLUSHING;
+  }
+read_error:
+  {
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+        ("recvmsg on file descriptor: %s.", g_strerror (errno)));
+    return GST_FLOW_ERROR;
+  }
+eos:
+  {
+    GST_DEBUG_OBJECT (src, "Read 0 bytes. EOS.");
+    return GST_FLOW_EOS;
+  }
+truncated:
+  {
+    GST_ELEMENT_ERROR (src, STREAM, DECODE, (NULL),
+        ("Received a truncated message"));
+    if (fd >= 0)
+      close (fd);
+    return GST_FLOW_ERROR;
+  }
+no_fd:
+  {
+    GST_ELEMENT_ERROR (src, STREAM, DECODE, (NULL),
+        ("Received a message without a file descriptor"));
+    return GST_FLOW_ERROR;
+  }
+invalid_packet:
+  {
+    GST_ELEMENT_ERROR (src, STREAM, DECODE, (NULL),
+        ("Received an invalid message of %" G_GSSIZE_FORMAT " bytes",
+            received));
+    close (fd);
+    return GST_FLOW_ERROR;
+  }
+short_fd:
+  {
+    GST_ELEMENT_ERROR (src, STREAM, DECODE, (NULL),
+        ("Received a file descriptor smaller than the %" G_GUINT64_FORMAT
+            " bytes of the message", packet.maxsize));
+    close (fd);
+    return GST_FLOW_ERROR;
+  }
+map_failed:
+  {
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+        ("Could not map received file descriptor"));
+    return GST_FLOW_ERROR;
+  }
+#else
+  GST_ELEMENT_ERROR (psrc, RESOURCE, READ, (NULL),
+      ("Passing file descriptors is not supported on this platform"));
+  return GST_FLOW_ERROR;
+#endif
+}
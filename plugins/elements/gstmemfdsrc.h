@@ -0,0 +1,68 @@
+/* GStreamer
+ *
+ * gstmemfdsrc.h:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __GST_MEMFD_SRC_H__
+#define __GST_MEMFD_SRC_H__
+
+#include <gst/gst.h>
+#include "gstfdsrc.h"
+
+G_BEGIN_DECLS
+
+
+#define GST_TYPE_MEMFD_SRC \
+  (gst_memfd_src_get_type())
+#define GST_MEMFD_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_MEMFD_SRC,GstMemfdSrc))
+#define GST_MEMFD_SRC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_MEMFD_SRC,GstMemfdSrcClass))
+#define GST_IS_MEMFD_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_MEMFD_SRC))
+#define GST_IS_MEMFD_SRC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_MEMFD_SRC))
+
+
+typedef struct _GstMemfdSrc GstMemfdSrc;
+typedef struct _GstMemfdSrcClass GstMemfdSrcClass;
+
+/**
+ * GstMemfdSrc:
+ *
+ * Opaque #GstMemfdSrc data structure.
+ */
+struct _GstMemfdSrc {
+  GstFdSrc parent;
+
+  /*< private >*/
+  /* where the release messages go, outlives the element when buffers are
+   * still in use */
+  gpointer channel;
+};
+
+struct _GstMemfdSrcClass {
+  GstFdSrcClass parent_class;
+};
+
+G_GNUC_INTERNAL GType gst_memfd_src_get_type(void);
+
+G_END_DECLS
+
+#endif /* __GST_MEMFD_SRC_H__ */
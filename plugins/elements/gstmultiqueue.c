@@ -170,6 +170,16 @@ struct _GstSingleQueue
   /* for serialized queries */
   GCond query_handled;
   gboolean last_query;
+
+  /* for servicing from the workers, protected by global lock */
+  gboolean started;             /* TRUE when the queue may be serviced */
+  gboolean scheduled;           /* TRUE when scheduled or run by a worker */
+  gboolean parked;              /* TRUE when not-linked and waiting its turn */
+  GThread *worker;              /* thread servicing the queue */
+  GstMiniObject *pending;       /* object popped before parking */
+  guint32 pending_id;
+  gboolean pending_is_query;
+  GCond serviced;               /* signalled when scheduled becomes FALSE */
 };
 
 
@@ -243,6 +253,12 @@ enum
 #define DEFAULT_LOW_PERCENT   10
 #define DEFAULT_HIGH_PERCENT  99
 #define DEFAULT_SYNC_BY_RUNNING_TIME FALSE
+#define DEFAULT_MAX_LIST_SIZE 0
+#define DEFAULT_MAX_THREADS 0
+
+/* max. number of objects pushed before a worker moves on to the next
+ * scheduled queue */
+#define SERVICE_BUDGET 16
 
 enum
 {
@@ -257,6 +273,8 @@ enum
   PROP_LOW_PERCENT,
   PROP_HIGH_PERCENT,
   PROP_SYNC_BY_RUNNING_TIME,
+  PROP_MAX_LIST_SIZE,
+  PROP_MAX_THREADS,
   PROP_LAST
 };
 
@@ -411,6 +429,48 @@ gst_multi_queue_class_init (GstMultiQueueClass * klass)
           DEFAULT_SYNC_BY_RUNNING_TIME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstMultiQueue:max-list-size
+   *
+   * When a queue has a backlog, push up to this many consecutive buffers
+   * downstream in one #GstBufferList. Only linked streams push lists, and
+   * events and queries still end a list. 0 or 1 pushes buffers one by one.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_LIST_SIZE,
+      g_param_spec_uint ("max-list-size", "Max. list size",
+          "Max. number of queued buffers to push downstream in one buffer list "
+          "(0=push buffers one by one)", 0, G_MAXINT, DEFAULT_MAX_LIST_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiQueue:max-threads
+   *
+   * Push the data of all queues from this many shared worker tasks instead of
+   * starting one streaming thread per source pad. A queue only occupies a
+   * worker while it has data to push, so this saves threads when there are
+   * many mostly idle streams.
+   *
+   * This is a soft limit. A worker that is blocked downstream can not service
+   * other queues, but a downstream element like a muxer or a sink waiting to
+   * preroll might need the data of another queue first. When all workers are
+   * pushing and another queue has data, a spare worker is started for it and
+   * stopped again when it is not needed anymore.
+   *
+   * The workers are #GstTask and stream-status messages are posted for them
+   * with the multiqueue as the source, so the task pool and thread policies
+   * of a #GstPipeline apply to them. The value is used when going from NULL
+   * to READY. 0 uses one streaming thread per source pad.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_THREADS,
+      g_param_spec_uint ("max-threads", "Max. threads",
+          "Number of threads pushing the data of all queues, more are started "
+          "when they all block (0=one thread per source pad)", 0, G_MAXINT,
+          DEFAULT_MAX_THREADS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gobject_class->finalize = gst_multi_queue_finalize;
 
   gst_element_class_set_static_metadata (gstelement_class,
@@ -448,12 +508,16 @@ gst_multi_queue_init (GstMultiQueue * mqueue)
   mqueue->high_percent = DEFAULT_HIGH_PERCENT;
 
   mqueue->sync_by_running_time = DEFAULT_SYNC_BY_RUNNING_TIME;
+  mqueue->max_list_size = DEFAULT_MAX_LIST_SIZE;
+  mqueue->max_threads = DEFAULT_MAX_THREADS;
 
   mqueue->counter = 1;
   mqueue->highid = -1;
   mqueue->high_time = GST_CLOCK_TIME_NONE;
 
   g_mutex_init (&mqueue->qlock);
+  g_queue_init (&mqueue->scheduled);
+  g_cond_init (&mqueue->work_cond);
 }
 
 static void
@@ -466,8 +530,11 @@ gst_multi_queue_finalize (GObject * object)
   mqueue->queues = NULL;
   mqueue->queues_cookie++;
 
+  gst_multi_queue_free_workers (mqueue);
+
   /* free/unref instance data */
   g_mutex_clear (&mqueue->qlock);
+  g_cond_clear (&mqueue->work_cond);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -527,6 +594,12 @@ gst_multi_queue_set_property (GObject * object, guint prop_id,
     case PROP_SYNC_BY_RUNNING_TIME:
       mq->sync_by_running_time = g_value_get_boolean (value);
       break;
+    case PROP_MAX_LIST_SIZE:
+      mq->max_list_size = g_value_get_uint (value);
+      break;
+    case PROP_MAX_THREADS:
+      mq->max_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -572,6 +645,12 @@ gst_multi_queue_get_property (GObject * object, guint prop_id,
     case PROP_SYNC_BY_RUNNING_TIME:
       g_value_set_boolean (value, mq->sync_by_running_time);
       break;
+    case PROP_MAX_LIST_SIZE:
+      g_value_set_uint (value, mq->max_list_size);
+      break;
+    case PROP_MAX_THREADS:
+      g_value_set_uint (value, mq->max_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -687,6 +766,287 @@ gst_multi_queue_release_pad (GstElement * element, GstPad * pad)
   gst_single_queue_free (sq);
 }
 
+/*
+ * Worker functions
+ *
+ * With max-threads, the queues are pushed by a set of worker tasks instead of
+ * a task per source pad. A queue that has something to push is scheduled and
+ * the next free worker services it for a while. The workers are normal
+ * #GstTask, the stream-status messages for them are posted by the multiqueue
+ * itself so that the task pool and thread policy of the pipeline apply.
+ *
+ * A worker that is blocked downstream can't service other queues, but a
+ * downstream element like a muxer or a sink that waits to preroll may need
+ * the data of another queue first. max-threads is therefore only the number
+ * of workers that are kept around: when all workers are pushing and another
+ * queue has data, a spare worker is started. Spare workers are stopped again
+ * when there is nothing to do for them.
+ */
+
+typedef struct
+{
+  GstMultiQueue *mq;
+  GstTask *task;
+  GRecMutex lock;
+  gboolean started;             /* TRUE while counted in n_workers */
+} GstMultiQueueWorker;
+
+static void gst_multi_queue_worker_loop (GstMultiQueueWorker * worker);
+
+static void
+gst_multi_queue_worker_status (GstMultiQueue * mq, GstTask * task,
+    GstStreamStatusType type)
+{
+  GstMessage *message;
+  GValue value = { 0 };
+
+  message = gst_message_new_stream_status (GST_OBJECT_CAST (mq), type,
+      GST_ELEMENT_CAST (mq));
+  g_value_init (&value, GST_TYPE_TASK);
+  g_value_set_object (&value, task);
+  gst_message_set_stream_status_object (message, &value);
+  g_value_unset (&value);
+
+  gst_element_post_message (GST_ELEMENT_CAST (mq), message);
+}
+
+static void
+gst_multi_queue_worker_enter (GstTask * task, GThread * thread,
+    GstMultiQueueWorker * worker)
+{
+  gst_multi_queue_worker_status (worker->mq, task,
+      GST_STREAM_STATUS_TYPE_ENTER);
+}
+
+static void
+gst_multi_queue_worker_leave (GstTask * task, GThread * thread,
+    GstMultiQueueWorker * worker)
+{
+  gst_multi_queue_worker_status (worker->mq, task,
+      GST_STREAM_STATUS_TYPE_LEAVE);
+}
+
+/* make a new worker task and post its create message, like
+ * gst_pad_start_task() does. WITH LOCK TAKEN */
+static GstMultiQueueWorker *
+gst_multi_queue_worker_new (GstMultiQueue * mq)
+{
+  GstMultiQueueWorker *worker;
+  gchar *name;
+
+  worker = g_slice_new0 (GstMultiQueueWorker);
+  worker->mq = mq;
+  g_rec_mutex_init (&worker->lock);
+  worker->task = gst_task_new ((GstTaskFunction) gst_multi_queue_worker_loop,
+      worker, NULL);
+  gst_task_set_lock (worker->task, &worker->lock);
+  gst_task_set_enter_callback (worker->task,
+      (GstTaskThreadFunc) gst_multi_queue_worker_enter, worker, NULL);
+  gst_task_set_leave_callback (worker->task,
+      (GstTaskThreadFunc) gst_multi_queue_worker_leave, worker, NULL);
+
+  name = g_strdup_printf ("%s:worker%u", GST_OBJECT_NAME (mq),
+      mq->workers->len);
+  gst_object_set_name (GST_OBJECT_CAST (worker->task), name);
+  g_free (name);
+
+  g_ptr_array_add (mq->workers, worker);
+
+  GST_DEBUG_OBJECT (mq, "created worker task %p", worker->task);
+  gst_multi_queue_worker_status (mq, worker->task,
+      GST_STREAM_STATUS_TYPE_CREATE);
+
+  return worker;
+}
+
+/* after the task was joined */
+static void
+gst_multi_queue_worker_free (GstMultiQueueWorker * worker)
+{
+  gst_object_unref (worker->task);
+  g_rec_mutex_clear (&worker->lock);
+  g_slice_free (GstMultiQueueWorker, worker);
+}
+
+/* start a stopped worker or a new one. WITH LOCK TAKEN */
+static void
+gst_multi_queue_start_worker (GstMultiQueue * mq)
+{
+  GstMultiQueueWorker *worker = NULL;
+  guint i;
+
+  for (i = 0; i < mq->workers->len; i++) {
+    GstMultiQueueWorker *w = g_ptr_array_index (mq->workers, i);
+
+    if (!w->started) {
+      worker = w;
+      break;
+    }
+  }
+  if (worker == NULL)
+    worker = gst_multi_queue_worker_new (mq);
+
+  GST_LOG_OBJECT (mq, "starting worker %p, %u started, %u pushing",
+      worker->task, mq->n_workers, mq->n_pushing);
+
+  /* a worker that stopped itself but did not leave its loop yet just goes
+   * on */
+  worker->started = TRUE;
+  mq->n_workers++;
+  if (!gst_task_start (worker->task)) {
+    GST_WARNING_OBJECT (mq, "failed to start worker %p", worker->task);
+    worker->started = FALSE;
+    mq->n_workers--;
+  }
+}
+
+/* make sure that a worker picks up the scheduled queues. When all workers
+ * are pushing downstream, which might block, another one is started even if
+ * there are max-threads already. WITH LOCK TAKEN */
+static void
+gst_multi_queue_check_workers (GstMultiQueue * mq)
+{
+  if (mq->stop_workers || g_queue_is_empty (&mq->scheduled))
+    return;
+
+  if (mq->n_idle > 0)
+    g_cond_signal (&mq->work_cond);
+  else if (mq->n_workers < mq->max_threads || mq->n_pushing == mq->n_workers)
+    gst_multi_queue_start_worker (mq);
+}
+
+/* schedule @sq for a worker when it has something to do.
+ * WITH LOCK TAKEN */
+static void
+gst_single_queue_schedule (GstMultiQueue * mq, GstSingleQueue * sq)
+{
+  if (mq->workers == NULL || sq->scheduled || !sq->started)
+    return;
+
+  /* a flushing queue is serviced to let it clean up */
+  if (!sq->flushing && (sq->parked || (sq->pending == NULL
+              && gst_data_queue_is_empty (sq->queue))))
+    return;
+
+  GST_LOG_OBJECT (mq, "SingleQueue %d : scheduling", sq->id);
+  sq->scheduled = TRUE;
+  g_queue_push_tail (&mq->scheduled, sq);
+  gst_multi_queue_check_workers (mq);
+}
+
+/* schedule @sq after data was queued */
+static void
+gst_single_queue_kick (GstMultiQueue * mq, GstSingleQueue * sq)
+{
+  if (mq->workers == NULL)
+    return;
+
+  GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+  gst_single_queue_schedule (mq, sq);
+  GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+}
+
+/* wake up a not-linked queue waiting for its turn.
+ * WITH LOCK TAKEN */
+static void
+gst_single_queue_wake (GstMultiQueue * mq, GstSingleQueue * sq)
+{
+  if (sq->parked) {
+    sq->parked = FALSE;
+    mq->numwaiting--;
+    gst_single_queue_schedule (mq, sq);
+  } else {
+    g_cond_signal (&sq->turn);
+  }
+}
+
+static gboolean
+gst_single_queue_start (GstMultiQueue * mq, GstSingleQueue * sq)
+{
+  if (mq->workers == NULL)
+    return gst_pad_start_task (sq->srcpad,
+        (GstTaskFunction) gst_multi_queue_loop, sq->srcpad, NULL);
+
+  GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+  sq->started = TRUE;
+  gst_single_queue_schedule (mq, sq);
+  GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+
+  return TRUE;
+}
+
+/* stop servicing @sq and wait until no worker runs it anymore, unless
+ * we are called from that worker. */
+static gboolean
+gst_single_queue_pause (GstMultiQueue * mq, GstSingleQueue * sq)
+{
+  if (mq->workers == NULL)
+    return gst_pad_pause_task (sq->srcpad);
+
+  GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+  sq->started = FALSE;
+  if (sq->worker == NULL && sq->scheduled) {
+    /* not picked up by a worker yet */
+    g_queue_remove (&mq->scheduled, sq);
+    sq->scheduled = FALSE;
+  } else if (sq->worker != g_thread_self ()) {
+    while (sq->scheduled)
+      g_cond_wait (&sq->serviced, &mq->qlock);
+  }
+  GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+
+  return TRUE;
+}
+
+/* start using worker tasks, they are started when queues are scheduled */
+static void
+gst_multi_queue_setup_workers (GstMultiQueue * mq)
+{
+  GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+  if (mq->max_threads > 0) {
+    mq->workers = g_ptr_array_new ();
+    mq->stop_workers = FALSE;
+  }
+  GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+}
+
+/* stop and free all workers, when no queue is serviced anymore */
+static void
+gst_multi_queue_free_workers (GstMultiQueue * mq)
+{
+  GPtrArray *workers;
+  guint i;
+
+  GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+  workers = mq->workers;
+  mq->workers = NULL;
+  if (workers) {
+    mq->stop_workers = TRUE;
+    for (i = 0; i < workers->len; i++) {
+      GstMultiQueueWorker *worker = g_ptr_array_index (workers, i);
+
+      gst_task_stop (worker->task);
+    }
+    g_cond_broadcast (&mq->work_cond);
+  }
+  GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+
+  if (workers == NULL)
+    return;
+
+  for (i = 0; i < workers->len; i++) {
+    GstMultiQueueWorker *worker = g_ptr_array_index (workers, i);
+
+    gst_task_join (worker->task);
+    gst_multi_queue_worker_free (worker);
+  }
+  g_ptr_array_free (workers, TRUE);
+
+  GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+  mq->n_workers = mq->n_idle = mq->n_pushing = 0;
+  GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+}
+
 static GstStateChangeReturn
 gst_multi_queue_change_state (GstElement * element, GstStateChange transition)
 {
@@ -695,6 +1055,10 @@ gst_multi_queue_change_state (GstElement * element, GstStateChange transition)
   GstStateChangeReturn result;
 
   switch (transition) {
+    case GST_STATE_CHANGE_NULL_TO_READY:
+      /* pads can be activated in READY already */
+      gst_multi_queue_setup_workers (mqueue);
+      break;
     case GST_STATE_CHANGE_READY_TO_PAUSED:{
       GList *tmp;
 
@@ -715,7 +1079,7 @@ gst_multi_queue_change_state (GstElement * element, GstStateChange transition)
       for (tmp = mqueue->queues; tmp; tmp = g_list_next (tmp)) {
         sq = (GstSingleQueue *) tmp->data;
         sq->flushing = TRUE;
-        g_cond_signal (&sq->turn);
+        gst_single_queue_wake (mqueue, sq);
       }
       GST_MULTI_QUEUE_MUTEX_UNLOCK (mqueue);
       break;
@@ -727,6 +1091,10 @@ gst_multi_queue_change_state (GstElement * element, GstStateChange transition)
   result = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
 
   switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_NULL:
+      /* all pads are deactivated now and no queue is serviced anymore */
+      gst_multi_queue_free_workers (mqueue);
+      break;
     default:
       break;
   }
@@ -753,13 +1121,13 @@ gst_single_queue_flush (GstMultiQueue * mq, GstSingleQueue * sq, gboolean flush,
     /* wake up non-linked task */
     GST_LOG_OBJECT (mq, "SingleQueue %d : waking up eventually waiting task",
         sq->id);
-    g_cond_signal (&sq->turn);
+    gst_single_queue_wake (mq, sq);
     sq->last_query = FALSE;
     g_cond_signal (&sq->query_handled);
     GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
 
     GST_LOG_OBJECT (mq, "SingleQueue %d : pausing task", sq->id);
-    result = gst_pad_pause_task (sq->srcpad);
+    result = gst_single_queue_pause (mq, sq);
     sq->sink_tainted = sq->src_tainted = TRUE;
   } else {
     GST_MULTI_QUEUE_MUTEX_LOCK (mq);
@@ -786,9 +1154,7 @@ gst_single_queue_flush (GstMultiQueue * mq, GstSingleQueue * sq, gboolean flush,
     GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
 
     GST_LOG_OBJECT (mq, "SingleQueue %d : starting task", sq->id);
-    result =
-        gst_pad_start_task (sq->srcpad, (GstTaskFunction) gst_multi_queue_loop,
-        sq->srcpad, NULL);
+    result = gst_single_queue_start (mq, sq);
   }
   return result;
 }
@@ -1057,6 +1423,33 @@ gst_single_queue_push_one (GstMultiQueue * mq, GstSingleQueue * sq,
         sq->id, buffer, GST_TIME_ARGS (timestamp));
 
     result = gst_pad_push (sq->srcpad, buffer);
+  } else if (GST_IS_BUFFER_LIST (object)) {
+    GstBufferList *list;
+    GstClockTime position;
+    guint i, n;
+
+    list = GST_BUFFER_LIST_CAST (object);
+    n = gst_buffer_list_length (list);
+
+    /* apply all buffers at once, see apply_buffer() */
+    position = sq->src_segment.position;
+    for (i = 0; i < n; i++) {
+      GstBuffer *buffer = gst_buffer_list_get (list, i);
+
+      if (GST_BUFFER_TIMESTAMP_IS_VALID (buffer))
+        position = GST_BUFFER_TIMESTAMP (buffer);
+      if (GST_BUFFER_DURATION_IS_VALID (buffer))
+        position += GST_BUFFER_DURATION (buffer);
+    }
+    apply_buffer (mq, sq, position, GST_CLOCK_TIME_NONE, &sq->src_segment);
+
+    /* Applying the buffers may have made the queue non-full again, unblock it if needed */
+    gst_data_queue_limits_changed (sq->queue);
+
+    GST_DEBUG_OBJECT (mq,
+        "SingleQueue %d : Pushing list %p of %u buffers", sq->id, list, n);
+
+    result = gst_pad_push_list (sq->srcpad, list);
   } else if (GST_IS_EVENT (object)) {
     GstEvent *event;
 
@@ -1157,42 +1550,102 @@ gst_multi_queue_mo_item_new (GstMiniObject * object, guint32 curid)
   return item;
 }
 
-/* Each main loop attempts to push buffers until the return value
+/* take the buffers that directly follow @object in the queue, up to
+ * max-list-size, and return them in one list with @object. @newid is set to
+ * the id of the last buffer. */
+static GstMiniObject *
+gst_single_queue_take_list (GstMultiQueue * mq, GstSingleQueue * sq,
+    GstMiniObject * object, guint32 * newid)
+{
+  GstBufferList *list = NULL;
+  GstDataQueueItem *sitem;
+  GstMultiQueueItem *item;
+  guint len = 1;
+
+  while (len < mq->max_list_size) {
+    /* only this thread takes items, so peek and pop don't block on a queue
+     * that is not empty. They fail when the queue is flushing. */
+    if (gst_data_queue_is_empty (sq->queue)
+        || !gst_data_queue_peek (sq->queue, &sitem))
+      break;
+
+    item = (GstMultiQueueItem *) sitem;
+    if (item->is_query || !GST_IS_BUFFER (item->object))
+      break;
+
+    if (!gst_data_queue_pop (sq->queue, &sitem))
+      break;
+
+    if (list == NULL) {
+      list = gst_buffer_list_new_sized (mq->max_list_size);
+      gst_buffer_list_add (list, GST_BUFFER_CAST (object));
+    }
+    *newid = item->posid;
+    gst_buffer_list_add (list,
+        GST_BUFFER_CAST (gst_multi_queue_item_steal_object (item)));
+    gst_multi_queue_item_destroy (item);
+    len++;
+  }
+
+  if (list == NULL)
+    return object;
+
+  GST_LOG_OBJECT (mq, "SingleQueue %d : took %u buffers up to id %u",
+      sq->id, len, *newid);
+
+  return GST_MINI_OBJECT_CAST (list);
+}
+
+/* Push one object of @sq. Returns FALSE when the queue has nothing to
+ * push anymore for now, which only happens when flushing or when the queue
+ * is serviced by a worker.
+ *
+ * Each iteration attempts to push buffers until the return value
  * is not-linked. not-linked pads are not allowed to push data beyond
  * any linked pads, so they don't 'rush ahead of the pack'.
  */
-static void
-gst_multi_queue_loop (GstPad * pad)
+static gboolean
+gst_single_queue_iterate (GstMultiQueue * mq, GstSingleQueue * sq)
 {
-  GstSingleQueue *sq;
   GstMultiQueueItem *item;
   GstDataQueueItem *sitem;
-  GstMultiQueue *mq;
   GstMiniObject *object = NULL;
   guint32 newid;
   GstFlowReturn result;
   GstClockTime next_time;
-  gboolean is_buffer;
-
-  sq = (GstSingleQueue *) gst_pad_get_element_private (pad);
-  mq = sq->mqueue;
+  gboolean is_buffer, is_query;
 
   GST_DEBUG_OBJECT (mq, "SingleQueue %d : trying to pop an object", sq->id);
 
   if (sq->flushing)
     goto out_flushing;
 
-  /* Get something from the queue, blocking until that happens, or we get
-   * flushed */
-  if (!(gst_data_queue_pop (sq->queue, &sitem)))
-    goto out_flushing;
+  if (sq->pending) {
+    /* we were parked with this object, try again */
+    object = sq->pending;
+    newid = sq->pending_id;
+    is_query = sq->pending_is_query;
+    sq->pending = NULL;
+  } else {
+    /* workers must not block, they have other queues to service */
+    if (mq->workers && gst_data_queue_is_empty (sq->queue)) {
+      single_queue_underrun_cb (sq->queue, sq);
+      return FALSE;
+    }
 
-  item = (GstMultiQueueItem *) sitem;
-  newid = item->posid;
+    /* Get something from the queue, blocking until that happens, or we get
+     * flushed */
+    if (!(gst_data_queue_pop (sq->queue, &sitem)))
+      goto out_flushing;
+
+    item = (GstMultiQueueItem *) sitem;
+    newid = item->posid;
+    is_query = item->is_query;
 
-  /* steal the object and destroy the item */
-  object = gst_multi_queue_item_steal_object (item);
-  gst_multi_queue_item_destroy (item);
+    /* steal the object and destroy the item */
+    object = gst_multi_queue_item_steal_object (item);
+    gst_multi_queue_item_destroy (item);
+  }
 
   is_buffer = GST_IS_BUFFER (object);
 
@@ -1252,6 +1705,18 @@ gst_multi_queue_loop (GstPad * pad)
         /* Wake up all non-linked pads before we sleep */
         wake_up_next_non_linked (mq);
 
+        if (mq->workers) {
+          /* park instead of sleeping, wake_up_next_non_linked() schedules
+           * us again when it is our turn */
+          sq->pending = object;
+          sq->pending_id = newid;
+          sq->pending_is_query = is_query;
+          sq->parked = TRUE;
+          mq->numwaiting++;
+          GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+          return FALSE;
+        }
+
         mq->numwaiting++;
         g_cond_wait (&sq->turn, &mq->qlock);
         mq->numwaiting--;
@@ -1289,6 +1754,12 @@ gst_multi_queue_loop (GstPad * pad)
   GST_LOG_OBJECT (mq, "BEFORE PUSHING sq->srcresult: %s",
       gst_flow_get_name (sq->srcresult));
 
+  /* Push the buffers that are queued behind this one along with it. Streams
+   * that are not linked keep pushing one buffer at a time, they must not
+   * run ahead of the others. */
+  if (is_buffer && mq->max_list_size > 1 && sq->srcresult == GST_FLOW_OK)
+    object = gst_single_queue_take_list (mq, sq, object, &newid);
+
   /* Update time stats */
   GST_MULTI_QUEUE_MUTEX_LOCK (mq);
   next_time = get_running_time (&sq->src_segment, object, FALSE);
@@ -1301,6 +1772,11 @@ gst_multi_queue_loop (GstPad * pad)
       wake_up_next_non_linked (mq);
     }
   }
+  if (sq->worker) {
+    /* the push might block, don't let the other queues wait for it */
+    mq->n_pushing++;
+    gst_multi_queue_check_workers (mq);
+  }
   GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
 
   /* Try to push out the new object */
@@ -1316,6 +1792,8 @@ gst_multi_queue_loop (GstPad * pad)
    * deadlocks if downstream does any waiting too.
    */
   GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+  if (sq->worker)
+    mq->n_pushing--;
   if (sq->pushed && sq->srcresult == GST_FLOW_OK
       && result == GST_FLOW_NOT_LINKED) {
     GList *tmp;
@@ -1335,7 +1813,7 @@ gst_multi_queue_loop (GstPad * pad)
           GST_LOG_OBJECT (mq, "Waking up singlequeue %d", sq2->id);
           sq2->pushed = FALSE;
           sq2->srcresult = GST_FLOW_OK;
-          g_cond_signal (&sq2->turn);
+          gst_single_queue_wake (mq, sq2);
         }
       }
     }
@@ -1354,7 +1832,7 @@ gst_multi_queue_loop (GstPad * pad)
   GST_LOG_OBJECT (mq, "AFTER PUSHING sq->srcresult: %s",
       gst_flow_get_name (sq->srcresult));
 
-  return;
+  return TRUE;
 
 out_flushing:
   {
@@ -1363,6 +1841,11 @@ out_flushing:
 
     /* Need to make sure wake up any sleeping pads when we exit */
     GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+    if (sq->pending) {
+      if (!sq->pending_is_query)
+        gst_mini_object_unref (sq->pending);
+      sq->pending = NULL;
+    }
     compute_high_time (mq);
     compute_high_id (mq);
     wake_up_next_non_linked (mq);
@@ -1378,10 +1861,91 @@ out_flushing:
     gst_single_queue_flush_queue (sq, FALSE);
     single_queue_underrun_cb (sq->queue, sq);
     gst_data_queue_set_flushing (sq->queue, TRUE);
-    gst_pad_pause_task (sq->srcpad);
+    if (mq->workers) {
+      GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+      sq->started = FALSE;
+      GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+    } else {
+      gst_pad_pause_task (sq->srcpad);
+    }
     GST_CAT_LOG_OBJECT (multi_queue_debug, mq,
         "SingleQueue[%d] task paused, reason:%s",
         sq->id, gst_flow_get_name (sq->srcresult));
+    return FALSE;
+  }
+}
+
+static void
+gst_multi_queue_loop (GstPad * pad)
+{
+  GstSingleQueue *sq;
+
+  sq = (GstSingleQueue *) gst_pad_get_element_private (pad);
+
+  gst_single_queue_iterate (sq->mqueue, sq);
+}
+
+/* Push the objects of @sq for a while and reschedule it when it still has
+ * something to do, so that the other queues get their turn. */
+static void
+gst_single_queue_service (GstMultiQueue * mq, GstSingleQueue * sq)
+{
+  guint budget = SERVICE_BUDGET;
+
+  /* like a task, hold the stream lock while pushing */
+  GST_PAD_STREAM_LOCK (sq->srcpad);
+  do {
+    if (!gst_single_queue_iterate (mq, sq))
+      break;
+  } while (--budget > 0);
+  GST_PAD_STREAM_UNLOCK (sq->srcpad);
+
+  GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+  sq->worker = NULL;
+  sq->scheduled = FALSE;
+  g_cond_broadcast (&sq->serviced);
+  gst_single_queue_schedule (mq, sq);
+  GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+}
+
+/* the function of the worker tasks, service the next scheduled queue */
+static void
+gst_multi_queue_worker_loop (GstMultiQueueWorker * worker)
+{
+  GstMultiQueue *mq = worker->mq;
+  GstSingleQueue *sq;
+
+  GST_MULTI_QUEUE_MUTEX_LOCK (mq);
+  while (!mq->stop_workers && g_queue_is_empty (&mq->scheduled)) {
+    /* spare workers are only kept while they are needed */
+    if (mq->n_workers > mq->max_threads)
+      goto stop;
+
+    mq->n_idle++;
+    g_cond_wait (&mq->work_cond, &mq->qlock);
+    mq->n_idle--;
+  }
+  if (mq->stop_workers) {
+    /* the task was stopped already */
+    GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+    return;
+  }
+
+  sq = g_queue_pop_head (&mq->scheduled);
+  sq->worker = g_thread_self ();
+  GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
+
+  gst_single_queue_service (mq, sq);
+  return;
+
+stop:
+  {
+    GST_LOG_OBJECT (mq, "stopping spare worker %p, %u started",
+        worker->task, mq->n_workers);
+    worker->started = FALSE;
+    mq->n_workers--;
+    gst_task_stop (worker->task);
+    GST_MULTI_QUEUE_MUTEX_UNLOCK (mq);
     return;
   }
 }
@@ -1423,6 +1987,8 @@ gst_multi_queue_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   if (!(gst_data_queue_push (sq->queue, (GstDataQueueItem *) item)))
     goto flushing;
 
+  gst_single_queue_kick (mq, sq);
+
   /* update time level, we must do this after pushing the data in the queue so
    * that we never end up filling the queue first. */
   apply_buffer (mq, sq, timestamp, duration, &sq->sink_segment);
@@ -1555,6 +2121,8 @@ gst_multi_queue_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
   if (!(res = gst_data_queue_push (sq->queue, (GstDataQueueItem *) item)))
     goto flushing;
 
+  gst_single_queue_kick (mq, sq);
+
   /* mark EOS when we received one, we must do that after putting the
    * buffer in the queue because EOS marks the buffer as filled. No need to take
    * a lock, the _check_full happens from this thread only, right before pushing
@@ -1631,6 +2199,7 @@ gst_multi_queue_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
               "SingleQueue %d : Enqueuing query %p of type %s with id %d",
               sq->id, query, GST_QUERY_TYPE_NAME (query), curid);
           res = gst_data_queue_push (sq->queue, (GstDataQueueItem *) item);
+          gst_single_queue_schedule (mq, sq);
           g_cond_wait (&sq->query_handled, &mq->qlock);
           res = sq->last_query;
         } else {
@@ -1748,7 +2317,7 @@ wake_up_next_non_linked (GstMultiQueue * mq)
               && sq->next_time >= mq->high_time)
           || (sq->nextid != 0 && sq->nextid <= mq->highid)) {
         GST_LOG_OBJECT (mq, "Waking up singlequeue %d", sq->id);
-        g_cond_signal (&sq->turn);
+        gst_single_queue_wake (mq, sq);
       }
     }
   }
@@ -2023,6 +2592,9 @@ gst_single_queue_free (GstSingleQueue * sq)
   g_object_unref (sq->queue);
   g_cond_clear (&sq->turn);
   g_cond_clear (&sq->query_handled);
+  g_cond_clear (&sq->serviced);
+  if (sq->pending && !sq->pending_is_query)
+    gst_mini_object_unref (sq->pending);
   g_free (sq);
 }
 
@@ -2089,6 +2661,7 @@ gst_single_queue_new (GstMultiQueue * mqueue, guint id)
   sq->last_time = GST_CLOCK_TIME_NONE;
   g_cond_init (&sq->turn);
   g_cond_init (&sq->query_handled);
+  g_cond_init (&sq->serviced);
 
   sq->sinktime = GST_CLOCK_TIME_NONE;
   sq->srctime = GST_CLOCK_TIME_NONE;
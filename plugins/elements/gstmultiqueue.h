@@ -74,6 +74,20 @@ struct _GstMultiQueue {
 			/* GstMultiQueueSize, counter and highid */
 
   gint numwaiting;	/* number of not-linked pads waiting */
+
+  guint max_list_size;	/* max. number of buffers pushed in one list */
+
+  guint max_threads;	/* number of worker tasks, 0 for one task per pad */
+
+  /* worker tasks that push the queues when not using a task per pad,
+   * protected by the global lock */
+  GPtrArray *workers;	/* all workers, NULL when using a task per pad */
+  GQueue scheduled;	/* queues waiting for a worker */
+  GCond work_cond;	/* signalled when a queue was scheduled */
+  guint n_workers;	/* number of started workers */
+  guint n_idle;		/* started workers waiting for a queue */
+  guint n_pushing;	/* started workers pushing downstream */
+  gboolean stop_workers;
 };
 
 struct _GstMultiQueueClass {
@@ -53,6 +53,12 @@
  * the specified minimum thresholds require (by default: when the queue is
  * empty). The #GstQueue::overrun signal is emitted when the queue is filled
  * up. Both signals are emitted from the context of the streaming thread.
+ *
+ * When #GstQueue:ring-size is set, the queue passes data through a bounded
+ * single-producer/single-consumer ring instead of a locked queue. The
+ * streaming threads on both sides then only take the queue lock to sleep when
+ * the queue stays empty or full for a while. The ring size is an additional
+ * limit on the number of buffers, events and queries in the queue.
  */
 
 #include "gst/gst_private.h"
@@ -120,13 +126,17 @@ enum
   PROP_MIN_THRESHOLD_TIME,
   PROP_LEAKY,
   PROP_SILENT,
-  PROP_FLUSH_ON_EOS
+  PROP_FLUSH_ON_EOS,
+  PROP_RING_SIZE,
+  PROP_MAX_LIST_SIZE
 };
 
 /* default property values */
 #define DEFAULT_MAX_SIZE_BUFFERS  200   /* 200 buffers */
 #define DEFAULT_MAX_SIZE_BYTES    (10 * 1024 * 1024)    /* 10 MB       */
 #define DEFAULT_MAX_SIZE_TIME     GST_SECOND    /* 1 second    */
+#define DEFAULT_RING_SIZE         0     /* locked queue */
+#define DEFAULT_MAX_LIST_SIZE     0     /* push buffers one by one */
 
 #define GST_QUEUE_MUTEX_LOCK(q) G_STMT_START {                          \
   g_mutex_lock (&q->qlock);                                              \
@@ -219,6 +229,22 @@ static gboolean gst_queue_sink_activate_mode (GstPad * pad, GstObject * parent,
 static gboolean gst_queue_is_empty (GstQueue * queue);
 static gboolean gst_queue_is_filled (GstQueue * queue);
 
+static void gst_queue_ring_setup (GstQueue * queue);
+static void gst_queue_ring_free (GstQueue * queue);
+static void gst_queue_ring_drain (GstQueue * queue, gboolean full);
+static void gst_queue_ring_reset (GstQueue * queue);
+static void gst_queue_ring_update_time (GstQueue * queue, gboolean sink);
+static guint64 gst_queue_ring_level_time (GstQueue * queue);
+static gboolean gst_queue_ring_is_empty (GstQueue * queue);
+static gboolean gst_queue_ring_is_filled (GstQueue * queue);
+static GstFlowReturn gst_queue_ring_chain (GstQueue * queue,
+    GstBuffer * buffer);
+static gboolean gst_queue_ring_enqueue_event (GstQueue * queue,
+    GstEvent * event);
+static gboolean gst_queue_ring_enqueue_query (GstQueue * queue,
+    GstQuery * query);
+static void gst_queue_ring_loop (GstQueue * queue);
+
 
 typedef struct
 {
@@ -387,6 +413,42 @@ gst_queue_class_init (GstQueueClass * klass)
           "Discard all data in the queue when an EOS event is received", FALSE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstQueue:ring-size
+   *
+   * Number of items in the lock-free ring that is used instead of the locked
+   * queue, rounded up to a power of two. 0 disables the ring. The ring is
+   * set up when the source pad is activated, changes take effect on the
+   * next activation.
+   *
+   * The ring is not used when the queue is leaky on the downstream end when
+   * it is activated, as dropping old data needs the locked queue. If the
+   * queue is made leaky downstream later, it blocks like a non-leaky queue.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, PROP_RING_SIZE,
+      g_param_spec_uint ("ring-size", "Ring size",
+          "Size of the lock-free ring between the streaming threads "
+          "(0=use a locked queue)", 0, 1 << 20, DEFAULT_RING_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstQueue:max-list-size
+   *
+   * When the queue has a backlog, push up to this many consecutive buffers
+   * downstream in one #GstBufferList. Events and queries end a list, and
+   * every buffer after the first one must still satisfy the minimum
+   * thresholds. 0 or 1 pushes buffers one by one.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_LIST_SIZE,
+      g_param_spec_uint ("max-list-size", "Max. list size",
+          "Max. number of queued buffers to push downstream in one buffer list "
+          "(0=push buffers one by one)", 0, G_MAXINT, DEFAULT_MAX_LIST_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gobject_class->finalize = gst_queue_finalize;
 
   gst_element_class_set_static_metadata (gstelement_class,
@@ -456,6 +518,10 @@ gst_queue_init (GstQueue * queue)
 
   queue->newseg_applied_to_src = FALSE;
 
+  queue->ring_size = DEFAULT_RING_SIZE;
+  queue->ring = NULL;
+  queue->max_list_size = DEFAULT_MAX_LIST_SIZE;
+
   GST_DEBUG_OBJECT (queue,
       "initialized queue's not_empty & not_full conditions");
 }
@@ -477,6 +543,11 @@ gst_queue_finalize (GObject * object)
   }
   gst_queue_array_free (queue->queue);
 
+  if (queue->ring) {
+    gst_queue_ring_drain (queue, TRUE);
+    gst_queue_ring_free (queue);
+  }
+
   g_mutex_clear (&queue->qlock);
   g_cond_clear (&queue->item_add);
   g_cond_clear (&queue->item_del);
@@ -545,7 +616,10 @@ apply_segment (GstQueue * queue, GstEvent * event, GstSegment * segment,
   GST_DEBUG_OBJECT (queue, "configured SEGMENT %" GST_SEGMENT_FORMAT, segment);
 
   /* segment can update the time level of the queue */
-  update_time_level (queue);
+  if (queue->ring)
+    gst_queue_ring_update_time (queue, sink);
+  else
+    update_time_level (queue);
 }
 
 /* take a buffer and update segment, updating the time level of the queue. */
@@ -578,12 +652,20 @@ apply_buffer (GstQueue * queue, GstBuffer * buffer, GstSegment * segment,
 
 
   /* calc diff with other end */
-  update_time_level (queue);
+  if (queue->ring)
+    gst_queue_ring_update_time (queue, sink);
+  else
+    update_time_level (queue);
 }
 
+/* in ring mode this must only be called when neither streaming thread is
+ * running, like on FLUSH_STOP and when deactivating */
 static void
 gst_queue_locked_flush (GstQueue * queue, gboolean full)
 {
+  if (queue->ring)
+    gst_queue_ring_drain (queue, full);
+
   while (!gst_queue_array_is_empty (queue->queue)) {
     GstQueueItem *qitem = gst_queue_array_pop_head (queue->queue);
 
@@ -612,6 +694,9 @@ gst_queue_locked_flush (GstQueue * queue, gboolean full)
   queue->sinktime = queue->srctime = GST_CLOCK_TIME_NONE;
   queue->sink_tainted = queue->src_tainted = TRUE;
 
+  if (queue->ring)
+    gst_queue_ring_reset (queue);
+
   /* we deleted a lot of something */
   GST_QUEUE_SIGNAL_DEL (queue);
 }
@@ -801,6 +886,9 @@ gst_queue_handle_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
     }
     default:
       if (GST_EVENT_IS_SERIALIZED (event)) {
+        if (queue->ring)
+          return gst_queue_ring_enqueue_event (queue, event);
+
         /* serialized events go in the queue */
         GST_QUEUE_MUTEX_LOCK (queue);
         if (queue->srcresult != GST_FLOW_OK) {
@@ -857,6 +945,9 @@ gst_queue_handle_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
       if (G_UNLIKELY (GST_QUERY_IS_SERIALIZED (query))) {
         GstQueueItem *qitem;
 
+        if (queue->ring)
+          return gst_queue_ring_enqueue_query (queue, query);
+
         GST_QUEUE_MUTEX_LOCK_CHECK (queue, out_flushing);
         GST_LOG_OBJECT (queue, "queuing query %p (%s)", query,
             GST_QUERY_TYPE_NAME (query));
@@ -891,6 +982,9 @@ gst_queue_is_empty (GstQueue * queue)
 {
   GstQueueItem *head;
 
+  if (queue->ring)
+    return gst_queue_ring_is_empty (queue);
+
   if (gst_queue_array_is_empty (queue->queue))
     return TRUE;
 
@@ -916,6 +1010,9 @@ gst_queue_is_empty (GstQueue * queue)
 static gboolean
 gst_queue_is_filled (GstQueue * queue)
 {
+  if (queue->ring)
+    return gst_queue_ring_is_filled (queue);
+
   return (((queue->max_size.buffers > 0 &&
               queue->cur_level.buffers >= queue->max_size.buffers) ||
           (queue->max_size.bytes > 0 &&
@@ -960,6 +1057,9 @@ gst_queue_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 
   queue = GST_QUEUE_CAST (parent);
 
+  if (queue->ring)
+    return gst_queue_ring_chain (queue, buffer);
+
   /* we have to lock the queue since we span threads */
   GST_QUEUE_MUTEX_LOCK_CHECK (queue, out_flushing);
   /* when we received EOS, we refuse any more data */
@@ -1086,6 +1186,43 @@ out_unexpected:
   }
 }
 
+/* with the queue lock. Checks if the next item is a buffer that can be
+ * pushed along with the one that was just dequeued. */
+static gboolean
+gst_queue_locked_has_next_buffer (GstQueue * queue)
+{
+  GstQueueItem *head;
+
+  head = gst_queue_array_peek_head (queue->queue);
+  if (head == NULL || head->is_query || !GST_IS_BUFFER (head->item))
+    return FALSE;
+
+  /* the thresholds apply to every buffer */
+  return !gst_queue_is_empty (queue);
+}
+
+/* with the queue lock. Takes the buffers that directly follow @buffer, up
+ * to max-list-size, and returns them in one list with @buffer. */
+static GstBufferList *
+gst_queue_locked_dequeue_list (GstQueue * queue, GstBuffer * buffer)
+{
+  GstBufferList *list;
+
+  list = gst_buffer_list_new_sized (queue->max_list_size);
+  gst_buffer_list_add (list, buffer);
+
+  do {
+    gst_buffer_list_add (list,
+        GST_BUFFER_CAST (gst_queue_locked_dequeue (queue)));
+  } while (gst_buffer_list_length (list) < queue->max_list_size
+      && gst_queue_locked_has_next_buffer (queue));
+
+  GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+      "pushing %u buffers in list %p", gst_buffer_list_length (list), list);
+
+  return list;
+}
+
 /* dequeue an item from the queue an push it downstream. This functions returns
  * the result of the push. */
 static GstFlowReturn
@@ -1116,8 +1253,15 @@ next:
       queue->head_needs_discont = FALSE;
     }
 
-    GST_QUEUE_MUTEX_UNLOCK (queue);
-    result = gst_pad_push (queue->srcpad, buffer);
+    if (queue->max_list_size > 1 && gst_queue_locked_has_next_buffer (queue)) {
+      GstBufferList *list = gst_queue_locked_dequeue_list (queue, buffer);
+
+      GST_QUEUE_MUTEX_UNLOCK (queue);
+      result = gst_pad_push_list (queue->srcpad, list);
+    } else {
+      GST_QUEUE_MUTEX_UNLOCK (queue);
+      result = gst_pad_push (queue->srcpad, buffer);
+    }
 
     /* need to check for srcresult here as well */
     GST_QUEUE_MUTEX_LOCK_CHECK (queue, out_flushing);
@@ -1221,6 +1365,11 @@ gst_queue_loop (GstPad * pad)
 
   queue = (GstQueue *) GST_PAD_PARENT (pad);
 
+  if (queue->ring) {
+    gst_queue_ring_loop (queue);
+    return;
+  }
+
   /* have to lock for thread-safety */
   GST_QUEUE_MUTEX_LOCK_CHECK (queue, out_flushing);
 
@@ -1282,6 +1431,905 @@ out_flushing:
   }
 }
 
+/* Ring mode
+ *
+ * The upstream streaming thread (chain, serialized events and queries) is the
+ * only producer and the queue task is the only consumer. Each side only
+ * changes its own end of the ring, its own segment and its own running time.
+ * The buffer and byte levels are changed with atomic operations and the time
+ * level is computed from the running times that both sides publish.
+ *
+ * A side that has to wait spins for a while, then sets its waiting flag and
+ * sleeps on the condition of the locked queue. The other side only takes the
+ * queue lock to wake it up when the flag is set. Each side halves the number
+ * of spins when spinning did not help and doubles it again when it did.
+ *
+ * The streaming threads don't read the size and leaky properties directly,
+ * they read a copy that is published when the properties change.
+ */
+#define GST_QUEUE_RING_MAX_SPINS 256
+#define GST_QUEUE_RING_MIN_SPINS 8
+#define GST_QUEUE_RING_CACHE_LINE 64
+
+/* a running time that is written by one side and read by the other. The
+ * sequence number is odd while the time is being changed. */
+typedef struct
+{
+  volatile gint seq;
+  volatile GstClockTime time;
+} GstQueueRingTime;
+
+/* the properties that the streaming threads use */
+typedef struct
+{
+  GstQueueSize max_size;
+  GstQueueSize min_threshold;
+  GstQueueLeaky leaky;
+  gboolean silent;
+} GstQueueRingConfig;
+
+struct _GstQueueRing
+{
+  guint mask;
+  gpointer *items;
+
+  /* changed by the producer */
+  volatile gint tail;
+  GstQueueRingTime sink_time;
+  guint producer_spins;
+  gchar pad1[GST_QUEUE_RING_CACHE_LINE];
+
+  /* changed by the consumer */
+  volatile gint head;
+  GstQueueRingTime src_time;
+  guint consumer_spins;
+  gchar pad2[GST_QUEUE_RING_CACHE_LINE];
+
+  /* set by the producer when an EOS event flushes the queue */
+  volatile gint flush_pending;
+
+  /* changed with the queue lock, the sequence number is odd while the
+   * config is being changed */
+  volatile gint config_seq;
+  GstQueueRingConfig config;
+};
+
+/* queries are tagged in the ring, their owner can free them when the queue
+ * is flushing so they must not be looked at before they are dequeued */
+#define GST_QUEUE_RING_QUERY_TAG ((gsize) 1)
+#define GST_QUEUE_RING_IS_QUERY(item) \
+    ((GPOINTER_TO_SIZE (item) & GST_QUEUE_RING_QUERY_TAG) != 0)
+#define GST_QUEUE_RING_QUERY(item) \
+    ((GstQuery *) GSIZE_TO_POINTER (GPOINTER_TO_SIZE (item) & \
+        ~GST_QUEUE_RING_QUERY_TAG))
+
+typedef gboolean (*GstQueueRingCheck) (GstQueue * queue);
+
+static void
+gst_queue_ring_time_set (GstQueueRingTime * t, GstClockTime time)
+{
+  g_atomic_int_inc (&t->seq);
+  t->time = time;
+  g_atomic_int_inc (&t->seq);
+}
+
+static GstClockTime
+gst_queue_ring_time_get (GstQueueRingTime * t)
+{
+  GstClockTime time;
+  gint seq;
+
+  /* the additions are full barriers around the read of the time */
+  do {
+    seq = g_atomic_int_add (&t->seq, 0);
+    time = t->time;
+  } while ((seq & 1) || g_atomic_int_add (&t->seq, 0) != seq);
+
+  return time;
+}
+
+/* publish the properties for the streaming threads, with the queue lock */
+static void
+gst_queue_ring_update_config (GstQueue * queue)
+{
+  GstQueueRing *ring = queue->ring;
+
+  g_atomic_int_inc (&ring->config_seq);
+  ring->config.max_size = queue->max_size;
+  ring->config.min_threshold = queue->min_threshold;
+  ring->config.leaky = queue->leaky;
+  ring->config.silent = queue->silent;
+  g_atomic_int_inc (&ring->config_seq);
+}
+
+static void
+gst_queue_ring_get_config (GstQueue * queue, GstQueueRingConfig * config)
+{
+  GstQueueRing *ring = queue->ring;
+  gint seq;
+
+  do {
+    seq = g_atomic_int_add (&ring->config_seq, 0);
+    *config = ring->config;
+  } while ((seq & 1) || g_atomic_int_add (&ring->config_seq, 0) != seq);
+}
+
+/* publish the running time of one side, only called by that side */
+static void
+gst_queue_ring_update_time (GstQueue * queue, gboolean sink)
+{
+  if (sink) {
+    queue->sinktime =
+        gst_segment_to_running_time (&queue->sink_segment, GST_FORMAT_TIME,
+        queue->sink_segment.position);
+    queue->sink_tainted = FALSE;
+    gst_queue_ring_time_set (&queue->ring->sink_time, queue->sinktime);
+  } else {
+    queue->srctime =
+        gst_segment_to_running_time (&queue->src_segment, GST_FORMAT_TIME,
+        queue->src_segment.position);
+    queue->src_tainted = FALSE;
+    gst_queue_ring_time_set (&queue->ring->src_time, queue->srctime);
+  }
+}
+
+static guint64
+gst_queue_ring_level_time (GstQueue * queue)
+{
+  gint64 sink_time, src_time;
+
+  sink_time = gst_queue_ring_time_get (&queue->ring->sink_time);
+  src_time = gst_queue_ring_time_get (&queue->ring->src_time);
+
+  if (sink_time >= src_time)
+    return sink_time - src_time;
+
+  return 0;
+}
+
+/* only called by the consumer */
+static inline gpointer
+gst_queue_ring_peek (GstQueueRing * ring)
+{
+  guint head = ring->head;
+
+  if (head == (guint) g_atomic_int_get (&ring->tail))
+    return NULL;
+
+  return g_atomic_pointer_get (&ring->items[head & ring->mask]);
+}
+
+/* only called by the producer, the ring must not be full */
+static inline void
+gst_queue_ring_push (GstQueueRing * ring, gpointer item)
+{
+  guint tail = ring->tail;
+
+  ring->items[tail & ring->mask] = item;
+  /* makes the item visible to the consumer */
+  g_atomic_int_set (&ring->tail, tail + 1);
+}
+
+static gboolean
+gst_queue_ring_is_full (GstQueue * queue)
+{
+  GstQueueRing *ring = queue->ring;
+
+  return (guint) g_atomic_int_get (&ring->tail) -
+      (guint) g_atomic_int_get (&ring->head) > ring->mask;
+}
+
+static gboolean
+gst_queue_ring_is_filled (GstQueue * queue)
+{
+  GstQueueRingConfig config;
+
+  if (gst_queue_ring_is_full (queue))
+    return TRUE;
+
+  gst_queue_ring_get_config (queue, &config);
+
+  return (config.max_size.buffers > 0 &&
+      (guint) g_atomic_int_get (&queue->cur_level.buffers) >=
+      config.max_size.buffers) ||
+      (config.max_size.bytes > 0 &&
+      (guint) g_atomic_int_get (&queue->cur_level.bytes) >=
+      config.max_size.bytes) ||
+      (config.max_size.time > 0 &&
+      gst_queue_ring_level_time (queue) >= config.max_size.time);
+}
+
+/* only called by the consumer */
+static gboolean
+gst_queue_ring_is_empty (GstQueue * queue)
+{
+  GstQueueRingConfig config;
+  gpointer head;
+
+  head = gst_queue_ring_peek (queue->ring);
+  if (head == NULL)
+    return TRUE;
+
+  /* like in the locked queue, only data at the head waits for the minimum
+   * thresholds. Data that is flushed on EOS does not wait at all. */
+  if (GST_QUEUE_RING_IS_QUERY (head) ||
+      (!GST_IS_BUFFER (head) && !GST_IS_BUFFER_LIST (head)) ||
+      g_atomic_int_get (&queue->ring->flush_pending))
+    return FALSE;
+
+  gst_queue_ring_get_config (queue, &config);
+
+  return ((config.min_threshold.buffers > 0 &&
+          (guint) g_atomic_int_get (&queue->cur_level.buffers) <
+          config.min_threshold.buffers) ||
+      (config.min_threshold.bytes > 0 &&
+          (guint) g_atomic_int_get (&queue->cur_level.bytes) <
+          config.min_threshold.bytes) ||
+      (config.min_threshold.time > 0 &&
+          gst_queue_ring_level_time (queue) < config.min_threshold.time)) &&
+      !gst_queue_ring_is_filled (queue);
+}
+
+/* take the item at the head of the ring and update the levels and the source
+ * segment, only called by the consumer. Queries are returned tagged. */
+static gpointer
+gst_queue_ring_dequeue (GstQueue * queue)
+{
+  GstQueueRing *ring = queue->ring;
+  gpointer item;
+
+  item = gst_queue_ring_peek (ring);
+  if (item == NULL)
+    return NULL;
+
+  g_atomic_int_set (&ring->head, (guint) ring->head + 1);
+
+  if (GST_QUEUE_RING_IS_QUERY (item)) {
+    GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+        "retrieved query %p from ring", GST_QUEUE_RING_QUERY (item));
+  } else if (GST_IS_BUFFER (item)) {
+    GstBuffer *buffer = GST_BUFFER_CAST (item);
+
+    GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+        "retrieved buffer %p from ring", buffer);
+
+    g_atomic_int_add (&queue->cur_level.buffers, -1);
+    g_atomic_int_add (&queue->cur_level.bytes,
+        -(gint) gst_buffer_get_size (buffer));
+    apply_buffer (queue, buffer, &queue->src_segment, TRUE, FALSE);
+  } else if (GST_IS_EVENT (item)) {
+    GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+        "retrieved event %p from ring", item);
+
+    if (GST_EVENT_TYPE (item) == GST_EVENT_SEGMENT)
+      apply_segment (queue, GST_EVENT_CAST (item), &queue->src_segment, FALSE);
+  }
+  return item;
+}
+
+/* drop all items in the ring like gst_queue_locked_flush() does. Only called
+ * by the consumer or while it is stopped, with the queue lock */
+static void
+gst_queue_ring_drain (GstQueue * queue, gboolean full)
+{
+  gpointer item;
+
+  while ((item = gst_queue_ring_dequeue (queue))) {
+    if (GST_QUEUE_RING_IS_QUERY (item))
+      continue;
+    if (!full && GST_IS_EVENT (item) && GST_EVENT_IS_STICKY (item)
+        && GST_EVENT_TYPE (item) != GST_EVENT_SEGMENT
+        && GST_EVENT_TYPE (item) != GST_EVENT_EOS) {
+      gst_pad_store_sticky_event (queue->srcpad, GST_EVENT_CAST (item));
+    }
+    gst_mini_object_unref (item);
+  }
+}
+
+/* with the queue lock. @waiting must be set before @blocked is checked so that
+ * the other side sees it after it changed the ring */
+static gboolean
+gst_queue_ring_wait_locked (GstQueue * queue, GstQueueRingCheck blocked,
+    gboolean * waiting, GCond * cond)
+{
+  g_atomic_int_set (waiting, TRUE);
+  while (queue->srcresult == GST_FLOW_OK && blocked (queue))
+    g_cond_wait (cond, &queue->qlock);
+  g_atomic_int_set (waiting, FALSE);
+
+  return queue->srcresult == GST_FLOW_OK;
+}
+
+/* wait until @blocked returns FALSE, returns FALSE when the queue is
+ * flushing. @spins is the number of spins of the waiting side. */
+static gboolean
+gst_queue_ring_wait (GstQueue * queue, GstQueueRingCheck blocked,
+    gboolean * waiting, GCond * cond, guint * spins)
+{
+  gboolean res;
+  guint i, n = *spins;
+
+  /* at high rates the other side makes progress much faster than we could
+   * sleep and wake up again, spin for a while first */
+  for (i = 0; i < n; i++) {
+    if (g_atomic_int_get (&queue->srcresult) != GST_FLOW_OK)
+      return FALSE;
+    if (!blocked (queue)) {
+      if (i > 0 && n < GST_QUEUE_RING_MAX_SPINS)
+        *spins = n * 2;
+      return TRUE;
+    }
+    /* let the other side run when it shares our CPU */
+    if (i >= n / 2)
+      g_thread_yield ();
+  }
+
+  /* spinning did not help, spin less the next time */
+  if (n > GST_QUEUE_RING_MIN_SPINS)
+    *spins = n / 2;
+
+  GST_QUEUE_MUTEX_LOCK (queue);
+  res = gst_queue_ring_wait_locked (queue, blocked, waiting, cond);
+  GST_QUEUE_MUTEX_UNLOCK (queue);
+
+  return res;
+}
+
+/* wake up the other side when it sleeps in gst_queue_ring_wait() */
+static inline void
+gst_queue_ring_wake (GstQueue * queue, gboolean * waiting, GCond * cond)
+{
+  if (g_atomic_int_get (waiting)) {
+    GST_QUEUE_MUTEX_LOCK (queue);
+    g_cond_signal (cond);
+    GST_QUEUE_MUTEX_UNLOCK (queue);
+  }
+}
+
+/* with the queue lock, after the locked queue or the ring was flushed */
+static void
+gst_queue_ring_reset (GstQueue * queue)
+{
+  gst_queue_ring_update_config (queue);
+  gst_queue_ring_update_time (queue, TRUE);
+  gst_queue_ring_update_time (queue, FALSE);
+  queue->ring->flush_pending = FALSE;
+}
+
+static void
+gst_queue_ring_free (GstQueue * queue)
+{
+  g_free (queue->ring->items);
+  g_slice_free (GstQueueRing, queue->ring);
+  queue->ring = NULL;
+}
+
+/* make, resize or remove the ring for the current properties, with the queue
+ * lock and while the streaming threads are stopped */
+static void
+gst_queue_ring_setup (GstQueue * queue)
+{
+  GstQueueRing *ring = queue->ring;
+  guint size = 0;
+
+  if (queue->ring_size > 0 && queue->leaky != GST_QUEUE_LEAK_DOWNSTREAM)
+    size = 1U << g_bit_storage (queue->ring_size - 1);
+
+  if (ring ? ring->mask + 1 == size : size == 0)
+    return;
+
+  /* only switch when nothing is queued */
+  if (ring ? ring->head != ring->tail :
+      !gst_queue_array_is_empty (queue->queue)) {
+    GST_DEBUG_OBJECT (queue, "queue is not empty, keeping the current mode");
+    return;
+  }
+
+  if (ring)
+    gst_queue_ring_free (queue);
+  GST_QUEUE_CLEAR_LEVEL (queue->cur_level);
+
+  if (size == 0)
+    return;
+
+  GST_DEBUG_OBJECT (queue, "using a ring of %u items", size);
+
+  ring = g_slice_new0 (GstQueueRing);
+  ring->mask = size - 1;
+  ring->items = g_new0 (gpointer, size);
+  ring->producer_spins = GST_QUEUE_RING_MAX_SPINS;
+  ring->consumer_spins = GST_QUEUE_RING_MAX_SPINS;
+  queue->ring = ring;
+
+  gst_queue_ring_reset (queue);
+}
+
+static GstFlowReturn
+gst_queue_ring_chain (GstQueue * queue, GstBuffer * buffer)
+{
+  GstQueueRingConfig config;
+  GstFlowReturn ret;
+
+  if (g_atomic_int_get (&queue->srcresult) != GST_FLOW_OK)
+    goto out_flushing;
+  /* when we received EOS, we refuse any more data */
+  if (queue->eos || g_atomic_int_get (&queue->unexpected))
+    goto out_eos;
+
+  GST_CAT_LOG_OBJECT (queue_dataflow, queue, "received buffer %p of size %"
+      G_GSIZE_FORMAT ", time %" GST_TIME_FORMAT ", duration %"
+      GST_TIME_FORMAT, buffer, gst_buffer_get_size (buffer),
+      GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buffer)),
+      GST_TIME_ARGS (GST_BUFFER_DURATION (buffer)));
+
+  while (gst_queue_ring_is_filled (queue)) {
+    gst_queue_ring_get_config (queue, &config);
+    if (!config.silent) {
+      g_signal_emit (queue, gst_queue_signals[SIGNAL_OVERRUN], 0);
+      if (g_atomic_int_get (&queue->srcresult) != GST_FLOW_OK)
+        goto out_flushing;
+      /* we recheck, the signal could have changed the thresholds */
+      if (!gst_queue_ring_is_filled (queue))
+        break;
+      gst_queue_ring_get_config (queue, &config);
+    }
+
+    if (config.leaky == GST_QUEUE_LEAK_UPSTREAM) {
+      /* next buffer needs to get a DISCONT flag */
+      queue->tail_needs_discont = TRUE;
+      GST_CAT_DEBUG_OBJECT (queue_dataflow, queue,
+          "queue is full, leaking buffer on upstream end");
+      gst_buffer_unref (buffer);
+      return GST_FLOW_OK;
+    }
+
+    /* leaking on the downstream end needs the locked queue, a queue that
+     * was made leaky downstream after activation waits for free space */
+    GST_CAT_DEBUG_OBJECT (queue_dataflow, queue,
+        "queue is full, waiting for free space");
+    if (!gst_queue_ring_wait (queue, gst_queue_ring_is_filled,
+            &queue->waiting_del, &queue->item_del,
+            &queue->ring->producer_spins))
+      goto out_flushing;
+    GST_CAT_DEBUG_OBJECT (queue_dataflow, queue, "queue is not full");
+
+    gst_queue_ring_get_config (queue, &config);
+    if (!config.silent) {
+      g_signal_emit (queue, gst_queue_signals[SIGNAL_RUNNING], 0);
+      if (g_atomic_int_get (&queue->srcresult) != GST_FLOW_OK)
+        goto out_flushing;
+    }
+  }
+
+  if (queue->tail_needs_discont) {
+    GstBuffer *subbuffer = gst_buffer_make_writable (buffer);
+
+    if (subbuffer) {
+      buffer = subbuffer;
+      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DISCONT);
+    } else {
+      GST_DEBUG_OBJECT (queue, "Could not mark buffer as DISCONT");
+    }
+    queue->tail_needs_discont = FALSE;
+  }
+
+  /* count the buffer before the consumer can take it */
+  g_atomic_int_inc (&queue->cur_level.buffers);
+  g_atomic_int_add (&queue->cur_level.bytes, gst_buffer_get_size (buffer));
+  apply_buffer (queue, buffer, &queue->sink_segment, TRUE, TRUE);
+
+  gst_queue_ring_push (queue->ring, buffer);
+  gst_queue_ring_wake (queue, &queue->waiting_add, &queue->item_add);
+
+  return GST_FLOW_OK;
+
+  /* special conditions */
+out_flushing:
+  {
+    ret = g_atomic_int_get (&queue->srcresult);
+
+    GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+        "exit because task paused, reason: %s", gst_flow_get_name (ret));
+    gst_buffer_unref (buffer);
+
+    return ret;
+  }
+out_eos:
+  {
+    GST_CAT_LOG_OBJECT (queue_dataflow, queue, "exit because we received EOS");
+    gst_buffer_unref (buffer);
+
+    return GST_FLOW_EOS;
+  }
+}
+
+static gboolean
+gst_queue_ring_enqueue_event (GstQueue * queue, GstEvent * event)
+{
+  GstEventType type = GST_EVENT_TYPE (event);
+
+  /* Errors in sticky event pushing are ignored like in the locked queue,
+   * except for EOS */
+  if (g_atomic_int_get (&queue->srcresult) != GST_FLOW_OK &&
+      (!GST_EVENT_IS_STICKY (event) || type == GST_EVENT_EOS))
+    goto out_flow_error;
+  /* refuse more events on EOS */
+  if (queue->eos)
+    goto out_eos;
+
+  /* events are not counted in the levels but they need room in the ring */
+  if (gst_queue_ring_is_full (queue) &&
+      !gst_queue_ring_wait (queue, gst_queue_ring_is_full,
+          &queue->waiting_del, &queue->item_del,
+          &queue->ring->producer_spins))
+    goto out_flushing;
+
+  switch (type) {
+    case GST_EVENT_EOS:
+      GST_CAT_LOG_OBJECT (queue_dataflow, queue, "got EOS from upstream");
+      /* Zero the thresholds, this makes sure the queue is completely
+       * filled and we can read all data from the queue. */
+      if (!queue->flush_on_eos) {
+        GST_QUEUE_MUTEX_LOCK (queue);
+        GST_QUEUE_CLEAR_LEVEL (queue->min_threshold);
+        gst_queue_ring_update_config (queue);
+        GST_QUEUE_MUTEX_UNLOCK (queue);
+      }
+      /* mark the queue as EOS. This prevents us from accepting more data. */
+      queue->eos = TRUE;
+      break;
+    case GST_EVENT_SEGMENT:
+      apply_segment (queue, event, &queue->sink_segment, TRUE);
+      /* a new segment allows us to accept more buffers if we got EOS
+       * from downstream */
+      g_atomic_int_set (&queue->unexpected, FALSE);
+      break;
+    default:
+      break;
+  }
+
+  gst_queue_ring_push (queue->ring, event);
+  /* the consumer drops everything before the EOS event */
+  if (type == GST_EVENT_EOS && queue->flush_on_eos)
+    g_atomic_int_set (&queue->ring->flush_pending, TRUE);
+  gst_queue_ring_wake (queue, &queue->waiting_add, &queue->item_add);
+
+  return TRUE;
+
+  /* ERRORS */
+out_flushing:
+  {
+    /* the sticky event is sent again with the next data after the flush */
+    if (GST_EVENT_IS_STICKY (event) && type != GST_EVENT_EOS) {
+      gst_event_unref (event);
+      return TRUE;
+    }
+    goto out_flow_error;
+  }
+out_eos:
+  {
+    GST_CAT_LOG_OBJECT (queue_dataflow, queue, "refusing event, we are EOS");
+    gst_event_unref (event);
+    return FALSE;
+  }
+out_flow_error:
+  {
+    GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+        "refusing event, we have a downstream flow error: %s",
+        gst_flow_get_name (g_atomic_int_get (&queue->srcresult)));
+    gst_event_unref (event);
+    return FALSE;
+  }
+}
+
+static gboolean
+gst_queue_ring_enqueue_query (GstQueue * queue, GstQuery * query)
+{
+  gboolean res;
+
+  /* the lock is held until we wait for the result, the consumer takes it
+   * before it signals the result */
+  GST_QUEUE_MUTEX_LOCK_CHECK (queue, out_flushing);
+  if (!gst_queue_ring_wait_locked (queue, gst_queue_ring_is_full,
+          &queue->waiting_del, &queue->item_del))
+    goto out_flushing;
+
+  GST_LOG_OBJECT (queue, "queuing query %p (%s)", query,
+      GST_QUERY_TYPE_NAME (query));
+  gst_queue_ring_push (queue->ring, GSIZE_TO_POINTER (GPOINTER_TO_SIZE (query) |
+          GST_QUEUE_RING_QUERY_TAG));
+  GST_QUEUE_SIGNAL_ADD (queue);
+  g_cond_wait (&queue->query_handled, &queue->qlock);
+  if (queue->srcresult != GST_FLOW_OK)
+    goto out_flushing;
+  res = queue->last_query;
+  GST_QUEUE_MUTEX_UNLOCK (queue);
+
+  return res;
+
+  /* ERRORS */
+out_flushing:
+  {
+    GST_DEBUG_OBJECT (queue, "we are flushing");
+    GST_QUEUE_MUTEX_UNLOCK (queue);
+    return FALSE;
+  }
+}
+
+/* answer a query that will not be handled */
+static void
+gst_queue_ring_drop_query (GstQueue * queue, GstQuery * query)
+{
+  GST_CAT_LOG_OBJECT (queue_dataflow, queue, "dropping query %p", query);
+
+  GST_QUEUE_MUTEX_LOCK (queue);
+  queue->last_query = FALSE;
+  g_cond_signal (&queue->query_handled);
+  GST_QUEUE_MUTEX_UNLOCK (queue);
+}
+
+/* drop everything before the EOS event when the queue flushes on EOS, like
+ * gst_queue_locked_flush() does for the locked queue */
+static void
+gst_queue_ring_flush_to_eos (GstQueue * queue)
+{
+  gpointer item;
+
+  while ((item = gst_queue_ring_peek (queue->ring))) {
+    if (!GST_QUEUE_RING_IS_QUERY (item) && GST_IS_EVENT (item)
+        && GST_EVENT_TYPE (item) == GST_EVENT_EOS) {
+      g_atomic_int_set (&queue->ring->flush_pending, FALSE);
+      break;
+    }
+
+    item = gst_queue_ring_dequeue (queue);
+    if (GST_QUEUE_RING_IS_QUERY (item)) {
+      gst_queue_ring_drop_query (queue, GST_QUEUE_RING_QUERY (item));
+      continue;
+    }
+    if (GST_IS_EVENT (item) && GST_EVENT_IS_STICKY (item)
+        && GST_EVENT_TYPE (item) != GST_EVENT_SEGMENT) {
+      gst_pad_store_sticky_event (queue->srcpad, GST_EVENT_CAST (item));
+    }
+    gst_mini_object_unref (item);
+  }
+  gst_queue_ring_wake (queue, &queue->waiting_del, &queue->item_del);
+}
+
+/* only called by the consumer, see gst_queue_locked_has_next_buffer() */
+static gboolean
+gst_queue_ring_has_next_buffer (GstQueue * queue)
+{
+  gpointer head;
+
+  head = gst_queue_ring_peek (queue->ring);
+  if (head == NULL || GST_QUEUE_RING_IS_QUERY (head) || !GST_IS_BUFFER (head))
+    return FALSE;
+
+  return !gst_queue_ring_is_empty (queue);
+}
+
+/* only called by the consumer, see gst_queue_locked_dequeue_list() */
+static GstBufferList *
+gst_queue_ring_dequeue_list (GstQueue * queue, GstBuffer * buffer)
+{
+  GstBufferList *list;
+
+  list = gst_buffer_list_new_sized (queue->max_list_size);
+  gst_buffer_list_add (list, buffer);
+
+  do {
+    gst_buffer_list_add (list,
+        GST_BUFFER_CAST (gst_queue_ring_dequeue (queue)));
+  } while (gst_buffer_list_length (list) < queue->max_list_size
+      && gst_queue_ring_has_next_buffer (queue));
+  gst_queue_ring_wake (queue, &queue->waiting_del, &queue->item_del);
+
+  GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+      "pushing %u buffers in list %p", gst_buffer_list_length (list), list);
+
+  return list;
+}
+
+/* dequeue an item from the ring and push it downstream, without the queue
+ * lock. This function returns the result of the push. */
+static GstFlowReturn
+gst_queue_ring_push_one (GstQueue * queue)
+{
+  GstFlowReturn result = GST_FLOW_OK;
+  gpointer data;
+
+  if (G_UNLIKELY (g_atomic_int_get (&queue->ring->flush_pending)))
+    gst_queue_ring_flush_to_eos (queue);
+
+  data = gst_queue_ring_dequeue (queue);
+  if (data == NULL)
+    goto no_item;
+  gst_queue_ring_wake (queue, &queue->waiting_del, &queue->item_del);
+
+next:
+  if (GST_QUEUE_RING_IS_QUERY (data)) {
+    GstQuery *query = GST_QUEUE_RING_QUERY (data);
+    gboolean ret, flushing;
+
+    ret = gst_pad_peer_query (queue->srcpad, query);
+
+    GST_QUEUE_MUTEX_LOCK (queue);
+    flushing = queue->srcresult != GST_FLOW_OK;
+    queue->last_query = ret && !flushing;
+    g_cond_signal (&queue->query_handled);
+    GST_QUEUE_MUTEX_UNLOCK (queue);
+
+    if (flushing)
+      goto out_flushing;
+    GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+        "did query %p, return %d", query, ret);
+  } else if (GST_IS_BUFFER (data)) {
+    if (queue->max_list_size > 1 && gst_queue_ring_has_next_buffer (queue)) {
+      result = gst_pad_push_list (queue->srcpad,
+          gst_queue_ring_dequeue_list (queue, GST_BUFFER_CAST (data)));
+    } else {
+      result = gst_pad_push (queue->srcpad, GST_BUFFER_CAST (data));
+    }
+
+    /* need to check for srcresult here as well */
+    if (g_atomic_int_get (&queue->srcresult) != GST_FLOW_OK)
+      goto out_flushing;
+
+    if (result == GST_FLOW_EOS) {
+      GST_CAT_LOG_OBJECT (queue_dataflow, queue, "got EOS from downstream");
+      /* refuse more buffers on the sinkpad and drop all items until we see
+       * an item that we can push again, which is EOS or SEGMENT. The flag is
+       * set first so that it is cleared again by a SEGMENT that is queued
+       * while we drop. */
+      g_atomic_int_set (&queue->unexpected, TRUE);
+      while ((data = gst_queue_ring_dequeue (queue))) {
+        if (GST_QUEUE_RING_IS_QUERY (data)) {
+          gst_queue_ring_drop_query (queue, GST_QUEUE_RING_QUERY (data));
+        } else if (GST_IS_BUFFER (data)) {
+          GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+              "dropping EOS buffer %p", data);
+          gst_buffer_unref (GST_BUFFER_CAST (data));
+        } else if (GST_IS_EVENT (data)) {
+          GstEvent *event = GST_EVENT_CAST (data);
+          GstEventType type = GST_EVENT_TYPE (event);
+
+          if (type == GST_EVENT_EOS || type == GST_EVENT_SEGMENT) {
+            /* we found a pushable item in the queue, push it out */
+            GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+                "pushing pushable event %s after EOS",
+                GST_EVENT_TYPE_NAME (event));
+            if (type == GST_EVENT_SEGMENT)
+              g_atomic_int_set (&queue->unexpected, FALSE);
+            gst_queue_ring_wake (queue, &queue->waiting_del, &queue->item_del);
+            goto next;
+          }
+          GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+              "dropping EOS event %p", event);
+          gst_event_unref (event);
+        }
+      }
+      gst_queue_ring_wake (queue, &queue->waiting_del, &queue->item_del);
+      /* Since we will still accept EOS and SEGMENT we return _FLOW_OK to the
+       * caller so that the task function does not shut down. */
+      result = GST_FLOW_OK;
+    }
+  } else if (GST_IS_EVENT (data)) {
+    GstEvent *event = GST_EVENT_CAST (data);
+    GstEventType type = GST_EVENT_TYPE (event);
+
+    gst_pad_push_event (queue->srcpad, event);
+
+    if (g_atomic_int_get (&queue->srcresult) != GST_FLOW_OK)
+      goto out_flushing;
+    /* if we're EOS, return EOS so that the task pauses. */
+    if (type == GST_EVENT_EOS) {
+      GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+          "pushed EOS event %p, return EOS", event);
+      result = GST_FLOW_EOS;
+    }
+  }
+  return result;
+
+  /* ERRORS */
+no_item:
+  {
+    GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+        "exit because we have no item in the queue");
+    return GST_FLOW_ERROR;
+  }
+out_flushing:
+  {
+    GST_CAT_LOG_OBJECT (queue_dataflow, queue, "exit because we are flushing");
+    return GST_FLOW_FLUSHING;
+  }
+}
+
+/* pause the task for the flow return in srcresult, called with the queue
+ * lock, which is released */
+static void
+gst_queue_ring_pause (GstQueue * queue)
+{
+  gboolean eos = queue->eos;
+  GstFlowReturn ret = queue->srcresult;
+
+  /* restarted after a RECONFIGURE event in the meantime */
+  if (ret == GST_FLOW_OK) {
+    GST_QUEUE_MUTEX_UNLOCK (queue);
+    return;
+  }
+
+  gst_pad_pause_task (queue->srcpad);
+  GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+      "pause task, reason:  %s", gst_flow_get_name (ret));
+  if (ret == GST_FLOW_FLUSHING) {
+    /* the producer can still be running, only drop the items here. The
+     * FLUSH_STOP event resets the rest of the state. */
+    gst_queue_ring_drain (queue, FALSE);
+    queue->last_query = FALSE;
+    g_cond_signal (&queue->query_handled);
+  }
+  GST_QUEUE_SIGNAL_DEL (queue);
+  GST_QUEUE_MUTEX_UNLOCK (queue);
+  /* let app know about us giving up if upstream is not expected to do so */
+  /* EOS is already taken care of elsewhere */
+  if (eos && (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_EOS)) {
+    GST_ELEMENT_ERROR (queue, STREAM, FAILED,
+        (_("Internal data flow error.")),
+        ("streaming task paused, reason %s (%d)",
+            gst_flow_get_name (ret), ret));
+    gst_pad_push_event (queue->srcpad, gst_event_new_eos ());
+  }
+}
+
+static void
+gst_queue_ring_loop (GstQueue * queue)
+{
+  GstQueueRingConfig config;
+  GstFlowReturn ret;
+
+  if (g_atomic_int_get (&queue->srcresult) != GST_FLOW_OK)
+    goto out_flushing;
+
+  while (gst_queue_ring_is_empty (queue)) {
+    GST_CAT_DEBUG_OBJECT (queue_dataflow, queue, "queue is empty");
+    gst_queue_ring_get_config (queue, &config);
+    if (!config.silent)
+      g_signal_emit (queue, gst_queue_signals[SIGNAL_UNDERRUN], 0);
+
+    /* this rechecks, the signal could have changed the thresholds */
+    if (!gst_queue_ring_wait (queue, gst_queue_ring_is_empty,
+            &queue->waiting_add, &queue->item_add,
+            &queue->ring->consumer_spins))
+      goto out_flushing;
+
+    GST_CAT_DEBUG_OBJECT (queue_dataflow, queue, "queue is not empty");
+    gst_queue_ring_get_config (queue, &config);
+    if (!config.silent) {
+      g_signal_emit (queue, gst_queue_signals[SIGNAL_RUNNING], 0);
+      g_signal_emit (queue, gst_queue_signals[SIGNAL_PUSHING], 0);
+      if (g_atomic_int_get (&queue->srcresult) != GST_FLOW_OK)
+        goto out_flushing;
+    }
+  }
+
+  ret = gst_queue_ring_push_one (queue);
+  if (ret != GST_FLOW_OK) {
+    GST_QUEUE_MUTEX_LOCK (queue);
+    queue->srcresult = ret;
+    gst_queue_ring_pause (queue);
+  }
+  return;
+
+  /* ERRORS */
+out_flushing:
+  {
+    GST_QUEUE_MUTEX_LOCK (queue);
+    gst_queue_ring_pause (queue);
+    return;
+  }
+}
+
 static gboolean
 gst_queue_handle_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
@@ -1351,7 +2399,8 @@ gst_queue_handle_src_query (GstPad * pad, GstObject * parent, GstQuery * query)
           peer_pos -= queue->cur_level.bytes;
           break;
         case GST_FORMAT_TIME:
-          peer_pos -= queue->cur_level.time;
+          peer_pos -= queue->ring ? gst_queue_ring_level_time (queue) :
+              queue->cur_level.time;
           break;
         default:
           GST_DEBUG_OBJECT (queue, "Can't adjust query in %s format, don't "
@@ -1414,8 +2463,21 @@ gst_queue_sink_activate_mode (GstPad * pad, GstObject * parent, GstPadMode mode,
         /* step 1, unblock chain function */
         GST_QUEUE_MUTEX_LOCK (queue);
         queue->srcresult = GST_FLOW_FLUSHING;
+        /* the item del signal will unblock */
+        GST_QUEUE_SIGNAL_DEL (queue);
+        queue->last_query = FALSE;
+        g_cond_signal (&queue->query_handled);
+        GST_QUEUE_MUTEX_UNLOCK (queue);
+
+        /* step 2, wait until streaming thread stopped and flush queue. In ring
+         * mode the chain function adds to the ring and changes the sink
+         * segment and time without the queue lock, it could still be past its
+         * check of srcresult. */
+        GST_PAD_STREAM_LOCK (pad);
+        GST_QUEUE_MUTEX_LOCK (queue);
         gst_queue_locked_flush (queue, TRUE);
         GST_QUEUE_MUTEX_UNLOCK (queue);
+        GST_PAD_STREAM_UNLOCK (pad);
       }
       result = TRUE;
       break;
@@ -1442,6 +2504,7 @@ gst_queue_src_activate_mode (GstPad * pad, GstObject * parent, GstPadMode mode,
         queue->srcresult = GST_FLOW_OK;
         queue->eos = FALSE;
         queue->unexpected = FALSE;
+        gst_queue_ring_setup (queue);
         result =
             gst_pad_start_task (pad, (GstTaskFunction) gst_queue_loop, pad,
             NULL);
@@ -1468,7 +2531,7 @@ gst_queue_src_activate_mode (GstPad * pad, GstObject * parent, GstPadMode mode,
 static void
 queue_capacity_change (GstQueue * queue)
 {
-  if (queue->leaky == GST_QUEUE_LEAK_DOWNSTREAM) {
+  if (queue->leaky == GST_QUEUE_LEAK_DOWNSTREAM && !queue->ring) {
     gst_queue_leak_downstream (queue);
   }
 
@@ -1532,11 +2595,20 @@ gst_queue_set_property (GObject * object,
     case PROP_FLUSH_ON_EOS:
       queue->flush_on_eos = g_value_get_boolean (value);
       break;
+    case PROP_RING_SIZE:
+      queue->ring_size = g_value_get_uint (value);
+      break;
+    case PROP_MAX_LIST_SIZE:
+      queue->max_list_size = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 
+  if (queue->ring)
+    gst_queue_ring_update_config (queue);
+
   GST_QUEUE_MUTEX_UNLOCK (queue);
 }
 
@@ -1556,7 +2628,10 @@ gst_queue_get_property (GObject * object,
       g_value_set_uint (value, queue->cur_level.buffers);
       break;
     case PROP_CUR_LEVEL_TIME:
-      g_value_set_uint64 (value, queue->cur_level.time);
+      if (queue->ring)
+        g_value_set_uint64 (value, gst_queue_ring_level_time (queue));
+      else
+        g_value_set_uint64 (value, queue->cur_level.time);
       break;
     case PROP_MAX_SIZE_BYTES:
       g_value_set_uint (value, queue->max_size.bytes);
@@ -1585,6 +2660,12 @@ gst_queue_get_property (GObject * object,
     case PROP_FLUSH_ON_EOS:
       g_value_set_boolean (value, queue->flush_on_eos);
       break;
+    case PROP_RING_SIZE:
+      g_value_set_uint (value, queue->ring_size);
+      break;
+    case PROP_MAX_LIST_SIZE:
+      g_value_set_uint (value, queue->max_list_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
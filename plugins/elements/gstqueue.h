@@ -46,6 +46,7 @@ typedef struct _GstQueue GstQueue;
 typedef struct _GstQueueSize GstQueueSize;
 typedef enum _GstQueueLeaky GstQueueLeaky;
 typedef struct _GstQueueClass GstQueueClass;
+typedef struct _GstQueueRing GstQueueRing;
 
 /**
  * GstQueueLeaky:
@@ -137,6 +138,14 @@ struct _GstQueue {
   gboolean last_query;
 
   gboolean flush_on_eos; /* flush on EOS */
+
+  /* single-producer/single-consumer ring used instead of the locked queue
+   * when ring_size is set, NULL otherwise */
+  guint ring_size;
+  GstQueueRing *ring;
+
+  /* max. number of buffers pushed downstream in one buffer list */
+  guint max_list_size;
 };
 
 struct _GstQueueClass {
@@ -0,0 +1,145 @@
+/* GStreamer
+ *
+ * allocators.c: benchmark page faults and throughput of the allocators
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <gst/gst.h>
+
+/* one 4K I420 frame */
+#define FRAME_SIZE (3840 * 2160 * 3 / 2)
+#define NUM_FRAMES 200
+
+static glong
+get_page_faults (void)
+{
+  struct rusage usage;
+
+  getrusage (RUSAGE_SELF, &usage);
+
+  return usage.ru_minflt + usage.ru_majflt;
+}
+
+static void
+fill_frame (GstBuffer * buffer, guint i)
+{
+  GstMapInfo info;
+
+  gst_buffer_map (buffer, &info, GST_MAP_WRITE);
+  memset (info.data, i, info.size);
+  gst_buffer_unmap (buffer, &info);
+}
+
+static void
+print_result (const gchar * name, const gchar * descr, GstClockTime start,
+    glong faults, guint num_frames)
+{
+  GstClockTime end = gst_util_get_timestamp ();
+
+  g_print ("%-20s %-8s %" GST_TIME_FORMAT " - %8.1f MB/s - %8ld page faults"
+      "\n", name, descr, GST_TIME_ARGS (end - start),
+      ((gdouble) FRAME_SIZE * num_frames / (1024 * 1024)) /
+      ((gdouble) (end - start) / GST_SECOND), get_page_faults () - faults);
+}
+
+/* allocate, fill and free every frame */
+static void
+run_alloc_test (GstAllocator * allocator, const gchar * name,
+    guint num_frames)
+{
+  GstClockTime start;
+  glong faults;
+  guint i;
+
+  faults = get_page_faults ();
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < num_frames; i++) {
+    GstBuffer *buffer;
+
+    buffer = gst_buffer_new_allocate (allocator, FRAME_SIZE, NULL);
+    fill_frame (buffer, i);
+    gst_buffer_unref (buffer);
+  }
+  print_result (name, "alloc", start, faults, num_frames);
+}
+
+/* fill frames from a bufferpool configured with the allocator */
+static void
+run_pool_test (GstAllocator * allocator, const gchar * name,
+    guint num_frames)
+{
+  GstBufferPool *pool;
+  GstStructure *config;
+  GstClockTime start;
+  glong faults;
+  guint i;
+
+  faults = get_page_faults ();
+  start = gst_util_get_timestamp ();
+
+  pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, NULL, FRAME_SIZE, 4, 0);
+  gst_buffer_pool_config_set_allocator (config, allocator, NULL);
+  gst_buffer_pool_set_config (pool, config);
+  gst_buffer_pool_set_active (pool, TRUE);
+
+  for (i = 0; i < num_frames; i++) {
+    GstBuffer *buffer;
+
+    gst_buffer_pool_acquire_buffer (pool, &buffer, NULL);
+    fill_frame (buffer, i);
+    gst_buffer_unref (buffer);
+  }
+
+  gst_buffer_pool_set_active (pool, FALSE);
+  gst_object_unref (pool);
+
+  print_result (name, "pool", start, faults, num_frames);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  const gchar *names[] = { GST_ALLOCATOR_SYSMEM, GST_ALLOCATOR_MMAP,
+    GST_ALLOCATOR_MMAP_PREFAULT
+  };
+  guint num_frames = NUM_FRAMES;
+  guint i;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    num_frames = atoi (argv[1]);
+
+  for (i = 0; i < G_N_ELEMENTS (names); i++) {
+    GstAllocator *allocator;
+
+    if (!(allocator = gst_allocator_find (names[i]))) {
+      g_print ("%-20s not available\n", names[i]);
+      continue;
+    }
+    run_alloc_test (allocator, names[i], num_frames);
+    run_pool_test (allocator, names[i], num_frames);
+    gst_object_unref (allocator);
+  }
+
+  return 0;
+}
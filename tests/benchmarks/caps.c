@@ -1,7 +1,7 @@
 /* GStreamer
  * Copyright (C) 2005 Andy Wingo <wingo@pobox.com>
  *
- * caps.c: benchmark for caps creation and destruction
+ * caps.c: benchmark for caps creation, destruction and operations
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Library General Public
@@ -40,6 +40,247 @@
   "rate = (int) [ 1, MAX ], " \
   "channels = (int) [ 1, MAX ]"
 
+#define AUDIO_FIXED_CAPS \
+  "audio/x-raw, format = (string) S16LE, rate = (int) 44100, " \
+  "channels = (int) 2"
+
+#define NUM_OPS 100000
+
+static void
+print_result (GstClockTime start, const gchar * descr)
+{
+  GstClockTime end = gst_util_get_timestamp ();
+
+  g_print ("%" GST_TIME_FORMAT " - average %" G_GUINT64_FORMAT " ns - %s\n",
+      GST_TIME_ARGS (end - start), (end - start) / NUM_OPS, descr);
+}
+
+/* the value operations that the caps operations are made of */
+static void
+run_value_tests (void)
+{
+  GValue v_int = G_VALUE_INIT, v_range = G_VALUE_INIT, dest = G_VALUE_INIT;
+  GValue v_frac = G_VALUE_INIT, v_frange = G_VALUE_INIT;
+  GstClockTime start;
+  gint i;
+
+  g_value_init (&v_int, G_TYPE_INT);
+  g_value_set_int (&v_int, 44100);
+  g_value_init (&v_range, GST_TYPE_INT_RANGE);
+  gst_value_set_int_range (&v_range, 1, G_MAXINT);
+  g_value_init (&v_frac, GST_TYPE_FRACTION);
+  gst_value_set_fraction (&v_frac, 30, 1);
+  g_value_init (&v_frange, GST_TYPE_FRACTION_RANGE);
+  gst_value_set_fraction_range_full (&v_frange, 0, 1, G_MAXINT, 1);
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < NUM_OPS; i++) {
+    gst_value_intersect (&dest, &v_range, &v_int);
+    g_value_unset (&dest);
+  }
+  print_result (start, "gst_value_intersect int range / int");
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < NUM_OPS; i++) {
+    gst_value_intersect (&dest, &v_frac, &v_frange);
+    g_value_unset (&dest);
+  }
+  print_result (start, "gst_value_intersect fraction / fraction range");
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < NUM_OPS; i++)
+    gst_value_can_intersect (&v_frange, &v_frac);
+  print_result (start, "gst_value_can_intersect fraction range / fraction");
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < NUM_OPS; i++) {
+    gst_value_subtract (&dest, &v_range, &v_int);
+    g_value_unset (&dest);
+  }
+  print_result (start, "gst_value_subtract int range - int");
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < NUM_OPS; i++) {
+    gst_value_union (&dest, &v_int, &v_range);
+    g_value_unset (&dest);
+  }
+  print_result (start, "gst_value_union int / int range");
+
+  g_value_unset (&v_int);
+  g_value_unset (&v_range);
+  g_value_unset (&v_frac);
+  g_value_unset (&v_frange);
+}
+
+static void
+run_caps_tests (GstCaps * templ)
+{
+  GstCaps *fixed, *res;
+  GstClockTime start;
+  gint i;
+
+  fixed = gst_caps_from_string (AUDIO_FIXED_CAPS);
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < NUM_OPS; i++) {
+    res = gst_caps_intersect (templ, fixed);
+    gst_caps_unref (res);
+  }
+  print_result (start, "gst_caps_intersect template / fixed");
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < NUM_OPS; i++)
+    gst_caps_can_intersect (fixed, templ);
+  print_result (start, "gst_caps_can_intersect fixed / template");
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < NUM_OPS; i++)
+    gst_caps_is_subset (fixed, templ);
+  print_result (start, "gst_caps_is_subset fixed / template");
+
+  gst_caps_unref (fixed);
+}
+
+static const gchar *video_formats[] = {
+  "I420", "YV12", "YUY2", "UYVY", "AYUV", "RGBx", "BGRx", "xRGB", "xBGR",
+  "RGBA", "BGRA", "ARGB", "ABGR", "RGB", "BGR", "Y41B", "Y42B", "YVYU",
+  "Y444", "v210", "v216", "NV12", "NV21", "GRAY8", "GRAY16_BE", "GRAY16_LE",
+  "v308", "RGB16", "BGR16", "RGB15", "BGR15", "UYVP", "A420", "RGB8P",
+  "YUV9", "YVU9", "IYU1", "ARGB64", "AYUV64", "r210", "I420_10LE",
+  "I420_10BE", "I422_10LE", "I422_10BE"
+};
+
+/* caps like the pad templates of many elements together, one structure per
+ * raw video format and feature, plus many other media types */
+static GstCaps *
+make_large_caps (guint n_other, gboolean reverse)
+{
+  GstCaps *caps;
+  guint i, n;
+
+  caps = gst_caps_new_empty ();
+  n = G_N_ELEMENTS (video_formats);
+  for (i = 0; i < n; i++) {
+    const gchar *format = video_formats[reverse ? n - 1 - i : i];
+
+    gst_caps_append_structure (caps, gst_structure_new ("video/x-raw",
+            "format", G_TYPE_STRING, format,
+            "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+            "height", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+            "framerate", GST_TYPE_FRACTION_RANGE, 0, 1, G_MAXINT, 1, NULL));
+    gst_caps_append_structure_full (caps, gst_structure_new ("video/x-raw",
+            "format", G_TYPE_STRING, format,
+            "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+            "height", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL),
+        gst_caps_features_new ("memory:GLMemory", NULL));
+  }
+  for (i = 0; i < n_other; i++) {
+    gchar *name = g_strdup_printf ("application/x-test-%u",
+        reverse ? n_other - 1 - i : i);
+
+    gst_caps_append_structure (caps, gst_structure_new (name,
+            "rate", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL));
+    g_free (name);
+  }
+  return caps;
+}
+
+static void
+run_large_caps_tests (void)
+{
+  GstCaps *caps1, *caps2, *res;
+  GstClockTime start, end;
+  guint i, num_ops = NUM_OPS / 1000;
+
+  caps1 = make_large_caps (200, FALSE);
+  caps2 = make_large_caps (200, TRUE);
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < num_ops; i++) {
+    res = gst_caps_intersect_full (caps1, caps2, GST_CAPS_INTERSECT_ZIG_ZAG);
+    gst_caps_unref (res);
+  }
+  end = gst_util_get_timestamp ();
+  g_print ("%" GST_TIME_FORMAT " - average %" G_GUINT64_FORMAT " ns - "
+      "zig-zag intersect of %u by %u structures\n",
+      GST_TIME_ARGS (end - start), (end - start) / num_ops,
+      gst_caps_get_size (caps1), gst_caps_get_size (caps2));
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < num_ops; i++) {
+    res = gst_caps_intersect_full (caps1, caps2, GST_CAPS_INTERSECT_FIRST);
+    gst_caps_unref (res);
+  }
+  end = gst_util_get_timestamp ();
+  g_print ("%" GST_TIME_FORMAT " - average %" G_GUINT64_FORMAT " ns - "
+      "first intersect of %u by %u structures\n",
+      GST_TIME_ARGS (end - start), (end - start) / num_ops,
+      gst_caps_get_size (caps1), gst_caps_get_size (caps2));
+
+  gst_caps_unref (caps2);
+  caps2 = gst_caps_from_string ("application/x-test-199, rate=(int)44100");
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < num_ops; i++)
+    gst_caps_can_intersect (caps1, caps2);
+  end = gst_util_get_timestamp ();
+  g_print ("%" GST_TIME_FORMAT " - average %" G_GUINT64_FORMAT " ns - "
+      "can_intersect of %u structures with the last one\n",
+      GST_TIME_ARGS (end - start), (end - start) / num_ops,
+      gst_caps_get_size (caps1));
+
+  gst_caps_unref (caps2);
+  gst_caps_unref (caps1);
+}
+
+static void
+run_simplify_test (GstCaps * caps, const gchar * descr)
+{
+  GstCaps *res;
+  GstClockTime start, end;
+  guint i, num_ops = NUM_OPS / 100, size = 0;
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < num_ops; i++) {
+    /* simplify works in place, give it a new copy every time */
+    res = gst_caps_simplify (gst_caps_copy (caps));
+    size = gst_caps_get_size (res);
+    gst_caps_unref (res);
+  }
+  end = gst_util_get_timestamp ();
+  g_print ("%" GST_TIME_FORMAT " - average %" G_GUINT64_FORMAT " ns - "
+      "copy and simplify %s, %u to %u structures\n",
+      GST_TIME_ARGS (end - start), (end - start) / num_ops, descr,
+      gst_caps_get_size (caps), size);
+}
+
+static void
+run_simplify_tests (void)
+{
+  GstCaps *caps;
+  guint i;
+
+  /* the format lists of raw video elements, one structure per format */
+  caps = make_large_caps (0, FALSE);
+  run_simplify_test (caps, "raw video formats");
+  gst_caps_unref (caps);
+
+  /* the same with some more media types */
+  caps = make_large_caps (200, FALSE);
+  run_simplify_test (caps, "raw video formats and other types");
+  gst_caps_unref (caps);
+
+  /* already simple, nothing to merge */
+  caps = gst_caps_new_empty ();
+  for (i = 0; i < 200; i++) {
+    gchar *name = g_strdup_printf ("application/x-test-%u", i);
+
+    gst_caps_append_structure (caps, gst_structure_new (name,
+            "rate", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL));
+    g_free (name);
+  }
+  run_simplify_test (caps, "simple caps");
+  gst_caps_unref (caps);
+}
 
 gint
 main (gint argc, gchar * argv[])
@@ -69,6 +310,12 @@ main (gint argc, gchar * argv[])
       GST_TIME_ARGS (end - start), i);
 
   g_free (capses);
+
+  run_value_tests ();
+  run_caps_tests (protocaps);
+  run_large_caps_tests ();
+  run_simplify_tests ();
+
   gst_caps_unref (protocaps);
 
   return 0;
@@ -26,6 +26,9 @@
  *  -c children: is the number of branches on each level
  *  -f <flavour>: can be a=udio/v=ideo and is conttrolling the kind of elements
  *                that are used.
+ *  -n queries: the number of caps queries on the sink after reaching paused,
+ *              like renegotiation and autoplugging do
+ *  -C: enable the caps query cache on all pads
  */
 
 #include <gst/gst.h>
@@ -131,6 +134,60 @@ create_nodes (GstBin * bin, GstElement * sink, gint depth, gint children,
   return TRUE;
 }
 
+static void
+enable_caps_cache (GstBin * bin)
+{
+  GstIterator *it;
+  GValue item = G_VALUE_INIT;
+
+  it = gst_bin_iterate_elements (bin);
+  while (gst_iterator_next (it, &item) == GST_ITERATOR_OK) {
+    GstElement *element = g_value_get_object (&item);
+    GList *walk;
+
+    GST_OBJECT_LOCK (element);
+    for (walk = element->pads; walk; walk = g_list_next (walk)) {
+      GstPad *pad = walk->data;
+
+      GST_OBJECT_LOCK (pad);
+      GST_PAD_SET_CACHE_CAPS (pad);
+      GST_OBJECT_UNLOCK (pad);
+    }
+    GST_OBJECT_UNLOCK (element);
+    g_value_reset (&item);
+  }
+  g_value_unset (&item);
+  gst_iterator_free (it);
+}
+
+static void
+run_queries (GstElement * sink, gint num_queries)
+{
+  GstPad *pad;
+  GstClockTime start, end;
+  gint i;
+
+  pad = gst_element_get_static_pad (sink, "sink");
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < num_queries; i++) {
+    GstCaps *caps;
+
+    /* a new reconfigure every 10 queries */
+    if (i % 10 == 0)
+      gst_pad_mark_reconfigure (pad);
+
+    caps = gst_pad_peer_query_caps (pad, NULL);
+    gst_caps_unref (caps);
+  }
+  end = gst_util_get_timestamp ();
+
+  g_print ("%" GST_TIME_FORMAT " for %d caps queries\n",
+      GST_TIME_ARGS (end - start), num_queries);
+
+  gst_object_unref (pad);
+}
+
 static void
 event_loop (GstElement * bin, GstClockTime start)
 {
@@ -208,6 +265,8 @@ main (gint argc, gchar * argv[])
   gint children = 3;
   gint flavour = FLAVOUR_AUDIO;
   const gchar *flavour_str = "audio";
+  gint num_queries = 1000;
+  gboolean cache_caps = FALSE;
 
   gst_init (&argc, &argv);
 
@@ -223,6 +282,12 @@ main (gint argc, gchar * argv[])
         arg++;
         if (arg < argc)
           children = atoi (argv[arg]);
+      } else if (!strcmp (argv[arg], "-n")) {
+        arg++;
+        if (arg < argc)
+          num_queries = atoi (argv[arg]);
+      } else if (!strcmp (argv[arg], "-C")) {
+        cache_caps = TRUE;
       } else if (!strcmp (argv[arg], "-f")) {
         arg++;
         if (arg < argc) {
@@ -243,8 +308,8 @@ main (gint argc, gchar * argv[])
   }
 
   /* build pipeline */
-  g_print ("building %s pipeline with depth = %d and children = %d\n",
-      flavour_str, depth, children);
+  g_print ("building %s pipeline with depth = %d and children = %d%s\n",
+      flavour_str, depth, children, cache_caps ? ", caching caps" : "");
   start = gst_util_get_timestamp ();
   bin = GST_BIN (gst_pipeline_new ("pipeline"));
   sink = gst_element_factory_make ("fakesink", NULL);
@@ -260,6 +325,9 @@ main (gint argc, gchar * argv[])
   g_print ("%" GST_TIME_FORMAT " built pipeline with %d elements\n",
       GST_TIME_ARGS (end - start), GST_BIN_NUMCHILDREN (bin));
 
+  if (cache_caps)
+    enable_caps_cache (bin);
+
   /* measure */
   g_print ("starting pipeline\n");
   gst_element_set_state (GST_ELEMENT (bin), GST_STATE_READY);
@@ -271,6 +339,9 @@ main (gint argc, gchar * argv[])
   g_print ("%" GST_TIME_FORMAT " reached paused\n",
       GST_TIME_ARGS (end - start));
 
+  /* measure renegotiation */
+  run_queries (sink, num_queries);
+
   /* clean up */
 Error:
   gst_element_set_state (GST_ELEMENT (bin), GST_STATE_NULL);
@@ -0,0 +1,170 @@
+/* GStreamer
+ *
+ * factoryfilter.c: benchmark filtering element factories on caps
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define NUM_FACTORIES 2000
+#define NUM_FILTERS 1000
+
+/* each fake element has a sink template for its own media type */
+static void
+bench_element_class_init (GstElementClass * klass, gpointer class_data)
+{
+  guint i = GPOINTER_TO_UINT (class_data);
+  GstCaps *caps;
+  gchar *media_type;
+
+  media_type = g_strdup_printf ("application/x-bench-%u", i);
+  caps = gst_caps_new_simple (media_type,
+      "rate", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL);
+  g_free (media_type);
+  gst_element_class_add_pad_template (klass,
+      gst_pad_template_new ("sink", GST_PAD_SINK, GST_PAD_ALWAYS, caps));
+  gst_caps_unref (caps);
+
+  caps = gst_caps_from_string ("video/x-raw, format=(string)I420");
+  gst_element_class_add_pad_template (klass,
+      gst_pad_template_new ("src", GST_PAD_SRC, GST_PAD_ALWAYS, caps));
+  gst_caps_unref (caps);
+
+  gst_element_class_set_static_metadata (klass, "Bench", "Codec/Decoder",
+      "Benchmark element", "GStreamer maintainers "
+      "<gstreamer-devel@lists.freedesktop.org>");
+}
+
+static void
+register_factories (guint num_factories)
+{
+  guint i;
+
+  for (i = 0; i < num_factories; i++) {
+    GTypeInfo info = { 0, };
+    gchar *name;
+    GType type;
+
+    info.class_size = sizeof (GstElementClass);
+    info.class_init = (GClassInitFunc) bench_element_class_init;
+    info.class_data = GUINT_TO_POINTER (i);
+    info.instance_size = sizeof (GstElement);
+
+    name = g_strdup_printf ("GstBenchElement%u", i);
+    type = g_type_register_static (GST_TYPE_ELEMENT, name, &info, 0);
+    g_free (name);
+
+    name = g_strdup_printf ("benchelement%u", i);
+    gst_element_register (NULL, name, GST_RANK_PRIMARY, type);
+    g_free (name);
+  }
+}
+
+/* what gst_element_factory_list_filter() does without the index */
+static GList *
+filter_all (GList * list, const GstCaps * caps, GstPadDirection direction)
+{
+  GQueue results = G_QUEUE_INIT;
+
+  for (; list; list = list->next) {
+    GstElementFactory *factory = list->data;
+    const GList *walk;
+
+    for (walk = gst_element_factory_get_static_pad_templates (factory); walk;
+        walk = walk->next) {
+      GstStaticPadTemplate *templ = walk->data;
+      GstCaps *tmpl_caps;
+      gboolean match;
+
+      if (templ->direction != direction)
+        continue;
+
+      tmpl_caps = gst_static_caps_get (&templ->static_caps);
+      match = gst_caps_can_intersect (caps, tmpl_caps);
+      gst_caps_unref (tmpl_caps);
+      if (match) {
+        g_queue_push_tail (&results, gst_object_ref (factory));
+        break;
+      }
+    }
+  }
+  return results.head;
+}
+
+static void
+print_result (const gchar * descr, GstClockTime start, guint num_filters,
+    guint num_results)
+{
+  GstClockTime end = gst_util_get_timestamp ();
+
+  g_print ("%" GST_TIME_FORMAT " - average %" G_GUINT64_FORMAT
+      " ns - %u filters %s, %u results\n", GST_TIME_ARGS (end - start),
+      (end - start) / num_filters, num_filters, descr, num_results);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  GstClockTime start;
+  GList *factories, *res;
+  GstCaps *caps;
+  guint num_factories = NUM_FACTORIES;
+  guint i, n = 0;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    num_factories = atoi (argv[1]);
+
+  register_factories (num_factories);
+
+  factories = gst_element_factory_list_get_elements
+      (GST_ELEMENT_FACTORY_TYPE_DECODER, GST_RANK_MARGINAL);
+  g_print ("%u decoders\n", g_list_length (factories));
+
+  caps = gst_caps_from_string ("application/x-bench-1, rate=(int)44100");
+
+  /* the first filter makes the index of each factory */
+  start = gst_util_get_timestamp ();
+  res = gst_element_factory_list_filter (factories, caps, GST_PAD_SINK, FALSE);
+  n = g_list_length (res);
+  gst_plugin_feature_list_free (res);
+  print_result ("making the index", start, 1, n);
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < NUM_FILTERS; i++) {
+    res = filter_all (factories, caps, GST_PAD_SINK);
+    n = g_list_length (res);
+    gst_plugin_feature_list_free (res);
+  }
+  print_result ("checking all factories", start, NUM_FILTERS, n);
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < NUM_FILTERS; i++) {
+    res = gst_element_factory_list_filter (factories, caps, GST_PAD_SINK,
+        FALSE);
+    n = g_list_length (res);
+    gst_plugin_feature_list_free (res);
+  }
+  print_result ("with the index", start, NUM_FILTERS, n);
+
+  gst_caps_unref (caps);
+  gst_plugin_feature_list_free (factories);
+
+  return 0;
+}
@@ -22,6 +22,131 @@
 #include <gst/gst.h>
 #include "gst/glib-compat-private.h"
 
+#define MAX_THREADS 64
+
+static GstBufferPool *
+make_pool (gboolean thread_cache, guint max_buffers)
+{
+  GstBufferPool *pool;
+  GstStructure *conf;
+
+  pool = gst_buffer_pool_new ();
+
+  conf = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (conf, NULL, 1400, 0, max_buffers);
+  if (thread_cache)
+    gst_buffer_pool_config_add_option (conf,
+        GST_BUFFER_POOL_OPTION_THREAD_CACHE);
+  gst_buffer_pool_set_config (pool, conf);
+
+  gst_buffer_pool_set_active (pool, TRUE);
+
+  return pool;
+}
+
+typedef struct
+{
+  GstBufferPool *pool;
+  guint64 nbuffers;
+  GAsyncQueue *queue;
+} ThreadData;
+
+/* acquire and release in the same thread */
+static gpointer
+run_acquire_release (ThreadData * data)
+{
+  GstBuffer *tmp;
+  guint64 i;
+
+  for (i = 0; i < data->nbuffers; i++) {
+    gst_buffer_pool_acquire_buffer (data->pool, &tmp, NULL);
+    gst_buffer_unref (tmp);
+  }
+  return NULL;
+}
+
+/* acquire and pass to a consumer thread, with at most 8 buffers in the pool
+ * so that the producer has to wait for the consumer */
+static gpointer
+run_producer (ThreadData * data)
+{
+  GstBuffer *tmp;
+  guint64 i;
+
+  for (i = 0; i < data->nbuffers; i++) {
+    gst_buffer_pool_acquire_buffer (data->pool, &tmp, NULL);
+    g_async_queue_push (data->queue, tmp);
+  }
+  return NULL;
+}
+
+static gpointer
+run_consumer (ThreadData * data)
+{
+  guint64 i;
+
+  for (i = 0; i < data->nbuffers; i++)
+    gst_buffer_unref (g_async_queue_pop (data->queue));
+
+  return NULL;
+}
+
+static void
+run_threads (guint64 nbuffers, gint nthreads, gboolean thread_cache)
+{
+  GThread *threads[MAX_THREADS];
+  ThreadData data;
+  GstClockTime start, end;
+  gint t;
+
+  data.pool = make_pool (thread_cache, 0);
+  data.nbuffers = nbuffers;
+
+  start = gst_util_get_timestamp ();
+  for (t = 0; t < nthreads; t++)
+    threads[t] = g_thread_new ("pool", (GThreadFunc) run_acquire_release,
+        &data);
+  for (t = 0; t < nthreads; t++)
+    g_thread_join (threads[t]);
+  end = gst_util_get_timestamp ();
+
+  g_print ("*** total %" GST_TIME_FORMAT " - average %" GST_TIME_FORMAT
+      "  - %d threads acquire/release %s\n", GST_TIME_ARGS (end - start),
+      GST_TIME_ARGS ((end - start) / (nbuffers * nthreads)), nthreads,
+      thread_cache ? "with thread cache" : "");
+
+  gst_buffer_pool_set_active (data.pool, FALSE);
+  gst_object_unref (data.pool);
+}
+
+static void
+run_producer_consumer (guint64 nbuffers, gboolean thread_cache)
+{
+  GThread *producer, *consumer;
+  ThreadData data;
+  GstClockTime start, end;
+
+  data.pool = make_pool (thread_cache, 8);
+  data.nbuffers = nbuffers;
+  data.queue = g_async_queue_new ();
+
+  start = gst_util_get_timestamp ();
+  consumer = g_thread_new ("consumer", (GThreadFunc) run_consumer, &data);
+  producer = g_thread_new ("producer", (GThreadFunc) run_producer, &data);
+  g_thread_join (producer);
+  g_thread_join (consumer);
+  end = gst_util_get_timestamp ();
+
+  g_print ("*** total %" GST_TIME_FORMAT " - average %" GST_TIME_FORMAT
+      "  - producer/consumer %s\n", GST_TIME_ARGS (end - start),
+      GST_TIME_ARGS ((end - start) / nbuffers),
+      thread_cache ? "with thread cache" : "");
+
+  g_async_queue_unref (data.queue);
+  gst_buffer_pool_set_active (data.pool, FALSE);
+  gst_object_unref (data.pool);
+}
+
 
 gint
 main (gint argc, gchar * argv[])
@@ -32,15 +157,23 @@ main (gint argc, gchar * argv[])
   GstClockTime start, end;
   guint64 nbuffers;
   GstStructure *conf;
+  gint nthreads = 4;
 
   gst_init (&argc, &argv);
 
-  if (argc != 2) {
-    g_print ("usage: %s <nbuffers>\n", argv[0]);
+  if (argc != 2 && argc != 3) {
+    g_print ("usage: %s <nbuffers> [nthreads]\n", argv[0]);
     exit (-1);
   }
 
   nbuffers = atoi (argv[1]);
+  if (argc == 3)
+    nthreads = atoi (argv[2]);
+
+  if (nthreads <= 0 || nthreads > MAX_THREADS) {
+    g_print ("number of threads must be between 1 and %d\n", MAX_THREADS);
+    exit (-2);
+  }
 
   if (nbuffers <= 0) {
     g_print ("number of buffers must be greater than 0\n");
@@ -86,5 +219,12 @@ main (gint argc, gchar * argv[])
   gst_buffer_pool_set_active (pool, FALSE);
   gst_object_unref (pool);
 
+  run_threads (nbuffers, 1, FALSE);
+  run_threads (nbuffers, 1, TRUE);
+  run_threads (nbuffers, nthreads, FALSE);
+  run_threads (nbuffers, nthreads, TRUE);
+  run_producer_consumer (nbuffers, FALSE);
+  run_producer_consumer (nbuffers, TRUE);
+
   return 0;
 }
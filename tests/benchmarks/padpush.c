@@ -0,0 +1,104 @@
+/* GStreamer
+ *
+ * padpush.c: benchmark for pushing buffers over a pad link
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define NUM_BUFFERS 1000000
+
+static GstFlowReturn
+chain_func (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  gst_buffer_unref (buffer);
+  return GST_FLOW_OK;
+}
+
+static GstPadProbeReturn
+probe_func (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+run_test (GstPad * src, GstBuffer * buffer, guint num_buffers,
+    const gchar * descr)
+{
+  GstClockTime start, end;
+  guint i;
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < num_buffers; i++) {
+    if (gst_pad_push (src, gst_buffer_ref (buffer)) != GST_FLOW_OK)
+      g_error ("push failed");
+  }
+  end = gst_util_get_timestamp ();
+
+  g_print ("%" GST_TIME_FORMAT " - average %" G_GUINT64_FORMAT
+      " ns - pushing %u buffers %s\n", GST_TIME_ARGS (end - start),
+      (end - start) / num_buffers, num_buffers, descr);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  GstPad *src, *sink;
+  GstSegment segment;
+  GstBuffer *buffer;
+  gulong id;
+  guint num_buffers = NUM_BUFFERS;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    num_buffers = atoi (argv[1]);
+
+  src = gst_pad_new ("src", GST_PAD_SRC);
+  sink = gst_pad_new ("sink", GST_PAD_SINK);
+  gst_pad_set_chain_function (sink, chain_func);
+
+  gst_pad_set_active (src, TRUE);
+  gst_pad_set_active (sink, TRUE);
+  gst_pad_link (src, sink);
+
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (src, gst_event_new_stream_start ("padpush"));
+  gst_pad_push_event (src, gst_event_new_segment (&segment));
+
+  buffer = gst_buffer_new ();
+
+  /* a probe on the srcpad makes every push take the locks and walk the
+   * probes, as it was before the fast path */
+  id = gst_pad_add_probe (src, GST_PAD_PROBE_TYPE_BUFFER, probe_func,
+      NULL, NULL);
+  run_test (src, buffer, num_buffers, "with probe (locked path)");
+  gst_pad_remove_probe (src, id);
+
+  run_test (src, buffer, num_buffers, "on stable link (fast path)");
+
+  gst_buffer_unref (buffer);
+
+  gst_pad_unlink (src, sink);
+  gst_pad_set_active (src, FALSE);
+  gst_pad_set_active (sink, FALSE);
+  gst_object_unref (src);
+  gst_object_unref (sink);
+
+  return 0;
+}
@@ -0,0 +1,133 @@
+/* GStreamer
+ *
+ * queue.c: benchmark for passing buffers through a queue
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define NUM_BUFFERS 1000000
+#define RING_SIZE 256
+
+static GMutex lock;
+static GCond cond;
+static volatile gint received;
+static gint expected;
+static GstClockTime latency_total;
+static GstClockTime latency_max;
+
+/* the offset of the buffers is the time they were pushed into the queue */
+static GstFlowReturn
+chain_func (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstClockTime latency;
+
+  latency = gst_util_get_timestamp () - GST_BUFFER_OFFSET (buffer);
+  gst_buffer_unref (buffer);
+
+  latency_total += latency;
+  if (latency > latency_max)
+    latency_max = latency;
+
+  if (g_atomic_int_add (&received, 1) + 1 == expected) {
+    g_mutex_lock (&lock);
+    g_cond_signal (&cond);
+    g_mutex_unlock (&lock);
+  }
+  return GST_FLOW_OK;
+}
+
+static void
+run_test (guint ring_size, guint num_buffers, const gchar * descr)
+{
+  GstElement *queue;
+  GstPad *src, *sink, *qpad;
+  GstSegment segment;
+  GstClockTime start, end;
+  guint i;
+
+  queue = gst_element_factory_make ("queue", NULL);
+  if (queue == NULL)
+    g_error ("need the queue element");
+  g_object_set (queue, "ring-size", ring_size, "silent", TRUE, NULL);
+
+  src = gst_pad_new ("src", GST_PAD_SRC);
+  sink = gst_pad_new ("sink", GST_PAD_SINK);
+  gst_pad_set_chain_function (sink, chain_func);
+
+  gst_pad_set_active (src, TRUE);
+  gst_pad_set_active (sink, TRUE);
+
+  qpad = gst_element_get_static_pad (queue, "sink");
+  gst_pad_link (src, qpad);
+  gst_object_unref (qpad);
+  qpad = gst_element_get_static_pad (queue, "src");
+  gst_pad_link (qpad, sink);
+  gst_object_unref (qpad);
+
+  gst_element_set_state (queue, GST_STATE_PLAYING);
+
+  gst_pad_push_event (src, gst_event_new_stream_start ("queue"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (src, gst_event_new_segment (&segment));
+
+  received = 0;
+  expected = num_buffers;
+  latency_total = latency_max = 0;
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < num_buffers; i++) {
+    GstBuffer *buffer = gst_buffer_new ();
+
+    GST_BUFFER_OFFSET (buffer) = gst_util_get_timestamp ();
+    if (gst_pad_push (src, buffer) != GST_FLOW_OK)
+      g_error ("push failed");
+  }
+  g_mutex_lock (&lock);
+  while (g_atomic_int_get (&received) < expected)
+    g_cond_wait (&cond, &lock);
+  g_mutex_unlock (&lock);
+  end = gst_util_get_timestamp ();
+
+  g_print ("%" GST_TIME_FORMAT " - average %" G_GUINT64_FORMAT
+      " ns, latency average %" G_GUINT64_FORMAT " ns, max %" G_GUINT64_FORMAT
+      " ns - passing %u buffers %s\n", GST_TIME_ARGS (end - start),
+      (end - start) / num_buffers, latency_total / num_buffers, latency_max,
+      num_buffers, descr);
+
+  gst_element_set_state (queue, GST_STATE_NULL);
+  gst_object_unref (queue);
+  gst_object_unref (src);
+  gst_object_unref (sink);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  guint num_buffers = NUM_BUFFERS;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    num_buffers = atoi (argv[1]);
+
+  run_test (0, num_buffers, "through the locked queue");
+  run_test (RING_SIZE, num_buffers, "through the ring");
+
+  return 0;
+}
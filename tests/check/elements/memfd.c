@@ -0,0 +1,262 @@
+/* GStreamer
+ *
+ * unit test for memfdsink and memfdsrc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <unistd.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <gst/check/gstcheck.h>
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstBuffer *
+receive_buffer (void)
+{
+  GstBuffer *buffer;
+
+  g_mutex_lock (&check_mutex);
+  while (buffers == NULL)
+    g_cond_wait (&check_cond, &check_mutex);
+  buffer = buffers->data;
+  buffers = g_list_delete_link (buffers, buffers);
+  g_mutex_unlock (&check_mutex);
+
+  return buffer;
+}
+
+static void
+check_pass_buffer (GstAllocator * allocator)
+{
+  GstElement *sink, *src;
+  GstPad *mysrcpad, *mysinkpad;
+  GstBuffer *buffer, *received;
+  GstMemory *mem;
+  GstMapInfo info;
+  gint fds[2];
+  guint i;
+
+  fail_if (socketpair (AF_UNIX, SOCK_SEQPACKET, 0, fds) < 0);
+
+  sink = gst_check_setup_element ("memfdsink");
+  mysrcpad = gst_check_setup_src_pad (sink, &srctemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  g_object_set (sink, "fd", fds[0], NULL);
+
+  src = gst_check_setup_element ("memfdsrc");
+  mysinkpad = gst_check_setup_sink_pad (src, &sinktemplate);
+  gst_pad_set_active (mysinkpad, TRUE);
+  g_object_set (src, "fd", fds[1], NULL);
+
+  fail_unless (gst_element_set_state (src,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS);
+  fail_if (gst_element_set_state (sink,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  gst_check_setup_events (mysrcpad, sink, NULL, GST_FORMAT_TIME);
+
+  buffer = gst_buffer_new_allocate (allocator, 1000, NULL);
+  gst_buffer_map (buffer, &info, GST_MAP_WRITE);
+  for (i = 0; i < info.size; i++)
+    info.data[i] = i;
+  gst_buffer_unmap (buffer, &info);
+  GST_BUFFER_PTS (buffer) = 10 * GST_SECOND;
+  GST_BUFFER_DURATION (buffer) = GST_SECOND;
+
+  fail_unless (gst_pad_push (mysrcpad, gst_buffer_ref (buffer)) ==
+      GST_FLOW_OK);
+
+  received = receive_buffer ();
+  fail_unless (GST_BUFFER_PTS (received) == 10 * GST_SECOND);
+  fail_unless (GST_BUFFER_DURATION (received) == GST_SECOND);
+  fail_unless (gst_buffer_n_memory (received) == 1);
+
+  mem = gst_buffer_peek_memory (received, 0);
+  fail_unless (gst_memory_get_fd (mem, NULL) >= 0);
+  fail_unless (GST_MEMORY_IS_READONLY (mem));
+
+  gst_buffer_map (received, &info, GST_MAP_READ);
+  fail_unless (info.size == 1000);
+  for (i = 0; i < info.size; i++)
+    fail_unless (info.data[i] == (guint8) i);
+  gst_buffer_unmap (received, &info);
+
+  /* with fd memory, writes of the sender are visible to the receiver */
+  if (allocator) {
+    /* the sink keeps the buffer until the receiver released it */
+    fail_unless (GST_MINI_OBJECT_REFCOUNT_VALUE (buffer) == 2);
+
+    mem = gst_buffer_peek_memory (buffer, 0);
+    gst_memory_map (mem, &info, GST_MAP_WRITE);
+    info.data[0] = 0xff;
+    gst_memory_unmap (mem, &info);
+    fail_unless (gst_buffer_memcmp (received, 0, "\xff", 1) == 0);
+  }
+  gst_buffer_unref (received);
+
+  /* the release message arrives asynchronously */
+  while (GST_MINI_OBJECT_REFCOUNT_VALUE (buffer) > 1)
+    g_usleep (G_USEC_PER_SEC / 1000);
+  gst_buffer_unref (buffer);
+
+  /* closing the socket makes the src go EOS */
+  fail_unless (gst_element_set_state (sink,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  close (fds[0]);
+
+  fail_unless (gst_element_set_state (src,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  close (fds[1]);
+
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_check_teardown_src_pad (sink);
+  gst_check_teardown_element (sink);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_sink_pad (src);
+  gst_check_teardown_element (src);
+  gst_check_drop_buffers ();
+}
+
+GST_START_TEST (test_pass_sysmem)
+{
+  /* sysmem is copied into fd memory by the sink */
+  check_pass_buffer (NULL);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pass_memfd)
+{
+  GstAllocator *allocator;
+
+  allocator = gst_allocator_find (GST_ALLOCATOR_MEMFD);
+  fail_unless (allocator != NULL);
+  check_pass_buffer (allocator);
+  gst_object_unref (allocator);
+}
+
+GST_END_TEST;
+
+/* the layout of the messages of memfdsink */
+typedef struct
+{
+  guint64 maxsize;
+  guint64 offset;
+  guint64 size;
+  guint64 pts;
+  guint64 dts;
+  guint64 duration;
+  guint32 flags;
+  guint32 id;
+} MemfdPacket;
+
+GST_START_TEST (test_short_fd)
+{
+  GstElement *src;
+  GstPad *mysinkpad;
+  GstMessage *msg;
+  GstBus *bus;
+  MemfdPacket packet = { 0, };
+  struct msghdr hdr = { 0, };
+  struct cmsghdr *cmsg;
+  struct iovec iov;
+  gchar control[CMSG_SPACE (sizeof (gint))];
+  gchar *name;
+  gint fds[2], fd;
+
+  fail_if (socketpair (AF_UNIX, SOCK_SEQPACKET, 0, fds) < 0);
+
+  src = gst_check_setup_element ("memfdsrc");
+  mysinkpad = gst_check_setup_sink_pad (src, &sinktemplate);
+  gst_pad_set_active (mysinkpad, TRUE);
+  g_object_set (src, "fd", fds[1], NULL);
+  bus = gst_bus_new ();
+  gst_element_set_bus (src, bus);
+
+  fail_unless (gst_element_set_state (src,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS);
+
+  /* a file of 10 bytes that claims to hold 4096 */
+  fd = g_file_open_tmp ("memfd-test-XXXXXX", &name, NULL);
+  fail_unless (fd >= 0);
+  unlink (name);
+  g_free (name);
+  fail_if (ftruncate (fd, 10) < 0);
+
+  packet.maxsize = 4096;
+  packet.size = 4096;
+  iov.iov_base = &packet;
+  iov.iov_len = sizeof (packet);
+  hdr.msg_iov = &iov;
+  hdr.msg_iovlen = 1;
+  hdr.msg_control = control;
+  hdr.msg_controllen = sizeof (control);
+  cmsg = CMSG_FIRSTHDR (&hdr);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (gint));
+  memcpy (CMSG_DATA (cmsg), &fd, sizeof (gint));
+  fail_unless (sendmsg (fds[0], &hdr, 0) == sizeof (packet));
+  close (fd);
+
+  /* the src refuses it instead of crashing on the mapping */
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL);
+  gst_message_unref (msg);
+  fail_unless (buffers == NULL);
+
+  fail_unless (gst_element_set_state (src,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  close (fds[0]);
+  close (fds[1]);
+
+  gst_element_set_bus (src, NULL);
+  gst_object_unref (bus);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_sink_pad (src);
+  gst_check_teardown_element (src);
+}
+
+GST_END_TEST;
+
+static Suite *
+memfd_suite (void)
+{
+  Suite *s = suite_create ("memfd");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_pass_sysmem);
+  tcase_add_test (tc_chain, test_pass_memfd);
+  tcase_add_test (tc_chain, test_short_fd);
+
+  return s;
+}
+
+GST_CHECK_MAIN (memfd);
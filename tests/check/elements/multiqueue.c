@@ -402,7 +402,7 @@ mq_dummypad_event (GstPad * sinkpad, GstObject * parent, GstEvent * event)
 }
 
 static void
-run_output_order_test (gint n_linked)
+run_output_order_test (gint n_linked, guint max_threads)
 {
   /* This test creates a multiqueue with 2 linked output, and 3 outputs that 
    * return 'not-linked' when data is pushed, then verifies that all buffers 
@@ -439,7 +439,8 @@ run_output_order_test (gint n_linked)
       "max-size-buffers", (guint) 0,
       "max-size-time", (guint64) 0,
       "extra-size-bytes", (guint) 0,
-      "extra-size-buffers", (guint) 0, "extra-size-time", (guint64) 0, NULL);
+      "extra-size-buffers", (guint) 0, "extra-size-time", (guint64) 0,
+      "max-threads", max_threads, NULL);
 
   /* Construct NPADS dummy output pads. The first 'n_linked' return FLOW_OK, the rest
    * return NOT_LINKED. The not-linked ones check the expected ordering of 
@@ -561,8 +562,18 @@ run_output_order_test (gint n_linked)
 
 GST_START_TEST (test_output_order)
 {
-  run_output_order_test (2);
-  run_output_order_test (0);
+  run_output_order_test (2, 0);
+  run_output_order_test (0, 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_output_order_pool)
+{
+  /* fewer threads than streams, not-linked streams must park */
+  run_output_order_test (2, 2);
+  run_output_order_test (0, 2);
+  run_output_order_test (2, 1);
 }
 
 GST_END_TEST;
@@ -725,6 +736,306 @@ GST_START_TEST (test_sparse_stream)
 
 GST_END_TEST;
 
+static GMutex list_mutex;
+static GCond list_cond;
+static gboolean list_blocked;
+static GList *list_received;
+static guint list_count;
+
+static GstPadProbeReturn
+mq_list_block_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  g_mutex_lock (&list_mutex);
+  list_blocked = TRUE;
+  g_cond_signal (&list_cond);
+  g_mutex_unlock (&list_mutex);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstFlowReturn
+mq_list_chain (GstPad * sinkpad, GstObject * parent, GstBuffer * buf)
+{
+  g_mutex_lock (&list_mutex);
+  list_received = g_list_append (list_received, buf);
+  g_cond_signal (&list_cond);
+  g_mutex_unlock (&list_mutex);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+mq_list_collect (GstBuffer ** buf, guint idx, gpointer user_data)
+{
+  list_received = g_list_append (list_received, gst_buffer_ref (*buf));
+
+  return TRUE;
+}
+
+static GstFlowReturn
+mq_list_chain_list (GstPad * sinkpad, GstObject * parent, GstBufferList * list)
+{
+  g_mutex_lock (&list_mutex);
+  g_mutex_lock (&_check_lock);
+  fail_unless (gst_buffer_list_length (list) <= 4);
+  g_mutex_unlock (&_check_lock);
+  list_count++;
+  gst_buffer_list_foreach (list, mq_list_collect, NULL);
+  g_cond_signal (&list_cond);
+  g_mutex_unlock (&list_mutex);
+
+  gst_buffer_list_unref (list);
+
+  return GST_FLOW_OK;
+}
+
+GST_START_TEST (test_push_list)
+{
+  GstElement *pipe;
+  GstElement *mq;
+  GstPad *inputpad, *sinkpad, *mq_sinkpad, *mq_srcpad;
+  GstBuffer *pushed[6];
+  GstSegment segment;
+  gulong probe_id;
+  GList *l;
+  gint i;
+
+  g_mutex_init (&list_mutex);
+  g_cond_init (&list_cond);
+  list_blocked = FALSE;
+  list_received = NULL;
+  list_count = 0;
+
+  pipe = gst_pipeline_new ("testbin");
+  mq = gst_element_factory_make ("multiqueue", NULL);
+  fail_unless (mq != NULL);
+  gst_bin_add (GST_BIN (pipe), mq);
+
+  g_object_set (mq,
+      "max-size-bytes", (guint) 0,
+      "max-size-buffers", (guint) 10,
+      "max-size-time", (guint64) 0, "max-list-size", (guint) 4, NULL);
+
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+
+  inputpad = gst_pad_new ("dummysrc", GST_PAD_SRC);
+  gst_pad_set_query_function (inputpad, mq_dummypad_query);
+
+  mq_sinkpad = gst_element_get_request_pad (mq, "sink_%u");
+  fail_unless (mq_sinkpad != NULL);
+  fail_unless (gst_pad_link (inputpad, mq_sinkpad) == GST_PAD_LINK_OK);
+
+  gst_pad_set_active (inputpad, TRUE);
+
+  gst_pad_push_event (inputpad, gst_event_new_stream_start ("test"));
+  gst_pad_push_event (inputpad, gst_event_new_segment (&segment));
+
+  mq_srcpad = mq_sinkpad_to_srcpad (mq, mq_sinkpad);
+
+  sinkpad = gst_pad_new ("dummysink", GST_PAD_SINK);
+  gst_pad_set_chain_function (sinkpad, mq_list_chain);
+  gst_pad_set_chain_list_function (sinkpad, mq_list_chain_list);
+  gst_pad_set_query_function (sinkpad, mq_dummypad_query);
+
+  fail_unless (gst_pad_link (mq_srcpad, sinkpad) == GST_PAD_LINK_OK);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  /* hold the first buffer in the srcpad so that the rest piles up */
+  probe_id = gst_pad_add_probe (mq_srcpad,
+      GST_PAD_PROBE_TYPE_BLOCK | GST_PAD_PROBE_TYPE_BUFFER |
+      GST_PAD_PROBE_TYPE_BUFFER_LIST, mq_list_block_probe, NULL, NULL);
+
+  gst_element_set_state (pipe, GST_STATE_PLAYING);
+
+  for (i = 0; i < 6; i++) {
+    pushed[i] = gst_buffer_new ();
+    GST_BUFFER_OFFSET (pushed[i]) = i;
+    fail_unless (gst_pad_push (inputpad, gst_buffer_ref (pushed[i]))
+        == GST_FLOW_OK);
+
+    if (i == 0) {
+      g_mutex_lock (&list_mutex);
+      while (!list_blocked)
+        g_cond_wait (&list_cond, &list_mutex);
+      g_mutex_unlock (&list_mutex);
+    }
+  }
+
+  /* the first buffer goes out alone, the next four are taken as one list
+   * and the last one is pushed on its own again */
+  gst_pad_remove_probe (mq_srcpad, probe_id);
+
+  g_mutex_lock (&list_mutex);
+  while (g_list_length (list_received) < 6)
+    g_cond_wait (&list_cond, &list_mutex);
+  g_mutex_unlock (&list_mutex);
+
+  fail_unless_equals_int (list_count, 1);
+  for (i = 0, l = list_received; l; i++, l = l->next)
+    fail_unless (l->data == pushed[i]);
+
+  /* Clean up */
+  gst_element_set_state (pipe, GST_STATE_NULL);
+
+  gst_pad_unlink (inputpad, mq_sinkpad);
+  gst_element_release_request_pad (mq, mq_sinkpad);
+  gst_object_unref (mq_sinkpad);
+  gst_object_unref (mq_srcpad);
+  gst_object_unref (inputpad);
+  gst_object_unref (sinkpad);
+
+  gst_object_unref (pipe);
+
+  g_list_free_full (list_received, (GDestroyNotify) gst_buffer_unref);
+  for (i = 0; i < 6; i++)
+    gst_buffer_unref (pushed[i]);
+
+  g_cond_clear (&list_cond);
+  g_mutex_clear (&list_mutex);
+}
+
+GST_END_TEST;
+
+static GMutex blocked_mutex;
+static GCond blocked_cond;
+static gboolean blocked_got_second;
+static gint blocked_received;
+
+/* like a muxer, the first stream only goes on once the second stream got
+ * data */
+static GstFlowReturn
+mq_blocking_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  gint num = GPOINTER_TO_INT (gst_pad_get_element_private (pad));
+
+  g_mutex_lock (&blocked_mutex);
+  if (num == 0) {
+    while (!blocked_got_second)
+      g_cond_wait (&blocked_cond, &blocked_mutex);
+  } else {
+    blocked_got_second = TRUE;
+  }
+  blocked_received++;
+  g_cond_broadcast (&blocked_cond);
+  g_mutex_unlock (&blocked_mutex);
+
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static GstBusSyncReply
+mq_count_worker_tasks (GstBus * bus, GstMessage * message, gpointer user_data)
+{
+  GstStreamStatusType type;
+  GstElement *owner;
+  const GValue *val;
+
+  if (GST_MESSAGE_TYPE (message) != GST_MESSAGE_STREAM_STATUS)
+    return GST_BUS_PASS;
+
+  gst_message_parse_stream_status (message, &type, &owner);
+  val = gst_message_get_stream_status_object (message);
+  /* the workers are posted with the multiqueue as the source */
+  if (type == GST_STREAM_STATUS_TYPE_CREATE &&
+      GST_MESSAGE_SRC (message) == GST_OBJECT_CAST (owner) &&
+      val != NULL && G_VALUE_HOLDS (val, GST_TYPE_TASK))
+    g_atomic_int_inc ((gint *) user_data);
+
+  return GST_BUS_PASS;
+}
+
+GST_START_TEST (test_max_threads_blocked)
+{
+  GstElement *pipe;
+  GstElement *mq;
+  GstBus *bus;
+  GstPad *inputpads[2], *sinkpads[2], *mq_sinkpads[2];
+  GstSegment segment;
+  gint n_created = 0;
+  gint i;
+
+  g_mutex_init (&blocked_mutex);
+  g_cond_init (&blocked_cond);
+  blocked_got_second = FALSE;
+  blocked_received = 0;
+
+  pipe = gst_pipeline_new ("testbin");
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipe));
+  gst_bus_set_sync_handler (bus, mq_count_worker_tasks, &n_created, NULL);
+
+  mq = gst_element_factory_make ("multiqueue", NULL);
+  fail_unless (mq != NULL);
+  gst_bin_add (GST_BIN (pipe), mq);
+
+  /* one worker for two streams */
+  g_object_set (mq, "max-threads", (guint) 1, NULL);
+
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+
+  for (i = 0; i < 2; i++) {
+    GstPad *mq_srcpad;
+
+    inputpads[i] = gst_pad_new (NULL, GST_PAD_SRC);
+    gst_pad_set_query_function (inputpads[i], mq_dummypad_query);
+
+    mq_sinkpads[i] = gst_element_get_request_pad (mq, "sink_%u");
+    fail_unless (mq_sinkpads[i] != NULL);
+    fail_unless (gst_pad_link (inputpads[i], mq_sinkpads[i]) ==
+        GST_PAD_LINK_OK);
+    gst_pad_set_active (inputpads[i], TRUE);
+
+    mq_srcpad = mq_sinkpad_to_srcpad (mq, mq_sinkpads[i]);
+
+    sinkpads[i] = gst_pad_new (NULL, GST_PAD_SINK);
+    gst_pad_set_chain_function (sinkpads[i], mq_blocking_chain);
+    gst_pad_set_query_function (sinkpads[i], mq_dummypad_query);
+    gst_pad_set_element_private (sinkpads[i], GINT_TO_POINTER (i));
+    fail_unless (gst_pad_link (mq_srcpad, sinkpads[i]) == GST_PAD_LINK_OK);
+    gst_pad_set_active (sinkpads[i], TRUE);
+    gst_object_unref (mq_srcpad);
+  }
+
+  gst_element_set_state (pipe, GST_STATE_PLAYING);
+
+  for (i = 0; i < 2; i++) {
+    gst_pad_push_event (inputpads[i], gst_event_new_stream_start ("test"));
+    gst_pad_push_event (inputpads[i], gst_event_new_segment (&segment));
+  }
+
+  /* the worker blocks downstream with the first buffer, the buffer of the
+   * second stream needs another thread */
+  fail_unless (gst_pad_push (inputpads[0], gst_buffer_new ()) == GST_FLOW_OK);
+  fail_unless (gst_pad_push (inputpads[1], gst_buffer_new ()) == GST_FLOW_OK);
+
+  g_mutex_lock (&blocked_mutex);
+  while (blocked_received < 2)
+    g_cond_wait (&blocked_cond, &blocked_mutex);
+  g_mutex_unlock (&blocked_mutex);
+
+  fail_unless (g_atomic_int_get (&n_created) >= 2);
+
+  /* Clean up */
+  gst_element_set_state (pipe, GST_STATE_NULL);
+
+  for (i = 0; i < 2; i++) {
+    gst_pad_unlink (inputpads[i], mq_sinkpads[i]);
+    gst_element_release_request_pad (mq, mq_sinkpads[i]);
+    gst_object_unref (mq_sinkpads[i]);
+    gst_object_unref (inputpads[i]);
+    gst_object_unref (sinkpads[i]);
+  }
+
+  gst_bus_set_sync_handler (bus, NULL, NULL, NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipe);
+
+  g_cond_clear (&blocked_cond);
+  g_mutex_clear (&blocked_mutex);
+}
+
+GST_END_TEST;
+
 static Suite *
 multiqueue_suite (void)
 {
@@ -740,8 +1051,12 @@ multiqueue_suite (void)
   tcase_add_test (tc_chain, test_request_pads_named);
 
   tcase_add_test (tc_chain, test_output_order);
+  tcase_add_test (tc_chain, test_output_order_pool);
+  tcase_add_test (tc_chain, test_max_threads_blocked);
 
   tcase_add_test (tc_chain, test_sparse_stream);
+
+  tcase_add_test (tc_chain, test_push_list);
   return s;
 }
 
@@ -126,6 +126,15 @@ setup (void)
   events = NULL;
 }
 
+/* same as setup() but passes the data through the lock-free ring */
+static void
+setup_ring (void)
+{
+  setup ();
+
+  g_object_set (queue, "ring-size", 64, NULL);
+}
+
 static void
 cleanup (void)
 {
@@ -698,6 +707,79 @@ GST_START_TEST (test_sticky_not_linked)
 
 GST_END_TEST;
 
+static gint list_count;
+
+static GstFlowReturn
+chain_list_func (GstPad * pad, GstObject * parent, GstBufferList * list)
+{
+  guint i, len;
+
+  g_mutex_lock (&check_mutex);
+  list_count++;
+  len = gst_buffer_list_length (list);
+  for (i = 0; i < len; i++) {
+    buffers = g_list_append (buffers,
+        gst_buffer_ref (gst_buffer_list_get (list, i)));
+  }
+  g_cond_signal (&check_cond);
+  g_mutex_unlock (&check_mutex);
+
+  gst_buffer_list_unref (list);
+
+  return GST_FLOW_OK;
+}
+
+/* queue 6 buffers while downstream is blocked
+ * check that they are pushed in lists of at most 4 buffers
+ */
+GST_START_TEST (test_push_list)
+{
+  GstBuffer *pushed[6];
+  GstSegment segment;
+  GList *l;
+  gint i;
+
+  g_object_set (G_OBJECT (queue), "max-list-size", 4, NULL);
+
+  block_src ();
+
+  UNDERRUN_LOCK ();
+  fail_unless (gst_element_set_state (queue,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+  UNDERRUN_WAIT ();
+  UNDERRUN_UNLOCK ();
+
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (mysrcpad, gst_event_new_stream_start ("test"));
+  gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment));
+
+  for (i = 0; i < 6; i++) {
+    pushed[i] = gst_buffer_new_and_alloc (4);
+    fail_unless (gst_pad_push (mysrcpad, pushed[i]) == GST_FLOW_OK);
+  }
+
+  list_count = 0;
+  mysinkpad = setup_sink_pad (queue, &sinktemplate);
+  gst_pad_set_chain_list_function (mysinkpad, chain_list_func);
+  unblock_src ();
+
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < 6)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  fail_unless_equals_int (list_count, 2);
+  for (l = buffers, i = 0; l; l = l->next, i++)
+    fail_unless (l->data == pushed[i]);
+
+  GST_DEBUG ("stopping");
+  fail_unless (gst_element_set_state (queue,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+}
+
+GST_END_TEST;
+
 #if 0
 static gboolean
 event_equals_newsegment (GstEvent * event, gboolean update, gdouble rate,
@@ -899,6 +981,7 @@ queue_suite (void)
 {
   Suite *s = suite_create ("queue");
   TCase *tc_chain = tcase_create ("general");
+  TCase *tc_ring = tcase_create ("ring");
 
   suite_add_tcase (s, tc_chain);
   tcase_add_checked_fixture (tc_chain, setup, cleanup);
@@ -913,6 +996,19 @@ queue_suite (void)
   tcase_add_test (tc_chain, test_newsegment);
 #endif
   tcase_add_test (tc_chain, test_sticky_not_linked);
+  tcase_add_test (tc_chain, test_push_list);
+
+  suite_add_tcase (s, tc_ring);
+  tcase_add_checked_fixture (tc_ring, setup_ring, cleanup);
+  tcase_add_test (tc_ring, test_non_leaky_underrun);
+  tcase_add_test (tc_ring, test_non_leaky_overrun);
+  tcase_add_test (tc_ring, test_leaky_upstream);
+  tcase_add_test (tc_ring, test_leaky_downstream);
+  tcase_add_test (tc_ring, test_time_level);
+  tcase_add_test (tc_ring, test_time_level_task_not_started);
+  tcase_add_test (tc_ring, test_queries_while_flushing);
+  tcase_add_test (tc_ring, test_sticky_not_linked);
+  tcase_add_test (tc_ring, test_push_list);
 
   return s;
 }
@@ -708,6 +708,51 @@ GST_START_TEST (test_map_range)
 
 GST_END_TEST;
 
+GST_START_TEST (test_many_memory)
+{
+  GstBuffer *buf;
+  GstMemory *mem[40];
+  GstMapInfo map;
+  guint i, max;
+
+  max = gst_buffer_get_max_memory ();
+  fail_unless (max < G_N_ELEMENTS (mem));
+
+  buf = gst_buffer_new ();
+  for (i = 0; i < G_N_ELEMENTS (mem); i++) {
+    mem[i] = gst_allocator_alloc (NULL, 10, NULL);
+    gst_buffer_append_memory (buf, mem[i]);
+  }
+
+  /* nothing is merged when going over the max */
+  fail_unless_equals_int (gst_buffer_n_memory (buf), G_N_ELEMENTS (mem));
+  fail_unless_equals_int (gst_buffer_get_size (buf), 10 * G_N_ELEMENTS (mem));
+  for (i = 0; i < G_N_ELEMENTS (mem); i++)
+    fail_unless (gst_buffer_peek_memory (buf, i) == mem[i]);
+
+  /* insert in the middle */
+  gst_buffer_insert_memory (buf, max, gst_allocator_alloc (NULL, 5, NULL));
+  fail_unless_equals_int (gst_buffer_n_memory (buf), G_N_ELEMENTS (mem) + 1);
+  fail_unless (gst_buffer_peek_memory (buf, max - 1) == mem[max - 1]);
+  fail_unless (gst_buffer_peek_memory (buf, max + 1) == mem[max]);
+
+  /* mapping a range only merges the range */
+  fail_unless (gst_buffer_map_range (buf, 2, 3, &map, GST_MAP_WRITE));
+  fail_unless_equals_int (map.size, 30);
+  gst_buffer_unmap (buf, &map);
+  fail_unless_equals_int (gst_buffer_n_memory (buf), G_N_ELEMENTS (mem) - 1);
+
+  /* mapping all merges into one */
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  fail_unless_equals_int (map.size, 10 * G_N_ELEMENTS (mem) + 5);
+  gst_buffer_unmap (buf, &map);
+  fail_unless_equals_int (gst_buffer_n_memory (buf), 1);
+
+  gst_buffer_unref (buf);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_find)
 {
   GstBuffer *buf;
@@ -848,6 +893,7 @@ gst_buffer_suite (void)
   tcase_add_test (tc_chain, test_resize);
   tcase_add_test (tc_chain, test_map);
   tcase_add_test (tc_chain, test_map_range);
+  tcase_add_test (tc_chain, test_many_memory);
   tcase_add_test (tc_chain, test_find);
   tcase_add_test (tc_chain, test_fill);
 
@@ -0,0 +1,250 @@
+/* GStreamer
+ *
+ * unit test for GstBufferPool
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#define IDLE_TIMEOUT (200 * GST_MSECOND)
+
+static GstBufferPool *
+create_pool (guint min_buffers, guint max_buffers, GstClockTime idle_timeout,
+    gboolean thread_cache)
+{
+  GstBufferPool *pool;
+  GstStructure *conf;
+
+  pool = gst_buffer_pool_new ();
+  conf = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (conf, NULL, 10, min_buffers,
+      max_buffers);
+  if (idle_timeout)
+    gst_buffer_pool_config_set_idle_timeout (conf, idle_timeout);
+  if (thread_cache)
+    gst_buffer_pool_config_add_option (conf,
+        GST_BUFFER_POOL_OPTION_THREAD_CACHE);
+  fail_unless (gst_buffer_pool_set_config (pool, conf));
+  fail_unless (gst_buffer_pool_set_active (pool, TRUE));
+
+  return pool;
+}
+
+static guint
+get_stat (GstBufferPool * pool, const gchar * name)
+{
+  GstStructure *stats;
+  guint value;
+
+  stats = gst_buffer_pool_get_stats (pool);
+  fail_unless (gst_structure_get_uint (stats, name, &value));
+  gst_structure_free (stats);
+
+  return value;
+}
+
+GST_START_TEST (test_idle_timeout_config)
+{
+  GstStructure *conf;
+  GstClockTime timeout;
+  GstBufferPool *pool;
+
+  pool = gst_buffer_pool_new ();
+  conf = gst_buffer_pool_get_config (pool);
+  fail_if (gst_buffer_pool_config_get_idle_timeout (conf, &timeout));
+  gst_buffer_pool_config_set_idle_timeout (conf, GST_SECOND);
+  fail_unless (gst_buffer_pool_config_get_idle_timeout (conf, &timeout));
+  fail_unless_equals_uint64 (timeout, GST_SECOND);
+  gst_structure_free (conf);
+  gst_object_unref (pool);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_stats)
+{
+  GstBufferPool *pool;
+  GstBuffer *buf[4];
+  guint i;
+
+  pool = create_pool (1, 0, 0, FALSE);
+  fail_unless_equals_int (get_stat (pool, "allocated"), 1);
+
+  for (i = 0; i < G_N_ELEMENTS (buf); i++)
+    fail_unless (gst_buffer_pool_acquire_buffer (pool, &buf[i],
+            NULL) == GST_FLOW_OK);
+
+  fail_unless_equals_int (get_stat (pool, "allocated"), 4);
+  fail_unless_equals_int (get_stat (pool, "outstanding"), 4);
+  fail_unless_equals_int (get_stat (pool, "hits"), 1);
+  fail_unless_equals_int (get_stat (pool, "misses"), 3);
+
+  for (i = 0; i < G_N_ELEMENTS (buf); i++)
+    gst_buffer_unref (buf[i]);
+
+  fail_unless_equals_int (get_stat (pool, "outstanding"), 0);
+  fail_unless_equals_int (get_stat (pool, "peak"), 4);
+  fail_unless_equals_int (get_stat (pool, "trimmed"), 0);
+
+  gst_buffer_pool_set_active (pool, FALSE);
+  gst_object_unref (pool);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_idle_trim)
+{
+  GstBufferPool *pool;
+  GstBuffer *buf[4];
+  guint i;
+
+  pool = create_pool (1, 0, IDLE_TIMEOUT, FALSE);
+
+  /* a burst of 4 buffers */
+  for (i = 0; i < G_N_ELEMENTS (buf); i++)
+    fail_unless (gst_buffer_pool_acquire_buffer (pool, &buf[i],
+            NULL) == GST_FLOW_OK);
+  for (i = 0; i < G_N_ELEMENTS (buf); i++)
+    gst_buffer_unref (buf[i]);
+
+  /* then only one buffer is used per idle period, the others become idle and
+   * are freed down to min-buffers */
+  for (i = 0; i < 2; i++) {
+    g_usleep (GST_TIME_AS_USECONDS (IDLE_TIMEOUT + IDLE_TIMEOUT / 2));
+    fail_unless (gst_buffer_pool_acquire_buffer (pool, &buf[0],
+            NULL) == GST_FLOW_OK);
+    gst_buffer_unref (buf[0]);
+  }
+
+  fail_unless_equals_int (get_stat (pool, "allocated"), 1);
+  fail_unless_equals_int (get_stat (pool, "trimmed"), 3);
+  fail_unless_equals_int (get_stat (pool, "peak"), 4);
+
+  gst_buffer_pool_set_active (pool, FALSE);
+  gst_object_unref (pool);
+}
+
+GST_END_TEST;
+
+static gpointer
+release_later (GstBuffer * buffer)
+{
+  g_usleep (G_USEC_PER_SEC / 10);
+  gst_buffer_unref (buffer);
+
+  return NULL;
+}
+
+GST_START_TEST (test_wait)
+{
+  GstBufferPool *pool;
+  GstBuffer *buf, *buf2;
+  GThread *thread;
+  GstBufferPoolAcquireParams params = { 0, };
+
+  pool = create_pool (1, 1, 0, TRUE);
+
+  fail_unless (gst_buffer_pool_acquire_buffer (pool, &buf,
+          NULL) == GST_FLOW_OK);
+
+  params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+  fail_unless (gst_buffer_pool_acquire_buffer (pool, &buf2,
+          &params) == GST_FLOW_EOS);
+
+  /* the buffer is released in another thread while we wait */
+  thread = g_thread_new ("release", (GThreadFunc) release_later, buf);
+  fail_unless (gst_buffer_pool_acquire_buffer (pool, &buf2,
+          NULL) == GST_FLOW_OK);
+  fail_unless (buf2 == buf);
+  g_thread_join (thread);
+
+  fail_unless_equals_int (get_stat (pool, "waits"), 1);
+  gst_buffer_unref (buf2);
+
+  gst_buffer_pool_set_active (pool, FALSE);
+  gst_object_unref (pool);
+}
+
+GST_END_TEST;
+
+static gpointer
+acquire_release (GstBufferPool * pool)
+{
+  GstBuffer *buf, *buf2;
+
+  /* the released buffer stays in the slot of this thread */
+  fail_unless (gst_buffer_pool_acquire_buffer (pool, &buf,
+          NULL) == GST_FLOW_OK);
+  gst_buffer_unref (buf);
+  fail_unless (gst_buffer_pool_acquire_buffer (pool, &buf2,
+          NULL) == GST_FLOW_OK);
+  fail_unless (buf2 == buf);
+  gst_buffer_unref (buf2);
+
+  return buf;
+}
+
+GST_START_TEST (test_thread_cache)
+{
+  GstBufferPool *pool;
+  GstBuffer *buf, *cached;
+  GThread *thread;
+
+  pool = create_pool (0, 0, 0, TRUE);
+
+  thread = g_thread_new ("cache", (GThreadFunc) acquire_release, pool);
+  cached = g_thread_join (thread);
+  fail_unless_equals_int (get_stat (pool, "misses"), 1);
+  fail_unless_equals_int (get_stat (pool, "hits"), 1);
+
+  /* another thread takes the cached buffer instead of allocating one */
+  fail_unless (gst_buffer_pool_acquire_buffer (pool, &buf,
+          NULL) == GST_FLOW_OK);
+  fail_unless (buf == cached);
+  gst_buffer_unref (buf);
+
+  /* and the buffer released here is found by the next thread again */
+  thread = g_thread_new ("cache", (GThreadFunc) acquire_release, pool);
+  fail_unless (g_thread_join (thread) == cached);
+
+  fail_unless_equals_int (get_stat (pool, "allocated"), 1);
+  fail_unless_equals_int (get_stat (pool, "misses"), 1);
+  fail_unless_equals_int (get_stat (pool, "hits"), 4);
+
+  gst_buffer_pool_set_active (pool, FALSE);
+  gst_object_unref (pool);
+}
+
+GST_END_TEST;
+
+static Suite *
+gst_buffer_pool_suite (void)
+{
+  Suite *s = suite_create ("GstBufferPool");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_idle_timeout_config);
+  tcase_add_test (tc_chain, test_stats);
+  tcase_add_test (tc_chain, test_idle_trim);
+  tcase_add_test (tc_chain, test_wait);
+  tcase_add_test (tc_chain, test_thread_cache);
+
+  return s;
+}
+
+GST_CHECK_MAIN (gst_buffer_pool);
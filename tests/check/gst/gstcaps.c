@@ -101,27 +101,42 @@ GST_END_TEST;
 GST_START_TEST (test_static_caps)
 {
   static GstStaticCaps scaps = GST_STATIC_CAPS ("audio/x-raw,rate=44100");
+  static GstStaticCaps scaps2 =
+      GST_STATIC_CAPS ("audio/x-raw, rate=(int)44100");
   GstCaps *caps1;
   GstCaps *caps2;
+  GstPadTemplate *templ;
   static GstStaticCaps sany = GST_STATIC_CAPS_ANY;
   static GstStaticCaps snone = GST_STATIC_CAPS_NONE;
 
   /* caps creation */
   caps1 = gst_static_caps_get (&scaps);
   fail_unless (caps1 != NULL);
-  /* 1 refcount core, one from us */
-  fail_unless (GST_CAPS_REFCOUNT (caps1) == 2);
+  /* 1 refcount core, 1 for the interned caps, one from us */
+  fail_unless (GST_CAPS_REFCOUNT (caps1) == 3);
 
   /* caps should be the same */
   caps2 = gst_static_caps_get (&scaps);
   fail_unless (caps2 != NULL);
-  /* 1 refcount core, two from us */
-  fail_unless (GST_CAPS_REFCOUNT (caps1) == 3);
+  /* 1 refcount core, 1 for the interned caps, two from us */
+  fail_unless (GST_CAPS_REFCOUNT (caps1) == 4);
   /* caps must be equal */
   fail_unless (caps1 == caps2);
+  gst_caps_unref (caps2);
 
-  gst_caps_unref (caps1);
+  /* static caps with the same contents share the interned instance */
+  caps2 = gst_static_caps_get (&scaps2);
+  fail_unless (caps1 == caps2);
+  gst_caps_unref (caps2);
+
+  /* and so do pad templates */
+  caps2 = gst_caps_from_string ("audio/x-raw, rate=(int)44100");
+  templ = gst_pad_template_new ("src", GST_PAD_SRC, GST_PAD_ALWAYS, caps2);
   gst_caps_unref (caps2);
+  fail_unless (GST_PAD_TEMPLATE_CAPS (templ) == caps1);
+  gst_object_unref (templ);
+
+  gst_caps_unref (caps1);
 
   caps1 = gst_static_caps_get (&sany);
   fail_unless (gst_caps_is_equal (caps1, GST_CAPS_ANY));
@@ -272,6 +287,61 @@ GST_START_TEST (test_simplify)
 
 GST_END_TEST;
 
+GST_START_TEST (test_simplify_large)
+{
+  const gchar *formats[] = { "I420", "YV12", "YUY2", "UYVY", "AYUV", "RGBx",
+    "BGRx", "xRGB", "xBGR", "RGBA", "BGRA", "ARGB", "ABGR", "RGB", "BGR",
+    "NV12", "NV21", "GRAY8"
+  };
+  GstCaps *caps, *orig, *res;
+  GstStructure *s;
+  const GValue *v;
+  guint i;
+
+  /* structures with different names are left alone */
+  caps = gst_caps_from_string ("audio/x-raw; video/x-raw; text/plain");
+  res = gst_caps_simplify (caps);
+  fail_unless (res == caps);
+  fail_unless_equals_int (gst_caps_get_size (res), 3);
+  gst_caps_unref (res);
+
+  /* one structure per format, in system memory and GL memory, and one
+   * structure that is a subset of another one */
+  caps = gst_caps_new_empty ();
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    gst_caps_append_structure (caps, gst_structure_new ("video/x-raw",
+            "format", G_TYPE_STRING, formats[i],
+            "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+            "height", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL));
+    gst_caps_append_structure_full (caps, gst_structure_new ("video/x-raw",
+            "format", G_TYPE_STRING, formats[i],
+            "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+            "height", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL),
+        gst_caps_features_new ("memory:GLMemory", NULL));
+  }
+  gst_caps_append_structure (caps, gst_structure_new ("video/x-raw",
+          "format", G_TYPE_STRING, "I420",
+          "width", G_TYPE_INT, 320, "height", G_TYPE_INT, 240, NULL));
+  orig = gst_caps_copy (caps);
+
+  res = gst_caps_simplify (caps);
+  GST_DEBUG ("simplified %" GST_PTR_FORMAT, res);
+  fail_unless_equals_int (gst_caps_get_size (res), 2);
+  fail_unless (gst_caps_is_equal (res, orig));
+
+  for (i = 0; i < 2; i++) {
+    s = gst_caps_get_structure (res, i);
+    v = gst_structure_get_value (s, "format");
+    fail_unless (GST_VALUE_HOLDS_LIST (v));
+    fail_unless_equals_int (gst_value_list_get_size (v),
+        G_N_ELEMENTS (formats));
+  }
+  gst_caps_unref (res);
+  gst_caps_unref (orig);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_truncate)
 {
   GstCaps *caps;
@@ -1083,6 +1153,292 @@ GST_START_TEST (test_features)
 
 GST_END_TEST;
 
+GST_START_TEST (test_features_shared)
+{
+  GstCaps *c1, *c2, *c3;
+  GstCapsFeatures *f1, *f2, *f3;
+
+  c1 = gst_caps_from_string ("video/x-raw(memory:VASurface, meta:Foo), "
+      "width=(int)320; audio/x-raw(ANY)");
+  c2 = gst_caps_from_string ("video/x-raw(meta:Foo, memory:VASurface), "
+      "width=(int)[ 1, 1000 ]");
+
+  /* read-only caps hand out the shared instances */
+  gst_caps_ref (c1);
+  gst_caps_ref (c2);
+  f1 = gst_caps_get_features (c1, 0);
+  f2 = gst_caps_get_features (c2, 0);
+  fail_unless (f1 == f2);
+  fail_unless (gst_caps_get_features (c1, 1) == GST_CAPS_FEATURES_ANY);
+
+  /* copies share them too */
+  c3 = gst_caps_copy (c1);
+  gst_caps_ref (c3);
+  f3 = gst_caps_get_features (c3, 0);
+  fail_unless (f3 == f1);
+  gst_caps_unref (c3);
+
+  fail_if (gst_caps_is_subset (c1, c2));
+  fail_unless (gst_caps_can_intersect (c1, c2));
+  gst_caps_unref (c2);
+
+  /* writable caps give their structure its own features to modify */
+  f3 = gst_caps_get_features (c3, 0);
+  fail_if (f3 == f1);
+  fail_unless (gst_caps_features_is_equal (f3, f1));
+  gst_caps_features_remove (f3, "meta:Foo");
+  fail_unless (gst_caps_get_features (c3, 0) == f3);
+  fail_if (gst_caps_features_is_equal (f3, f1));
+  fail_unless (gst_caps_features_contains (f1, "meta:Foo"));
+
+  /* the shared instances can't be modified or freed */
+  ASSERT_CRITICAL (gst_caps_features_remove (f1, "meta:Foo"));
+  ASSERT_CRITICAL (gst_caps_features_free (f1));
+  fail_unless (gst_caps_features_contains (f1, "meta:Foo"));
+  fail_if (gst_caps_can_intersect (c2, c3));
+
+  gst_caps_unref (c3);
+  gst_caps_unref (c2);
+  gst_caps_unref (c1);
+  gst_caps_unref (c1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_intern)
+{
+  GstCaps *c1, *c2, *c3, *i1, *i2;
+
+  c1 = gst_caps_from_string ("video/x-raw, format=(string)I420, "
+      "width=(int)320, height=(int)240");
+  /* same caps with a different field order */
+  c2 = gst_caps_from_string ("video/x-raw, height=(int)240, "
+      "width=(int)320, format=(string)I420");
+  fail_unless (c1 != c2);
+
+  i1 = gst_caps_intern (c1);
+  fail_unless (i1 == c1);
+  fail_if (gst_caps_is_writable (i1));
+  i2 = gst_caps_intern (c2);
+  fail_unless (i2 == i1);
+  gst_caps_unref (i2);
+
+  /* interning again is a no-op */
+  i2 = gst_caps_intern (gst_caps_ref (i1));
+  fail_unless (i2 == i1);
+  gst_caps_unref (i2);
+
+  c2 = gst_caps_from_string ("video/x-raw, format=(string)I420, "
+      "width=(int)320, height=(int)480");
+  i2 = gst_caps_intern (c2);
+  fail_unless (i2 != i1);
+  fail_if (gst_caps_is_equal (i1, i2));
+  fail_if (gst_caps_is_strictly_equal (i1, i2));
+
+  /* a writable copy is a new object that is equal */
+  c3 = gst_caps_make_writable (gst_caps_ref (i1));
+  fail_unless (c3 != i1);
+  fail_unless (gst_caps_is_writable (c3));
+  fail_unless (gst_caps_is_equal (c3, i1));
+  gst_caps_unref (c3);
+  gst_caps_unref (i2);
+
+  /* subset and intersect results are cached, run them twice */
+  c2 = gst_caps_from_string ("video/x-raw, format=(string){ I420, YV12 }, "
+      "width=(int)[ 1, 1000 ], height=(int)[ 1, 1000 ]");
+  i2 = gst_caps_intern (c2);
+  fail_unless (gst_caps_is_subset (i1, i2));
+  fail_unless (gst_caps_is_subset (i1, i2));
+  fail_if (gst_caps_is_subset (i2, i1));
+  fail_if (gst_caps_is_subset (i2, i1));
+  fail_if (gst_caps_is_equal (i1, i2));
+
+  c3 = gst_caps_intersect (i2, i1);
+  fail_unless (c3 == i1);
+  gst_caps_unref (c3);
+  c3 = gst_caps_intersect (i2, i1);
+  fail_unless (c3 == i1);
+  gst_caps_unref (c3);
+  c3 = gst_caps_intersect_full (i1, i2, GST_CAPS_INTERSECT_FIRST);
+  fail_unless (c3 == i1);
+  gst_caps_unref (c3);
+
+  gst_caps_unref (i2);
+  gst_caps_unref (i1);
+
+  /* ANY and EMPTY caps are different */
+  i1 = gst_caps_intern (gst_caps_new_any ());
+  i2 = gst_caps_intern (gst_caps_new_empty ());
+  fail_unless (i1 != i2);
+  fail_unless (gst_caps_is_any (i1));
+  fail_unless (gst_caps_is_empty (i2));
+  gst_caps_unref (i2);
+  gst_caps_unref (i1);
+}
+
+GST_END_TEST;
+
+static void
+check_binary_roundtrip (GstCaps * caps)
+{
+  GstCaps *caps2;
+  guint8 *data;
+  gsize size;
+
+  data = gst_caps_to_binary (caps, &size);
+  fail_unless (data != NULL);
+  caps2 = gst_caps_from_binary (data, size);
+  fail_unless (caps2 != NULL);
+  fail_unless (gst_caps_is_strictly_equal (caps, caps2),
+      "%" GST_PTR_FORMAT " != %" GST_PTR_FORMAT, caps, caps2);
+  gst_caps_unref (caps2);
+  g_free (data);
+}
+
+GST_START_TEST (test_binary)
+{
+  GstCaps *caps, *caps2;
+  guint8 *data;
+  gsize size, i;
+
+  caps = gst_caps_new_any ();
+  check_binary_roundtrip (caps);
+  gst_caps_unref (caps);
+
+  caps = gst_caps_new_empty ();
+  check_binary_roundtrip (caps);
+  gst_caps_unref (caps);
+
+  caps = gst_caps_from_string ("video/x-raw, "
+      "format=(string){ I420, YV12 }, width=(int)[ 16, 4096, 2 ], "
+      "height=(int)[ 16, 4096 ], framerate=(fraction)[ 0/1, 2147483647/1 ], "
+      "pixel-aspect-ratio=(fraction)1/1, interlaced=(boolean)false, "
+      "level=(double)2.5, range=(double)[ 0.5, 1.5 ], "
+      "offset=(gint64)[ 0, 1000 ], size=(guint64)12345678901, "
+      "flags=(uint)7, matrix=(int)< < 1, 0 >, < 0, 1 > >; "
+      "video/x-raw(memory:GLMemory, meta:Foo), format=(string)RGBA; "
+      "video/x-raw(ANY), format=(string)NV12; audio/x-raw");
+  fail_unless (caps != NULL);
+  gst_caps_set_simple (caps, "mask", GST_TYPE_BITMASK, (guint64) 0x0f, NULL);
+  check_binary_roundtrip (caps);
+
+  /* truncated or damaged data is rejected */
+  data = gst_caps_to_binary (caps, &size);
+  for (i = 0; i < size; i++) {
+    caps2 = gst_caps_from_binary (data, i);
+    fail_unless (caps2 == NULL);
+  }
+  data[0] = 'X';
+  fail_unless (gst_caps_from_binary (data, size) == NULL);
+  g_free (data);
+  gst_caps_unref (caps);
+}
+
+GST_END_TEST;
+
+static GstCaps *
+make_named_caps (guint len, guint names, guint width)
+{
+  GstCaps *caps = gst_caps_new_empty ();
+  guint i;
+
+  for (i = 0; i < len; i++) {
+    gchar *name = g_strdup_printf ("test/name%u", (i * 7) % names);
+
+    gst_caps_append_structure (caps, gst_structure_new (name,
+            "v", GST_TYPE_INT_RANGE, (gint) i, (gint) (i + width), NULL));
+    g_free (name);
+  }
+  return caps;
+}
+
+/* straightforward zig-zag intersection for reference */
+static GstCaps *
+intersect_zig_zag_reference (GstCaps * caps1, GstCaps * caps2)
+{
+  GstCaps *dest = gst_caps_new_empty ();
+  guint len1 = gst_caps_get_size (caps1), len2 = gst_caps_get_size (caps2);
+  guint i, j, k;
+
+  for (i = 0; i < len1 + len2 - 1; i++) {
+    j = MIN (i, len1 - 1);
+    k = (i > j) ? (i - j) : 0;
+    while (k < len2) {
+      GstStructure *istruct;
+
+      istruct = gst_structure_intersect (gst_caps_get_structure (caps1, j),
+          gst_caps_get_structure (caps2, k));
+      if (istruct)
+        dest = gst_caps_merge_structure (dest, istruct);
+      k++;
+      if (j == 0)
+        break;
+      j--;
+    }
+  }
+  return dest;
+}
+
+static GstCaps *
+intersect_first_reference (GstCaps * caps1, GstCaps * caps2)
+{
+  GstCaps *dest = gst_caps_new_empty ();
+  guint i, j;
+
+  for (i = 0; i < gst_caps_get_size (caps1); i++) {
+    for (j = 0; j < gst_caps_get_size (caps2); j++) {
+      GstStructure *istruct;
+
+      istruct = gst_structure_intersect (gst_caps_get_structure (caps1, i),
+          gst_caps_get_structure (caps2, j));
+      if (istruct)
+        dest = gst_caps_merge_structure (dest, istruct);
+    }
+  }
+  return dest;
+}
+
+GST_START_TEST (test_intersect_large)
+{
+  GstCaps *caps1, *caps2, *icaps, *ref;
+  guint i;
+
+  caps1 = make_named_caps (40, 5, 10);
+  caps2 = make_named_caps (30, 3, 4);
+
+  icaps = gst_caps_intersect_full (caps1, caps2, GST_CAPS_INTERSECT_ZIG_ZAG);
+  ref = intersect_zig_zag_reference (caps1, caps2);
+  fail_if (gst_caps_is_empty (icaps));
+  fail_unless (gst_caps_is_strictly_equal (icaps, ref));
+  gst_caps_unref (icaps);
+  gst_caps_unref (ref);
+
+  /* first mode keeps the order of caps1 */
+  icaps = gst_caps_intersect_full (caps1, caps2, GST_CAPS_INTERSECT_FIRST);
+  ref = intersect_first_reference (caps1, caps2);
+  fail_if (gst_caps_is_empty (icaps));
+  fail_unless (gst_caps_is_strictly_equal (icaps, ref));
+  gst_caps_unref (icaps);
+  gst_caps_unref (ref);
+
+  fail_unless (gst_caps_can_intersect (caps1, caps2));
+  gst_caps_unref (caps2);
+
+  /* no structure with the same name */
+  caps2 = gst_caps_from_string ("test/other, v=(int)[ 0, 100 ]");
+  for (i = 0; i < 10; i++)
+    gst_caps_append (caps2, gst_caps_from_string ("test/other2"));
+  fail_if (gst_caps_can_intersect (caps1, caps2));
+  icaps = gst_caps_intersect (caps1, caps2);
+  fail_unless (gst_caps_is_empty (icaps));
+  gst_caps_unref (icaps);
+
+  gst_caps_unref (caps2);
+  gst_caps_unref (caps1);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_caps_suite (void)
 {
@@ -1095,6 +1451,7 @@ gst_caps_suite (void)
   tcase_add_test (tc_chain, test_mutability);
   tcase_add_test (tc_chain, test_static_caps);
   tcase_add_test (tc_chain, test_simplify);
+  tcase_add_test (tc_chain, test_simplify_large);
   tcase_add_test (tc_chain, test_truncate);
   tcase_add_test (tc_chain, test_subset);
   tcase_add_test (tc_chain, test_merge_fundamental);
@@ -1107,9 +1464,13 @@ gst_caps_suite (void)
   tcase_add_test (tc_chain, test_intersect_first);
   tcase_add_test (tc_chain, test_intersect_first2);
   tcase_add_test (tc_chain, test_intersect_duplication);
+  tcase_add_test (tc_chain, test_intersect_large);
   tcase_add_test (tc_chain, test_normalize);
   tcase_add_test (tc_chain, test_broken);
   tcase_add_test (tc_chain, test_features);
+  tcase_add_test (tc_chain, test_features_shared);
+  tcase_add_test (tc_chain, test_intern);
+  tcase_add_test (tc_chain, test_binary);
 
   return s;
 }
@@ -119,6 +119,107 @@ GST_START_TEST (test_can_sink_all_caps)
 
 GST_END_TEST;
 
+static void
+filter_test_class_init (GstElementClass * klass, gpointer class_data)
+{
+  GstCaps *caps;
+
+  caps = gst_caps_from_string (class_data);
+  gst_element_class_add_pad_template (klass,
+      gst_pad_template_new ("sink", GST_PAD_SINK, GST_PAD_ALWAYS, caps));
+  gst_caps_unref (caps);
+  gst_element_class_set_static_metadata (klass, "test", "Test", "test",
+      "test");
+}
+
+static GstElementFactory *
+register_filter_test_element (const gchar * name, const gchar * caps)
+{
+  GTypeInfo info = { 0, };
+  GType type;
+
+  info.class_size = sizeof (GstElementClass);
+  info.class_init = (GClassInitFunc) filter_test_class_init;
+  info.class_data = caps;
+  info.instance_size = sizeof (GstElement);
+
+  type = g_type_register_static (GST_TYPE_ELEMENT, name, &info, 0);
+  fail_unless (gst_element_register (NULL, name, GST_RANK_NONE, type));
+
+  return gst_element_factory_find (name);
+}
+
+static gboolean
+filter_has_factory (GList * list, const GstCaps * caps, gboolean subsetonly,
+    GstElementFactory * factory)
+{
+  GList *res;
+  gboolean found;
+
+  res = gst_element_factory_list_filter (list, caps, GST_PAD_SINK,
+      subsetonly);
+  found = g_list_find (res, factory) != NULL;
+  gst_plugin_feature_list_free (res);
+
+  return found;
+}
+
+/* check that the index of the registry doesn't lose matches */
+GST_START_TEST (test_list_filter)
+{
+  GstElementFactory *audio, *gl, *any, *unregistered;
+  GList *list;
+  GstCaps *caps;
+
+  audio = register_filter_test_element ("filtertestaudio",
+      "audio/x-raw, rate=(int)[ 1, 48000 ]");
+  gl = register_filter_test_element ("filtertestgl",
+      "video/x-raw(memory:GLMemory), format=(string)RGBA");
+  any = register_filter_test_element ("filtertestany", "ANY");
+  unregistered = setup_factory ();
+
+  list = g_list_prepend (NULL, audio);
+  list = g_list_prepend (list, gl);
+  list = g_list_prepend (list, any);
+  list = g_list_prepend (list, unregistered);
+
+  caps = gst_caps_from_string ("audio/x-raw, rate=(int)44100");
+  fail_unless (filter_has_factory (list, caps, FALSE, audio));
+  fail_unless (filter_has_factory (list, caps, TRUE, audio));
+  fail_if (filter_has_factory (list, caps, FALSE, gl));
+  fail_unless (filter_has_factory (list, caps, FALSE, any));
+  fail_unless (filter_has_factory (list, caps, FALSE, unregistered));
+  gst_caps_unref (caps);
+
+  /* the features have to match */
+  caps = gst_caps_from_string ("video/x-raw, format=(string)RGBA");
+  fail_if (filter_has_factory (list, caps, FALSE, gl));
+  fail_unless (filter_has_factory (list, caps, FALSE, any));
+  gst_caps_unref (caps);
+  caps = gst_caps_from_string ("video/x-raw(memory:GLMemory), "
+      "format=(string)RGBA; audio/x-raw");
+  fail_unless (filter_has_factory (list, caps, FALSE, gl));
+  fail_unless (filter_has_factory (list, caps, FALSE, audio));
+  gst_caps_unref (caps);
+  caps = gst_caps_from_string ("video/x-raw(ANY)");
+  fail_unless (filter_has_factory (list, caps, FALSE, gl));
+  gst_caps_unref (caps);
+
+  /* ANY caps match everything */
+  caps = gst_caps_new_any ();
+  fail_unless (filter_has_factory (list, caps, FALSE, audio));
+  fail_unless (filter_has_factory (list, caps, FALSE, gl));
+  gst_caps_unref (caps);
+
+  g_list_free (list);
+  g_object_unref (unregistered);
+  gst_object_unref (any);
+  gst_object_unref (gl);
+  gst_object_unref (audio);
+}
+
+GST_END_TEST;
+
 /* check if the elementfactory of a class is filled (see #131079) */
 GST_START_TEST (test_class)
 {
@@ -175,6 +276,7 @@ gst_element_factory_suite (void)
   tcase_add_test (tc_chain, test_create);
   tcase_add_test (tc_chain, test_can_sink_any_caps);
   tcase_add_test (tc_chain, test_can_sink_all_caps);
+  tcase_add_test (tc_chain, test_list_filter);
 
   return s;
 }
@@ -586,6 +586,135 @@ GST_START_TEST (send_custom_events)
 
 GST_END_TEST;
 
+GST_START_TEST (recycle_events)
+{
+  GstStructure *stats;
+  GstStructure *qos_stats;
+  GstEvent *event, *event2;
+  GstQOSType type;
+  gdouble proportion;
+  GstClockTimeDiff diff;
+  GstClockTime timestamp;
+  GstCaps *caps;
+  gboolean enabled;
+  guint32 seqnum;
+
+  event = gst_event_new_qos (GST_QOS_TYPE_OVERFLOW, 1.5, 10, 100);
+  seqnum = gst_event_get_seqnum (event);
+  gst_event_unref (event);
+
+  /* the new event reuses the freed one and has its own values */
+  event2 = gst_event_new_qos (GST_QOS_TYPE_UNDERFLOW, 0.5, -10, 200);
+  gst_event_parse_qos (event2, &type, &proportion, &diff, &timestamp);
+  fail_unless (type == GST_QOS_TYPE_UNDERFLOW);
+  fail_unless (proportion == 0.5);
+  fail_unless (diff == -10);
+  fail_unless (timestamp == 200);
+  fail_unless_equals_int (gst_structure_n_fields (gst_event_get_structure
+          (event2)), 4);
+  fail_unless (gst_structure_has_name (gst_event_get_structure (event2),
+          "GstEventQOS"));
+  fail_if (gst_event_get_seqnum (event2) == seqnum);
+
+  stats = gst_allocator_get_cache_stats ();
+  fail_unless (gst_structure_get_boolean (stats, "enabled", &enabled));
+  if (enabled)
+    fail_unless (event2 == event);
+  fail_unless (gst_structure_get (stats, "GstEvent-qos", GST_TYPE_STRUCTURE,
+          &qos_stats, NULL));
+  gst_structure_free (qos_stats);
+  gst_structure_free (stats);
+  gst_event_unref (event2);
+
+  /* recycling releases the values of the event */
+  caps = gst_caps_new_empty_simple ("foo/x-bar");
+  event = gst_event_new_caps (caps);
+  ASSERT_CAPS_REFCOUNT (caps, "caps", 2);
+  gst_event_unref (event);
+  ASSERT_CAPS_REFCOUNT (caps, "caps", 1);
+  gst_caps_unref (caps);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (typed_event_payload)
+{
+  GstEvent *event, *copy;
+  GstSegment segment;
+  const GstSegment *parsed;
+  const GstStructure *structure;
+  GstCaps *caps, *parsed_caps;
+  GstClockTime latency;
+  gdouble proportion;
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  segment.start = 10;
+  segment.base = 20;
+  event = gst_event_new_segment (&segment);
+
+  /* the structure is made from the segment when it is asked for */
+  gst_event_parse_segment (event, &parsed);
+  fail_unless (parsed->start == 10);
+  fail_unless (parsed->base == 20);
+  structure = gst_event_get_structure (event);
+  fail_unless (structure != NULL);
+  fail_unless (gst_event_get_structure (event) == structure);
+  fail_unless (gst_structure_has_name (structure, "GstEventSegment"));
+  fail_unless (gst_structure_get (structure, "segment",
+          GST_TYPE_SEGMENT, &parsed, NULL));
+  fail_unless (parsed->start == 10);
+  gst_segment_free ((GstSegment *) parsed);
+
+  /* copies keep their own segment */
+  copy = gst_event_copy (event);
+  gst_event_unref (event);
+  gst_event_parse_segment (copy, &parsed);
+  fail_unless (parsed->start == 10);
+  fail_unless (parsed->base == 20);
+
+  /* changes through the structure are parsed */
+  segment.start = 30;
+  gst_structure_set (gst_event_writable_structure (copy), "segment",
+      GST_TYPE_SEGMENT, &segment, NULL);
+  gst_event_parse_segment (copy, &parsed);
+  fail_unless (parsed->start == 30);
+  gst_event_unref (copy);
+
+  /* the caps event refs its caps, the structure refs them once more */
+  caps = gst_caps_new_empty_simple ("foo/x-bar");
+  event = gst_event_new_caps (caps);
+  ASSERT_CAPS_REFCOUNT (caps, "caps", 2);
+  gst_event_parse_caps (event, &parsed_caps);
+  fail_unless (parsed_caps == caps);
+  fail_unless (gst_event_has_name (event, "GstEventCaps"));
+  ASSERT_CAPS_REFCOUNT (caps, "caps", 3);
+  copy = gst_event_copy (event);
+  ASSERT_CAPS_REFCOUNT (caps, "caps", 4);
+  gst_event_unref (event);
+  ASSERT_CAPS_REFCOUNT (caps, "caps", 2);
+  gst_structure_remove_field (gst_event_writable_structure (copy), "caps");
+  ASSERT_CAPS_REFCOUNT (caps, "caps", 1);
+  gst_event_unref (copy);
+  gst_caps_unref (caps);
+
+  event = gst_event_new_qos (GST_QOS_TYPE_OVERFLOW, 1.5, 10, 100);
+  gst_structure_set (gst_event_writable_structure (event), "proportion",
+      G_TYPE_DOUBLE, 2.5, NULL);
+  gst_event_parse_qos (event, NULL, &proportion, NULL, NULL);
+  fail_unless (proportion == 2.5);
+  gst_event_unref (event);
+
+  event = gst_event_new_latency (5 * GST_SECOND);
+  structure = gst_event_get_structure (event);
+  fail_unless (gst_structure_get_uint64 (structure, "latency", &latency));
+  fail_unless_equals_uint64 (latency, 5 * GST_SECOND);
+  gst_event_parse_latency (event, &latency);
+  fail_unless_equals_uint64 (latency, 5 * GST_SECOND);
+  gst_event_unref (event);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_event_suite (void)
 {
@@ -597,6 +726,8 @@ gst_event_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, create_events);
   tcase_add_test (tc_chain, send_custom_events);
+  tcase_add_test (tc_chain, recycle_events);
+  tcase_add_test (tc_chain, typed_event_payload);
   return s;
 }
 
@@ -30,6 +30,10 @@
 # define RUNNING_ON_VALGRIND FALSE
 #endif
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 #include <gst/check/gstcheck.h>
 
 GST_START_TEST (test_submemory)
@@ -508,6 +512,185 @@ GST_START_TEST (test_map_resize)
 
 GST_END_TEST;
 
+static guint64
+get_cache_hits (const gchar * name)
+{
+  GstStructure *stats;
+  const GstStructure *s;
+  guint64 hits;
+
+  stats = gst_allocator_get_cache_stats ();
+  fail_unless (stats != NULL);
+  s = gst_value_get_structure (gst_structure_get_value (stats, name));
+  fail_unless (s != NULL);
+  fail_unless (gst_structure_get_uint64 (s, "hits", &hits));
+  gst_structure_free (stats);
+
+  return hits;
+}
+
+GST_START_TEST (test_cache_stats)
+{
+  GstStructure *stats;
+  GstMemory *mem[20];
+  guint64 hits;
+  gboolean enabled;
+  guint i;
+
+  stats = gst_allocator_get_cache_stats ();
+  fail_unless (gst_structure_get_boolean (stats, "enabled", &enabled));
+  gst_structure_free (stats);
+
+  hits = get_cache_hits ("GstMemorySystem-256");
+
+  /* free some blocks into the cache of this thread */
+  for (i = 0; i < 10; i++)
+    mem[i] = gst_allocator_alloc (NULL, 16, NULL);
+  for (i = 0; i < 10; i++)
+    gst_memory_unref (mem[i]);
+
+  /* the first 10 come from the cache, the others need the depot, which adds
+   * the hits of this thread to the stats */
+  for (i = 0; i < G_N_ELEMENTS (mem); i++)
+    mem[i] = gst_allocator_alloc (NULL, 16, NULL);
+  for (i = 0; i < G_N_ELEMENTS (mem); i++) {
+    fail_unless (gst_memory_get_sizes (mem[i], NULL, NULL) == 16);
+    gst_memory_unref (mem[i]);
+  }
+
+  if (enabled)
+    fail_unless (get_cache_hits ("GstMemorySystem-256") >= hits + 10);
+}
+
+GST_END_TEST;
+
+
+GST_START_TEST (test_mmap_allocator)
+{
+  GstAllocator *allocator;
+  GstAllocationParams params;
+  GstMemory *mem, *sub, *copy;
+  GstMapInfo info;
+  const gchar *names[] = { GST_ALLOCATOR_MMAP, GST_ALLOCATOR_MMAP_PREFAULT };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (names); i++) {
+    allocator = gst_allocator_find (names[i]);
+    if (allocator == NULL)
+      return;
+
+    gst_allocation_params_init (&params);
+    params.align = 8191;
+    params.prefix = 16;
+    params.padding = 32;
+
+    mem = gst_allocator_alloc (allocator, 100, &params);
+    fail_unless (mem != NULL);
+    fail_unless (mem->allocator == allocator);
+    fail_unless (mem->offset == 16);
+    fail_unless (mem->size == 100);
+    fail_unless (mem->maxsize >= 148);
+
+    fail_unless (gst_memory_map (mem, &info, GST_MAP_WRITE));
+    fail_unless (((guintptr) info.data - mem->offset) % 8192 == 0);
+    fail_unless (info.data[0] == 0);
+    memset (info.data, 0xaa, info.size);
+    gst_memory_unmap (mem, &info);
+
+    sub = gst_memory_share (mem, 10, 20);
+    fail_unless (sub->parent == mem);
+    fail_unless (gst_memory_map (sub, &info, GST_MAP_READ));
+    fail_unless (info.size == 20);
+    fail_unless (info.data[0] == 0xaa);
+    gst_memory_unmap (sub, &info);
+    gst_memory_unref (sub);
+
+    copy = gst_memory_copy (mem, 0, -1);
+    fail_unless (copy->allocator == allocator);
+    fail_unless (gst_memory_map (copy, &info, GST_MAP_READ));
+    fail_unless (info.size == 100);
+    fail_unless (info.data[99] == 0xaa);
+    gst_memory_unmap (copy, &info);
+    gst_memory_unref (copy);
+
+    gst_memory_unref (mem);
+
+    /* empty memory is not mapped but can still be used */
+    mem = gst_allocator_alloc (allocator, 0, NULL);
+    fail_unless (mem != NULL);
+    fail_unless (mem->maxsize == 0);
+    fail_unless (gst_memory_map (mem, &info, GST_MAP_READWRITE));
+    fail_unless (info.size == 0);
+    gst_memory_unmap (mem, &info);
+    gst_memory_unref (mem);
+
+    gst_object_unref (allocator);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_memfd_allocator)
+{
+  GstAllocator *allocator;
+  GstMemory *mem, *sub, *imported;
+  GstMapInfo info;
+  gsize offset;
+  gint fd;
+
+  allocator = gst_allocator_find (GST_ALLOCATOR_MEMFD);
+  if (allocator == NULL)
+    return;
+
+  mem = gst_allocator_alloc (allocator, 100, NULL);
+  fail_unless (mem != NULL);
+  fd = gst_memory_get_fd (mem, &offset);
+  fail_unless (fd >= 0);
+  fail_unless (offset == 0);
+
+  fail_unless (gst_memory_map (mem, &info, GST_MAP_WRITE));
+  memset (info.data, 0x55, info.size);
+  gst_memory_unmap (mem, &info);
+
+  /* shared memory uses the same fd */
+  sub = gst_memory_share (mem, 10, 20);
+  fail_unless (gst_memory_get_fd (sub, &offset) == fd);
+  fail_unless (offset == 10);
+
+  /* map the fd again, like another process would */
+  imported = gst_memory_new_fd (0, dup (fd), offset + 20, offset, 20);
+  fail_unless (imported != NULL);
+  fail_unless (gst_memory_get_fd (imported, NULL) >= 0);
+  fail_unless (gst_memory_map (imported, &info, GST_MAP_WRITE));
+  fail_unless (info.size == 20);
+  fail_unless (info.data[0] == 0x55);
+  info.data[0] = 0xaa;
+  gst_memory_unmap (imported, &info);
+  gst_memory_unref (imported);
+
+  /* the write is visible in the original memory */
+  fail_unless (gst_memory_map (mem, &info, GST_MAP_READ));
+  fail_unless (info.data[10] == 0xaa);
+  gst_memory_unmap (mem, &info);
+
+  /* empty memory can be allocated too */
+  gst_memory_unref (sub);
+  sub = gst_allocator_alloc (allocator, 0, NULL);
+  fail_unless (sub != NULL);
+  fail_unless (gst_memory_get_fd (sub, NULL) >= 0);
+  fail_unless (gst_memory_get_sizes (sub, NULL, NULL) == 0);
+  gst_memory_unref (sub);
+
+  /* other memory has no fd */
+  sub = gst_allocator_alloc (NULL, 100, NULL);
+  fail_unless (gst_memory_get_fd (sub, NULL) == -1);
+  gst_memory_unref (sub);
+
+  gst_memory_unref (mem);
+  gst_object_unref (allocator);
+}
+
+GST_END_TEST;
 
 static Suite *
 gst_memory_suite (void)
@@ -526,6 +709,9 @@ gst_memory_suite (void)
   tcase_add_test (tc_chain, test_map);
   tcase_add_test (tc_chain, test_map_nested);
   tcase_add_test (tc_chain, test_map_resize);
+  tcase_add_test (tc_chain, test_cache_stats);
+  tcase_add_test (tc_chain, test_mmap_allocator);
+  tcase_add_test (tc_chain, test_memfd_allocator);
 
   return s;
 }
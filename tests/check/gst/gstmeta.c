@@ -245,6 +245,91 @@ GST_START_TEST (test_meta_locked)
 
 GST_END_TEST;
 
+static gboolean
+foreach_meta_remove_odd (GstBuffer * buffer, GstMeta ** meta,
+    gpointer user_data)
+{
+  GstMetaTest *test = (GstMetaTest *) * meta;
+
+  if (test->pts % 2)
+    *meta = NULL;
+  return TRUE;
+}
+
+static guint
+count_meta (GstBuffer * buffer)
+{
+  gpointer state = NULL;
+  guint count = 0;
+
+  while (gst_buffer_iterate_meta (buffer, &state))
+    count++;
+
+  return count;
+}
+
+GST_START_TEST (test_meta_many)
+{
+  GstBuffer *buffer, *copy;
+  GstMetaTest *meta;
+  gpointer state = NULL;
+  gint i;
+
+  buffer = gst_buffer_new_and_alloc (4);
+
+  /* more than fit inline in the buffer */
+  for (i = 0; i < 20; i++) {
+    meta = GST_META_TEST_ADD (buffer);
+    fail_if (meta == NULL);
+    meta->pts = i;
+    meta->dts = i;
+    meta->duration = GST_CLOCK_TIME_NONE;
+    meta->clock_rate = GST_SECOND;
+
+    /* the last added meta is found */
+    fail_unless (GST_META_TEST_GET (buffer) == meta);
+  }
+  fail_unless_equals_int (count_meta (buffer), 20);
+
+  copy = gst_buffer_copy (buffer);
+  fail_unless_equals_int (count_meta (copy), 20);
+  fail_if (GST_META_TEST_GET (copy) == NULL);
+
+  /* removing the found meta makes the next one of the API found */
+  meta = GST_META_TEST_GET (buffer);
+  fail_unless (gst_buffer_remove_meta (buffer, (GstMeta *) meta));
+  meta = GST_META_TEST_GET (buffer);
+  fail_if (meta == NULL);
+  fail_unless_equals_int (meta->pts, 18);
+  fail_unless_equals_int (count_meta (buffer), 19);
+
+  fail_unless (gst_buffer_foreach_meta (buffer, foreach_meta_remove_odd, NULL));
+  fail_unless_equals_int (count_meta (buffer), 10);
+  meta = GST_META_TEST_GET (buffer);
+  fail_if (meta == NULL);
+  fail_unless_equals_int (meta->pts, 18);
+
+  /* all remaining metas are even and still intact */
+  while ((meta = (GstMetaTest *) gst_buffer_iterate_meta (buffer, &state))) {
+    fail_unless (meta->pts % 2 == 0);
+    fail_unless (meta->dts == meta->pts);
+  }
+
+  fail_unless (gst_buffer_foreach_meta (buffer, foreach_meta, NULL));
+  fail_unless_equals_int (count_meta (buffer), 0);
+  fail_unless (GST_META_TEST_GET (buffer) == NULL);
+
+  /* the buffer can be reused */
+  meta = GST_META_TEST_ADD (buffer);
+  fail_if (meta == NULL);
+  fail_unless (GST_META_TEST_GET (buffer) == meta);
+
+  gst_buffer_unref (copy);
+  gst_buffer_unref (buffer);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_buffermeta_suite (void)
 {
@@ -254,6 +339,7 @@ gst_buffermeta_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_meta_test);
   tcase_add_test (tc_chain, test_meta_locked);
+  tcase_add_test (tc_chain, test_meta_many);
 
   return s;
 }
@@ -1714,6 +1714,116 @@ GST_START_TEST (test_sticky_events)
 
 GST_END_TEST;
 
+static gint caps_queries = 0;
+
+static gboolean
+caps_query_count_func (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  if (GST_QUERY_TYPE (query) == GST_QUERY_CAPS)
+    caps_queries++;
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+GST_START_TEST (test_caps_cache)
+{
+  GstPadTemplate *templ;
+  GstPad *pad, *other, *sink;
+  GstCaps *caps, *result, *filter;
+  GstElement *parent;
+
+  caps = gst_caps_from_string ("foo/bar; foo/baz");
+  templ = gst_pad_template_new ("src", GST_PAD_SRC, GST_PAD_ALWAYS, caps);
+  gst_caps_unref (caps);
+  pad = gst_pad_new_from_template (templ, "src");
+  gst_object_unref (templ);
+  gst_pad_set_query_function (pad, caps_query_count_func);
+
+  /* not cached by default */
+  caps_queries = 0;
+  result = gst_pad_query_caps (pad, NULL);
+  gst_caps_unref (result);
+  result = gst_pad_query_caps (pad, NULL);
+  gst_caps_unref (result);
+  fail_unless_equals_int (caps_queries, 2);
+
+  GST_OBJECT_LOCK (pad);
+  GST_PAD_SET_CACHE_CAPS (pad);
+  GST_OBJECT_UNLOCK (pad);
+
+  caps_queries = 0;
+  result = gst_pad_query_caps (pad, NULL);
+  fail_unless_equals_int (gst_caps_get_size (result), 2);
+  gst_caps_unref (result);
+  result = gst_pad_query_caps (pad, NULL);
+  fail_unless_equals_int (gst_caps_get_size (result), 2);
+  gst_caps_unref (result);
+  fail_unless_equals_int (caps_queries, 1);
+
+  /* an equal filter is found in the cache */
+  filter = gst_caps_from_string ("foo/bar");
+  result = gst_pad_query_caps (pad, filter);
+  fail_unless_equals_int (gst_caps_get_size (result), 1);
+  gst_caps_unref (result);
+  gst_caps_unref (filter);
+  fail_unless_equals_int (caps_queries, 2);
+  filter = gst_caps_from_string ("foo/bar");
+  result = gst_pad_query_caps (pad, filter);
+  fail_unless_equals_int (gst_caps_get_size (result), 1);
+  gst_caps_unref (result);
+  gst_caps_unref (filter);
+  fail_unless_equals_int (caps_queries, 2);
+
+  /* reconfigure invalidates */
+  gst_pad_mark_reconfigure (pad);
+  result = gst_pad_query_caps (pad, NULL);
+  gst_caps_unref (result);
+  fail_unless_equals_int (caps_queries, 3);
+  result = gst_pad_query_caps (pad, NULL);
+  gst_caps_unref (result);
+  fail_unless_equals_int (caps_queries, 3);
+
+  /* and so does an explicit invalidate */
+  gst_pad_invalidate_caps_cache (pad);
+  result = gst_pad_query_caps (pad, NULL);
+  gst_caps_unref (result);
+  fail_unless_equals_int (caps_queries, 4);
+
+  /* changes on unrelated pads keep the results */
+  other = gst_pad_new ("other", GST_PAD_SRC);
+  gst_pad_mark_reconfigure (other);
+  gst_pad_invalidate_caps_cache (other);
+  result = gst_pad_query_caps (pad, NULL);
+  gst_caps_unref (result);
+  fail_unless_equals_int (caps_queries, 4);
+
+  /* linking the pad invalidates */
+  sink = gst_pad_new ("sink", GST_PAD_SINK);
+  fail_unless (gst_pad_link (pad, sink) == GST_PAD_LINK_OK);
+  result = gst_pad_query_caps (pad, NULL);
+  gst_caps_unref (result);
+  fail_unless_equals_int (caps_queries, 5);
+  gst_pad_unlink (pad, sink);
+
+  /* reconfigure can be marked with the lock of the element held, the pads
+   * behind it are only invalidated by the next query */
+  parent = gst_bin_new (NULL);
+  fail_unless (gst_element_add_pad (parent, gst_object_ref (sink)));
+  GST_OBJECT_LOCK (parent);
+  gst_pad_mark_reconfigure (sink);
+  GST_OBJECT_UNLOCK (parent);
+  result = gst_pad_query_caps (pad, NULL);
+  gst_caps_unref (result);
+  fail_unless_equals_int (caps_queries, 5);
+  gst_object_unref (parent);
+
+  gst_object_unref (sink);
+  gst_object_unref (other);
+  gst_object_unref (pad);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_pad_suite (void)
 {
@@ -1756,6 +1866,7 @@ gst_pad_suite (void)
   tcase_add_test (tc_chain, test_block_async_full_destroy_dispose);
   tcase_add_test (tc_chain, test_block_async_replace_callback_no_flush);
   tcase_add_test (tc_chain, test_sticky_events);
+  tcase_add_test (tc_chain, test_caps_cache);
 
   return s;
 }
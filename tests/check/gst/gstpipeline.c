@@ -574,6 +574,210 @@ GST_START_TEST (test_pipeline_in_pipeline)
 
 GST_END_TEST;
 
+static GstTaskScheduling policy_scheduling;
+static gint policy_nice;
+
+static GstBusSyncReply
+policy_sync_handler (GstBus * bus, GstMessage * message, gpointer data)
+{
+  GstStreamStatusType type;
+  const GValue *val;
+
+  if (GST_MESSAGE_TYPE (message) != GST_MESSAGE_STREAM_STATUS)
+    return GST_BUS_PASS;
+
+  gst_message_parse_stream_status (message, &type, NULL);
+  val = gst_message_get_stream_status_object (message);
+  if (type == GST_STREAM_STATUS_TYPE_CREATE && G_VALUE_HOLDS (val,
+          GST_TYPE_TASK)) {
+    GstTask *task = g_value_get_object (val);
+
+    policy_scheduling = gst_task_get_scheduling (task, NULL);
+    policy_nice = gst_task_get_nice (task);
+  }
+  return GST_BUS_PASS;
+}
+
+static gint pool_func_count;
+
+static void
+pool_func (gpointer user_data)
+{
+  g_atomic_int_inc (&pool_func_count);
+}
+
+GST_START_TEST (test_task_pool)
+{
+  GstElement *pipeline;
+  GstTaskPool *pool;
+  GError *error = NULL;
+
+  pipeline = gst_pipeline_new (NULL);
+  pool = gst_work_stealing_task_pool_new (1);
+  gst_pipeline_set_task_pool (GST_PIPELINE (pipeline), pool);
+  pool_func_count = 0;
+
+  /* the pool is not prepared before the pipeline goes to READY */
+  gst_task_pool_push (pool, pool_func, NULL, &error);
+  fail_unless (error != NULL);
+  g_clear_error (&error);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_READY),
+      GST_STATE_CHANGE_SUCCESS);
+  gst_task_pool_push (pool, pool_func, NULL, &error);
+  fail_unless (error == NULL);
+
+  /* cleaning up runs what is still queued */
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  fail_unless_equals_int (g_atomic_int_get (&pool_func_count), 1);
+
+  gst_task_pool_push (pool, pool_func, NULL, &error);
+  fail_unless (error != NULL);
+  g_clear_error (&error);
+
+  gst_object_unref (pipeline);
+  gst_object_unref (pool);
+}
+
+GST_END_TEST;
+
+static GstElement *
+make_pool_pipeline (GstTaskPool * pool)
+{
+  GstElement *pipeline, *fakesrc, *fakesink;
+
+  pipeline = gst_pipeline_new (NULL);
+  fakesrc = gst_element_factory_make ("fakesrc", NULL);
+  fakesink = gst_element_factory_make ("fakesink", NULL);
+  fail_unless (fakesrc && fakesink);
+  g_object_set (fakesink, "sync", TRUE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), fakesrc, fakesink, NULL);
+  fail_unless (gst_element_link (fakesrc, fakesink));
+  gst_pipeline_set_task_pool (GST_PIPELINE (pipeline), pool);
+
+  return pipeline;
+}
+
+static void
+check_shared_pool (GstTaskPool * pool)
+{
+  GstElement *p1, *p2;
+  GError *error = NULL;
+
+  p1 = make_pool_pipeline (pool);
+  p2 = make_pool_pipeline (pool);
+  pool_func_count = 0;
+
+  fail_unless (gst_element_set_state (p1,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_set_state (p2,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (p1, NULL, NULL, -1),
+      GST_STATE_CHANGE_SUCCESS);
+  fail_unless_equals_int (gst_element_get_state (p2, NULL, NULL, -1),
+      GST_STATE_CHANGE_SUCCESS);
+
+  /* the streaming thread of p2 still runs in the pool, stopping p1 must
+   * not wait for it nor clean up the pool */
+  fail_unless_equals_int (gst_element_set_state (p1, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  gst_task_pool_push (pool, pool_func, NULL, &error);
+  fail_unless (error == NULL);
+
+  fail_unless_equals_int (gst_element_set_state (p2, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  fail_unless_equals_int (g_atomic_int_get (&pool_func_count), 1);
+
+  gst_object_unref (p1);
+  gst_object_unref (p2);
+}
+
+GST_START_TEST (test_task_pool_shared)
+{
+  GstTaskPool *pool;
+
+  pool = gst_work_stealing_task_pool_new (1);
+  check_shared_pool (pool);
+  gst_object_unref (pool);
+
+  pool = gst_task_pool_new ();
+  check_shared_pool (pool);
+  gst_object_unref (pool);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_thread_policy)
+{
+  GstElement *pipeline, *fakesrc, *fakesink;
+  GstStructure *policy;
+  GstMessage *msg;
+  GstBus *bus;
+
+  pipeline = gst_pipeline_new (NULL);
+  fakesrc = gst_element_factory_make ("fakesrc", "src");
+  fakesink = gst_element_factory_make ("fakesink", "sink");
+  fail_unless (pipeline && fakesrc && fakesink);
+
+  g_object_set (fakesrc, "num-buffers", 10, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), fakesrc, fakesink, NULL);
+  fail_unless (gst_element_link (fakesrc, fakesink));
+
+  /* the policy of the pad is used before the one of the element */
+  policy = gst_structure_from_string ("thread-policy, scheduling=fifo, "
+      "priority=1", NULL);
+  gst_pipeline_set_thread_policy (GST_PIPELINE (pipeline), "src", policy);
+  gst_structure_free (policy);
+  policy = gst_structure_from_string ("thread-policy, scheduling=other, "
+      "nice=0", NULL);
+  gst_pipeline_set_thread_policy (GST_PIPELINE (pipeline), "src.src", policy);
+  gst_structure_free (policy);
+
+  policy = gst_pipeline_get_thread_policy (GST_PIPELINE (pipeline), "src.src");
+  fail_unless (policy != NULL);
+  fail_unless_equals_string (gst_structure_get_string (policy, "scheduling"),
+      "other");
+  gst_structure_free (policy);
+  fail_unless (gst_pipeline_get_thread_policy (GST_PIPELINE (pipeline),
+          NULL) == NULL);
+
+  /* a wrong policy is refused right away */
+  policy = gst_structure_from_string ("thread-policy, cpus=foo", NULL);
+  fail_if (gst_pipeline_set_thread_policy (GST_PIPELINE (pipeline), "sink",
+          policy));
+  gst_structure_free (policy);
+  fail_unless (gst_pipeline_get_thread_policy (GST_PIPELINE (pipeline),
+          "sink") == NULL);
+
+  policy_scheduling = GST_TASK_SCHEDULING_INHERIT;
+  policy_nice = GST_TASK_NICE_INHERIT;
+
+  bus = gst_element_get_bus (pipeline);
+  gst_bus_set_sync_handler (bus, policy_sync_handler, NULL, NULL);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_ASYNC);
+  msg = gst_bus_timed_pop_filtered (bus, -1, GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  fail_unless_equals_int (policy_scheduling, GST_TASK_SCHEDULING_OTHER);
+  fail_unless_equals_int (policy_nice, 0);
+
+  gst_bus_set_sync_handler (bus, NULL, NULL, NULL);
+  gst_object_unref (bus);
+
+  /* removing a policy */
+  gst_pipeline_set_thread_policy (GST_PIPELINE (pipeline), "src.src", NULL);
+  fail_unless (gst_pipeline_get_thread_policy (GST_PIPELINE (pipeline),
+          "src.src") == NULL);
+
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_pipeline_suite (void)
 {
@@ -591,6 +795,9 @@ gst_pipeline_suite (void)
   tcase_add_test (tc_chain, test_base_time);
   tcase_add_test (tc_chain, test_concurrent_create);
   tcase_add_test (tc_chain, test_pipeline_in_pipeline);
+  tcase_add_test (tc_chain, test_task_pool);
+  tcase_add_test (tc_chain, test_task_pool_shared);
+  tcase_add_test (tc_chain, test_thread_policy);
 
   return s;
 }
@@ -276,6 +276,72 @@ GST_START_TEST (test_queries)
 
 GST_END_TEST;
 
+GST_START_TEST (typed_query_payload)
+{
+  const GstStructure *structure;
+  GstClockTime min, max;
+  GstQuery *query, *copy;
+  GstFormat format;
+  gboolean live;
+  gint64 value;
+  guint64 uvalue;
+
+  /* the structure is made from the typed fields when it is asked for and is
+   * kept up to date after that */
+  query = gst_query_new_position (GST_FORMAT_TIME);
+  gst_query_set_position (query, GST_FORMAT_TIME, 50);
+  structure = gst_query_get_structure (query);
+  fail_unless (gst_structure_has_name (structure, "GstQueryPosition"));
+  fail_unless (gst_structure_get_int64 (structure, "current", &value));
+  fail_unless_equals_int64 (value, 50);
+  gst_query_set_position (query, GST_FORMAT_TIME, 55);
+  fail_unless (gst_query_get_structure (query) == structure);
+  fail_unless (gst_structure_get_int64 (structure, "current", &value));
+  fail_unless_equals_int64 (value, 55);
+
+  /* changes through the structure are parsed */
+  gst_structure_set (gst_query_writable_structure (query), "current",
+      G_TYPE_INT64, G_GINT64_CONSTANT (60), NULL);
+  gst_query_parse_position (query, &format, &value);
+  fail_unless_equals_int (format, GST_FORMAT_TIME);
+  fail_unless_equals_int64 (value, 60);
+  gst_query_unref (query);
+
+  query = gst_query_new_duration (GST_FORMAT_BYTES);
+  gst_query_set_duration (query, GST_FORMAT_BYTES, 1000);
+  copy = gst_query_copy (query);
+  gst_query_unref (query);
+  gst_query_parse_duration (copy, &format, &value);
+  fail_unless_equals_int (format, GST_FORMAT_BYTES);
+  fail_unless_equals_int64 (value, 1000);
+  structure = gst_query_get_structure (copy);
+  fail_unless (gst_structure_has_name (structure, "GstQueryDuration"));
+  fail_unless (gst_structure_get_int64 (structure, "duration", &value));
+  fail_unless_equals_int64 (value, 1000);
+  gst_query_unref (copy);
+
+  query = gst_query_new_latency ();
+  gst_query_parse_latency (query, &live, &min, &max);
+  fail_if (live);
+  fail_unless_equals_uint64 (min, 0);
+  fail_unless_equals_uint64 (max, GST_CLOCK_TIME_NONE);
+  gst_query_set_latency (query, TRUE, 10, 20);
+  structure = gst_query_get_structure (query);
+  fail_unless (gst_structure_get_boolean (structure, "live", &live));
+  fail_unless (live);
+  fail_unless (gst_structure_get_uint64 (structure, "max-latency", &uvalue));
+  fail_unless_equals_uint64 (uvalue, 20);
+  gst_structure_set (gst_query_writable_structure (query), "min-latency",
+      G_TYPE_UINT64, G_GUINT64_CONSTANT (15), NULL);
+  gst_query_parse_latency (query, &live, &min, &max);
+  fail_unless (live);
+  fail_unless_equals_uint64 (min, 15);
+  fail_unless_equals_uint64 (max, 20);
+  gst_query_unref (query);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_query_suite (void)
 {
@@ -287,6 +353,7 @@ gst_query_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, create_queries);
   tcase_add_test (tc_chain, test_queries);
+  tcase_add_test (tc_chain, typed_query_payload);
   return s;
 }
 
@@ -23,7 +23,11 @@
 #endif
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
 #include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 static gint
 plugin_name_cmp (GstPlugin * a, GstPlugin * b)
@@ -203,6 +207,115 @@ GST_START_TEST (test_registry_update)
 
 GST_END_TEST;
 
+/* the path of this program, to run it with a different registry */
+static const gchar *test_program;
+
+static gint
+line_cmp (const gchar ** a, const gchar ** b)
+{
+  return strcmp (*a, *b);
+}
+
+/* print the caps of all static pad templates, called in the child processes
+ * of test_registry_binary_caps */
+static int
+dump_template_caps (void)
+{
+  GList *factories, *f;
+  GPtrArray *lines;
+  guint i;
+
+  gst_init (NULL, NULL);
+
+  lines = g_ptr_array_new_with_free_func (g_free);
+  factories = gst_registry_get_feature_list (gst_registry_get (),
+      GST_TYPE_ELEMENT_FACTORY);
+  for (f = factories; f; f = f->next) {
+    GstElementFactory *factory = f->data;
+    const GList *t;
+
+    for (t = gst_element_factory_get_static_pad_templates (factory); t;
+        t = t->next) {
+      GstStaticPadTemplate *templ = t->data;
+      GstCaps *caps;
+      gchar *str;
+
+      /* the string is public API, templates from the registry have it too */
+      g_assert (templ->static_caps.string != NULL);
+
+      caps = gst_static_pad_template_get_caps (templ);
+      str = gst_caps_to_string (caps);
+      g_ptr_array_add (lines, g_strdup_printf ("%s:%s:%s:%s",
+              GST_OBJECT_NAME (factory), templ->name_template, str,
+              templ->static_caps.string));
+      g_free (str);
+      gst_caps_unref (caps);
+    }
+  }
+  gst_plugin_feature_list_free (factories);
+
+  g_ptr_array_sort (lines, (GCompareFunc) line_cmp);
+  for (i = 0; i < lines->len; i++)
+    g_print ("%s\n", (const gchar *) g_ptr_array_index (lines, i));
+  g_ptr_array_free (lines, TRUE);
+
+  return 0;
+}
+
+static gchar *
+run_dump_template_caps (const gchar * registry_file)
+{
+  gchar *argv[] = { (gchar *) test_program, (gchar *) "--dump-template-caps",
+    NULL
+  };
+  gchar **envp, *output = NULL;
+  gint status;
+
+  envp = g_get_environ ();
+  envp = g_environ_setenv (envp, "GST_REGISTRY", registry_file, TRUE);
+  envp = g_environ_unsetenv (envp, "GST_REGISTRY_1_0");
+  /* scan in the process so that the first run gets the caps from the
+   * elements, and don't rescan in the second run */
+  envp = g_environ_setenv (envp, "GST_REGISTRY_FORK", "no", TRUE);
+
+  fail_unless (g_spawn_sync (NULL, argv, envp, 0, NULL, NULL, &output, NULL,
+          &status, NULL));
+  fail_unless (status == 0);
+  g_strfreev (envp);
+
+  return output;
+}
+
+GST_START_TEST (test_registry_binary_caps)
+{
+  gchar *registry_file, *scanned, *loaded;
+  gint fd;
+
+  fd = g_file_open_tmp ("gst-check-registry-XXXXXX.bin", &registry_file, NULL);
+  fail_unless (fd >= 0);
+  close (fd);
+  g_unlink (registry_file);
+
+  /* the first run scans the plugins and writes the registry */
+  scanned = run_dump_template_caps (registry_file);
+  fail_unless (g_file_test (registry_file, G_FILE_TEST_EXISTS));
+
+  /* the second run loads the binary caps from the registry */
+  g_setenv ("GST_REGISTRY_UPDATE", "no", TRUE);
+  loaded = run_dump_template_caps (registry_file);
+  g_unsetenv ("GST_REGISTRY_UPDATE");
+
+  fail_unless (scanned != NULL && *scanned != '\0');
+  fail_unless_equals_string (loaded, scanned);
+
+  g_unlink (registry_file);
+  g_free (registry_file);
+  g_free (scanned);
+  g_free (loaded);
+}
+
+GST_END_TEST;
+
 static Suite *
 registry_suite (void)
 {
@@ -212,8 +325,22 @@ registry_suite (void)
   suite_add_tcase (s, tc_chain);
 
   tcase_add_test (tc_chain, test_registry_update);
+  tcase_add_test (tc_chain, test_registry_binary_caps);
 
   return s;
 }
 
-GST_CHECK_MAIN (registry);
+int
+main (int argc, char **argv)
+{
+  Suite *s;
+
+  if (argc == 2 && strcmp (argv[1], "--dump-template-caps") == 0)
+    return dump_template_caps ();
+
+  test_program = argv[0];
+
+  gst_check_init (&argc, &argv);
+  s = registry_suite ();
+  return gst_check_run_suite (s, "registry", __FILE__);
+}
@@ -607,6 +607,124 @@ GST_START_TEST (test_vararg_getters)
 
 GST_END_TEST;
 
+GST_START_TEST (test_from_string_untyped)
+{
+  GstStructure *s;
+  const gchar *str;
+  gboolean b;
+  gint i;
+
+  /* words are strings unless the other types can deserialize them */
+  s = gst_structure_from_string ("test, word=hello, flag=yes, off=False, "
+      "num=42, low=min, big=inf, frac=1/2, bytes=12abc", NULL);
+  fail_unless (s != NULL);
+
+  fail_unless ((str = gst_structure_get_string (s, "word")));
+  fail_unless_equals_string (str, "hello");
+  fail_unless (gst_structure_get_boolean (s, "flag", &b));
+  fail_unless (b);
+  fail_unless (gst_structure_get_boolean (s, "off", &b));
+  fail_if (b);
+  fail_unless (gst_structure_get_int (s, "num", &i));
+  fail_unless_equals_int (i, 42);
+  fail_unless (gst_structure_get_int (s, "low", &i));
+  fail_unless_equals_int (i, G_MININT);
+  fail_unless (gst_structure_has_field_typed (s, "big", G_TYPE_DOUBLE));
+  fail_unless (gst_structure_has_field_typed (s, "frac", GST_TYPE_FRACTION));
+  fail_unless ((str = gst_structure_get_string (s, "bytes")));
+  fail_unless_equals_string (str, "12abc");
+  gst_structure_free (s);
+
+  /* plain numbers keep the meaning the int deserializer gives them */
+  s = gst_structure_from_string ("test, neg=-17, oct=010, "
+      "wide=1234567890, huge=4294967296, zero=-0", NULL);
+  fail_unless (s != NULL);
+  fail_unless (gst_structure_get_int (s, "neg", &i));
+  fail_unless_equals_int (i, -17);
+  fail_unless (gst_structure_get_int (s, "oct", &i));
+  fail_unless_equals_int (i, 8);
+  fail_unless (gst_structure_get_int (s, "wide", &i));
+  fail_unless_equals_int (i, 1234567890);
+  fail_unless (gst_structure_has_field_typed (s, "huge", G_TYPE_DOUBLE));
+  fail_unless (gst_structure_get_int (s, "zero", &i));
+  fail_unless_equals_int (i, 0);
+  gst_structure_free (s);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_many_fields)
+{
+  GstStructure *s, *s2;
+  gchar name[16];
+  gint i, val;
+
+  s = gst_structure_new_empty ("test");
+
+  /* enough fields to get an index, added in reverse quark order */
+  for (i = 63; i >= 0; i--) {
+    g_snprintf (name, sizeof (name), "field-%d", i);
+    gst_structure_set (s, name, G_TYPE_INT, i, NULL);
+  }
+  fail_unless_equals_int (gst_structure_n_fields (s), 64);
+
+  /* fields keep the order in which they were added */
+  for (i = 0; i < 64; i++) {
+    g_snprintf (name, sizeof (name), "field-%d", 63 - i);
+    fail_unless_equals_string (gst_structure_nth_field_name (s, i), name);
+  }
+
+  for (i = 0; i < 64; i++) {
+    g_snprintf (name, sizeof (name), "field-%d", i);
+    fail_unless (gst_structure_get_int (s, name, &val));
+    fail_unless_equals_int (val, i);
+  }
+  fail_if (gst_structure_has_field (s, "field-64"));
+
+  /* replacing a value does not add a field */
+  gst_structure_set (s, "field-10", G_TYPE_INT, 100, NULL);
+  fail_unless_equals_int (gst_structure_n_fields (s), 64);
+  fail_unless (gst_structure_get_int (s, "field-10", &val));
+  fail_unless_equals_int (val, 100);
+
+  s2 = gst_structure_copy (s);
+  fail_unless (gst_structure_is_equal (s, s2));
+
+  /* remove every other field, the others stay in order */
+  for (i = 0; i < 64; i += 2) {
+    g_snprintf (name, sizeof (name), "field-%d", i);
+    gst_structure_remove_field (s, name);
+  }
+  fail_unless_equals_int (gst_structure_n_fields (s), 32);
+  for (i = 0; i < 32; i++) {
+    g_snprintf (name, sizeof (name), "field-%d", 63 - 2 * i);
+    fail_unless_equals_string (gst_structure_nth_field_name (s, i), name);
+  }
+  for (i = 0; i < 64; i++) {
+    g_snprintf (name, sizeof (name), "field-%d", i);
+    fail_unless (gst_structure_has_field (s, name) == (i % 2 == 1));
+  }
+  fail_if (gst_structure_is_equal (s, s2));
+
+  /* the copy is not affected */
+  for (i = 0; i < 64; i++) {
+    g_snprintf (name, sizeof (name), "field-%d", i);
+    fail_unless (gst_structure_get_int (s2, name, &val));
+    fail_unless_equals_int (val, i == 10 ? 100 : i);
+  }
+
+  gst_structure_remove_all_fields (s2);
+  fail_unless_equals_int (gst_structure_n_fields (s2), 0);
+  gst_structure_set (s2, "field-1", G_TYPE_INT, 1, NULL);
+  fail_unless (gst_structure_get_int (s2, "field-1", &val));
+  fail_unless_equals_int (val, 1);
+
+  gst_structure_free (s2);
+  gst_structure_free (s);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_structure_suite (void)
 {
@@ -628,6 +746,8 @@ gst_structure_suite (void)
   tcase_add_test (tc_chain, test_structure_nested);
   tcase_add_test (tc_chain, test_structure_nested_from_and_to_string);
   tcase_add_test (tc_chain, test_vararg_getters);
+  tcase_add_test (tc_chain, test_many_fields);
+  tcase_add_test (tc_chain, test_from_string_untyped);
   return s;
 }
 
@@ -178,6 +178,242 @@ GST_START_TEST (test_no_lock)
 
 GST_END_TEST;
 
+static gint pool_started;
+static gboolean pool_release;
+
+static void
+pool_block_func (void *data)
+{
+  g_mutex_lock (&task_lock);
+  pool_started++;
+  g_cond_broadcast (&task_cond);
+  while (!pool_release)
+    g_cond_wait (&task_cond, &task_lock);
+  g_mutex_unlock (&task_lock);
+}
+
+GST_START_TEST (test_work_stealing_pool_busy)
+{
+  GstTaskPool *pool;
+  GError *error = NULL;
+  gint i;
+
+  g_cond_init (&task_cond);
+  g_mutex_init (&task_lock);
+  pool_started = 0;
+  pool_release = FALSE;
+
+  pool = gst_work_stealing_task_pool_new (1);
+  fail_unless (GST_IS_WORK_STEALING_TASK_POOL (pool));
+  gst_task_pool_prepare (pool, &error);
+  fail_unless (error == NULL);
+
+  /* functions that block their worker must not keep the others from
+   * starting */
+  for (i = 0; i < 4; i++) {
+    gst_task_pool_push_full (pool, i % 3, pool_block_func, NULL, &error);
+    fail_unless (error == NULL);
+  }
+
+  g_mutex_lock (&task_lock);
+  while (pool_started < 4)
+    g_cond_wait (&task_cond, &task_lock);
+  pool_release = TRUE;
+  g_cond_broadcast (&task_cond);
+  g_mutex_unlock (&task_lock);
+
+  gst_task_pool_cleanup (pool);
+  gst_object_unref (pool);
+}
+
+GST_END_TEST;
+
+static void
+pool_count_func (void *data)
+{
+  g_mutex_lock (&task_lock);
+  pool_started++;
+  g_cond_broadcast (&task_cond);
+  g_mutex_unlock (&task_lock);
+}
+
+static void
+pool_push_func (void *data)
+{
+  GstTaskPool *pool = data;
+  gint i;
+
+  /* these go to the queue of this worker, the others steal them */
+  for (i = 0; i < 8; i++)
+    gst_task_pool_push (pool, pool_count_func, NULL, NULL);
+}
+
+GST_START_TEST (test_work_stealing_pool_push)
+{
+  GstTaskPool *pool;
+
+  g_cond_init (&task_cond);
+  g_mutex_init (&task_lock);
+  pool_started = 0;
+
+  pool = gst_work_stealing_task_pool_new (2);
+  gst_task_pool_prepare (pool, NULL);
+
+  gst_task_pool_push (pool, pool_push_func, pool, NULL);
+
+  g_mutex_lock (&task_lock);
+  while (pool_started < 8)
+    g_cond_wait (&task_cond, &task_lock);
+  g_mutex_unlock (&task_lock);
+
+  gst_task_pool_cleanup (pool);
+  gst_object_unref (pool);
+
+  /* pushing on a pool that is not prepared fails */
+  pool = gst_work_stealing_task_pool_new (0);
+  {
+    GError *error = NULL;
+
+    gst_task_pool_push (pool, pool_count_func, NULL, &error);
+    fail_unless (error != NULL);
+    g_error_free (error);
+  }
+  gst_object_unref (pool);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_work_stealing_pool_task)
+{
+  GstTaskPool *pool;
+  GstTask *t;
+
+  pool = gst_work_stealing_task_pool_new (2);
+  gst_task_pool_prepare (pool, NULL);
+
+  t = gst_task_new (task_func, NULL, NULL);
+  fail_if (t == NULL);
+  gst_task_set_pool (t, pool);
+  fail_unless (gst_task_get_priority_class (t) ==
+      GST_TASK_POOL_PRIORITY_NORMAL);
+  gst_task_set_priority_class (t, GST_TASK_POOL_PRIORITY_HIGH);
+  fail_unless (gst_task_get_priority_class (t) == GST_TASK_POOL_PRIORITY_HIGH);
+
+  g_rec_mutex_init (&task_mutex);
+  gst_task_set_lock (t, &task_mutex);
+
+  g_cond_init (&task_cond);
+  g_mutex_init (&task_lock);
+
+  g_mutex_lock (&task_lock);
+  fail_unless (gst_task_start (t));
+  /* wait for it to spin up */
+  g_cond_wait (&task_cond, &task_lock);
+  g_mutex_unlock (&task_lock);
+
+  fail_unless (gst_task_join (t));
+  gst_object_unref (t);
+
+  gst_task_pool_cleanup (pool);
+  gst_object_unref (pool);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_thread_policy)
+{
+  GstStructure *policy;
+  GstTask *t;
+  guint cpus[] = { 0 }, *res, n_cpus;
+  gint priority;
+
+  t = gst_task_new (task_func, NULL, NULL);
+  fail_if (t == NULL);
+
+  fail_unless (gst_task_get_scheduling (t, NULL) ==
+      GST_TASK_SCHEDULING_INHERIT);
+  fail_unless (gst_task_get_nice (t) == GST_TASK_NICE_INHERIT);
+  fail_unless (gst_task_get_cpus (t, &n_cpus) == NULL);
+  fail_unless (n_cpus == 0);
+
+  gst_task_set_scheduling (t, GST_TASK_SCHEDULING_RR, 10);
+  fail_unless (gst_task_get_scheduling (t, &priority) ==
+      GST_TASK_SCHEDULING_RR);
+  fail_unless (priority == 10);
+  gst_task_set_nice (t, 5);
+  fail_unless (gst_task_get_nice (t) == 5);
+  ASSERT_CRITICAL (gst_task_set_nice (t, 20));
+  ASSERT_CRITICAL (gst_task_set_nice (t, -21));
+  fail_unless (gst_task_get_nice (t) == 5);
+
+  policy = gst_structure_from_string ("thread-policy, scheduling=fifo, "
+      "priority=20, cpus=0", NULL);
+  fail_unless (policy != NULL);
+  if (gst_task_set_thread_policy (t, policy)) {
+    fail_unless (gst_task_get_scheduling (t, &priority) ==
+        GST_TASK_SCHEDULING_FIFO);
+    fail_unless (priority == 20);
+    /* fields that are not set are reset */
+    fail_unless (gst_task_get_nice (t) == GST_TASK_NICE_INHERIT);
+    res = gst_task_get_cpus (t, &n_cpus);
+    fail_unless (n_cpus == 1);
+    fail_unless (res[0] == 0);
+    g_free (res);
+  }
+  gst_structure_free (policy);
+
+  /* an invalid policy does not change the task */
+  gst_task_set_nice (t, 5);
+  policy = gst_structure_from_string ("thread-policy, scheduling=batch, "
+      "nice=10", NULL);
+  fail_if (gst_task_thread_policy_is_valid (policy));
+  fail_if (gst_task_set_thread_policy (t, policy));
+  fail_unless (gst_task_get_nice (t) == 5);
+  gst_structure_free (policy);
+  policy = gst_structure_from_string ("thread-policy, nice=20", NULL);
+  fail_if (gst_task_thread_policy_is_valid (policy));
+  fail_if (gst_task_set_thread_policy (t, policy));
+  fail_unless (gst_task_get_nice (t) == 5);
+  gst_structure_free (policy);
+  policy = gst_structure_from_string ("thread-policy, scheduling=other, "
+      "nice=10", NULL);
+  fail_unless (gst_task_thread_policy_is_valid (policy));
+  gst_structure_free (policy);
+
+  /* the thread keeps running when the policy can't be applied */
+  gst_task_set_scheduling (t, GST_TASK_SCHEDULING_OTHER, 0);
+  gst_task_set_nice (t, GST_TASK_NICE_INHERIT);
+  if (!gst_task_set_cpus (t, cpus, G_N_ELEMENTS (cpus)))
+    gst_task_set_cpus (t, NULL, 0);
+
+  g_rec_mutex_init (&task_mutex);
+  gst_task_set_lock (t, &task_mutex);
+
+  g_cond_init (&task_cond);
+  g_mutex_init (&task_lock);
+
+  g_mutex_lock (&task_lock);
+  fail_unless (gst_task_start (t));
+  /* wait for it to spin up */
+  g_cond_wait (&task_cond, &task_lock);
+  g_mutex_unlock (&task_lock);
+
+  fail_unless (gst_task_join (t));
+
+  /* with a nice value the task runs in a thread of its own */
+  gst_task_set_nice (t, 5);
+
+  g_mutex_lock (&task_lock);
+  fail_unless (gst_task_start (t));
+  g_cond_wait (&task_cond, &task_lock);
+  g_mutex_unlock (&task_lock);
+
+  fail_unless (gst_task_join (t));
+  gst_object_unref (t);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_create)
 {
   GstTask *t;
@@ -203,6 +439,10 @@ gst_task_suite (void)
   tcase_add_test (tc_chain, test_lock);
   tcase_add_test (tc_chain, test_lock_start);
   tcase_add_test (tc_chain, test_join);
+  tcase_add_test (tc_chain, test_work_stealing_pool_busy);
+  tcase_add_test (tc_chain, test_work_stealing_pool_push);
+  tcase_add_test (tc_chain, test_work_stealing_pool_task);
+  tcase_add_test (tc_chain, test_thread_policy);
 
   return s;
 }
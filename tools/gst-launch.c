@@ -936,6 +936,46 @@ bus_sync_handler (GstBus * bus, GstMessage * message, gpointer data)
   return GST_BUS_PASS;
 }
 
+/* configure the thread policies given as "TARGET:FIELDS", like
+ * "alsasrc0:scheduling=fifo,priority=50" */
+static gboolean
+set_thread_policies (GstPipeline * pipeline, gchar ** policies)
+{
+  for (; *policies; policies++) {
+    GstStructure *policy;
+    gchar *fields, *target, *desc;
+    gboolean ok;
+
+    fields = strchr (*policies, ':');
+    if (fields == NULL)
+      goto wrong_policy;
+
+    target = g_strndup (*policies, fields - *policies);
+    desc = g_strdup_printf ("thread-policy, %s", fields + 1);
+    policy = gst_structure_from_string (desc, NULL);
+    g_free (desc);
+
+    if (policy) {
+      ok = gst_pipeline_set_thread_policy (pipeline,
+          (*target && strcmp (target, "*") != 0) ? target : NULL, policy);
+      gst_structure_free (policy);
+    } else {
+      ok = FALSE;
+    }
+    g_free (target);
+
+    if (!ok)
+      goto wrong_policy;
+  }
+  return TRUE;
+
+wrong_policy:
+  {
+    g_printerr (_("ERROR: invalid thread policy '%s'.\n"), *policies);
+    return FALSE;
+  }
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -948,6 +988,7 @@ main (int argc, char *argv[])
 #endif
   gchar *savefile = NULL;
   gchar *exclude_args = NULL;
+  gchar **thread_policies = NULL;
 #ifndef GST_DISABLE_OPTION_PARSING
   GOptionEntry options[] = {
     {"tags", 't', 0, G_OPTION_ARG_NONE, &tags,
@@ -966,6 +1007,11 @@ main (int argc, char *argv[])
         N_("Do not install a fault handler"), NULL},
     {"eos-on-shutdown", 'e', 0, G_OPTION_ARG_NONE, &eos_on_shutdown,
         N_("Force EOS on sources before shutting the pipeline down"), NULL},
+    {"thread-policy", 0, 0, G_OPTION_ARG_STRING_ARRAY, &thread_policies,
+          N_("Set the scheduling policy, nice value or CPUs of the streaming "
+              "threads of an element or pad, like "
+              "alsasrc0:scheduling=fifo,priority=50,cpus=2"),
+        N_("TARGET:POLICY")},
 #if 0
     {"index", 'i', 0, G_OPTION_ARG_NONE, &check_index,
         N_("Gather and print index statistics"), NULL},
@@ -1065,6 +1111,15 @@ main (int argc, char *argv[])
       gst_bin_add (GST_BIN (real_pipeline), pipeline);
       pipeline = real_pipeline;
     }
+
+    if (thread_policies) {
+      gboolean ok;
+
+      ok = set_thread_policies (GST_PIPELINE (pipeline), thread_policies);
+      g_strfreev (thread_policies);
+      if (!ok)
+        return 1;
+    }
 #if 0
     if (check_index) {
       /* gst_index_new() creates a null-index, it does not store anything, but